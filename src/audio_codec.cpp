@@ -0,0 +1,182 @@
+#include "audio_codec.h"
+
+#define MULAW_BIAS  0x84
+#define MULAW_CLIP  32635
+
+#define WAV_FORMAT_PCM    1
+#define WAV_FORMAT_MULAW  7
+#define WAV_CANONICAL_HEADER  44
+
+const char* audioEncodingName(AudioEncoding encoding) {
+    return encoding == AudioEncoding::MULAW ? "MULAW" : "LINEAR16";
+}
+
+size_t audioBytesPerSample(AudioEncoding encoding) {
+    return encoding == AudioEncoding::MULAW ? 1 : 2;
+}
+
+// -----------------------------------------------------------------------------
+// G.711 mu-law
+// -----------------------------------------------------------------------------
+
+uint8_t mulawEncode(int16_t sample) {
+    int sign = (sample >> 8) & 0x80;
+    int magnitude = sign ? -(int)sample : sample;
+    if (magnitude > MULAW_CLIP) magnitude = MULAW_CLIP;
+    magnitude += MULAW_BIAS;
+
+    // Segment = position of the highest set bit above the 4-bit mantissa
+    int exponent = 7;
+    for (int mask = 0x4000; (magnitude & mask) == 0 && exponent > 0; mask >>= 1) {
+        exponent--;
+    }
+    int mantissa = (magnitude >> (exponent + 3)) & 0x0F;
+
+    return ~(sign | (exponent << 4) | mantissa);
+}
+
+int16_t mulawDecode(uint8_t code) {
+    code = ~code;
+    int exponent = (code >> 4) & 0x07;
+    int mantissa = code & 0x0F;
+    int magnitude = (((mantissa << 3) + MULAW_BIAS) << exponent) - MULAW_BIAS;
+    return (code & 0x80) ? -magnitude : magnitude;
+}
+
+void mulawEncodeBlock(const int16_t* samples, size_t count, uint8_t* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = mulawEncode(samples[i]);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// WavDecoder
+// -----------------------------------------------------------------------------
+
+static uint16_t readLE16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t readLE32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+WavDecoder::WavDecoder(AudioEncoding fallback, PcmSink sink)
+    : _fallback(fallback)
+    , _encoding(fallback)
+    , _sink(sink)
+{
+    reset();
+}
+
+void WavDecoder::reset() {
+    _encoding = _fallback;
+    _inData = false;
+    _closed = false;
+    _headerLen = 0;
+    _sampleRate = 0;
+    _blockLen = 0;
+    _lowByte = 0;
+    _haveLowByte = false;
+    _samplesDelivered = 0;
+}
+
+bool WavDecoder::write(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length && !_closed; i++) {
+        if (_inData) {
+            decodeByte(data[i]);
+            continue;
+        }
+
+        // Header bytes are held until the data chunk is found
+        _header[_headerLen++] = data[i];
+        parseHeader();
+    }
+    return !_closed;
+}
+
+bool WavDecoder::parseHeader() {
+    if (_headerLen < 4) return false;
+
+    if (memcmp(_header, "RIFF", 4) != 0) {
+        // Headerless: the held bytes are already audio
+        startData(0);
+        return true;
+    }
+
+    // "RIFF" size "WAVE", then chunks of id + size + body
+    size_t pos = 12;
+    while (pos + 8 <= _headerLen) {
+        const uint8_t* chunk = _header + pos;
+        uint32_t size = readLE32(chunk + 4);
+
+        if (memcmp(chunk, "data", 4) == 0) {
+            startData(pos + 8);
+            return true;
+        }
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && pos + 8 + 16 <= _headerLen) {
+            uint16_t format = readLE16(chunk + 8);
+            _sampleRate = readLE32(chunk + 12);
+            if (format == WAV_FORMAT_MULAW) {
+                _encoding = AudioEncoding::MULAW;
+            } else if (format == WAV_FORMAT_PCM) {
+                _encoding = AudioEncoding::LINEAR16;
+            }
+        }
+
+        pos += 8 + size + (size & 1);  // Chunks are word aligned
+    }
+
+    if (_headerLen == MAX_HEADER) {
+        // No data chunk in sight: assume the canonical 44-byte layout
+        Serial.println("[WAV] Header not recognised, assuming 44 bytes");
+        startData(WAV_CANONICAL_HEADER);
+        return true;
+    }
+
+    return false;
+}
+
+void WavDecoder::startData(size_t from) {
+    _inData = true;
+    for (size_t i = from; i < _headerLen && !_closed; i++) {
+        decodeByte(_header[i]);
+    }
+    _headerLen = 0;
+}
+
+bool WavDecoder::decodeByte(uint8_t byte) {
+    if (_encoding == AudioEncoding::MULAW) {
+        return pushSample(mulawDecode(byte));
+    }
+
+    // LINEAR16 little-endian; a sample may straddle two writes
+    if (!_haveLowByte) {
+        _lowByte = byte;
+        _haveLowByte = true;
+        return true;
+    }
+    _haveLowByte = false;
+    return pushSample((int16_t)(_lowByte | (byte << 8)));
+}
+
+bool WavDecoder::pushSample(int16_t sample) {
+    _block[_blockLen++] = sample;
+    if (_blockLen < BLOCK_SAMPLES) return true;
+
+    size_t accepted = _sink(_block, BLOCK_SAMPLES);
+    _samplesDelivered += accepted;
+    _blockLen = 0;
+    if (accepted < BLOCK_SAMPLES) {
+        _closed = true;
+    }
+    return !_closed;
+}
+
+void WavDecoder::flush() {
+    if (_closed || _blockLen == 0) return;
+
+    _samplesDelivered += _sink(_block, _blockLen);
+    _blockLen = 0;
+}
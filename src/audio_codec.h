@@ -0,0 +1,85 @@
+#ifndef AUDIO_CODEC_H
+#define AUDIO_CODEC_H
+
+#include <Arduino.h>
+#include <functional>
+
+// Sample formats understood by Google Cloud STT/TTS that need no codec library
+enum class AudioEncoding {
+    LINEAR16,  // 16-bit PCM, 2 bytes per sample
+    MULAW      // G.711 mu-law, 1 byte per sample (~14-bit dynamic range)
+};
+
+// API name ("LINEAR16" / "MULAW") and wire size of one sample
+const char* audioEncodingName(AudioEncoding encoding);
+size_t audioBytesPerSample(AudioEncoding encoding);
+
+// G.711 mu-law
+uint8_t mulawEncode(int16_t sample);
+int16_t mulawDecode(uint8_t code);
+void mulawEncodeBlock(const int16_t* samples, size_t count, uint8_t* out);
+
+// Streaming decoder stage: encoded bytes in, PCM blocks out to a sink.
+// Other codecs plug in behind the same interface
+class AudioDecoder {
+public:
+    // Returns the number of samples accepted; fewer than offered stops decoding
+    using PcmSink = std::function<size_t(const int16_t* samples, size_t count)>;
+
+    virtual ~AudioDecoder() {}
+
+    virtual void reset() = 0;
+
+    // Feed encoded bytes; false once the sink has stopped accepting
+    virtual bool write(const uint8_t* data, size_t length) = 0;
+
+    // Deliver any buffered partial block (end of stream)
+    virtual void flush() = 0;
+
+    // Samples the sink accepted since reset()
+    virtual size_t getSamplesDelivered() const = 0;
+};
+
+// WAV container as returned by TTS (LINEAR16 or MULAW inside). Walks the
+// RIFF chunks to "data", so extra chunks (fact, LIST) are skipped. Data
+// without a RIFF header is decoded as the fallback encoding
+class WavDecoder : public AudioDecoder {
+public:
+    WavDecoder(AudioEncoding fallback, PcmSink sink);
+
+    void reset() override;
+    bool write(const uint8_t* data, size_t length) override;
+    void flush() override;
+    size_t getSamplesDelivered() const override { return _samplesDelivered; }
+
+    // Format found in the header (fallback until the header is parsed)
+    AudioEncoding getEncoding() const { return _encoding; }
+    uint32_t getSampleRate() const { return _sampleRate; }
+
+private:
+    static const size_t BLOCK_SAMPLES = 512;
+    static const size_t MAX_HEADER = 256;
+
+    bool parseHeader();
+    void startData(size_t from);
+    bool decodeByte(uint8_t byte);
+    bool pushSample(int16_t sample);
+
+    AudioEncoding _fallback;
+    AudioEncoding _encoding;
+    PcmSink _sink;
+
+    bool _inData;
+    bool _closed;
+    uint8_t _header[MAX_HEADER];
+    size_t _headerLen;
+    uint32_t _sampleRate;
+
+    int16_t _block[BLOCK_SAMPLES];
+    size_t _blockLen;
+    uint8_t _lowByte;       // First byte of a LINEAR16 sample split across writes
+    bool _haveLowByte;
+    size_t _samplesDelivered;
+};
+
+#endif // AUDIO_CODEC_H
@@ -0,0 +1,133 @@
+#include "audio_dsp.h"
+#include <cmath>
+
+static inline int16_t saturate16(int32_t value) {
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t)value;
+}
+
+static inline int16_t mulQ15(int16_t sample, int32_t gain) {
+    return (int16_t)((sample * gain + 0x4000) >> 15);
+}
+
+int32_t dspGainFromPercent(int percent) {
+    return (percent * 32768 + 50) / 100;
+}
+
+void dspScaleQ15(const int16_t* in, int16_t* out, size_t count, int32_t gain) {
+    // Gain is at most 1.0 (32768), so the product never leaves int16 range
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int16_t a = in[i], b = in[i + 1], c = in[i + 2], d = in[i + 3];
+        out[i]     = mulQ15(a, gain);
+        out[i + 1] = mulQ15(b, gain);
+        out[i + 2] = mulQ15(c, gain);
+        out[i + 3] = mulQ15(d, gain);
+    }
+    for (; i < count; i++) {
+        out[i] = mulQ15(in[i], gain);
+    }
+}
+
+void dspMixQ15(int16_t* dst, const int16_t* src, size_t count, int32_t gain) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        dst[i]     = saturate16(dst[i]     + mulQ15(src[i],     gain));
+        dst[i + 1] = saturate16(dst[i + 1] + mulQ15(src[i + 1], gain));
+        dst[i + 2] = saturate16(dst[i + 2] + mulQ15(src[i + 2], gain));
+        dst[i + 3] = saturate16(dst[i + 3] + mulQ15(src[i + 3], gain));
+    }
+    for (; i < count; i++) {
+        dst[i] = saturate16(dst[i] + mulQ15(src[i], gain));
+    }
+}
+
+uint64_t dspSumSquares(const int16_t* samples, size_t count) {
+    // Two squares fit in 32 bits (2 * 2^30); widen once per pair
+    uint64_t sum = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int32_t a = samples[i], b = samples[i + 1], c = samples[i + 2], d = samples[i + 3];
+        sum += (uint32_t)(a * a) + (uint32_t)(b * b);
+        sum += (uint32_t)(c * c) + (uint32_t)(d * d);
+    }
+    for (; i < count; i++) {
+        int32_t a = samples[i];
+        sum += (uint32_t)(a * a);
+    }
+    return sum;
+}
+
+float dspRms(const int16_t* samples, size_t count) {
+    if (count == 0) return 0;
+    return sqrtf((float)dspSumSquares(samples, count) / count);
+}
+
+int32_t dspMeanAbs(const int16_t* samples, size_t count) {
+    if (count == 0) return 0;
+
+    int32_t sum = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        sum += abs(samples[i]) + abs(samples[i + 1]) + abs(samples[i + 2]) + abs(samples[i + 3]);
+    }
+    for (; i < count; i++) {
+        sum += abs(samples[i]);
+    }
+    return sum / (int32_t)count;
+}
+
+int32_t dspPeak(const int16_t* samples, size_t count) {
+    int32_t peak = 0;
+    for (size_t i = 0; i < count; i++) {
+        int32_t level = abs(samples[i]);
+        if (level > peak) peak = level;
+    }
+    return peak;
+}
+
+uint32_t dspZeroCrossings(const int16_t* samples, size_t count) {
+    // Neighbours differ in sign exactly when their XOR is negative
+    uint32_t crossings = 0;
+    size_t i = 1;
+    for (; i + 4 <= count; i += 4) {
+        crossings += ((samples[i - 1] ^ samples[i])     < 0)
+                   + ((samples[i]     ^ samples[i + 1]) < 0)
+                   + ((samples[i + 1] ^ samples[i + 2]) < 0)
+                   + ((samples[i + 2] ^ samples[i + 3]) < 0);
+    }
+    for (; i < count; i++) {
+        crossings += (samples[i - 1] ^ samples[i]) < 0;
+    }
+    return crossings;
+}
+
+size_t dspResample(const int16_t* in, size_t inCount, int16_t* out, size_t outMax,
+                   uint32_t inRate, uint32_t outRate) {
+    if (inCount == 0 || outRate == 0) return 0;
+
+    if (inRate == outRate) {
+        size_t n = min(inCount, outMax);
+        memmove(out, in, n * sizeof(int16_t));
+        return n;
+    }
+
+    // Read position in Q16; the fraction is taken as Q15 to stay in 32 bits
+    uint32_t step = ((uint64_t)inRate << 16) / outRate;
+    uint64_t position = 0;
+    size_t written = 0;
+
+    while (written < outMax) {
+        size_t index = position >> 16;
+        if (index >= inCount) break;
+
+        int32_t a = in[index];
+        int32_t b = index + 1 < inCount ? in[index + 1] : a;
+        int32_t frac = (position & 0xFFFF) >> 1;
+        out[written++] = (int16_t)(a + (((b - a) * frac) >> 15));
+
+        position += step;
+    }
+    return written;
+}
@@ -0,0 +1,35 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <Arduino.h>
+
+// Integer sample kernels shared by playback, recording and wake word.
+// All results are bit-exact with the straightforward scalar loops they
+// replace (RMS aside, which differs only by float rounding); the loops are
+// unrolled so the Xtensa core keeps its multiply-accumulate unit busy.
+
+// Volume percentage (0-100) as a Q15 gain; 100% = 32768
+int32_t dspGainFromPercent(int percent);
+
+// out = in * gain (Q15, rounded); in and out may be the same buffer
+void dspScaleQ15(const int16_t* in, int16_t* out, size_t count, int32_t gain);
+
+// dst = saturate(dst + src * gain)
+void dspMixQ15(int16_t* dst, const int16_t* src, size_t count, int32_t gain);
+
+// Sum of x^2 (exact) and the RMS level it gives
+uint64_t dspSumSquares(const int16_t* samples, size_t count);
+float dspRms(const int16_t* samples, size_t count);
+
+// Mean and peak of |x|
+int32_t dspMeanAbs(const int16_t* samples, size_t count);
+int32_t dspPeak(const int16_t* samples, size_t count);
+
+// Sign changes between neighbouring samples (0 counts as positive)
+uint32_t dspZeroCrossings(const int16_t* samples, size_t count);
+
+// Linear-interpolation rate conversion of one block; returns samples written
+size_t dspResample(const int16_t* in, size_t inCount, int16_t* out, size_t outMax,
+                   uint32_t inRate, uint32_t outRate);
+
+#endif // AUDIO_DSP_H
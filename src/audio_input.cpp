@@ -1,19 +1,177 @@
 #include "audio_input.h"
 #include "config.h"
+#include "audio_dsp.h"
 
-#define MAX_RECORDING_SECONDS 10
-#define SAMPLE_BUFFER_SIZE    512
+#define SAMPLE_BUFFER_SIZE    MIC_FRAME_SAMPLES
+
+// Onsets with more sign changes than this are noise bursts (clicks, hiss)
+// rather than the start of voiced speech
+#define VAD_MAX_ONSET_ZCR     0.45f
+
+// The detector measures mean absolute level; for noise that is about 0.8x
+// the RMS other modules report
+#define NOISE_RMS_TO_MEAN_ABS 0.8f
+
+// ---------------------------------------------------------------------------
+// VoiceActivityDetector
+// ---------------------------------------------------------------------------
+
+static uint32_t msToFrames(uint32_t ms, uint32_t sampleRate) {
+    const uint32_t frame = VoiceActivityDetector::FRAME_SAMPLES;
+    return max((ms * sampleRate / 1000 + frame - 1) / frame, (uint32_t)1);
+}
+
+VoiceActivityDetector::VoiceActivityDetector(uint32_t sampleRate, int minLevel, float onsetRatio,
+                                             float releaseRatio, uint32_t onsetMs,
+                                             uint32_t endSilenceMs, uint32_t noSpeechMs)
+    : _sampleRate(sampleRate)
+    , _minLevel(minLevel)
+    , _onsetRatio(onsetRatio)
+    , _releaseRatio(releaseRatio)
+    , _onsetFrames(msToFrames(onsetMs, sampleRate))
+    , _endFrames(msToFrames(endSilenceMs, sampleRate))
+    , _noSpeechSamples((size_t)noSpeechMs * sampleRate / 1000)
+    , _learnedFloor(0)
+{
+    reset();
+}
+
+void VoiceActivityDetector::reset(size_t prerollSamples, int noiseLevel) {
+    _absSum = 0;
+    _crossings = 0;
+    _lastSample = 0;
+    _frameFill = 0;
+    _position = 0;
+
+    // The window starts out as if it had heard the room already: at the
+    // level measured before the recording, else the floor learned in the
+    // last one. Only with neither is it a guess that leaves the threshold
+    // at the minimum level until real blocks replace it
+    int prior = noiseLevel > 0 ? noiseLevel
+              : _learnedFloor > 0 ? _learnedFloor
+              : (int)(_minLevel / _onsetRatio);
+    for (size_t i = 0; i < NOISE_BLOCKS; i++) {
+        _blockMin[i] = prior;
+    }
+    _block = 0;
+    _blockFrames = 0;
+    _floor = prior;
+
+    _level = 0;
+    _activeRun = 0;
+    _quietRun = 0;
+    _runStart = 0;
+    _armAfter = prerollSamples;
+    _inSpeech = false;
+    _hasSpeech = false;
+    _armed = false;
+    _ended = false;
+    _speechStart = 0;
+    _speechEnd = 0;
+}
+
+void VoiceActivityDetector::process(const int16_t* samples, size_t count) {
+    while (count > 0 && !_ended) {
+        size_t n = min(count, FRAME_SAMPLES - _frameFill);
+
+        _absSum += dspMeanAbs(samples, n) * (int32_t)n;
+        _crossings += ((_lastSample ^ samples[0]) < 0) + dspZeroCrossings(samples, n);
+        _lastSample = samples[n - 1];
+
+        _frameFill += n;
+        samples += n;
+        count -= n;
+
+        if (_frameFill == FRAME_SAMPLES) {
+            processFrame();
+            _absSum = 0;
+            _crossings = 0;
+            _frameFill = 0;
+        }
+    }
+}
+
+void VoiceActivityDetector::processFrame() {
+    int level = _absSum / (int32_t)FRAME_SAMPLES;
+    float zcr = (float)_crossings / FRAME_SAMPLES;
+    size_t frameStart = _position;
+    _position += FRAME_SAMPLES;
+    _level = level;
+
+    // Hysteresis: starting speech takes more than continuing it, and only
+    // a voiced frame can start it (fricatives can continue it)
+    float threshold = max((float)_minLevel, _floor * (_inSpeech ? _releaseRatio : _onsetRatio));
+    bool active = level > threshold && (_inSpeech || zcr < VAD_MAX_ONSET_ZCR);
+    trackNoise(level);
+
+    if (active) {
+        _quietRun = 0;
+        if (_activeRun++ == 0) _runStart = frameStart;
+
+        if (!_inSpeech && _activeRun >= _onsetFrames) {
+            _inSpeech = true;
+            if (!_hasSpeech) {
+                _hasSpeech = true;
+                _speechStart = _runStart;
+            }
+        }
+        if (_inSpeech) {
+            _speechEnd = _position;
+            if (frameStart >= _armAfter) _armed = true;
+        }
+    } else {
+        _activeRun = 0;
+
+        // Hangover: speech carries on through pauses shorter than the end
+        if (_inSpeech && ++_quietRun >= _endFrames) {
+            _inSpeech = false;
+            _quietRun = 0;
+            if (_armed) _ended = true;
+        }
+    }
+
+    if (!_armed && !_inSpeech && _position >= _armAfter + _noSpeechSamples) {
+        _ended = true;
+    }
+}
+
+void VoiceActivityDetector::trackNoise(int level) {
+    _blockMin[_block] = min(_blockMin[_block], level);
+
+    int lowest = _blockMin[0];
+    for (size_t i = 1; i < NOISE_BLOCKS; i++) {
+        lowest = min(lowest, _blockMin[i]);
+    }
+    // Smoothed, so one quiet frame does not drop the threshold at once
+    _floor += (lowest - _floor) * 0.3f;
+
+    if (++_blockFrames >= BLOCK_FRAMES) {
+        _blockFrames = 0;
+        _learnedFloor = (int)_floor;
+        _block = (_block + 1) % NOISE_BLOCKS;
+        _blockMin[_block] = INT32_MAX;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// AudioInput
+// ---------------------------------------------------------------------------
 
 AudioInput::AudioInput()
     : _initialized(false)
     , _recording(false)
-    , _buffer(nullptr)
-    , _bufferSize(0)
-    , _bufferPos(0)
+    , _bufferFull(false)
+    , _speechFrom(0)
+    , _speechTo(0)
+    , _releasedPos(0)
     , _readBuffer(nullptr)
     , _readBufferSize(SAMPLE_BUFFER_SIZE)
+    , _mic(nullptr)
+    , _subscriberId(-1)
     , _callback(nullptr)
-    , _lastSoundTime(0)
+    , _vad(I2S_MIC_SAMPLE_RATE, VAD_THRESHOLD, VAD_ONSET_RATIO, VAD_RELEASE_RATIO,
+           VAD_ONSET_MS, VAD_END_SILENCE_MS, VAD_NO_SPEECH_MS)
+    , _trimPad(I2S_MIC_SAMPLE_RATE * VAD_TRIM_PAD_MS / 1000)
     , _avgLevel(0)
 {
 }
@@ -22,27 +180,31 @@ AudioInput::~AudioInput() {
     end();
 }
 
-bool AudioInput::begin() {
+bool AudioInput::begin(MicCapture& mic) {
     if (_initialized) return true;
 
-    // Allocate buffers in PSRAM if available
-    _bufferSize = I2S_MIC_SAMPLE_RATE * MAX_RECORDING_SECONDS;
+    // Recording memory grows in blocks as the user talks
+    if (!_capture.begin(I2S_MIC_SAMPLE_RATE * RECORDING_MAX_SECONDS, CAPTURE_RESERVE_BLOCKS)) {
+        Serial.println("[AudioInput] Failed to allocate capture buffer");
+        return false;
+    }
 
     if (psramFound()) {
-        _buffer = (int16_t*)ps_malloc(_bufferSize * sizeof(int16_t));
         _readBuffer = (int16_t*)ps_malloc(_readBufferSize * sizeof(int16_t));
     } else {
-        _buffer = (int16_t*)malloc(_bufferSize * sizeof(int16_t));
         _readBuffer = (int16_t*)malloc(_readBufferSize * sizeof(int16_t));
     }
 
-    if (!_buffer || !_readBuffer) {
+    if (!_readBuffer || !_captureRing.begin(AUDIO_CAPTURE_RING_SAMPLES)) {
         Serial.println("[AudioInput] Failed to allocate buffers");
         return false;
     }
 
-    if (!configureI2S()) {
-        Serial.println("[AudioInput] Failed to configure I2S");
+    // The ring absorbs frames while loop() is busy, so slow redraws drop nothing
+    _mic = &mic;
+    _subscriberId = mic.subscribe(&_captureRing);
+    if (_subscriberId < 0) {
+        Serial.println("[AudioInput] No free mic subscriber slot");
         return false;
     }
 
@@ -53,138 +215,127 @@ bool AudioInput::begin() {
 
 void AudioInput::end() {
     if (_initialized) {
-        i2s_driver_uninstall(I2S_MIC_PORT);
+        _mic->setActive(_subscriberId, false);
 
-        if (_buffer) {
-            free(_buffer);
-            _buffer = nullptr;
-        }
+        _capture.end();
         if (_readBuffer) {
             free(_readBuffer);
             _readBuffer = nullptr;
         }
+        _captureRing.release();
 
         _initialized = false;
     }
 }
 
-bool AudioInput::configureI2S() {
-    i2s_config_t i2s_config = {
-        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
-        .sample_rate = I2S_MIC_SAMPLE_RATE,
-        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 8,
-        .dma_buf_len = 256,
-        .use_apll = false,
-        .tx_desc_auto_clear = false,
-        .fixed_mclk = 0
-    };
-
-    i2s_pin_config_t pin_config = {
-        .bck_io_num = I2S_MIC_SCK_PIN,
-        .ws_io_num = I2S_MIC_WS_PIN,
-        .data_out_num = I2S_PIN_NO_CHANGE,
-        .data_in_num = I2S_MIC_SD_PIN
-    };
-
-    esp_err_t err = i2s_driver_install(I2S_MIC_PORT, &i2s_config, 0, NULL);
-    if (err != ESP_OK) {
-        Serial.printf("[AudioInput] i2s_driver_install failed: %d\n", err);
-        return false;
-    }
-
-    err = i2s_set_pin(I2S_MIC_PORT, &pin_config);
-    if (err != ESP_OK) {
-        Serial.printf("[AudioInput] i2s_set_pin failed: %d\n", err);
-        i2s_driver_uninstall(I2S_MIC_PORT);
-        return false;
-    }
-
-    i2s_zero_dma_buffer(I2S_MIC_PORT);
-
-    return true;
-}
-
-void AudioInput::startRecording() {
+void AudioInput::startRecording(size_t prerollSamples, float noiseRms) {
     if (!_initialized) return;
 
     clearBuffer();
+    _captureRing.clear();
+    _bufferFull = false;
+    _vad.reset(prerollSamples, (int)(noiseRms * NOISE_RMS_TO_MEAN_ABS));
     _recording = true;
-    _lastSoundTime = millis();
 
-    Serial.println("[AudioInput] Recording started");
+    _mic->setActive(_subscriberId, true, prerollSamples);
+
+    Serial.printf("[AudioInput] Recording started (%d samples pre-roll)\n", prerollSamples);
 }
 
 void AudioInput::stopRecording() {
+    if (_mic) {
+        _mic->setActive(_subscriberId, false);
+    }
+
+    // Keep whatever the capture task had already queued
+    if (_recording) {
+        process();
+    }
+
     _recording = false;
-    Serial.printf("[AudioInput] Recording stopped, %d samples\n", _bufferPos);
+    Serial.printf("[AudioInput] Recording stopped, %d samples, %d kept as speech (noise floor %d)\n",
+                  _capture.size(), getBufferSize(), _vad.getNoiseFloor());
+    if (getDroppedSamples() > 0) {
+        Serial.printf("[AudioInput] %d samples dropped\n", getDroppedSamples());
+    }
+}
+
+uint32_t AudioInput::getDroppedSamples() const {
+    return _mic ? _mic->getDroppedSamples(_subscriberId) : 0;
 }
 
 void AudioInput::clearBuffer() {
-    _bufferPos = 0;
-    memset(_buffer, 0, _bufferSize * sizeof(int16_t));
+    // No need to zero anything: only appended samples are ever read
+    _capture.clear();
+    _speechFrom = 0;
+    _speechTo = 0;
+    _releasedPos = 0;
 }
 
 void AudioInput::process() {
     if (!_initialized) return;
 
-    size_t bytesRead = 0;
-    esp_err_t result = i2s_read(
-        I2S_MIC_PORT,
-        _readBuffer,
-        _readBufferSize * sizeof(int16_t),
-        &bytesRead,
-        pdMS_TO_TICKS(10)
-    );
-
-    if (result != ESP_OK || bytesRead == 0) return;
-
-    size_t samplesRead = bytesRead / sizeof(int16_t);
-
-    // Calculate average level for VAD
-    int32_t sum = 0;
-    for (size_t i = 0; i < samplesRead; i++) {
-        sum += abs(_readBuffer[i]);
+    size_t samplesRead;
+    while ((samplesRead = _captureRing.read(_readBuffer, _readBufferSize)) > 0) {
+        processFrame(samplesRead);
     }
-    _avgLevel = sum / samplesRead;
+}
 
-    // Copy to main buffer if recording
-    if (_recording) {
-        size_t spaceLeft = _bufferSize - _bufferPos;
-        size_t toCopy = min(samplesRead, spaceLeft);
+void AudioInput::processFrame(size_t samplesRead) {
+    // Calculate average level for VAD
+    _avgLevel = dspMeanAbs(_readBuffer, samplesRead);
 
-        if (toCopy > 0) {
-            memcpy(_buffer + _bufferPos, _readBuffer, toCopy * sizeof(int16_t));
-            _bufferPos += toCopy;
+    // Append to the capture if recording
+    if (_recording && !_bufferFull) {
+        size_t copied = _capture.append(_readBuffer, samplesRead);
+        if (copied > 0) {
+            _vad.process(_readBuffer, copied);
         }
 
-        // Auto-stop if buffer full
-        if (_bufferPos >= _bufferSize) {
-            stopRecording();
+        // Stop capturing at the length limit, or if PSRAM ran out for the
+        // next block; detectVoice() then ends the turn
+        if (copied < samplesRead || _capture.isFull()) {
+            _mic->setActive(_subscriberId, false);
+            _bufferFull = true;
+            Serial.printf("[AudioInput] %s, recording stopped, %d samples\n",
+                          _capture.isFull() ? "Buffer full" : "Out of capture memory", _capture.size());
         }
-    }
 
-    // Call callback if set
-    if (_callback) {
-        _callback(_readBuffer, samplesRead);
+        updateSpeechRange();
+        releaseSpeech();
     }
 }
 
-bool AudioInput::detectVoice() {
-    if (_avgLevel > VAD_THRESHOLD) {
-        _lastSoundTime = millis();
-        return true;
+void AudioInput::updateSpeechRange() {
+    if (!_vad.hasSpeech()) {
+        _speechFrom = 0;
+        _speechTo = 0;
+        return;
     }
 
-    // Check if silence duration exceeded
-    if (_recording && (millis() - _lastSoundTime > VAD_SILENCE_MS)) {
-        return false;  // Silence detected, should stop recording
+    // VAD positions count from the start of the capture
+    size_t start = _vad.getSpeechStart();
+    _speechFrom = start > _trimPad ? start - _trimPad : 0;
+    _speechTo = min(_vad.getSpeechEnd() + _trimPad, _capture.size());
+}
+
+void AudioInput::releaseSpeech() {
+    size_t from = max(_releasedPos, _speechFrom);
+    if (_speechTo <= from) return;
+
+    // Handed over a block at a time; the capture is not contiguous
+    while (_callback && from < _speechTo) {
+        size_t count;
+        const int16_t* samples = _capture.span(from, count);
+        count = min(count, _speechTo - from);
+        _callback(samples, count);
+        from += count;
     }
+    _releasedPos = _speechTo;
+}
 
-    return _recording;  // Continue if still recording
+bool AudioInput::detectVoice() {
+    return _recording && !_bufferFull && !_vad.isEnded();
 }
 
 int AudioInput::getAverageLevel() {
@@ -2,59 +2,166 @@
 #define AUDIO_INPUT_H
 
 #include <Arduino.h>
-#include <driver/i2s.h>
 #include <functional>
+#include "mic_capture.h"
+#include "ring_buffer.h"
+#include "capture_buffer.h"
+
+// Finds where an utterance starts and ends in recorded audio. The speech
+// threshold sits a ratio above the room's noise floor, the smallest frame
+// level of the last two seconds (minimum statistics: the pauses between
+// words keep it at the noise even while the user talks), and never below a
+// fixed minimum. Speech starts after a short run of loud, voiced frames and
+// ends after a stretch of quiet ones. Speech in the pre-roll counts for
+// trimming, but the end of the utterance is only armed by speech after it,
+// so a pause after the wake word does not end the turn.
+class VoiceActivityDetector {
+public:
+    static const size_t FRAME_SAMPLES = 512;   // 32 ms at 16 kHz
+
+    VoiceActivityDetector(uint32_t sampleRate, int minLevel, float onsetRatio, float releaseRatio,
+                          uint32_t onsetMs, uint32_t endSilenceMs, uint32_t noSpeechMs);
+
+    // New utterance; the first prerollSamples were captured before it began.
+    // noiseLevel is the room's mean absolute sample level if it was measured
+    // beforehand (0: use the floor learned in the last utterance)
+    void reset(size_t prerollSamples = 0, int noiseLevel = 0);
+
+    // Samples in any block size (frames are assembled internally)
+    void process(const int16_t* samples, size_t count);
+
+    bool inSpeech() const { return _inSpeech; }
+    bool hasSpeech() const { return _hasSpeech; }
+
+    // End of utterance, or nobody spoke after the pre-roll within noSpeechMs
+    bool isEnded() const { return _ended; }
+
+    // Sample positions (from reset) of the first and past the last speech frame
+    size_t getSpeechStart() const { return _speechStart; }
+    size_t getSpeechEnd() const { return _speechEnd; }
+
+    int getNoiseFloor() const { return (int)_floor; }
+    int getLevel() const { return _level; }
+
+private:
+    static const size_t NOISE_BLOCKS = 4;        // Minimum tracked over 4 blocks
+    static const uint32_t BLOCK_FRAMES = 16;     // of ~0.5 s each
+
+    void processFrame();
+    void trackNoise(int level);
+
+    uint32_t _sampleRate;
+    int _minLevel;
+    float _onsetRatio;
+    float _releaseRatio;
+    uint32_t _onsetFrames;
+    uint32_t _endFrames;
+    size_t _noSpeechSamples;
+
+    // Frame being assembled
+    int32_t _absSum;
+    uint32_t _crossings;
+    int16_t _lastSample;
+    size_t _frameFill;
+    size_t _position;   // Samples in completed frames
+
+    // Noise floor
+    int _blockMin[NOISE_BLOCKS];
+    size_t _block;
+    uint32_t _blockFrames;
+    float _floor;
+    int _learnedFloor;  // Kept across reset(); 0 until a block has been heard
+
+    // Endpointing
+    int _level;
+    uint32_t _activeRun;
+    uint32_t _quietRun;
+    size_t _runStart;
+    size_t _armAfter;
+    bool _inSpeech;
+    bool _hasSpeech;
+    bool _armed;
+    bool _ended;
+    size_t _speechStart;
+    size_t _speechEnd;
+};
 
 class AudioInput {
 public:
-    using AudioCallback = std::function<void(int16_t* samples, size_t count)>;
+    using AudioCallback = std::function<void(const int16_t* samples, size_t count)>;
 
     AudioInput();
     ~AudioInput();
 
-    bool begin();
+    // Records from the shared mic service
+    bool begin(MicCapture& mic);
     void end();
 
     // Recording control
-    void startRecording();
+    // prerollSamples of audio from just before the call are kept at the start.
+    // noiseRms is the room's background level if something was measuring it
+    // (0 = unknown); it lets end of speech work from the first frame
+    void startRecording(size_t prerollSamples = 0, float noiseRms = 0);
     void stopRecording();
     bool isRecording() const { return _recording; }
 
-    // Get audio buffer (call after stopRecording)
-    int16_t* getBuffer() const { return _buffer; }
-    size_t getBufferSize() const { return _bufferPos; }
+    // Recorded speech (call after stopRecording): getBufferSize() samples
+    // from getSpeechOffset() in the capture. Leading and trailing silence
+    // are trimmed off, keeping VAD_TRIM_PAD_MS either side
+    const CaptureBuffer& getCapture() const { return _capture; }
+    size_t getSpeechOffset() const { return _speechFrom; }
+    size_t getBufferSize() const { return _speechTo - _speechFrom; }
 
-    // Clear buffer
+    // Drops the recording and returns its memory beyond the reserve
+    // (call once the audio has been transcribed)
     void clearBuffer();
 
     // Voice Activity Detection
-    bool detectVoice();  // Returns true if voice detected
+    bool detectVoice();  // False once the utterance has ended (or the buffer is full)
     int getAverageLevel();  // Get current audio level
+    const VoiceActivityDetector& getVad() const { return _vad; }
 
-    // Callback for real-time audio processing
+    // Receives the recording as it is confirmed to be speech (runs from
+    // process()): leading silence is never passed on, and a pause is only
+    // passed on once speech resumes, so trailing silence is never sent
     void setAudioCallback(AudioCallback callback) { _callback = callback; }
 
-    // Process audio (call in loop when recording)
+    // Drain audio queued by the capture task (call in loop when recording)
     void process();
 
+    // Samples lost because process() fell more than a ring behind
+    uint32_t getDroppedSamples() const;
+
 private:
     bool _initialized;
     bool _recording;
 
-    int16_t* _buffer;
-    size_t _bufferSize;
-    size_t _bufferPos;
+    CaptureBuffer _capture;
+    bool _bufferFull;
+
+    // Trimmed speech in _capture, and how much the callback has been given
+    size_t _speechFrom;
+    size_t _speechTo;
+    size_t _releasedPos;
 
     int16_t* _readBuffer;
     size_t _readBufferSize;
 
+    // Frames queued by the mic capture task while recording
+    MicCapture* _mic;
+    int _subscriberId;
+    SpscRing<int16_t> _captureRing;
+
     AudioCallback _callback;
 
     // VAD
-    uint32_t _lastSoundTime;
+    VoiceActivityDetector _vad;
+    size_t _trimPad;
     int _avgLevel;
 
-    bool configureI2S();
+    void processFrame(size_t samplesRead);
+    void updateSpeechRange();
+    void releaseSpeech();
 };
 
 #endif // AUDIO_INPUT_H
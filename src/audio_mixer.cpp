@@ -0,0 +1,268 @@
+#include "audio_mixer.h"
+#include "audio_dsp.h"
+
+#define UNITY_GAIN  32768
+
+AudioMixer::AudioMixer()
+    : _lock(portMUX_INITIALIZER_UNLOCKED)
+    , _arena(nullptr)
+    , _masterGain(UNITY_GAIN)
+    , _duckGain(UNITY_GAIN)
+    , _duckStep(UNITY_GAIN)
+{
+    for (int i = 0; i < (int)Voice::COUNT; i++) {
+        VoiceState& v = _voices[i];
+        v.head = 0;
+        v.queued = 0;
+        v.position = 0;
+        v.stream = nullptr;
+        v.prebuffer = 0;
+        v.streamStarted = false;
+        v.ending = false;
+        v.duck = UNITY_GAIN;
+    }
+}
+
+void AudioMixer::setDuck(int32_t gain, int32_t rampStep) {
+    _duckGain = gain;
+    _duckStep = rampStep > 0 ? rampStep : UNITY_GAIN;
+}
+
+bool AudioMixer::queue(Voice voice, const int16_t* samples, size_t count, bool owned) {
+    VoiceState& v = _voices[(int)voice];
+
+    portENTER_CRITICAL(&_lock);
+    bool queued = samples && count > 0 && v.queued < QUEUE_LEN;
+    if (queued) {
+        Clip& clip = v.clips[(v.head + v.queued) % QUEUE_LEN];
+        clip.samples = samples;
+        clip.count = count;
+        clip.owned = owned;
+        v.queued++;
+        v.ending = false;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (!queued && owned && samples) {
+        arenaFree(_arena, (void*)samples);
+    }
+    return queued;
+}
+
+void AudioMixer::attachStream(Voice voice, SpscRing<int16_t>* ring, size_t prebuffer) {
+    VoiceState& v = _voices[(int)voice];
+
+    portENTER_CRITICAL(&_lock);
+    v.stream = ring;
+    v.prebuffer = prebuffer;
+    v.streamStarted = false;
+    v.ending = false;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void AudioMixer::end(Voice voice) {
+    portENTER_CRITICAL(&_lock);
+    _voices[(int)voice].ending = true;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void AudioMixer::stop(Voice voice) {
+    VoiceState& v = _voices[(int)voice];
+    Clip dropped[QUEUE_LEN];
+    size_t count = 0;
+
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < v.queued; i++) {
+        dropped[count++] = v.clips[(v.head + i) % QUEUE_LEN];
+    }
+    v.head = 0;
+    v.queued = 0;
+    v.position = 0;
+    v.stream = nullptr;
+    v.streamStarted = false;
+    v.ending = false;
+    portEXIT_CRITICAL(&_lock);
+
+    for (size_t i = 0; i < count; i++) {
+        if (dropped[i].owned) {
+            arenaFree(_arena, (void*)dropped[i].samples);
+        }
+    }
+}
+
+bool AudioMixer::isActive(Voice voice) const {
+    const VoiceState& v = _voices[(int)voice];
+
+    portENTER_CRITICAL(&_lock);
+    bool active = v.queued > 0 || v.stream != nullptr;
+    portEXIT_CRITICAL(&_lock);
+    return active;
+}
+
+size_t AudioMixer::getQueued(Voice voice) const {
+    portENTER_CRITICAL(&_lock);
+    size_t queued = _voices[(int)voice].queued;
+    portEXIT_CRITICAL(&_lock);
+    return queued;
+}
+
+bool AudioMixer::isWaiting() const {
+    for (int i = 0; i < (int)Voice::COUNT; i++) {
+        if (_voices[i].stream) return true;
+    }
+    return false;
+}
+
+size_t AudioMixer::available(int index, size_t limit) {
+    VoiceState& v = _voices[index];
+
+    if (v.stream) {
+        size_t buffered = v.stream->available();
+        if (!v.streamStarted) {
+            // The end flag also starts a stream that never reached prebuffer
+            if (buffered < v.prebuffer && !v.ending) return 0;
+            v.streamStarted = true;
+        }
+        return min(buffered, limit);
+    }
+
+    size_t total = 0;
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < v.queued && total < limit; i++) {
+        total += v.clips[(v.head + i) % QUEUE_LEN].count;
+    }
+    if (v.queued > 0) total -= v.position;
+    portEXIT_CRITICAL(&_lock);
+
+    return min(total, limit);
+}
+
+bool AudioMixer::ducked(int index) const {
+    for (int i = index + 1; i < (int)Voice::COUNT; i++) {
+        if (_voices[i].queued > 0 || _voices[i].stream) return true;
+    }
+    return false;
+}
+
+size_t AudioMixer::render(int16_t* out, size_t count) {
+    // The block is as long as the voice with the most audio ready
+    size_t total = 0;
+    for (int i = 0; i < (int)Voice::COUNT; i++) {
+        total = max(total, available(i, count));
+    }
+
+    if (total > 0) {
+        memset(out, 0, total * sizeof(int16_t));
+
+        for (size_t offset = 0; offset < total; offset += MIX_BLOCK) {
+            size_t block = min(MIX_BLOCK, total - offset);
+
+            for (int i = 0; i < (int)Voice::COUNT; i++) {
+                VoiceState& v = _voices[i];
+                if (v.queued == 0 && !v.stream) {
+                    v.duck = UNITY_GAIN;
+                    continue;
+                }
+
+                // Step the duck gain toward its target once per block
+                int32_t target = ducked(i) ? _duckGain : UNITY_GAIN;
+                if (v.duck < target) {
+                    v.duck = min(target, v.duck + _duckStep);
+                } else if (v.duck > target) {
+                    v.duck = max(target, v.duck - _duckStep);
+                }
+
+                int32_t gain = (int32_t)(((int64_t)_masterGain * v.duck) >> 15);
+                if (v.stream) {
+                    if (v.streamStarted) mixStream(i, out + offset, block, gain);
+                } else {
+                    mixClips(i, out + offset, block, gain);
+                }
+            }
+        }
+    }
+
+    // Done callbacks run last, outside the lock, so they may queue more audio
+    bool done[(int)Voice::COUNT];
+    for (int i = 0; i < (int)Voice::COUNT; i++) {
+        done[i] = checkDone(i);
+    }
+    for (int i = 0; i < (int)Voice::COUNT; i++) {
+        if (done[i] && _doneCallback) _doneCallback((Voice)i);
+    }
+    return total;
+}
+
+size_t AudioMixer::mixClips(int index, int16_t* out, size_t count, int32_t gain) {
+    VoiceState& v = _voices[index];
+    size_t mixed = 0;
+
+    while (mixed < count) {
+        portENTER_CRITICAL(&_lock);
+        bool empty = v.queued == 0;
+        Clip clip = v.clips[v.head];
+        size_t position = v.position;
+        portEXIT_CRITICAL(&_lock);
+        if (empty) break;
+
+        // Back to back: the next clip continues in the same block
+        size_t n = min(count - mixed, clip.count - position);
+        dspMixQ15(out + mixed, clip.samples + position, n, gain);
+        mixed += n;
+        position += n;
+
+        if (position >= clip.count) {
+            popClip(index);
+        } else {
+            v.position = position;
+        }
+    }
+    return mixed;
+}
+
+size_t AudioMixer::mixStream(int index, int16_t* out, size_t count, int32_t gain) {
+    SpscRing<int16_t>* ring = _voices[index].stream;
+    size_t mixed = 0;
+
+    // Two runs at most: up to the end of the ring, then from its start
+    while (mixed < count) {
+        size_t run;
+        const int16_t* data = ring->peek(run);
+        if (run == 0) break;
+
+        run = min(run, count - mixed);
+        dspMixQ15(out + mixed, data, run, gain);
+        ring->consume(run);
+        mixed += run;
+    }
+    return mixed;
+}
+
+void AudioMixer::popClip(int index) {
+    VoiceState& v = _voices[index];
+
+    portENTER_CRITICAL(&_lock);
+    Clip finished = v.clips[v.head];
+    v.head = (v.head + 1) % QUEUE_LEN;
+    v.queued--;
+    v.position = 0;
+    portEXIT_CRITICAL(&_lock);
+
+    if (finished.owned) {
+        arenaFree(_arena, (void*)finished.samples);
+    }
+}
+
+bool AudioMixer::checkDone(int index) {
+    VoiceState& v = _voices[index];
+
+    portENTER_CRITICAL(&_lock);
+    bool done = v.ending && v.queued == 0 && (!v.stream || v.stream->available() == 0);
+    if (done) {
+        v.ending = false;
+        v.stream = nullptr;
+        v.streamStarted = false;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return done;
+}
@@ -0,0 +1,104 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <Arduino.h>
+#include <functional>
+#include "ring_buffer.h"
+#include "memory_arena.h"
+
+// Output voices, lowest priority first. A voice that ducks lowers every
+// voice below it while it plays
+enum class Voice {
+    SPEECH,   // TTS stream or clips, cached replies
+    NOTIFY,   // Blocking play()/playTone() sounds (ducks speech)
+    CUE,      // Sound bank cues (ducks speech and notifications)
+    COUNT
+};
+
+// Mixes the output voices into one block for the playback task. Each voice
+// plays a queue of clips back to back (a clip ending mid-block continues
+// with the next one in the same block) or a streaming ring. Clips are
+// queued from any task; everything that removes audio (finishing a clip,
+// stop) runs in the task calling render(), so the mix never reads freed
+// memory.
+class AudioMixer {
+public:
+    // Called from render() when a voice that was end()ed has played out
+    using DoneCallback = std::function<void(Voice voice)>;
+
+    static const size_t QUEUE_LEN = 4;  // Clips per voice
+
+    AudioMixer();
+
+    // Owned clips are returned to the arena (or heap) when they finish
+    void setArena(TurnArena* arena) { _arena = arena; }
+    void setDoneCallback(DoneCallback callback) { _doneCallback = callback; }
+
+    // Q15 gains: master volume, and the level a ducked voice drops to.
+    // Ducking ramps by rampStep per MIX_BLOCK samples to avoid clicks
+    void setMasterGain(int32_t gain) { _masterGain = gain; }
+    void setDuck(int32_t gain, int32_t rampStep);
+
+    // Append a clip; false when the voice's queue is full. Owned clips that
+    // can't be queued are released here
+    bool queue(Voice voice, const int16_t* samples, size_t count, bool owned);
+
+    // Play from a ring instead of clips once prebuffer samples are in it
+    void attachStream(Voice voice, SpscRing<int16_t>* ring, size_t prebuffer);
+
+    // No more audio for this voice: DoneCallback fires once it has played out
+    void end(Voice voice);
+
+    // Drop the voice's clips and stream (render task only)
+    void stop(Voice voice);
+
+    bool isActive(Voice voice) const;
+    bool isStreaming(Voice voice) const { return _voices[(int)voice].stream != nullptr; }
+    bool isEnding(Voice voice) const { return _voices[(int)voice].ending; }
+    size_t getQueued(Voice voice) const;
+
+    // True while a stream is buffering or underrun (poll sooner than idle)
+    bool isWaiting() const;
+
+    // Mix up to count samples into out; returns the samples produced (0 when
+    // every voice is idle). Stream voices never get padded with silence
+    size_t render(int16_t* out, size_t count);
+
+    static const size_t MIX_BLOCK = 128;  // Gain ramp granularity (8 ms at 16 kHz)
+
+private:
+    struct Clip {
+        const int16_t* samples;
+        size_t count;
+        bool owned;
+    };
+
+    struct VoiceState {
+        Clip clips[QUEUE_LEN];
+        size_t head;          // Index of the playing clip
+        size_t queued;        // Clips in the queue, including the playing one
+        size_t position;      // Samples played of the head clip
+        SpscRing<int16_t>* stream;
+        size_t prebuffer;
+        bool streamStarted;
+        bool ending;
+        int32_t duck;         // Current duck gain (Q15), ramps toward the target
+    };
+
+    size_t available(int index, size_t limit);
+    bool ducked(int index) const;
+    size_t mixClips(int index, int16_t* out, size_t count, int32_t gain);
+    size_t mixStream(int index, int16_t* out, size_t count, int32_t gain);
+    void popClip(int index);
+    bool checkDone(int index);
+
+    VoiceState _voices[(int)Voice::COUNT];
+    mutable portMUX_TYPE _lock;
+    TurnArena* _arena;
+    DoneCallback _doneCallback;
+    int32_t _masterGain;
+    int32_t _duckGain;
+    int32_t _duckStep;
+};
+
+#endif // AUDIO_MIXER_H
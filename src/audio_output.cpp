@@ -1,16 +1,31 @@
 #include "audio_output.h"
 #include "config.h"
+#include "audio_dsp.h"
+#include "metrics.h"
 #include <cmath>
 
+#define PLAYBACK_TASK_STACK  4096
+#define PLAYBACK_IDLE_MS     50     // Idle wait between wake-ups
+#define PLAYBACK_POLL_MS     5      // Wait while a stream is buffering or underrun
+#define PLAYBACK_WAIT_MS     500    // Longest stop()/play() waits on the task
+
+#define VOICE_BIT(voice)  (1u << (int)(voice))
+
 AudioOutput::AudioOutput()
     : _initialized(false)
-    , _playing(false)
     , _volume(DEFAULT_VOLUME)
-    , _stopRequested(false)
-    , _asyncBuffer(nullptr)
-    , _asyncSamples(0)
-    , _asyncPosition(0)
+    , _task(nullptr)
+    , _taskRunning(false)
+    , _lock(portMUX_INITIALIZER_UNLOCKED)
+    , _stopMask(0)
+    , _levelPos(0)
+    , _underrunArmed(false)
+    , _arena(nullptr)
+    , _dmaPool(nullptr)
 {
+    _mixer.setMasterGain(dspGainFromPercent(DEFAULT_VOLUME));
+    _mixer.setDoneCallback([this](Voice voice) { voiceDone(voice); });
+    memset(_levels, 0, sizeof(_levels));
 }
 
 AudioOutput::~AudioOutput() {
@@ -25,6 +40,27 @@ bool AudioOutput::begin() {
         return false;
     }
 
+    // Cues are rendered once here instead of synthesized on every beep
+    _sounds.begin(I2S_SPK_SAMPLE_RATE);
+
+    // Speech dips under cues over AUDIO_DUCK_RAMP_MS, one mix block at a time
+    int32_t duckGain = dspGainFromPercent(AUDIO_DUCK_PERCENT);
+    size_t rampBlocks = max((size_t)1, (size_t)I2S_SPK_SAMPLE_RATE * AUDIO_DUCK_RAMP_MS / 1000
+                                                / AudioMixer::MIX_BLOCK);
+    _mixer.setDuck(duckGain, (dspGainFromPercent(100) - duckGain) / rampBlocks);
+
+    // Playback gets its own task so display redraws and network calls in
+    // loop() can no longer starve the DMA queue
+    _taskRunning = true;
+    if (xTaskCreatePinnedToCore(playbackTask, "audio_out", PLAYBACK_TASK_STACK, this,
+                                AUDIO_PLAYBACK_TASK_PRIO, &_task, AUDIO_TASK_CORE) != pdPASS) {
+        Serial.println("[AudioOutput] Failed to start playback task");
+        _taskRunning = false;
+        _task = nullptr;
+        i2s_driver_uninstall(I2S_SPK_PORT);
+        return false;
+    }
+
     _initialized = true;
     Serial.println("[AudioOutput] Initialized");
     return true;
@@ -32,13 +68,115 @@ bool AudioOutput::begin() {
 
 void AudioOutput::end() {
     if (_initialized) {
-        stop();
+        _taskRunning = false;
+        wakeTask();
+        uint32_t start = millis();
+        while (_task && millis() - start < PLAYBACK_WAIT_MS) {
+            delay(5);
+        }
+
         i2s_driver_uninstall(I2S_SPK_PORT);
         _initialized = false;
     }
-    if (_asyncBuffer) {
-        free(_asyncBuffer);
-        _asyncBuffer = nullptr;
+
+    // The task is gone, so the voices can be dropped from here
+    for (int i = 0; i < (int)Voice::COUNT; i++) {
+        _mixer.stop((Voice)i);
+    }
+    _streamRing.release();
+    _sounds.end();
+}
+
+void AudioOutput::setArena(TurnArena* arena) {
+    _arena = arena;
+    _mixer.setArena(arena);
+}
+
+void AudioOutput::wakeTask() {
+    if (_task) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+void AudioOutput::playbackTask(void* param) {
+    AudioOutput* output = (AudioOutput*)param;
+
+    Serial.println("[AudioOutput] Playback task started");
+
+    while (output->_taskRunning) {
+        output->service();
+    }
+
+    Serial.println("[AudioOutput] Playback task stopped");
+    output->_task = nullptr;
+    vTaskDelete(NULL);
+}
+
+void AudioOutput::service() {
+    uint32_t stopMask = _stopMask;
+    if (stopMask) {
+        i2s_zero_dma_buffer(I2S_SPK_PORT);
+        for (int i = 0; i < (int)Voice::COUNT; i++) {
+            if (stopMask & VOICE_BIT(i)) _mixer.stop((Voice)i);
+        }
+        portENTER_CRITICAL(&_lock);
+        _stopMask &= ~stopMask;
+        portEXIT_CRITICAL(&_lock);
+        _underrunArmed = false;
+        return;
+    }
+
+    size_t samples = _mixer.render(_chunk, CHUNK_SAMPLES);
+    if (samples == 0) {
+        if (_underrunArmed && !_mixer.isEnding(Voice::SPEECH)) {
+            metricsCount(Counter::I2S_UNDERRUN);
+            _underrunArmed = false;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(_mixer.isWaiting() ? PLAYBACK_POLL_MS : PLAYBACK_IDLE_MS));
+        return;
+    }
+
+    // Blocking is fine, this task does nothing else; the DMA queue paces it
+    size_t bytesWritten = 0;
+    esp_err_t err = i2s_write(I2S_SPK_PORT, _chunk, samples * sizeof(int16_t),
+                              &bytesWritten, portMAX_DELAY);
+    if (err != ESP_OK) {
+        Serial.printf("[AudioOutput] I2S write error: %d\n", err);
+    }
+
+    if (_mixer.isActive(Voice::SPEECH)) {
+        metricsEnd(Span::FIRST_AUDIO);
+        _underrunArmed = true;
+    }
+
+    int level = dspMeanAbs(_chunk, samples);
+    portENTER_CRITICAL(&_lock);
+    _levels[_levelPos].time = millis();
+    _levels[_levelPos].level = level;
+    _levelPos = (_levelPos + 1) % LEVEL_HISTORY;
+    portEXIT_CRITICAL(&_lock);
+}
+
+int AudioOutput::getOutputLevel(uint32_t windowMs) const {
+    uint32_t now = millis();
+    int level = 0;
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < LEVEL_HISTORY; i++) {
+        if (now - _levels[i].time <= windowMs && _levels[i].level > level) {
+            level = _levels[i].level;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+    return level;
+}
+
+void AudioOutput::voiceDone(Voice voice) {
+    if (voice == Voice::SPEECH) {
+        _underrunArmed = false;
+        Serial.println("[AudioOutput] Speech playback complete");
+    }
+    if (_doneCallback) {
+        _doneCallback(voice);
     }
 }
 
@@ -84,196 +222,234 @@ bool AudioOutput::configureI2S() {
 
 void AudioOutput::setVolume(int volume) {
     _volume = constrain(volume, MIN_VOLUME, MAX_VOLUME);
+    _mixer.setMasterGain(dspGainFromPercent(_volume));  // Applies from the next mix block
     Serial.printf("[AudioOutput] Volume set to %d%%\n", _volume);
 }
 
 void AudioOutput::play(const int16_t* samples, size_t count) {
     if (!_initialized || count == 0) return;
 
-    _playing = true;
+    playChunked(count, [samples](int16_t* out, size_t offset, size_t n) {
+        memcpy(out, samples + offset, n * sizeof(int16_t));
+    });
+}
 
-    // Create a copy to apply volume
-    int16_t* buffer = (int16_t*)malloc(count * sizeof(int16_t));
-    if (!buffer) {
-        Serial.println("[AudioOutput] Failed to allocate buffer");
-        _playing = false;
-        return;
+void AudioOutput::playChunked(size_t count, const ChunkFill& fill) {
+    // A pool block is reused for every chunk; without a pool one chunk is malloc'd
+    int16_t* chunk = _dmaPool ? (int16_t*)_dmaPool->acquire() : nullptr;
+    bool pooled = chunk != nullptr;
+    size_t chunkSamples = pooled ? _dmaPool->getBlockSize() / sizeof(int16_t)
+                                 : min(count, CHUNK_SAMPLES);
+
+    if (!pooled) {
+        chunk = (int16_t*)malloc(chunkSamples * sizeof(int16_t));
+        if (!chunk) {
+            Serial.println("[AudioOutput] Failed to allocate buffer");
+            return;
+        }
     }
 
-    memcpy(buffer, samples, count * sizeof(int16_t));
-    applyVolume(buffer, count);
+    for (size_t offset = 0; offset < count; offset += chunkSamples) {
+        size_t n = min(count - offset, chunkSamples);
+        fill(chunk, offset, n);
 
-    size_t bytesWritten = 0;
-    i2s_write(I2S_SPK_PORT, buffer, count * sizeof(int16_t), &bytesWritten, portMAX_DELAY);
+        // The chunk is free again once the mixer has consumed it
+        if (!_mixer.queue(Voice::NOTIFY, chunk, n, false)) break;
+        _mixer.end(Voice::NOTIFY);
+        wakeTask();
 
-    free(buffer);
-    _playing = false;
+        uint32_t start = millis();
+        while (_mixer.isActive(Voice::NOTIFY) && millis() - start < PLAYBACK_WAIT_MS) {
+            delay(1);
+        }
+    }
+
+    if (pooled) {
+        _dmaPool->release(chunk);
+    } else {
+        free(chunk);
+    }
 }
 
 void AudioOutput::playTone(int frequency, int durationMs) {
     if (!_initialized) return;
 
-    _playing = true;
-
     int sampleCount = (I2S_SPK_SAMPLE_RATE * durationMs) / 1000;
-    int16_t* samples = (int16_t*)malloc(sampleCount * sizeof(int16_t));
+    int fadeLen = sampleCount / 10;
 
-    if (!samples) {
-        Serial.println("[AudioOutput] Failed to allocate tone buffer");
-        _playing = false;
-        return;
-    }
-
-    // Generate sine wave
+    // Generate the sine wave chunk by chunk; the phase carries across chunks
     float phase = 0;
     float phaseIncrement = (2.0f * M_PI * frequency) / I2S_SPK_SAMPLE_RATE;
 
-    for (int i = 0; i < sampleCount; i++) {
-        // Apply envelope for smoother sound
-        float envelope = 1.0f;
-        int fadeLen = sampleCount / 10;
-
-        if (i < fadeLen) {
-            envelope = (float)i / fadeLen;  // Fade in
-        } else if (i > sampleCount - fadeLen) {
-            envelope = (float)(sampleCount - i) / fadeLen;  // Fade out
+    playChunked(sampleCount, [&](int16_t* out, size_t offset, size_t n) {
+        for (size_t j = 0; j < n; j++) {
+            int i = offset + j;
+
+            // Apply envelope for smoother sound
+            float envelope = 1.0f;
+            if (i < fadeLen) {
+                envelope = (float)i / fadeLen;  // Fade in
+            } else if (i > sampleCount - fadeLen) {
+                envelope = (float)(sampleCount - i) / fadeLen;  // Fade out
+            }
+
+            out[j] = (int16_t)(sin(phase) * 16000 * envelope);
+            phase += phaseIncrement;
+            if (phase > 2.0f * M_PI) phase -= 2.0f * M_PI;
         }
+    });
+}
 
-        samples[i] = (int16_t)(sin(phase) * 16000 * envelope);
-        phase += phaseIncrement;
-        if (phase > 2.0f * M_PI) phase -= 2.0f * M_PI;
-    }
+void AudioOutput::playCue(Cue cue) {
+    if (!_initialized) return;
 
-    play(samples, sampleCount);
-    free(samples);
+    size_t count;
+    const int16_t* samples = _sounds.get(cue, count);
+    if (!samples) return;
 
-    _playing = false;
+    // Cues queue behind each other; when the queue is full the press is dropped
+    if (_mixer.queue(Voice::CUE, samples, count, false)) {
+        _mixer.end(Voice::CUE);
+        wakeTask();
+    }
 }
 
 void AudioOutput::playBeep() {
-    playTone(1000, 50);  // 1kHz for 50ms
+    playCue(Cue::BEEP);
 }
 
 void AudioOutput::playStartSound() {
-    playTone(800, 100);
-    delay(50);
-    playTone(1200, 100);
+    playCue(Cue::START);
 }
 
 void AudioOutput::playStopSound() {
-    playTone(1200, 100);
-    delay(50);
-    playTone(800, 100);
+    playCue(Cue::STOP);
 }
 
 void AudioOutput::playErrorSound() {
-    playTone(400, 200);
-    delay(100);
-    playTone(300, 300);
+    playCue(Cue::ERROR);
 }
 
-void AudioOutput::stop() {
-    _stopRequested = true;
-    if (_initialized) {
-        i2s_zero_dma_buffer(I2S_SPK_PORT);
-    }
-    if (_asyncBuffer) {
-        free(_asyncBuffer);
-        _asyncBuffer = nullptr;
-    }
-    _asyncSamples = 0;
-    _asyncPosition = 0;
-    _playing = false;
-    _stopRequested = false;
+bool AudioOutput::isPlaying() const {
+    return _mixer.isActive(Voice::SPEECH) || _mixer.isActive(Voice::NOTIFY);
 }
 
-void AudioOutput::playAsync(const int16_t* samples, size_t count) {
-    Serial.println("[AUDIO DEBUG] ========== PLAYBACK START ==========");
-    Serial.printf("[AUDIO DEBUG] Requested to play %d samples\n", count);
+void AudioOutput::stop() {
+    requestStop(VOICE_BIT(Voice::SPEECH) | VOICE_BIT(Voice::NOTIFY));
+}
 
-    if (!_initialized || count == 0) {
-        Serial.println("[AUDIO DEBUG] ERROR: Not initialized or count is 0");
+void AudioOutput::requestStop(uint32_t voices) {
+    if (!_task) {
+        for (int i = 0; i < (int)Voice::COUNT; i++) {
+            if (voices & VOICE_BIT(i)) _mixer.stop((Voice)i);
+        }
         return;
     }
 
-    // Stop any existing playback
-    if (_asyncBuffer) {
-        Serial.println("[AUDIO DEBUG] Freeing previous buffer");
-        free(_asyncBuffer);
-    }
-
-    // Allocate buffer in PSRAM if available
-    size_t bufferSize = count * sizeof(int16_t);
-    Serial.printf("[AUDIO DEBUG] Allocating %d bytes for playback buffer\n", bufferSize);
+    // The task finishes its current chunk (at most ~64 ms) and then drops the voices
+    portENTER_CRITICAL(&_lock);
+    _stopMask |= voices;
+    portEXIT_CRITICAL(&_lock);
+    wakeTask();
 
-    if (psramFound()) {
-        _asyncBuffer = (int16_t*)ps_malloc(bufferSize);
-        Serial.println("[AUDIO DEBUG] Using PSRAM");
-    } else {
-        _asyncBuffer = (int16_t*)malloc(bufferSize);
-        Serial.println("[AUDIO DEBUG] Using regular RAM");
+    uint32_t start = millis();
+    while ((_stopMask & voices) && millis() - start < PLAYBACK_WAIT_MS) {
+        delay(1);
     }
+}
 
-    if (!_asyncBuffer) {
-        Serial.println("[AUDIO DEBUG] ERROR: Failed to allocate async buffer!");
+void AudioOutput::playAsync(const int16_t* samples, size_t count) {
+    if (!_initialized || count == 0) return;
+
+    // Allocate buffer from the turn arena (PSRAM/heap if none or full)
+    int16_t* buffer = (int16_t*)arenaAlloc(_arena, count * sizeof(int16_t));
+    if (!buffer) {
+        Serial.println("[AudioOutput] Failed to allocate async buffer");
         return;
     }
+    memcpy(buffer, samples, count * sizeof(int16_t));
 
-    memcpy(_asyncBuffer, samples, bufferSize);
-    Serial.println("[AUDIO DEBUG] Buffer copied");
+    requestStop(VOICE_BIT(Voice::SPEECH));
+    _mixer.queue(Voice::SPEECH, buffer, count, true);
+    endQueue();
 
-    // Check first few samples
-    Serial.printf("[AUDIO DEBUG] First 4 samples: %d %d %d %d\n",
-                  _asyncBuffer[0], _asyncBuffer[1], _asyncBuffer[2], _asyncBuffer[3]);
-    Serial.printf("[AUDIO DEBUG] Last 4 samples: %d %d %d %d\n",
-                  _asyncBuffer[count-4], _asyncBuffer[count-3], _asyncBuffer[count-2], _asyncBuffer[count-1]);
+    Serial.printf("[AudioOutput] Playing %d samples (%.2f sec)\n",
+                  count, (float)count / I2S_SPK_SAMPLE_RATE);
+}
 
-    applyVolume(_asyncBuffer, count);
+void AudioOutput::playBuffer(const int16_t* samples, size_t count) {
+    if (!_initialized || count == 0) return;
 
-    _asyncSamples = count;
-    _asyncPosition = 0;
-    _playing = true;
-    _stopRequested = false;
+    requestStop(VOICE_BIT(Voice::SPEECH));
+    _mixer.queue(Voice::SPEECH, samples, count, false);
+    endQueue();
 
-    Serial.printf("[AUDIO DEBUG] Starting async playback: %d samples (%.2f sec at %d Hz)\n",
-                  count, (float)count / I2S_SPK_SAMPLE_RATE, I2S_SPK_SAMPLE_RATE);
-    Serial.println("[AUDIO DEBUG] ========================================");
+    Serial.printf("[AudioOutput] Playing %d samples (%.2f sec) in place\n",
+                  count, (float)count / I2S_SPK_SAMPLE_RATE);
 }
 
-void AudioOutput::update() {
-    if (!_playing || !_asyncBuffer || _stopRequested) return;
-
-    if (_asyncPosition >= _asyncSamples) {
-        // Playback complete
-        Serial.println("[AudioOutput] Async playback complete");
-        free(_asyncBuffer);
-        _asyncBuffer = nullptr;
-        _asyncSamples = 0;
-        _asyncPosition = 0;
-        _playing = false;
-        return;
-    }
+bool AudioOutput::queueBuffer(const int16_t* samples, size_t count) {
+    if (!_initialized || count == 0) return false;
 
-    // Write a chunk of audio - use blocking write to ensure audio plays
-    const size_t CHUNK_SIZE = 1024;
-    size_t remaining = _asyncSamples - _asyncPosition;
-    size_t toWrite = min(remaining, CHUNK_SIZE);
+    bool queued = _mixer.queue(Voice::SPEECH, samples, count, false);
+    wakeTask();
+    return queued;
+}
 
-    size_t bytesWritten = 0;
-    esp_err_t err = i2s_write(I2S_SPK_PORT, _asyncBuffer + _asyncPosition,
-              toWrite * sizeof(int16_t), &bytesWritten, portMAX_DELAY);
+void AudioOutput::endQueue() {
+    _mixer.end(Voice::SPEECH);
+    wakeTask();
+}
 
-    if (err != ESP_OK) {
-        Serial.printf("[AudioOutput] I2S write error: %d\n", err);
+bool AudioOutput::beginStream(size_t prebufferSamples) {
+    if (!_initialized) return false;
+
+    // The ring is allocated once and kept, so streaming never fragments the heap
+    if (!_streamRing.isAllocated() && !_streamRing.begin(TTS_STREAM_BUFFER_SAMPLES)) {
+        Serial.println("[AudioOutput] Failed to allocate stream ring");
+        return false;
     }
 
-    _asyncPosition += bytesWritten / sizeof(int16_t);
+    // Streaming replaces any speech still playing
+    requestStop(VOICE_BIT(Voice::SPEECH));
+    _streamRing.reset();
+
+    size_t prebuffer = prebufferSamples > 0 ? prebufferSamples : TTS_STREAM_PREBUFFER_SAMPLES;
+    prebuffer = min(prebuffer, _streamRing.capacity() / 2);
+    _mixer.attachStream(Voice::SPEECH, &_streamRing, prebuffer);
+    wakeTask();
+
+    Serial.printf("[AudioOutput] Stream started (prebuffer %d samples)\n", prebuffer);
+    return true;
 }
 
-void AudioOutput::applyVolume(int16_t* samples, size_t count) {
-    float volumeMultiplier = _volume / 100.0f;
+size_t AudioOutput::writeStream(const int16_t* samples, size_t count) {
+    if (!isStreaming() || _mixer.isEnding(Voice::SPEECH) || !samples) return 0;
+
+    size_t written = 0;
+    while (written < count && isStreaming()) {
+        size_t space;
+        int16_t* dst = _streamRing.writePtr(space);
 
-    for (size_t i = 0; i < count; i++) {
-        samples[i] = (int16_t)(samples[i] * volumeMultiplier);
+        if (space == 0) {
+            // Ring full: the playback task drains it at the I2S rate
+            wakeTask();
+            delay(PLAYBACK_POLL_MS);
+            continue;
+        }
+
+        size_t toCopy = min(count - written, space);
+        memcpy(dst, samples + written, toCopy * sizeof(int16_t));
+        _streamRing.commit(toCopy);
+
+        written += toCopy;
     }
+
+    wakeTask();
+    return written;
+}
+
+void AudioOutput::endStream() {
+    if (!isStreaming()) return;
+    endQueue();  // Play out whatever is buffered, even below prebuffer
 }
@@ -3,50 +3,126 @@
 
 #include <Arduino.h>
 #include <driver/i2s.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <functional>
+#include "ring_buffer.h"
+#include "memory_arena.h"
+#include "sound_bank.h"
+#include "audio_mixer.h"
 
 class AudioOutput {
 public:
+    // Runs on the playback task when a voice has played out everything it
+    // was given up to its end (playBuffer/playAsync, endQueue, endStream)
+    using DoneCallback = std::function<void(Voice voice)>;
+
     AudioOutput();
     ~AudioOutput();
 
     bool begin();
     void end();
 
+    // Clip copies come from the turn arena, cue chunks from the DMA pool
+    void setArena(TurnArena* arena);
+    void setDmaPool(DmaPool* pool) { _dmaPool = pool; }
+
+    void setDoneCallback(DoneCallback callback) { _doneCallback = callback; }
+
     // Volume control (0-100)
     void setVolume(int volume);
     int getVolume() const { return _volume; }
 
-    // Play audio buffer
+    // Short sound on the notification voice: mixed over speech (ducking it)
+    // and play() blocks until it has been mixed
     void play(const int16_t* samples, size_t count);
-    void playAsync(const int16_t* samples, size_t count);  // Non-blocking play
     void playTone(int frequency, int durationMs);
 
-    // Feedback sounds
+    // Speech voice: replaces whatever speech is playing
+    void playAsync(const int16_t* samples, size_t count);  // Non-blocking play (copies)
+
+    // Zero-copy variant: the caller keeps samples valid and unchanged until
+    // isPlaying() is false or stop() returns
+    void playBuffer(const int16_t* samples, size_t count);
+
+    // Gapless speech: clips play back to back in queue order (zero-copy,
+    // like playBuffer). False when AudioMixer::QUEUE_LEN clips are pending
+    bool queueBuffer(const int16_t* samples, size_t count);
+    size_t getQueuedBuffers() const { return _mixer.getQueued(Voice::SPEECH); }
+    void endQueue();  // Last clip queued: the done callback follows it
+
+    // Feedback sounds from the sound bank. Non-blocking, and mixed over any
+    // clip or stream in progress instead of interrupting it
+    void playCue(Cue cue);
     void playBeep();          // Short beep for button press
     void playStartSound();    // Sound when starting to listen
     void playStopSound();     // Sound when stopping
     void playErrorSound();    // Error indication
 
-    // State
-    bool isPlaying() const { return _playing; }
-    void stop();
+    // Streaming playback (PCM pushed while it is still arriving)
+    bool beginStream(size_t prebufferSamples = 0);  // 0 = TTS_STREAM_PREBUFFER_SAMPLES
+    size_t writeStream(const int16_t* samples, size_t count);  // Blocks while the ring is full
+    void endStream();  // No more data, play out what is buffered
+    bool isStreaming() const { return _mixer.isStreaming(Voice::SPEECH); }
 
-    // Process async playback (call in loop)
-    void update();
+    // State: speech or a notification sound is playing (cues don't count)
+    bool isPlaying() const;
+    void stop();  // Speech and notifications; cues play out
+
+    // Loudest mean absolute level among the chunks written to I2S in the
+    // last windowMs (after volume and mixing); 0 when nothing played
+    int getOutputLevel(uint32_t windowMs) const;
 
 private:
     bool _initialized;
-    bool _playing;
     int _volume;
-    bool _stopRequested;
 
-    // Async playback
-    int16_t* _asyncBuffer;
-    size_t _asyncSamples;
-    size_t _asyncPosition;
+    // Playback task (sole writer to the I2S port)
+    TaskHandle_t _task;
+    volatile bool _taskRunning;
+    mutable portMUX_TYPE _lock;
+
+    // Voices to drop, applied by the playback task (bit per Voice)
+    volatile uint32_t _stopMask;
 
+    AudioMixer _mixer;
+    SoundBank _sounds;
+    DoneCallback _doneCallback;
+
+    // Mixed chunk handed to i2s_write (playback task only)
+    static const size_t CHUNK_SAMPLES = 1024;  // 64 ms at 16 kHz
+    int16_t _chunk[CHUNK_SAMPLES];
+
+    // Level of each recent chunk, for echo-aware listeners (under _lock)
+    struct LevelEntry {
+        uint32_t time;
+        int level;
+    };
+    static const size_t LEVEL_HISTORY = 8;  // ~0.5 s of chunks
+    LevelEntry _levels[LEVEL_HISTORY];
+    size_t _levelPos;
+
+    // Speech has played since it last finished or was stopped; running dry
+    // before its end then counts as an underrun (playback task only)
+    bool _underrunArmed;
+
+    TurnArena* _arena;
+    DmaPool* _dmaPool;
+
+    // Streaming playback ring (writeStream produces, the mixer consumes)
+    SpscRing<int16_t> _streamRing;
+
+    static void playbackTask(void* param);
+    void service();
+    void requestStop(uint32_t voices);
+    void voiceDone(Voice voice);
+    void wakeTask();
     bool configureI2S();
-    void applyVolume(int16_t* samples, size_t count);
+
+    // Plays count samples as notifications, one pool chunk at a time;
+    // fill(out, offset, n) writes the next n samples
+    using ChunkFill = std::function<void(int16_t* out, size_t offset, size_t count)>;
+    void playChunked(size_t count, const ChunkFill& fill);
 };
 
 #endif // AUDIO_OUTPUT_H
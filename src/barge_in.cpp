@@ -0,0 +1,137 @@
+#include "barge_in.h"
+#include "config.h"
+#include "audio_dsp.h"
+#include "audio_output.h"
+#include <esp_heap_caps.h>
+
+#define BARGE_IN_TASK_STACK   3072
+#define BARGE_IN_RING_FRAMES  4
+
+BargeInDetector::BargeInDetector()
+    : _initialized(false)
+    , _listening(false)
+    , _resetPending(false)
+    , _callback(nullptr)
+    , _taskHandle(nullptr)
+    , _taskRunning(false)
+    , _mic(nullptr)
+    , _output(nullptr)
+    , _subscriberId(-1)
+    , _frame(nullptr)
+    , _gate(BARGE_IN_ECHO_COUPLING, BARGE_IN_ECHO_MARGIN, BARGE_IN_MIN_LEVEL, BARGE_IN_TRIGGER_FRAMES)
+    , _detectionCount(0)
+{
+}
+
+BargeInDetector::~BargeInDetector() {
+    end();
+}
+
+bool BargeInDetector::begin(MicCapture& mic, AudioOutput& output) {
+    if (_initialized) return true;
+
+    _frame = (int16_t*)heap_caps_malloc(MIC_FRAME_SAMPLES * sizeof(int16_t),
+                                        MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!_frame || !_ring.begin(MIC_FRAME_SAMPLES * BARGE_IN_RING_FRAMES)) {
+        Serial.println("[BargeIn] Failed to allocate buffers");
+        end();
+        return false;
+    }
+
+    _output = &output;
+    _taskRunning = true;
+    if (xTaskCreatePinnedToCore(detectionTask, "barge_in", BARGE_IN_TASK_STACK, this,
+                                1, &_taskHandle, 0) != pdPASS) {
+        Serial.println("[BargeIn] Failed to start detection task");
+        _taskRunning = false;
+        _taskHandle = nullptr;
+        end();
+        return false;
+    }
+
+    _mic = &mic;
+    _subscriberId = mic.subscribe(&_ring, _taskHandle);
+    if (_subscriberId < 0) {
+        Serial.println("[BargeIn] No free mic subscriber slot");
+        end();
+        return false;
+    }
+
+    _initialized = true;
+    Serial.println("[BargeIn] Initialized");
+    return true;
+}
+
+void BargeInDetector::end() {
+    stopListening();
+
+    _taskRunning = false;
+    if (_taskHandle) {
+        xTaskNotifyGive(_taskHandle);
+    }
+    uint32_t start = millis();
+    while (_taskHandle && millis() - start < 500) {
+        delay(5);
+    }
+    _ring.release();
+
+    if (_frame) {
+        heap_caps_free(_frame);
+        _frame = nullptr;
+    }
+    _initialized = false;
+}
+
+void BargeInDetector::startListening() {
+    if (!_initialized || _listening) return;
+
+    _resetPending = true;
+    _listening = true;
+    _mic->setActive(_subscriberId, true);
+}
+
+void BargeInDetector::stopListening() {
+    if (!_listening) return;
+
+    _mic->setActive(_subscriberId, false);
+    _listening = false;
+}
+
+void BargeInDetector::detectionTask(void* param) {
+    BargeInDetector* detector = (BargeInDetector*)param;
+
+    while (detector->_taskRunning) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+
+        if (detector->_resetPending) {
+            detector->_resetPending = false;
+            detector->_gate.reset();
+        }
+
+        while (detector->_ring.available() >= MIC_FRAME_SAMPLES) {
+            detector->_ring.read(detector->_frame, MIC_FRAME_SAMPLES);
+            if (detector->_listening) {
+                detector->processFrame(detector->_frame, MIC_FRAME_SAMPLES);
+            }
+        }
+    }
+
+    detector->_taskHandle = nullptr;
+    vTaskDelete(NULL);
+}
+
+void BargeInDetector::processFrame(const int16_t* samples, size_t count) {
+    // The speaker window spans the I2S queue and the room, so the echo of
+    // what was written is inside it whenever the mic hears it
+    float micLevel = dspMeanAbs(samples, count);
+    float speakerLevel = _output->getOutputLevel(BARGE_IN_REFERENCE_MS);
+
+    if (_gate.process(micLevel, speakerLevel)) {
+        _detectionCount++;
+        Serial.printf("[BargeIn] Speech over playback (mic %.0f, speaker %.0f, coupling %.2f)\n",
+                      micLevel, speakerLevel, _gate.getCoupling());
+        if (_callback) {
+            _callback();
+        }
+    }
+}
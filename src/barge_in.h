@@ -0,0 +1,120 @@
+#ifndef BARGE_IN_H
+#define BARGE_IN_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "mic_capture.h"
+#include "ring_buffer.h"
+
+class AudioOutput;
+
+// Barge-in callback (called from the detector task)
+typedef void (*BargeInCallback)(void);
+
+// Tells the user's voice from the assistant's own echo by frame level.
+// The speaker level that was just played, times the learned coupling from
+// speaker to mic, is what the mic would hear with nobody talking; speech
+// has to clear that by a margin for several frames in a row. The coupling
+// is learned while the mic only hears echo: it follows quieter ratios
+// down quickly and creeps up slowly, so the user's voice barely moves it.
+class EchoGate {
+public:
+    EchoGate(float coupling, float margin, float minLevel, int triggerFrames)
+        : _initialCoupling(coupling), _margin(margin), _minLevel(minLevel),
+          _triggerFrames(triggerFrames) { reset(); }
+
+    void reset() {
+        _coupling = _initialCoupling;
+        _noise = 0;
+        _speechFrames = 0;
+        _triggered = false;
+    }
+
+    // One mic frame against the speaker level around it; true once, on
+    // the frame that completes a run of speech frames
+    bool process(float micLevel, float speakerLevel) {
+        if (_triggered) return false;
+
+        float echo = _coupling * speakerLevel;
+        float threshold = max(_minLevel, _noise * 2.0f) + echo * _margin;
+        bool speech = micLevel > threshold;
+
+        if (speech) {
+            if (++_speechFrames >= _triggerFrames) {
+                _triggered = true;
+                return true;
+            }
+            return false;
+        }
+        _speechFrames = 0;
+
+        if (speakerLevel > _minLevel) {
+            float ratio = micLevel / speakerLevel;
+            _coupling += (ratio - _coupling) * (ratio < _coupling ? 0.2f : 0.02f);
+        } else {
+            // Speaker quiet: the mic hears the room
+            _noise = _noise <= 0 ? micLevel
+                                 : _noise + (micLevel - _noise) * (micLevel < _noise ? 0.2f : 0.02f);
+        }
+        return false;
+    }
+
+    float getCoupling() const { return _coupling; }
+    float getNoise() const { return _noise; }
+
+private:
+    float _initialCoupling;
+    float _margin;
+    float _minLevel;
+    int _triggerFrames;
+
+    float _coupling;
+    float _noise;
+    int _speechFrames;
+    bool _triggered;
+};
+
+// Listens to the mic while a reply plays and reports when the user talks
+// over it. Mic frames come from the shared MicCapture; the speaker level is
+// the one AudioOutput actually wrote, so volume changes and cues count
+class BargeInDetector {
+public:
+    BargeInDetector();
+    ~BargeInDetector();
+
+    bool begin(MicCapture& mic, AudioOutput& output);
+    void end();
+
+    // Armed for one reply: the gate starts over and fires at most once
+    void startListening();
+    void stopListening();
+    bool isListening() const { return _listening; }
+
+    void setCallback(BargeInCallback callback) { _callback = callback; }
+
+    int getDetectionCount() const { return _detectionCount; }
+
+private:
+    static void detectionTask(void* param);
+    void processFrame(const int16_t* samples, size_t count);
+
+    bool _initialized;
+    volatile bool _listening;
+    volatile bool _resetPending;
+    BargeInCallback _callback;
+
+    TaskHandle_t _taskHandle;
+    volatile bool _taskRunning;
+
+    MicCapture* _mic;
+    AudioOutput* _output;
+    int _subscriberId;
+    SpscRing<int16_t> _ring;
+    int16_t* _frame;
+
+    EchoGate _gate;
+    int _detectionCount;
+};
+
+#endif // BARGE_IN_H
@@ -0,0 +1,199 @@
+#include "base64.h"
+
+#define XX  0x80    // Not in the alphabet: skipped
+#define PD  0xC0    // Padding
+
+static const char ENCODE[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Character -> 6-bit value; XX and PD both have the top bit set, so one OR
+// across a group tells whether it can take the fast path
+static const uint8_t DECODE[256] = {
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, XX, XX, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, PD, XX, XX,
+    XX,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, XX,
+    XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+};
+
+static inline void encodeGroup(uint32_t group, char* out) {
+    out[0] = ENCODE[group >> 18];
+    out[1] = ENCODE[(group >> 12) & 0x3F];
+    out[2] = ENCODE[(group >> 6) & 0x3F];
+    out[3] = ENCODE[group & 0x3F];
+}
+
+size_t base64EncodeBlock(const uint8_t* data, size_t length, char* out) {
+    char* p = out;
+
+    // Two groups per pass: 6 bytes in, 8 characters out
+    while (length >= 6) {
+        encodeGroup((uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2], p);
+        encodeGroup((uint32_t)data[3] << 16 | (uint32_t)data[4] << 8 | data[5], p + 4);
+        data += 6;
+        length -= 6;
+        p += 8;
+    }
+
+    if (length >= 3) {
+        encodeGroup((uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2], p);
+        data += 3;
+        length -= 3;
+        p += 4;
+    }
+
+    if (length > 0) {
+        uint32_t group = (uint32_t)data[0] << 16 | (length > 1 ? (uint32_t)data[1] << 8 : 0);
+        encodeGroup(group, p);
+        p[3] = '=';
+        if (length == 1) p[2] = '=';
+        p += 4;
+    }
+
+    return p - out;
+}
+
+String base64Encode(const uint8_t* data, size_t length) {
+    String encoded;
+    encoded.reserve(base64EncodedLength(length));
+
+    // Appended a piece at a time instead of a character at a time
+    const size_t pieceBytes = 384;
+    char piece[base64EncodedLength(pieceBytes) + 1];
+
+    while (length > 0) {
+        size_t n = min(length, pieceBytes);
+        piece[base64EncodeBlock(data, n, piece)] = '\0';
+        encoded += piece;
+        data += n;
+        length -= n;
+    }
+
+    return encoded;
+}
+
+size_t base64Decode(const char* input, size_t length, uint8_t* out) {
+    Base64Decoder decoder;
+    size_t written = decoder.update(input, length, out);
+    return written + decoder.finish(out + written);
+}
+
+// ---------------------------------------------------------------------------
+// Base64Encoder
+// ---------------------------------------------------------------------------
+
+size_t Base64Encoder::update(const uint8_t* data, size_t length, char* out) {
+    char* p = out;
+
+    // Complete the group carried from the last update
+    if (_carryLen > 0) {
+        while (_carryLen < 3 && length > 0) {
+            _carry[_carryLen++] = *data++;
+            length--;
+        }
+        if (_carryLen < 3) return 0;
+        p += base64EncodeBlock(_carry, 3, p);
+        _carryLen = 0;
+    }
+
+    size_t whole = length - length % 3;
+    p += base64EncodeBlock(data, whole, p);
+
+    _carryLen = length - whole;
+    memcpy(_carry, data + whole, _carryLen);
+    return p - out;
+}
+
+size_t Base64Encoder::finish(char* out) {
+    size_t written = base64EncodeBlock(_carry, _carryLen, out);
+    reset();
+    return written;
+}
+
+// ---------------------------------------------------------------------------
+// Base64Decoder
+// ---------------------------------------------------------------------------
+
+void Base64Decoder::reset() {
+    _bits = 0;
+    _count = 0;
+    _done = false;
+}
+
+size_t Base64Decoder::update(const char* input, size_t length, uint8_t* out) {
+    const uint8_t* in = (const uint8_t*)input;
+    const uint8_t* end = in + length;
+    uint8_t* p = out;
+
+    while (!_done) {
+        // Fast path: whole groups of alphabet characters, 4 in and 3 out
+        if (_count == 0) {
+            while (end - in >= 4) {
+                uint8_t a = DECODE[in[0]], b = DECODE[in[1]], c = DECODE[in[2]], d = DECODE[in[3]];
+                if ((a | b | c | d) & 0x80) break;
+
+                uint32_t group = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | d;
+                p[0] = group >> 16;
+                p[1] = group >> 8;
+                p[2] = group;
+                in += 4;
+                p += 3;
+            }
+        }
+
+        if (in == end) break;
+
+        // Slow path, one character: group split across updates, padding,
+        // or something to skip
+        uint8_t value = DECODE[*in++];
+        if (value == PD) {
+            p += emitPartial(p);
+            _done = true;
+        } else if (!(value & 0x80)) {
+            _bits = _bits << 6 | value;
+            if (++_count == 4) {
+                p[0] = _bits >> 16;
+                p[1] = _bits >> 8;
+                p[2] = _bits;
+                p += 3;
+                _bits = 0;
+                _count = 0;
+            }
+        }
+    }
+
+    return p - out;
+}
+
+size_t Base64Decoder::finish(uint8_t* out) {
+    size_t written = _done ? 0 : emitPartial(out);
+    reset();
+    return written;
+}
+
+size_t Base64Decoder::emitPartial(uint8_t* out) {
+    // 2 characters carry 1 byte, 3 carry 2; a lone character carries none
+    size_t written = 0;
+    if (_count == 2) {
+        out[0] = _bits >> 4;
+        written = 1;
+    } else if (_count == 3) {
+        out[0] = _bits >> 10;
+        out[1] = _bits >> 2;
+        written = 2;
+    }
+    _bits = 0;
+    _count = 0;
+    return written;
+}
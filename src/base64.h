@@ -0,0 +1,78 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <Arduino.h>
+
+// Base64 (RFC 4648, standard alphabet, padded) for the STT upload and the
+// TTS download. Decoding is table driven; whole 4-character groups take a
+// fast path, and anything outside the alphabet (whitespace, line breaks, the
+// backslash of a JSON "\/" escape) is skipped.
+
+// Characters for length bytes, padding included
+constexpr size_t base64EncodedLength(size_t length) {
+    return (length + 2) / 3 * 4;
+}
+
+// Most bytes decoded from length characters (including up to 3 carried over
+// by a Base64Decoder from its previous update)
+constexpr size_t base64DecodedMaxLength(size_t length) {
+    return length / 4 * 3 + 3;
+}
+
+// One block into out (base64EncodedLength(length) chars, not terminated),
+// padded if length % 3 != 0. Returns characters written
+size_t base64EncodeBlock(const uint8_t* data, size_t length, char* out);
+
+// Whole buffer as a String (batch STT request body)
+String base64Encode(const uint8_t* data, size_t length);
+
+// Whole input into out, which holds base64DecodedMaxLength(length) bytes.
+// Stops at the first '='; returns bytes written
+size_t base64Decode(const char* input, size_t length, uint8_t* out);
+
+// Incremental encoder: data arrives in pieces of any size, and a trailing
+// partial 3-byte group is carried into the next update so padding only
+// appears at the end
+class Base64Encoder {
+public:
+    Base64Encoder() { reset(); }
+
+    void reset() { _carryLen = 0; }
+
+    // out holds base64EncodedLength(length); returns characters written
+    size_t update(const uint8_t* data, size_t length, char* out);
+
+    // Carried bytes, padded (at most 4 characters); resets the encoder
+    size_t finish(char* out);
+
+private:
+    uint8_t _carry[3];
+    size_t _carryLen;   // Bytes of an incomplete group (0-2 between calls)
+};
+
+// Incremental decoder: characters arrive in pieces split anywhere, with a
+// partial group carried between updates. Input after padding is ignored
+class Base64Decoder {
+public:
+    Base64Decoder() { reset(); }
+
+    void reset();
+
+    // out holds base64DecodedMaxLength(length); returns bytes written
+    size_t update(const char* input, size_t length, uint8_t* out);
+
+    // Bytes of an unpadded final group (at most 2); resets the decoder
+    size_t finish(uint8_t* out);
+
+    // Padding seen: the encoded data is complete
+    bool isDone() const { return _done; }
+
+private:
+    size_t emitPartial(uint8_t* out);
+
+    uint32_t _bits;     // Characters of the current group, 6 bits each
+    size_t _count;      // Characters in _bits (0-3)
+    bool _done;
+};
+
+#endif // BASE64_H
@@ -1,11 +1,16 @@
 #include "buttons.h"
 #include "config.h"
+#include <driver/gpio.h>
 
 #define LONG_PRESS_MS      500
 #define DOUBLE_CLICK_MS    300
 
 Buttons::Buttons()
     : _callback(nullptr)
+    , _initialized(false)
+    , _polling(false)
+    , _edgePending(true)    // Read the pins once on the first update
+    , _wakeTask(nullptr)
 {
     // Initialize button states
     _buttons[0] = {BTN_BOOT_PIN, true, true, 0, 0, false, 0, 0};
@@ -20,7 +25,49 @@ void Buttons::begin() {
     pinMode(BTN_VOL_UP_PIN, INPUT_PULLUP);
     pinMode(BTN_VOL_DOWN_PIN, INPUT_PULLUP);
 
-    Serial.println("[Buttons] Initialized");
+    for (ButtonState& state : _buttons) {
+        if (_polling) {
+            gpio_wakeup_enable((gpio_num_t)state.pin, GPIO_INTR_LOW_LEVEL);
+        } else {
+            attachInterruptArg(state.pin, onEdge, this, CHANGE);
+        }
+    }
+    _edgePending = true;
+
+    if (!_initialized) {
+        _initialized = true;
+        Serial.println("[Buttons] Initialized");
+    }
+}
+
+void Buttons::enableSleepWakeup() {
+    _polling = true;
+    for (ButtonState& state : _buttons) {
+        detachInterrupt(state.pin);
+        gpio_wakeup_enable((gpio_num_t)state.pin, GPIO_INTR_LOW_LEVEL);
+    }
+}
+
+void IRAM_ATTR Buttons::onEdge(void* arg) {
+    Buttons* buttons = static_cast<Buttons*>(arg);
+    buttons->_edgePending = true;
+
+    TaskHandle_t task = buttons->_wakeTask;
+    if (task) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(task, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+}
+
+bool Buttons::isSettling() const {
+    for (const ButtonState& state : _buttons) {
+        // Held (long press timing) or bouncing (debounce timing)
+        if (state.currentState || state.lastState != state.currentState) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void Buttons::setCallback(ButtonCallback callback) {
@@ -28,6 +75,10 @@ void Buttons::setCallback(ButtonCallback callback) {
 }
 
 void Buttons::update() {
+    // A released button only changes with an edge interrupt
+    if (!_polling && !_edgePending && !isSettling()) return;
+    _edgePending = false;
+
     processButton(0, Button::BOOT);
     processButton(1, Button::VOL_UP);
     processButton(2, Button::VOL_DOWN);
@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 #include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 enum class ButtonEvent {
     NONE,
@@ -24,12 +26,24 @@ public:
 
     Buttons();
 
+    // Pins and edge interrupts (call again if something reconfigures the pins)
     void begin();
     void setCallback(ButtonCallback callback);
 
-    // Call in loop
+    // Task woken by a button edge (the loop task, so it can sleep while idle)
+    void setWakeTask(TaskHandle_t task) { _wakeTask = task; }
+
+    // Light sleep: a held-low pin wakes the chip instead. The wakeup uses the
+    // pins' level interrupts, so edge interrupts are off and update() polls
+    void enableSleepWakeup();
+
+    // Call in loop; reads the pins only after an edge or while a press is
+    // being debounced or timed
     void update();
 
+    // A press is in progress: keep calling update() promptly
+    bool isSettling() const;
+
     // Direct state query
     bool isPressed(Button button);
     bool isHeld(Button button);  // True if held for > 500ms
@@ -48,7 +62,12 @@ private:
 
     ButtonState _buttons[3];
     ButtonCallback _callback;
+    bool _initialized;
+    bool _polling;                  // No edge interrupts (sleep wakeup mode)
+    volatile bool _edgePending;
+    volatile TaskHandle_t _wakeTask;
 
+    static void IRAM_ATTR onEdge(void* arg);
     void processButton(int index, Button button);
 };
 
@@ -0,0 +1,136 @@
+#include "capture_buffer.h"
+#include <esp_heap_caps.h>
+
+static int16_t* allocBlock() {
+    void* block = heap_caps_malloc(CaptureBuffer::BLOCK_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!block) {
+        block = heap_caps_malloc(CaptureBuffer::BLOCK_BYTES, MALLOC_CAP_8BIT);
+    }
+    return (int16_t*)block;
+}
+
+CaptureBuffer::CaptureBuffer()
+    : _blocks(nullptr)
+    , _maxBlocks(0)
+    , _maxSamples(0)
+    , _reserve(0)
+    , _allocated(0)
+    , _size(0)
+    , _failures(0)
+{
+}
+
+CaptureBuffer::~CaptureBuffer() {
+    end();
+}
+
+bool CaptureBuffer::begin(size_t maxSamples, size_t reserveBlocks) {
+    if (_blocks) return true;
+
+    _maxBlocks = (maxSamples + BLOCK_SAMPLES - 1) / BLOCK_SAMPLES;
+    _blocks = (int16_t**)calloc(_maxBlocks, sizeof(int16_t*));
+    if (!_blocks) {
+        Serial.println("[Capture] Failed to allocate block table");
+        return false;
+    }
+
+    _maxSamples = maxSamples;
+    _reserve = min(reserveBlocks, _maxBlocks);
+    _allocated = 0;
+    _size = 0;
+
+    while (_allocated < _reserve) {
+        if (!addBlock()) {
+            Serial.println("[Capture] Failed to allocate reserve blocks");
+            end();
+            return false;
+        }
+    }
+
+    Serial.printf("[Capture] %d KB reserved, up to %d KB on demand\n",
+                  _reserve * BLOCK_BYTES / 1024, _maxBlocks * BLOCK_BYTES / 1024);
+    return true;
+}
+
+void CaptureBuffer::end() {
+    if (_blocks) {
+        for (size_t i = 0; i < _allocated; i++) {
+            heap_caps_free(_blocks[i]);
+        }
+        free(_blocks);
+        _blocks = nullptr;
+    }
+    _maxBlocks = 0;
+    _maxSamples = 0;
+    _reserve = 0;
+    _allocated = 0;
+    _size = 0;
+}
+
+void CaptureBuffer::clear() {
+    while (_allocated > _reserve) {
+        _allocated--;
+        heap_caps_free(_blocks[_allocated]);
+        _blocks[_allocated] = nullptr;
+    }
+    _size = 0;
+}
+
+bool CaptureBuffer::addBlock() {
+    if (_allocated >= _maxBlocks) return false;
+
+    int16_t* block = allocBlock();
+    if (!block) {
+        _failures++;
+        return false;
+    }
+    _blocks[_allocated++] = block;
+    return true;
+}
+
+size_t CaptureBuffer::append(const int16_t* samples, size_t count) {
+    if (!_blocks) return 0;
+
+    size_t appended = 0;
+    count = min(count, _maxSamples - _size);
+
+    while (appended < count) {
+        size_t block = _size / BLOCK_SAMPLES;
+        if (block >= _allocated && !addBlock()) break;
+
+        size_t within = _size % BLOCK_SAMPLES;
+        size_t n = min(count - appended, BLOCK_SAMPLES - within);
+        memcpy(_blocks[block] + within, samples + appended, n * sizeof(int16_t));
+        _size += n;
+        appended += n;
+    }
+
+    return appended;
+}
+
+const int16_t* CaptureBuffer::span(size_t offset, size_t& count) const {
+    if (offset >= _size) {
+        count = 0;
+        return nullptr;
+    }
+
+    size_t within = offset % BLOCK_SAMPLES;
+    count = min(BLOCK_SAMPLES - within, _size - offset);
+    return _blocks[offset / BLOCK_SAMPLES] + within;
+}
+
+size_t CaptureBuffer::read(size_t offset, int16_t* out, size_t count) const {
+    size_t copied = 0;
+
+    while (copied < count) {
+        size_t run;
+        const int16_t* data = span(offset + copied, run);
+        if (run == 0) break;
+
+        run = min(run, count - copied);
+        memcpy(out + copied, data, run * sizeof(int16_t));
+        copied += run;
+    }
+
+    return copied;
+}
@@ -0,0 +1,57 @@
+#ifndef CAPTURE_BUFFER_H
+#define CAPTURE_BUFFER_H
+
+#include <Arduino.h>
+
+// Recording storage that grows as the user talks: samples go into 4 KB
+// PSRAM blocks taken one at a time, so a short command costs a few blocks
+// instead of a full-length buffer, and nothing is zeroed up front. The first
+// reserveBlocks are kept between recordings (the common case never touches
+// the heap); clear() gives the rest back. Blocks are not contiguous, so
+// readers walk the recording a span at a time.
+class CaptureBuffer {
+public:
+    static const size_t BLOCK_BYTES = 4096;
+    static const size_t BLOCK_SAMPLES = BLOCK_BYTES / sizeof(int16_t);
+
+    CaptureBuffer();
+    ~CaptureBuffer();
+
+    // Room for up to maxSamples; reserveBlocks are allocated now and kept
+    bool begin(size_t maxSamples, size_t reserveBlocks);
+    void end();
+
+    // Empties the recording and frees the blocks beyond the reserve
+    void clear();
+
+    // Returns samples appended: fewer than count once maxSamples is reached
+    // or a block can't be allocated
+    size_t append(const int16_t* samples, size_t count);
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _maxSamples; }
+    bool isFull() const { return _size >= _maxSamples; }
+
+    // Contiguous run starting at offset (up to the end of its block);
+    // count is set to its length, 0 past the end
+    const int16_t* span(size_t offset, size_t& count) const;
+
+    // Copies count samples from offset into out; returns samples copied
+    size_t read(size_t offset, int16_t* out, size_t count) const;
+
+    size_t getBlockCount() const { return _allocated; }
+    uint32_t getAllocFailures() const { return _failures; }
+
+private:
+    bool addBlock();
+
+    int16_t** _blocks;      // Block table, filled from the front
+    size_t _maxBlocks;
+    size_t _maxSamples;
+    size_t _reserve;
+    size_t _allocated;
+    size_t _size;
+    uint32_t _failures;
+};
+
+#endif // CAPTURE_BUFFER_H
@@ -0,0 +1,151 @@
+#include "chat_history.h"
+#include <esp_heap_caps.h>
+
+ChatHistory::ChatHistory()
+    : _buffer(nullptr)
+    , _budget(0)
+    , _used(0)
+    , _first(0)
+    , _count(0)
+{
+}
+
+ChatHistory::~ChatHistory() {
+    end();
+}
+
+bool ChatHistory::begin(size_t budgetBytes) {
+    if (_buffer) return true;
+
+    // Turn sizes are 16-bit
+    budgetBytes = min(budgetBytes, (size_t)UINT16_MAX);
+
+    _buffer = (char*)heap_caps_malloc(budgetBytes + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!_buffer) {
+        _buffer = (char*)heap_caps_malloc(budgetBytes + 1, MALLOC_CAP_8BIT);
+    }
+    if (!_buffer) {
+        Serial.println("[History] Failed to allocate history");
+        return false;
+    }
+
+    _budget = budgetBytes;
+    clear();
+    return true;
+}
+
+void ChatHistory::end() {
+    if (_buffer) {
+        heap_caps_free(_buffer);
+        _buffer = nullptr;
+    }
+    _budget = 0;
+    _used = 0;
+    _first = 0;
+    _count = 0;
+}
+
+void ChatHistory::clear() {
+    _used = 0;
+    _first = 0;
+    _count = 0;
+    if (_buffer) _buffer[0] = '\0';
+}
+
+bool ChatHistory::add(const String& userMessage, const String& response) {
+    if (!_buffer) return false;
+
+    // Two messages, each followed by a comma
+    size_t userBytes = serializeMessage("user", userMessage.c_str(), nullptr);
+    size_t modelBytes = serializeMessage("model", response.c_str(), nullptr);
+    size_t bytes = userBytes + modelBytes + 2;
+    if (bytes > _budget) {
+        Serial.printf("[History] Turn of %u bytes exceeds the budget, not kept\n", bytes);
+        return false;
+    }
+
+    while (_count == MAX_TURNS || _used + bytes > _budget) {
+        dropOldest();
+    }
+
+    char* out = _buffer + _used;
+    out += serializeMessage("user", userMessage.c_str(), out);
+    *out++ = ',';
+    out += serializeMessage("model", response.c_str(), out);
+    *out++ = ',';
+    *out = '\0';
+
+    _turnBytes[(_first + _count) % MAX_TURNS] = bytes;
+    _count++;
+    _used += bytes;
+    return true;
+}
+
+void ChatHistory::dropOldest() {
+    if (_count == 0) return;
+
+    // The history is a few KB, so moving it down is cheaper than keeping
+    // the turns in wrapped pieces the request would have to stitch together
+    size_t bytes = _turnBytes[_first];
+    memmove(_buffer, _buffer + bytes, _used - bytes + 1);
+    _used -= bytes;
+    _first = (_first + 1) % MAX_TURNS;
+    _count--;
+}
+
+size_t ChatHistory::serializeMessage(const char* role, const char* text, char* out) {
+    static const char PREFIX[] = "{\"role\":\"";
+    static const char MIDDLE[] = "\",\"parts\":[{\"text\":\"";
+    static const char SUFFIX[] = "\"}]}";
+
+    size_t length = 0;
+    auto put = [&](const char* s, size_t n) {
+        if (out) memcpy(out + length, s, n);
+        length += n;
+    };
+
+    put(PREFIX, sizeof(PREFIX) - 1);
+    put(role, strlen(role));
+    put(MIDDLE, sizeof(MIDDLE) - 1);
+    length += escape(text, out ? out + length : nullptr);
+    put(SUFFIX, sizeof(SUFFIX) - 1);
+    return length;
+}
+
+size_t ChatHistory::escape(const char* text, char* out) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    size_t length = 0;
+
+    for (const char* p = text; *p; p++) {
+        char c = *p;
+        char escaped = 0;
+        switch (c) {
+            case '"':  escaped = '"'; break;
+            case '\\': escaped = '\\'; break;
+            case '\n': escaped = 'n'; break;
+            case '\r': escaped = 'r'; break;
+            case '\t': escaped = 't'; break;
+            default: break;
+        }
+
+        if (escaped) {
+            if (out) {
+                out[length] = '\\';
+                out[length + 1] = escaped;
+            }
+            length += 2;
+        } else if ((uint8_t)c < 0x20) {
+            if (out) {
+                memcpy(out + length, "\\u00", 4);
+                out[length + 4] = HEX_DIGITS[(uint8_t)c >> 4];
+                out[length + 5] = HEX_DIGITS[c & 0x0F];
+            }
+            length += 6;
+        } else {
+            // UTF-8 passes through unchanged
+            if (out) out[length] = c;
+            length++;
+        }
+    }
+    return length;
+}
@@ -0,0 +1,59 @@
+#ifndef CHAT_HISTORY_H
+#define CHAT_HISTORY_H
+
+#include <Arduino.h>
+
+// Conversation turns kept as the JSON the Gemini API expects, so a request
+// is the stored bytes copied as they are instead of a document rebuilt on
+// every turn. Turns live back to back in one PSRAM block with a trailing
+// comma each; a fixed ring of turn sizes tracks where they end. The oldest
+// turns go once the byte budget (and so the upload size) would be exceeded
+class ChatHistory {
+public:
+    static const size_t MAX_TURNS = 32;
+
+    ChatHistory();
+    ~ChatHistory();
+
+    // budgetBytes of serialized history, allocated once
+    bool begin(size_t budgetBytes);
+    void end();
+    bool isReady() const { return _buffer != nullptr; }
+
+    void clear();
+
+    // One exchange: stored as a user and a model message. False if it
+    // alone exceeds the budget (nothing is dropped then)
+    bool add(const String& userMessage, const String& response);
+
+    // Serialized turns for the "contents" array: "{...},{...}," (ends with
+    // a comma, so the current message follows directly)
+    const char* data() const { return _buffer; }
+    size_t size() const { return _used; }
+
+    size_t count() const { return _count; }
+    size_t getBudget() const { return _budget; }
+
+    // Rough Gemini token count for English text (~4 bytes per token)
+    static size_t estimateTokens(size_t bytes) { return (bytes + 3) / 4; }
+
+    // {"role":"<role>","parts":[{"text":"<text>"}]}, written to out if set;
+    // returns the length either way
+    static size_t serializeMessage(const char* role, const char* text, char* out);
+
+    // JSON string escaping without quotes; returns the length, writes if out is set
+    static size_t escape(const char* text, char* out);
+
+private:
+    void dropOldest();
+
+    char* _buffer;
+    size_t _budget;
+    size_t _used;
+
+    uint16_t _turnBytes[MAX_TURNS];
+    size_t _first;
+    size_t _count;
+};
+
+#endif // CHAT_HISTORY_H
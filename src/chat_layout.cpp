@@ -0,0 +1,141 @@
+#include "chat_layout.h"
+
+ChatLayout::ChatLayout(int charsPerLine, size_t maxBytes)
+    : _first(0)
+    , _count(0)
+    , _bytes(0)
+    , _totalLines(0)
+    , _charsPerLine(max(charsPerLine, 1))
+    , _maxBytes(maxBytes)
+{
+}
+
+void ChatLayout::clear() {
+    while (_count > 0) {
+        dropOldest();
+    }
+    _first = 0;
+}
+
+void ChatLayout::add(const String& text, uint16_t color) {
+    if (_count == MAX_MESSAGES) {
+        dropOldest();
+    }
+
+    Message& message = slot(_count++);
+    message.text = text;
+    message.color = color;
+    _bytes += text.length();
+    relayout(message, 0);
+    enforceBudget();
+}
+
+void ChatLayout::appendToLast(const String& text) {
+    if (_count == 0) {
+        add(text, 0);
+        return;
+    }
+
+    // Earlier lines were broken with their whole window of text in view,
+    // so appending can only move the last one
+    Message& message = slot(_count - 1);
+    message.text += text;
+    _bytes += text.length();
+    relayout(message, message.lines.empty() ? 0 : message.lines.size() - 1);
+    enforceBudget();
+}
+
+void ChatLayout::replaceLast(const String& text) {
+    if (_count == 0) {
+        add(text, 0);
+        return;
+    }
+
+    Message& message = slot(_count - 1);
+    _bytes -= message.text.length();
+    message.text = text;
+    _bytes += text.length();
+    relayout(message, 0);
+    enforceBudget();
+}
+
+void ChatLayout::relayout(Message& message, size_t fromLine) {
+    size_t from = 0;
+    if (fromLine < message.lines.size()) {
+        from = message.lines[fromLine].start;
+    }
+    _totalLines -= message.lines.size() - min(fromLine, message.lines.size());
+    message.lines.resize(min(fromLine, message.lines.size()));
+
+    size_t before = message.lines.size();
+    wrap(message.text.c_str(), message.text.length(), from, _charsPerLine, message.lines);
+    if (message.lines.empty()) {
+        message.lines.push_back({0, 0});  // Even an empty message takes a line
+    }
+    _totalLines += message.lines.size() - before;
+}
+
+void ChatLayout::dropOldest() {
+    Message& message = slot(0);
+    _bytes -= message.text.length();
+    _totalLines -= message.lines.size();
+    message.text = "";
+    message.lines.clear();
+    _first = (_first + 1) % MAX_MESSAGES;
+    _count--;
+}
+
+void ChatLayout::enforceBudget() {
+    // The newest message always stays, even if it alone is over budget
+    while (_bytes > _maxBytes && _count > 1) {
+        dropOldest();
+    }
+}
+
+void ChatLayout::wrap(const char* text, size_t length, size_t from,
+                      int charsPerLine, std::vector<Line>& lines) {
+    size_t width = charsPerLine;
+    size_t pos = from;
+
+    while (pos < length) {
+        size_t remaining = length - pos;
+
+        // A newline within reach ends the line early
+        size_t scan = min(remaining, width);
+        size_t newline = scan;
+        for (size_t i = 0; i < scan; i++) {
+            if (text[pos + i] == '\n') {
+                newline = i;
+                break;
+            }
+        }
+        if (newline < scan) {
+            lines.push_back({(uint16_t)pos, (uint16_t)newline});
+            pos += newline + 1;
+            continue;
+        }
+
+        if (remaining <= width) {
+            lines.push_back({(uint16_t)pos, (uint16_t)remaining});
+            break;
+        }
+
+        // Last space that fits (the one right after a full line counts);
+        // the space itself is dropped
+        size_t breakAt = 0;
+        for (size_t i = width; i > 0; i--) {
+            if (text[pos + i] == ' ') {
+                breakAt = i;
+                break;
+            }
+        }
+
+        if (breakAt > 0) {
+            lines.push_back({(uint16_t)pos, (uint16_t)breakAt});
+            pos += breakAt + 1;
+        } else {
+            lines.push_back({(uint16_t)pos, (uint16_t)width});
+            pos += width;
+        }
+    }
+}
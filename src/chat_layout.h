@@ -0,0 +1,69 @@
+#ifndef CHAT_LAYOUT_H
+#define CHAT_LAYOUT_H
+
+#include <Arduino.h>
+#include <vector>
+
+// Chat messages with their line breaks worked out once, when the text
+// arrives. The UI font is monospaced, so a line's start and length fully
+// place every glyph and drawing never has to measure text again.
+// Messages live in a ring of fixed slots with a text byte budget: the
+// oldest go when either runs out. Slots keep their String and line
+// capacity, so a long session settles into reusing the same buffers.
+class ChatLayout {
+public:
+    struct Line {
+        uint16_t start;   // Offset into the message text
+        uint16_t length;
+    };
+
+    static const size_t MAX_MESSAGES = 24;
+
+    ChatLayout(int charsPerLine, size_t maxBytes);
+
+    void clear();
+
+    void add(const String& text, uint16_t color);
+
+    // Streamed replies: only the last line of the newest message is re-wrapped
+    void appendToLast(const String& text);
+    void replaceLast(const String& text);
+
+    // Index 0 is the oldest message still held
+    size_t count() const { return _count; }
+    const String& getText(size_t index) const { return slot(index).text; }
+    uint16_t getColor(size_t index) const { return slot(index).color; }
+    const std::vector<Line>& getLines(size_t index) const { return slot(index).lines; }
+
+    size_t getTotalLines() const { return _totalLines; }
+    size_t getBytes() const { return _bytes; }
+
+    // Break text[from..] into lines of at most charsPerLine: at the last
+    // space that fits, at newlines, or mid-word when there is no space
+    static void wrap(const char* text, size_t length, size_t from,
+                     int charsPerLine, std::vector<Line>& lines);
+
+private:
+    struct Message {
+        String text;
+        uint16_t color;
+        std::vector<Line> lines;
+    };
+
+    Message& slot(size_t index) { return _slots[(_first + index) % MAX_MESSAGES]; }
+    const Message& slot(size_t index) const { return _slots[(_first + index) % MAX_MESSAGES]; }
+
+    void relayout(Message& message, size_t fromLine);
+    void dropOldest();
+    void enforceBudget();
+
+    Message _slots[MAX_MESSAGES];
+    size_t _first;
+    size_t _count;
+    size_t _bytes;
+    size_t _totalLines;
+    int _charsPerLine;
+    size_t _maxBytes;
+};
+
+#endif // CHAT_LAYOUT_H
@@ -0,0 +1,318 @@
+#include "connection_pool.h"
+#include <WiFi.h>
+#include "config.h"
+
+#define HTTPS_PORT              443
+#define POOL_TASK_STACK         8192   // mbedTLS handshake needs a deep stack
+#define POOL_TASK_PRIO          1
+#define POOL_TASK_CORE          0
+
+ConnectionPool::ConnectionPool()
+    : _slotCount(0)
+    , _mutex(nullptr)
+    , _task(nullptr)
+    , _taskRunning(false)
+    , _warmEnabled(false)
+    , _handshakes(0)
+    , _reuses(0)
+    , _handshakeTimeMs(0)
+{
+}
+
+ConnectionPool::~ConnectionPool() {
+    end();
+}
+
+bool ConnectionPool::begin() {
+    if (_mutex) return true;
+
+    _mutex = xSemaphoreCreateMutex();
+    if (!_mutex) {
+        Serial.println("[Pool] Failed to create mutex");
+        return false;
+    }
+
+    _taskRunning = true;
+    BaseType_t result = xTaskCreatePinnedToCore(
+        warmTask,
+        "conn_pool",
+        POOL_TASK_STACK,
+        this,
+        POOL_TASK_PRIO,
+        &_task,
+        POOL_TASK_CORE
+    );
+
+    if (result != pdPASS) {
+        // Still usable: connections are just opened on demand
+        Serial.println("[Pool] Failed to create keep-warm task");
+        _taskRunning = false;
+        _task = nullptr;
+    }
+
+    Serial.printf("[Pool] Initialized with %d hosts\n", _slotCount);
+    return true;
+}
+
+void ConnectionPool::end() {
+    if (_task) {
+        _taskRunning = false;
+        xTaskNotifyGive(_task);
+
+        // The task clears its handle on the way out
+        uint32_t start = millis();
+        while (_task && millis() - start < 2000) {
+            delay(10);
+        }
+    }
+
+    if (_mutex) {
+        closeAll();
+        vSemaphoreDelete(_mutex);
+        _mutex = nullptr;
+    }
+}
+
+bool ConnectionPool::addHost(const char* host) {
+    if (findSlot(host)) return true;
+    if (_slotCount >= CONNECTION_POOL_MAX_HOSTS) {
+        Serial.printf("[Pool] No slot left for %s\n", host);
+        return false;
+    }
+
+    Slot& slot = _slots[_slotCount];
+    slot.host = host;
+    slot.client.setInsecure();  // Skip certificate verification for simplicity
+    slot.inUse = false;
+    slot.warming = false;
+    slot.waiters = 0;
+    slot.lastUsed = 0;
+    slot.lastRequest = 0;
+    slot.handshakes = 0;
+    slot.reuses = 0;
+    _slotCount++;
+    return true;
+}
+
+ConnectionPool::Slot* ConnectionPool::findSlot(const char* host) {
+    for (size_t i = 0; i < _slotCount; i++) {
+        if (strcmp(_slots[i].host, host) == 0) return &_slots[i];
+    }
+    return nullptr;
+}
+
+ConnectionPool::Slot* ConnectionPool::findSlot(WiFiClientSecure* client) {
+    for (size_t i = 0; i < _slotCount; i++) {
+        if (&_slots[i].client == client) return &_slots[i];
+    }
+    return nullptr;
+}
+
+WiFiClientSecure* ConnectionPool::acquire(const char* host, uint32_t waitMs) {
+    if (!_mutex) return nullptr;
+
+    Slot* slot = findSlot(host);
+    if (!slot) return nullptr;
+
+    // Claim the slot; the mutex is only held for the flags, never for I/O
+    uint32_t start = millis();
+    bool waiting = false;
+    while (true) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        bool claimed = !slot->inUse;
+        bool warming = slot->warming;
+        if (claimed) {
+            slot->inUse = true;
+            slot->lastRequest = millis();
+            if (waiting) slot->waiters--;
+        } else if (!waiting) {
+            // Counted while waiting, so the keep-warm task leaves it alone
+            slot->waiters++;
+            waiting = true;
+        }
+        xSemaphoreGive(_mutex);
+
+        if (claimed) break;
+
+        // A keep-warm handshake is the one this request would make anyway:
+        // wait for it rather than fall back to a one-off connection
+        if (warming) {
+            start = millis();
+        } else if (millis() - start > waitMs) {
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+            slot->waiters--;
+            xSemaphoreGive(_mutex);
+            Serial.printf("[Pool] %s busy\n", host);
+            return nullptr;
+        }
+        delay(10);
+    }
+
+    // Leftover bytes mean the previous exchange was not fully read
+    if (slot->client.connected() && slot->client.available() == 0) {
+        slot->reuses++;
+        _reuses++;
+    } else if (!connect(*slot)) {
+        release(&slot->client, false);
+        return nullptr;
+    }
+
+    return &slot->client;
+}
+
+void ConnectionPool::release(WiFiClientSecure* client, bool reusable) {
+    Slot* slot = findSlot(client);
+    if (!slot) return;
+
+    if (!reusable || !client->connected()) {
+        client->stop();
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    slot->lastUsed = millis();
+    slot->inUse = false;
+    xSemaphoreGive(_mutex);
+}
+
+bool ConnectionPool::connect(Slot& slot) {
+    slot.client.stop();
+
+    uint32_t start = millis();
+    if (!slot.client.connect(slot.host, HTTPS_PORT)) {
+        Serial.printf("[Pool] Failed to connect to %s\n", slot.host);
+        return false;
+    }
+
+    uint32_t elapsed = millis() - start;
+    slot.handshakes++;
+    _handshakes++;
+    _handshakeTimeMs += elapsed;
+    Serial.printf("[Pool] Connected to %s in %lu ms\n", slot.host, elapsed);
+    return true;
+}
+
+void ConnectionPool::setWarmEnabled(bool enabled) {
+    bool wasEnabled = _warmEnabled;
+    _warmEnabled = enabled;
+
+    // Check right away rather than on the next period
+    if (enabled && !wasEnabled && _task) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+void ConnectionPool::closeAll() {
+    if (!_mutex) return;
+
+    for (size_t i = 0; i < _slotCount; i++) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        bool idle = !_slots[i].inUse;
+        if (idle) _slots[i].inUse = true;
+        xSemaphoreGive(_mutex);
+
+        if (idle) {
+            _slots[i].client.stop();
+            release(&_slots[i].client, false);
+        }
+    }
+}
+
+void ConnectionPool::warmTask(void* param) {
+    ConnectionPool* pool = static_cast<ConnectionPool*>(param);
+
+    while (pool->_taskRunning) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONNECTION_POOL_CHECK_MS));
+        if (!pool->_taskRunning) break;
+
+        if (pool->_warmEnabled && WiFi.status() == WL_CONNECTED) {
+            pool->warmIdleConnections();
+        }
+    }
+
+    pool->_task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void ConnectionPool::warmIdleConnections() {
+    for (size_t i = 0; i < _slotCount && _warmEnabled; i++) {
+        Slot& slot = _slots[i];
+
+        // Each TLS session holds ~40KB of buffers; don't starve the rest
+        if (ESP.getFreeHeap() < CONNECTION_POOL_MIN_HEAP) {
+            return;
+        }
+
+        // Never wait: a request in flight or waiting always wins
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        bool idle = !slot.inUse && slot.waiters == 0;
+        if (idle) {
+            slot.inUse = true;
+            slot.warming = true;
+        }
+        xSemaphoreGive(_mutex);
+        if (!idle) continue;
+
+        // Keep connections ready while the assistant is in use; long after
+        // the last request, an idle device shouldn't handshake every few
+        // minutes for a turn that may never come. The first one is warmed
+        // at boot
+        uint32_t now = millis();
+        bool wanted = slot.lastRequest != 0 ? now - slot.lastRequest < CONNECTION_POOL_WARM_FOR_MS
+                                            : slot.handshakes == 0;
+
+        // Servers drop idle keep-alive sockets; replace one before that
+        // happens so the next turn never finds a dead connection
+        bool stale = slot.lastUsed != 0 && now - slot.lastUsed > CONNECTION_POOL_REFRESH_MS;
+        bool connected = false;
+        if (wanted && (!slot.client.connected() || stale)) {
+            connected = connect(slot);
+        }
+
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        if (connected) slot.lastUsed = millis();
+        slot.warming = false;
+        slot.inUse = false;
+        xSemaphoreGive(_mutex);
+    }
+}
+
+void ConnectionPool::printStats() {
+    Serial.printf("[Pool] %lu handshakes (%lu ms total), %lu reuses\n",
+                  (unsigned long)_handshakes, (unsigned long)_handshakeTimeMs,
+                  (unsigned long)_reuses);
+    for (size_t i = 0; i < _slotCount; i++) {
+        Serial.printf("[Pool]   %s: %lu handshakes, %lu reuses, %s\n",
+                      _slots[i].host, (unsigned long)_slots[i].handshakes,
+                      (unsigned long)_slots[i].reuses,
+                      _slots[i].client.connected() ? "open" : "closed");
+    }
+}
+
+// -----------------------------------------------------------------------------
+// PooledClient
+// -----------------------------------------------------------------------------
+
+PooledClient::PooledClient(ConnectionPool* pool, const char* host)
+    : _pool(pool)
+    , _client(nullptr)
+    , _pooled(false)
+    , _reusable(true)
+{
+    if (_pool) {
+        _client = _pool->acquire(host);
+        _pooled = _client != nullptr;
+    }
+
+    if (!_client) {
+        _oneOff.setInsecure();
+        _client = &_oneOff;
+    }
+}
+
+PooledClient::~PooledClient() {
+    if (_pooled) {
+        _pool->release(_client, _reusable);
+    } else {
+        _oneOff.stop();
+    }
+}
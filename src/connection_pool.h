@@ -0,0 +1,101 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#define CONNECTION_POOL_MAX_HOSTS 4
+
+// Keeps one TLS connection per API host open between requests, so a voice
+// turn pays for the TCP + TLS handshake once instead of on every call.
+// Each host has a single connection; a caller borrows it for one request.
+class ConnectionPool {
+public:
+    ConnectionPool();
+    ~ConnectionPool();
+
+    // Start the background keep-warm task
+    bool begin();
+    void end();
+
+    // Register a host to pool (before the first acquire)
+    bool addHost(const char* host);
+
+    // Borrow the connection for host, connecting if it is closed
+    // Waits while another task holds it; nullptr if unknown or unreachable
+    WiFiClientSecure* acquire(const char* host, uint32_t waitMs = 5000);
+
+    // Return a borrowed connection; reusable=false closes it
+    void release(WiFiClientSecure* client, bool reusable = true);
+
+    // Background reconnect of dropped connections (enable while idle), for
+    // CONNECTION_POOL_WARM_FOR_MS after the last request
+    void setWarmEnabled(bool enabled);
+
+    // Close every idle connection (called when WiFi drops); one in use is
+    // closed by its request failing
+    void closeAll();
+
+    // Statistics
+    uint32_t getHandshakeCount() const { return _handshakes; }
+    uint32_t getReuseCount() const { return _reuses; }
+    uint32_t getHandshakeTimeMs() const { return _handshakeTimeMs; }
+    void printStats();
+
+private:
+    struct Slot {
+        const char* host;
+        WiFiClientSecure client;
+        bool inUse;
+        bool warming;           // Claimed by the keep-warm task
+        uint8_t waiters;        // Requests waiting to claim it
+        uint32_t lastUsed;      // Last request or reconnect
+        uint32_t lastRequest;   // Last acquire by a caller, 0 = none yet
+        uint32_t handshakes;
+        uint32_t reuses;
+    };
+
+    static void warmTask(void* param);
+    void warmIdleConnections();
+    Slot* findSlot(const char* host);
+    Slot* findSlot(WiFiClientSecure* client);
+    bool connect(Slot& slot);
+
+    Slot _slots[CONNECTION_POOL_MAX_HOSTS];
+    size_t _slotCount;
+    SemaphoreHandle_t _mutex;
+
+    TaskHandle_t _task;
+    volatile bool _taskRunning;
+    volatile bool _warmEnabled;
+
+    volatile uint32_t _handshakes;
+    volatile uint32_t _reuses;
+    volatile uint32_t _handshakeTimeMs;
+};
+
+// Borrows a pooled connection for the lifetime of one request and hands it
+// back on scope exit. Falls back to a one-off connection without a pool.
+class PooledClient {
+public:
+    PooledClient(ConnectionPool* pool, const char* host);
+    ~PooledClient();
+
+    WiFiClientSecure& get() { return *_client; }
+    bool isPooled() const { return _pooled; }
+
+    // The connection's state is unknown (error, early exit): close it on release
+    void discard() { _reusable = false; }
+
+private:
+    ConnectionPool* _pool;
+    WiFiClientSecure* _client;
+    WiFiClientSecure _oneOff;
+    bool _pooled;
+    bool _reusable;
+};
+
+#endif // CONNECTION_POOL_H
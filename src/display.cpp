@@ -1,27 +1,71 @@
 #include "display.h"
 #include "config.h"
+#include <esp_heap_caps.h>
 
 Display::Display()
-    : _currentScreen(Screen::SPLASH)
+    : _frame(&_tft)
+    , _gfx(&_tft)
+    , _nextBounce(0)
+    , _dirtyStrips(0)
+    , _currentScreen(Screen::SPLASH)
     , _state(AssistantState::IDLE)
-    , _chatScrollY(30)
+    , _chat(CHARS_PER_LINE, DISPLAY_CHAT_BYTES)
+    , _streamingAI(false)
+    , _scrollBack(0)
+    , _scrollTarget(0)
+    , _lastScrollTime(0)
     , _lastAnimTime(0)
     , _animFrame(0)
 {
+    _bounce[0] = _bounce[1] = nullptr;
+    memset(_stripHash, 0, sizeof(_stripHash));
 }
 
 void Display::begin() {
     _tft.init();
     _tft.setRotation(0);  // Portrait mode
     _tft.fillScreen(COLOR_BG);
-    _tft.setTextColor(COLOR_TEXT, COLOR_BG);
-    _tft.setTextWrap(false);
+
+#if DISPLAY_USE_FRAMEBUFFER
+    // 16-bit sprite in PSRAM (~106 KB); the panel only gets strips that changed
+    _frame.setColorDepth(16);
+    _frame.setAttribute(PSRAM_ENABLE, true);
+    if (_frame.createSprite(TFT_WIDTH, TFT_HEIGHT)) {
+        _gfx = &_frame;
+        _frame.fillSprite(COLOR_BG);
+        for (int strip = 0; strip < STRIP_COUNT; strip++) {
+            _stripHash[strip] = hashStrip(strip);
+        }
+
+        // DMA can't read the sprite in PSRAM directly, so strips are copied
+        // into an internal buffer first; two let a copy overlap the transfer
+        size_t bounceBytes = TFT_WIDTH * STRIP_ROWS * PUSH_STRIPS * sizeof(uint16_t);
+        _bounce[0] = (uint16_t*)heap_caps_malloc(bounceBytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        _bounce[1] = (uint16_t*)heap_caps_malloc(bounceBytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (_bounce[0] && _bounce[1] && _tft.initDMA()) {
+            // The bus belongs to the display alone; keep it selected so a
+            // push can still be running when flush() returns
+            _tft.startWrite();
+        } else {
+            heap_caps_free(_bounce[0]);
+            heap_caps_free(_bounce[1]);
+            _bounce[0] = _bounce[1] = nullptr;
+            Serial.println("[Display] No DMA buffers, pushing strips synchronously");
+        }
+    } else {
+        Serial.println("[Display] Framebuffer allocation failed, drawing directly");
+    }
+#endif
+
+    _gfx->setTextColor(COLOR_TEXT, COLOR_BG);
+    _gfx->setTextWrap(false);
 
     // Enable backlight
     pinMode(TFT_BL_PIN, OUTPUT);
     setBacklight(true);
 
-    Serial.println("[Display] Initialized " + String(TFT_WIDTH) + "x" + String(TFT_HEIGHT));
+    Serial.println("[Display] Initialized " + String(TFT_WIDTH) + "x" + String(TFT_HEIGHT) +
+                   (_gfx == &_frame ? (_bounce[0] ? " (framebuffer, DMA)" : " (framebuffer)") : ""));
 }
 
 void Display::setBacklight(bool on) {
@@ -34,136 +78,226 @@ void Display::setBrightness(uint8_t level) {
 
 void Display::showSplash() {
     _currentScreen = Screen::SPLASH;
-    _tft.fillScreen(COLOR_BG);
+    _gfx->fillScreen(COLOR_BG);
 
     // Title
-    _tft.setTextSize(2);
-    _tft.setTextColor(COLOR_ACCENT);
-    _tft.setTextDatum(MC_DATUM);
-    _tft.drawString("ESP32-S3", TFT_WIDTH / 2, TFT_HEIGHT / 2 - 40);
-    _tft.drawString("AI Assistant", TFT_WIDTH / 2, TFT_HEIGHT / 2 - 10);
+    _gfx->setTextSize(2);
+    _gfx->setTextColor(COLOR_ACCENT);
+    _gfx->setTextDatum(MC_DATUM);
+    _gfx->drawString("ESP32-S3", TFT_WIDTH / 2, TFT_HEIGHT / 2 - 40);
+    _gfx->drawString("AI Assistant", TFT_WIDTH / 2, TFT_HEIGHT / 2 - 10);
 
     // Subtitle
-    _tft.setTextSize(1);
-    _tft.setTextColor(COLOR_TEXT_DIM);
-    _tft.drawString("Powered by Gemini", TFT_WIDTH / 2, TFT_HEIGHT / 2 + 30);
+    _gfx->setTextSize(1);
+    _gfx->setTextColor(COLOR_TEXT_DIM);
+    _gfx->drawString("Powered by Gemini", TFT_WIDTH / 2, TFT_HEIGHT / 2 + 30);
 
-    _tft.setTextDatum(TL_DATUM);
+    _gfx->setTextDatum(TL_DATUM);
+    markDirty(0, TFT_HEIGHT);
+    flush();
 }
 
 void Display::showStatus(const String& wifiStatus, const String& ip) {
     _currentScreen = Screen::STATUS;
-    _tft.fillScreen(COLOR_BG);
+    _gfx->fillScreen(COLOR_BG);
 
-    _tft.setTextSize(1);
-    _tft.setTextColor(COLOR_TEXT);
+    _gfx->setTextSize(1);
+    _gfx->setTextColor(COLOR_TEXT);
 
     int y = 10;
-    _tft.drawString("System Status", 10, y);
+    _gfx->drawString("System Status", 10, y);
     y += 25;
 
-    _tft.setTextColor(COLOR_TEXT_DIM);
-    _tft.drawString("WiFi:", 10, y);
-    _tft.setTextColor(wifiStatus == "Connected" ? COLOR_USER_MSG : COLOR_ERROR);
-    _tft.drawString(wifiStatus, 60, y);
+    _gfx->setTextColor(COLOR_TEXT_DIM);
+    _gfx->drawString("WiFi:", 10, y);
+    _gfx->setTextColor(wifiStatus == "Connected" ? COLOR_USER_MSG : COLOR_ERROR);
+    _gfx->drawString(wifiStatus, 60, y);
     y += 15;
 
     if (ip.length() > 0) {
-        _tft.setTextColor(COLOR_TEXT_DIM);
-        _tft.drawString("IP:", 10, y);
-        _tft.setTextColor(COLOR_TEXT);
-        _tft.drawString(ip, 60, y);
+        _gfx->setTextColor(COLOR_TEXT_DIM);
+        _gfx->drawString("IP:", 10, y);
+        _gfx->setTextColor(COLOR_TEXT);
+        _gfx->drawString(ip, 60, y);
     }
+    markDirty(0, TFT_HEIGHT);
+    flush();
 }
 
 void Display::showChat() {
     _currentScreen = Screen::CHAT;
-    _tft.fillScreen(COLOR_BG);
+    _gfx->fillScreen(COLOR_BG);
 
     // Draw status bar at top
     drawStatusBar(0, 70, false);
 
     // Draw state indicator
     drawStateIndicator();
+    markDirty(0, TFT_HEIGHT);
+    flush();
 }
 
 void Display::showError(const String& message) {
-    _tft.fillRect(0, TFT_HEIGHT - 60, TFT_WIDTH, 60, COLOR_ERROR);
-    _tft.setTextColor(TFT_WHITE);
-    _tft.setTextSize(1);
+    _gfx->fillRect(0, TFT_HEIGHT - 60, TFT_WIDTH, 60, COLOR_ERROR);
+    _gfx->setTextColor(TFT_WHITE);
+    _gfx->setTextSize(1);
     wrapText(message, 5, TFT_HEIGHT - 55, TFT_WIDTH - 10, TFT_WHITE);
+    markDirty(TFT_HEIGHT - 60, 60);
+    flush();
 }
 
 void Display::setAssistantState(AssistantState state) {
     _state = state;
     if (_currentScreen == Screen::CHAT) {
         drawStateIndicator();
+        flush();
     }
 }
 
 void Display::showUserMessage(const String& message) {
-    _chatHistory.push_back("You: " + message);
+    _chat.add("You: " + message, COLOR_USER_MSG);
+    _streamingAI = false;
+    chatGrew(newestHeight() + MESSAGE_GAP);
+}
 
-    if (_currentScreen == Screen::CHAT) {
-        // Clear chat area
-        _tft.fillRect(0, 30, TFT_WIDTH, TFT_HEIGHT - 80, COLOR_BG);
+void Display::showAIMessage(const String& message) {
+    _chat.add("AI: " + message, COLOR_AI_MSG);
+    _streamingAI = false;
+    chatGrew(newestHeight() + MESSAGE_GAP);
+}
 
-        int y = 35;
-        _tft.setTextSize(1);
+void Display::beginAIMessage() {
+    _chat.add("AI: ", COLOR_AI_MSG);
+    _streamingAI = true;
+    chatGrew(newestHeight() + MESSAGE_GAP);
+}
 
-        // Show last few messages
-        int startIdx = max(0, (int)_chatHistory.size() - 6);
-        for (int i = startIdx; i < _chatHistory.size(); i++) {
-            uint16_t color = _chatHistory[i].startsWith("You:") ? COLOR_USER_MSG : COLOR_AI_MSG;
-            wrapText(_chatHistory[i], 5, y, TFT_WIDTH - 10, color);
-            y += getTextHeight(_chatHistory[i], TFT_WIDTH - 10) + 8;
+void Display::appendAIMessage(const String& text) {
+    if (!_streamingAI) {
+        beginAIMessage();
+    }
+    int before = newestHeight();
+    _chat.appendToLast(text);
+    chatGrew(newestHeight() - before);
+}
 
-            if (y > TFT_HEIGHT - 80) break;
-        }
+void Display::endAIMessage(const String& message) {
+    if (!_streamingAI) {
+        showAIMessage(message);
+        return;
+    }
+
+    // Fragments can be lost under load; the final text is authoritative
+    _streamingAI = false;
+    String full = "AI: " + message;
+    if (_chat.getText(_chat.count() - 1) != full) {
+        int before = newestHeight();
+        _chat.replaceLast(full);
+        chatGrew(newestHeight() - before);
     }
 }
 
-void Display::showAIMessage(const String& message) {
-    _chatHistory.push_back("AI: " + message);
+void Display::scrollChat(int pixels) {
+    _scrollTarget = constrain(_scrollTarget + pixels, 0, maxScrollBack());
+}
 
-    if (_currentScreen == Screen::CHAT) {
-        // Clear chat area
-        _tft.fillRect(0, 30, TFT_WIDTH, TFT_HEIGHT - 80, COLOR_BG);
+void Display::scrollChatToLatest() {
+    _scrollTarget = 0;
+}
+
+void Display::chatGrew(int pixels) {
+    // The view is anchored to the newest line: new text starts just below
+    // it and scrolls in. Scrolled back, the same text stays in view
+    _scrollBack += pixels;
+    if (_scrollTarget > 0) {
+        _scrollTarget += pixels;
+    }
+    int limit = maxScrollBack();
+    _scrollBack = constrain(_scrollBack, 0, limit);
+    _scrollTarget = constrain(_scrollTarget, 0, limit);
+    drawChat();
+}
 
-        int y = 35;
-        _tft.setTextSize(1);
+int Display::newestHeight() const {
+    if (_chat.count() == 0) return 0;
+    return _chat.getLines(_chat.count() - 1).size() * LINE_HEIGHT;
+}
+
+int Display::maxScrollBack() const {
+    int content = _chat.getTotalLines() * LINE_HEIGHT +
+                  (int)_chat.count() * MESSAGE_GAP - MESSAGE_GAP;
+    return max(0, content - (CHAT_HEIGHT - 2 * CHAT_PADDING));
+}
+
+void Display::drawChat() {
+    if (_currentScreen != Screen::CHAT) return;
+
+    // Repainted in full, but only strips whose pixels differ reach the panel
+    _gfx->fillRect(0, CHAT_TOP, TFT_WIDTH, CHAT_HEIGHT, COLOR_BG);
+    markDirty(CHAT_TOP, CHAT_HEIGHT);
+    _gfx->setTextSize(1);
+
+    // Lines cut by the edges are clipped, which is what makes pixel scrolling
+    _gfx->setViewport(0, CHAT_TOP, TFT_WIDTH, CHAT_HEIGHT, false);
+
+    // Walk up from the newest message; short histories start at the top
+    int top = CHAT_TOP + CHAT_PADDING;
+    int bottom = top + (CHAT_HEIGHT - 2 * CHAT_PADDING) + _scrollBack;
+    if (maxScrollBack() == 0) {
+        bottom = top + _chat.getTotalLines() * LINE_HEIGHT +
+                 (int)_chat.count() * MESSAGE_GAP - MESSAGE_GAP;
+    }
 
-        // Show last few messages
-        int startIdx = max(0, (int)_chatHistory.size() - 6);
-        for (int i = startIdx; i < _chatHistory.size(); i++) {
-            uint16_t color = _chatHistory[i].startsWith("You:") ? COLOR_USER_MSG : COLOR_AI_MSG;
-            wrapText(_chatHistory[i], 5, y, TFT_WIDTH - 10, color);
-            y += getTextHeight(_chatHistory[i], TFT_WIDTH - 10) + 8;
+    int y = bottom;
+    for (size_t i = _chat.count(); i-- > 0 && y > CHAT_TOP; ) {
+        const std::vector<ChatLayout::Line>& lines = _chat.getLines(i);
+        y -= lines.size() * LINE_HEIGHT;
 
-            if (y > TFT_HEIGHT - 80) break;
+        _gfx->setTextColor(_chat.getColor(i));
+        for (size_t l = 0; l < lines.size(); l++) {
+            int lineY = y + l * LINE_HEIGHT;
+            if (lineY + LINE_HEIGHT <= CHAT_TOP || lineY >= CHAT_TOP + CHAT_HEIGHT) continue;
+            drawLine(_chat.getText(i), lines[l], CHAT_PADDING, lineY);
         }
+        y -= MESSAGE_GAP;
     }
+
+    _gfx->resetViewport();
+    flush();
+}
+
+void Display::drawLine(const String& text, const ChatLayout::Line& line, int x, int y) {
+    // Copy out the line so drawing needs no String temporaries
+    char buffer[64];
+    size_t length = min((size_t)line.length, sizeof(buffer) - 1);
+    memcpy(buffer, text.c_str() + line.start, length);
+    buffer[length] = '\0';
+    _gfx->drawString(buffer, x, y);
 }
 
 void Display::showThinking() {
     if (_currentScreen == Screen::CHAT) {
-        _tft.fillRect(0, TFT_HEIGHT - 50, TFT_WIDTH, 20, COLOR_BG);
-        _tft.setTextColor(COLOR_ACCENT);
-        _tft.setTextSize(1);
-        _tft.drawString("Thinking...", 10, TFT_HEIGHT - 45);
+        _gfx->fillRect(0, TFT_HEIGHT - 50, TFT_WIDTH, 20, COLOR_BG);
+        _gfx->setTextColor(COLOR_ACCENT);
+        _gfx->setTextSize(1);
+        _gfx->drawString("Thinking...", 10, TFT_HEIGHT - 45);
+        markDirty(TFT_HEIGHT - 50, 20);
+        flush();
     }
 }
 
 void Display::clearChat() {
-    _chatHistory.clear();
-    if (_currentScreen == Screen::CHAT) {
-        _tft.fillRect(0, 30, TFT_WIDTH, TFT_HEIGHT - 80, COLOR_BG);
-    }
+    _chat.clear();
+    _streamingAI = false;
+    _scrollBack = 0;
+    _scrollTarget = 0;
+    drawChat();
 }
 
 void Display::updateStatusBar(int8_t rssi, int volume, bool listening) {
     if (_currentScreen == Screen::CHAT) {
         drawStatusBar(rssi, volume, listening);
+        flush();
     }
 }
 
@@ -177,13 +311,87 @@ void Display::update() {
             drawStateIndicator();
         }
     }
+
+    // Ease the chat towards its scroll target, ending pixel by pixel
+    if (_scrollBack != _scrollTarget && millis() - _lastScrollTime >= 20) {
+        _lastScrollTime = millis();
+        int step = (_scrollTarget - _scrollBack) / 4;
+        if (step == 0) step = _scrollTarget > _scrollBack ? 1 : -1;
+        _scrollBack += step;
+        drawChat();
+    }
+    flush();
+}
+
+void Display::markDirty(int y, int h) {
+    if (_gfx != &_frame || h <= 0) return;
+
+    int first = max(0, y / STRIP_ROWS);
+    int last = min(STRIP_COUNT - 1, (y + h - 1) / STRIP_ROWS);
+    for (int strip = first; strip <= last; strip++) {
+        _dirtyStrips |= 1ULL << strip;
+    }
+}
+
+void Display::flush() {
+    if (!_dirtyStrips) return;
+
+    // Runs of strips that really changed go out together, PUSH_STRIPS at a time
+    int runStart = -1;
+    for (int strip = 0; strip <= STRIP_COUNT; strip++) {
+        bool changed = false;
+        if (strip < STRIP_COUNT && (_dirtyStrips & (1ULL << strip))) {
+            uint32_t hash = hashStrip(strip);
+            changed = hash != _stripHash[strip];
+            _stripHash[strip] = hash;
+        }
+
+        if (changed && runStart < 0) {
+            runStart = strip;
+        } else if (!changed && runStart >= 0) {
+            pushStrips(runStart, strip - runStart);
+            runStart = -1;
+        }
+        if (runStart >= 0 && strip - runStart + 1 == PUSH_STRIPS) {
+            pushStrips(runStart, PUSH_STRIPS);
+            runStart = -1;
+        }
+    }
+    _dirtyStrips = 0;
+}
+
+void Display::pushStrips(int first, int count) {
+    uint16_t* pixels = (uint16_t*)_frame.getPointer();
+    int y = first * STRIP_ROWS;
+    int h = min(count * STRIP_ROWS, TFT_HEIGHT - y);
+
+    if (_bounce[0]) {
+        // Returns once the copy is made; waits only if the previous push
+        // on the other buffer is still running
+        _tft.pushImageDMA(0, y, TFT_WIDTH, h, pixels + y * TFT_WIDTH, _bounce[_nextBounce]);
+        _nextBounce ^= 1;
+    } else {
+        _tft.pushImage(0, y, TFT_WIDTH, h, pixels + y * TFT_WIDTH);
+    }
+}
+
+uint32_t Display::hashStrip(int strip) {
+    // FNV-1a over the strip's pixels, two at a time
+    const uint32_t* words = (const uint32_t*)_frame.getPointer() + strip * STRIP_ROWS * TFT_WIDTH / 2;
+    int rows = min(STRIP_ROWS, TFT_HEIGHT - strip * STRIP_ROWS);
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < rows * TFT_WIDTH / 2; i++) {
+        hash = (hash ^ words[i]) * 16777619u;
+    }
+    return hash;
 }
 
 void Display::drawStatusBar(int8_t rssi, int volume, bool listening) {
-    _tft.fillRect(0, 0, TFT_WIDTH, 25, COLOR_STATUS_BAR);
+    _gfx->fillRect(0, 0, TFT_WIDTH, 25, COLOR_STATUS_BAR);
+    markDirty(0, 25);
 
-    _tft.setTextSize(1);
-    _tft.setTextColor(COLOR_TEXT);
+    _gfx->setTextSize(1);
+    _gfx->setTextColor(COLOR_TEXT);
 
     // WiFi signal strength indicator
     int bars = 0;
@@ -195,23 +403,24 @@ void Display::drawStatusBar(int8_t rssi, int volume, bool listening) {
     for (int i = 0; i < 4; i++) {
         int h = 4 + i * 3;
         uint16_t color = (i < bars) ? COLOR_ACCENT : COLOR_TEXT_DIM;
-        _tft.fillRect(5 + i * 5, 20 - h, 3, h, color);
+        _gfx->fillRect(5 + i * 5, 20 - h, 3, h, color);
     }
 
     // Volume indicator
-    _tft.drawString("Vol:" + String(volume) + "%", 30, 8);
+    _gfx->drawString("Vol:" + String(volume) + "%", 30, 8);
 
     // Listening indicator
     if (listening) {
-        _tft.fillCircle(TFT_WIDTH - 15, 12, 6, TFT_RED);
+        _gfx->fillCircle(TFT_WIDTH - 15, 12, 6, TFT_RED);
     }
 }
 
 void Display::drawStateIndicator() {
     int y = TFT_HEIGHT - 25;
-    _tft.fillRect(0, y, TFT_WIDTH, 25, COLOR_STATUS_BAR);
+    _gfx->fillRect(0, y, TFT_WIDTH, 25, COLOR_STATUS_BAR);
+    markDirty(y, 25);
 
-    _tft.setTextSize(1);
+    _gfx->setTextSize(1);
     String stateText;
     uint16_t stateColor;
 
@@ -238,46 +447,23 @@ void Display::drawStateIndicator() {
             break;
     }
 
-    _tft.setTextColor(stateColor);
-    _tft.setTextDatum(MC_DATUM);
-    _tft.drawString(stateText, TFT_WIDTH / 2, y + 12);
-    _tft.setTextDatum(TL_DATUM);
+    _gfx->setTextColor(stateColor);
+    _gfx->setTextDatum(MC_DATUM);
+    _gfx->drawString(stateText, TFT_WIDTH / 2, y + 12);
+    _gfx->setTextDatum(TL_DATUM);
 }
 
 void Display::wrapText(const String& text, int x, int y, int maxWidth, uint16_t color) {
-    _tft.setTextColor(color);
+    _gfx->setTextColor(color);
 
-    String remaining = text;
-    int lineY = y;
-    int charWidth = 6;  // Approximate character width for size 1
-
-    while (remaining.length() > 0) {
-        int maxChars = maxWidth / charWidth;
-        if (remaining.length() <= maxChars) {
-            _tft.drawString(remaining, x, lineY);
-            break;
-        }
-
-        // Find last space within maxChars
-        int breakPoint = maxChars;
-        for (int i = maxChars; i > 0; i--) {
-            if (remaining.charAt(i) == ' ') {
-                breakPoint = i;
-                break;
-            }
-        }
-
-        _tft.drawString(remaining.substring(0, breakPoint), x, lineY);
-        remaining = remaining.substring(breakPoint + 1);
-        lineY += 12;
+    std::vector<ChatLayout::Line> lines;
+    ChatLayout::wrap(text.c_str(), text.length(), 0, maxWidth / CHAR_WIDTH, lines);
 
+    int lineY = y;
+    for (const ChatLayout::Line& line : lines) {
         if (lineY > TFT_HEIGHT - 30) break;  // Stop if running out of screen
+        drawLine(text, line, x, lineY);
+        markDirty(lineY, LINE_HEIGHT);
+        lineY += LINE_HEIGHT;
     }
 }
-
-int Display::getTextHeight(const String& text, int maxWidth) {
-    int charWidth = 6;
-    int maxChars = maxWidth / charWidth;
-    int lines = (text.length() / maxChars) + 1;
-    return lines * 12;
-}
@@ -3,7 +3,7 @@
 
 #include <Arduino.h>
 #include <TFT_eSPI.h>
-#include <vector>
+#include "chat_layout.h"
 
 // UI Colors
 #define COLOR_BG          TFT_BLACK
@@ -48,9 +48,21 @@ public:
     void setAssistantState(AssistantState state);
     void showUserMessage(const String& message);
     void showAIMessage(const String& message);
+
+    // Streamed AI reply: begin, append fragments as they arrive, then end
+    // with the full text (append without begin starts a new message)
+    void beginAIMessage();
+    void appendAIMessage(const String& text);
+    void endAIMessage(const String& message);
+
     void showThinking();
     void clearChat();
 
+    // Scroll the chat back (positive, towards older messages) or forward by
+    // pixels; animated from update(). New text follows unless scrolled back
+    void scrollChat(int pixels);
+    void scrollChatToLatest();
+
     // Status bar
     void updateStatusBar(int8_t rssi, int volume, bool listening);
 
@@ -59,22 +71,57 @@ public:
     Screen getCurrentScreen() const { return _currentScreen; }
 
 private:
+    // Dirty tracking works on full-width row strips: a strip is contiguous
+    // in the framebuffer, so it goes to the panel as a single DMA push
+    static const int STRIP_ROWS = 8;
+    static const int STRIP_COUNT = (TFT_HEIGHT + STRIP_ROWS - 1) / STRIP_ROWS;
+    static const int PUSH_STRIPS = 2;  // Strips per DMA bounce buffer
+
+    // Chat area geometry (built-in font at size 1 is 6x8, monospaced)
+    static const int CHAR_WIDTH = 6;
+    static const int LINE_HEIGHT = 12;
+    static const int MESSAGE_GAP = 8;
+    static const int CHAT_TOP = 30;
+    static const int CHAT_HEIGHT = TFT_HEIGHT - 80;
+    static const int CHAT_PADDING = 5;
+    static const int CHARS_PER_LINE = (TFT_WIDTH - 2 * CHAT_PADDING) / CHAR_WIDTH;
+
     TFT_eSPI _tft;
+    TFT_eSprite _frame;    // PSRAM framebuffer every draw goes to
+    TFT_eSPI* _gfx;        // _frame, or _tft directly if the sprite didn't fit
+    uint16_t* _bounce[2];  // Internal DMA staging, alternated between pushes
+    int _nextBounce;
+    uint64_t _dirtyStrips;
+    uint32_t _stripHash[STRIP_COUNT];  // Content last sent to the panel
+
     Screen _currentScreen;
     AssistantState _state;
 
-    // Chat scrolling
-    int _chatScrollY;
-    std::vector<String> _chatHistory;
+    // Chat history and scrolling, measured up from the newest line
+    ChatLayout _chat;
+    bool _streamingAI;  // Last entry is an AI reply still being appended
+    int _scrollBack;    // Pixels currently shown above the bottom
+    int _scrollTarget;  // Where the animation is heading; 0 = follow new text
+    uint32_t _lastScrollTime;
 
     // Animation
     uint32_t _lastAnimTime;
     int _animFrame;
 
+    // Framebuffer
+    void markDirty(int y, int h);
+    void flush();
+    void pushStrips(int first, int count);
+    uint32_t hashStrip(int strip);
+
     void drawStatusBar(int8_t rssi, int volume, bool listening);
     void drawStateIndicator();
+    void drawChat();
+    void chatGrew(int pixels);
+    int newestHeight() const;
+    int maxScrollBack() const;
+    void drawLine(const String& text, const ChatLayout::Line& line, int x, int y);
     void wrapText(const String& text, int x, int y, int maxWidth, uint16_t color);
-    int getTextHeight(const String& text, int maxWidth);
 };
 
 #endif // DISPLAY_H
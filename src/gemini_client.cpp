@@ -1,5 +1,11 @@
 #include "gemini_client.h"
+#include "gemini_parse.h"
 #include "config.h"
+#include "http_stream.h"
+#include "log.h"
+#include "metrics.h"
+
+#define GEMINI_SSE_MAX_LINE  8192   // Longest SSE event kept (a few sentences)
 
 GeminiClient::GeminiClient()
     : _apiKey(nullptr)
@@ -8,12 +14,36 @@ GeminiClient::GeminiClient()
     , _systemPrompt("")
     , _hasError(false)
     , _lastError("")
+    , _pool(nullptr)
+    , _mutex(nullptr)
 {
+    buildRequestPrefix();
+    buildRequestSuffix();
 }
 
 void GeminiClient::begin(const char* apiKey) {
     _apiKey = apiKey;
-    _client.setInsecure();  // Skip certificate verification for simplicity
+    if (!_history.isReady()) {
+        _history.begin(GEMINI_HISTORY_BYTES);
+    }
+    if (!_mutex) {
+        _mutex = xSemaphoreCreateMutex();
+    }
+}
+
+void GeminiClient::lock() {
+    if (_mutex) xSemaphoreTake(_mutex, portMAX_DELAY);
+}
+
+void GeminiClient::unlock() {
+    if (_mutex) xSemaphoreGive(_mutex);
+}
+
+void GeminiClient::setConnectionPool(ConnectionPool* pool) {
+    _pool = pool;
+    if (_pool) {
+        _pool->addHost(GEMINI_API_HOST);
+    }
 }
 
 void GeminiClient::setModel(const char* model) {
@@ -22,10 +52,12 @@ void GeminiClient::setModel(const char* model) {
 
 void GeminiClient::setMaxTokens(int maxTokens) {
     _maxTokens = maxTokens;
+    buildRequestSuffix();
 }
 
 void GeminiClient::setSystemPrompt(const String& prompt) {
     _systemPrompt = prompt;
+    buildRequestPrefix();
 }
 
 void GeminiClient::clearHistory() {
@@ -52,32 +84,44 @@ String GeminiClient::chat(const String& userMessage) {
     String requestBody = buildRequestBody(userMessage);
 
     Serial.println("[Gemini] Sending request...");
-    Serial.println("[Gemini] URL: " + url);
+    LOG_DEBUG("[Gemini] URL: %s\n", url.c_str());
+
+    PooledClient client(_pool, GEMINI_API_HOST);
 
     HTTPClient http;
-    http.begin(_client, url);
+    http.setReuse(true);
+    http.begin(client.get(), url);
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(30000);  // 30 second timeout
 
+    metricsBegin(Span::GEMINI_TTFB);
+    metricsBegin(Span::GEMINI_TOTAL);
     int httpCode = http.POST(requestBody);
 
+    // A pooled connection the server already closed fails before any
+    // response; retry once on a fresh one
+    if (httpCode < 0 && client.isPooled()) {
+        Serial.println("[Gemini] Pooled connection lost, reconnecting");
+        client.get().stop();
+        http.end();
+        http.begin(client.get(), url);
+        http.addHeader("Content-Type", "application/json");
+        http.setTimeout(30000);
+        httpCode = http.POST(requestBody);
+    }
+
     String response = "";
 
     if (httpCode > 0) {
         if (httpCode == HTTP_CODE_OK) {
+            // Without streaming the reply arrives in one piece
+            metricsEnd(Span::GEMINI_TTFB);
             String payload = http.getString();
             response = parseResponse(payload);
 
             if (!_hasError && response.length() > 0) {
-                // Add to conversation history
-                _history.push_back({"user", userMessage});
-                _history.push_back({"model", response});
-
-                // Limit history size
-                while (_history.size() > MAX_CONVERSATION_HISTORY * 2) {
-                    _history.erase(_history.begin());
-                    _history.erase(_history.begin());
-                }
+                metricsEnd(Span::GEMINI_TOTAL);
+                addToHistory(userMessage, response);
             }
         } else {
             String errorBody = http.getString();
@@ -91,43 +135,154 @@ String GeminiClient::chat(const String& userMessage) {
     return response;
 }
 
-String GeminiClient::buildRequestBody(const String& userMessage) {
-    JsonDocument doc;
-
-    // Build contents array with conversation history
-    JsonArray contents = doc["contents"].to<JsonArray>();
-
-    // Add system prompt as first user message if set
-    if (_systemPrompt.length() > 0 && _history.empty()) {
-        JsonObject systemMsg = contents.add<JsonObject>();
-        systemMsg["role"] = "user";
-        JsonArray parts = systemMsg["parts"].to<JsonArray>();
-        JsonObject part = parts.add<JsonObject>();
-        part["text"] = "System instructions: " + _systemPrompt;
-
-        // Add model acknowledgment
-        JsonObject ackMsg = contents.add<JsonObject>();
-        ackMsg["role"] = "model";
-        JsonArray ackParts = ackMsg["parts"].to<JsonArray>();
-        JsonObject ackPart = ackParts.add<JsonObject>();
-        ackPart["text"] = "Understood. I will follow these instructions.";
-    }
-
-    // Add conversation history
-    for (const auto& msg : _history) {
-        JsonObject historyMsg = contents.add<JsonObject>();
-        historyMsg["role"] = msg.role;
-        JsonArray parts = historyMsg["parts"].to<JsonArray>();
-        JsonObject part = parts.add<JsonObject>();
-        part["text"] = msg.content;
-    }
-
-    // Add current user message
-    JsonObject userMsg = contents.add<JsonObject>();
-    userMsg["role"] = "user";
-    JsonArray parts = userMsg["parts"].to<JsonArray>();
-    JsonObject part = parts.add<JsonObject>();
-    part["text"] = userMessage;
+String GeminiClient::chatStream(const String& userMessage, TextCallback onDelta) {
+    clearError();
+
+    if (_apiKey == nullptr || strlen(_apiKey) == 0) {
+        setError("API key not set");
+        return "";
+    }
+
+    String path = "/v1beta/models/";
+    path += _model;
+    path += ":streamGenerateContent?alt=sse&key=";
+    path += _apiKey;
+
+    // Written in pieces through the chunk buffer: the history goes out
+    // straight from its own storage
+    String userJson = serializeUserMessage(userMessage);
+
+    Serial.printf("[Gemini] Sending streaming request (%u history bytes)...\n", _history.size());
+
+    PooledClient client(_pool, GEMINI_API_HOST);
+    ChunkedRequest request;
+    metricsBegin(Span::GEMINI_TTFB);
+    metricsBegin(Span::GEMINI_TOTAL);
+    unsigned long startTime = millis();
+    int httpCode = -1;
+
+    // A pooled connection the server already closed fails before any
+    // response; retry once on a fresh one
+    for (int attempt = 0; attempt < 2 && httpCode <= 0; attempt++) {
+        if (attempt > 0) {
+            if (!client.isPooled()) break;
+            Serial.println("[Gemini] Pooled connection lost, reconnecting");
+            client.get().stop();
+        }
+
+        if (request.begin(client.get(), GEMINI_API_HOST, path, "application/json", true)) {
+            request.print(_requestPrefix);
+            request.write((const uint8_t*)_history.data(), _history.size());
+            request.print(userJson);
+            request.print(_requestSuffix);
+            httpCode = request.finish(30000);
+        }
+    }
+    userJson = "";
+
+    if (httpCode <= 0) {
+        setError("Connection failed");
+        request.abort();
+        return "";
+    }
+
+    if (httpCode != 200) {
+        String errorBody = request.readBody();
+        setError("HTTP error " + String(httpCode) + ": " + errorBody);
+        return "";
+    }
+
+    // Events arrive as "data: {json}" lines; each carries the next fragment
+    String response;
+    String line;
+    line.reserve(512);
+    uint8_t buffer[512];
+    bool stopped = false;
+    bool firstDelta = true;
+    int n = 0;
+
+    while (!_hasError && !stopped &&
+           (n = request.readBody(buffer, sizeof(buffer), 30000)) > 0) {
+        for (int i = 0; i < n && !_hasError && !stopped; i++) {
+            char c = (char)buffer[i];
+            if (c == '\r') continue;
+            if (c != '\n') {
+                if (line.length() < GEMINI_SSE_MAX_LINE) line += c;
+                continue;
+            }
+
+            if (line.startsWith("data:")) {
+                String delta = parseStreamEvent(line.c_str() + 5);
+                if (delta.length() > 0) {
+                    if (firstDelta) {
+                        metricsEnd(Span::GEMINI_TTFB);
+                        Serial.printf("[Gemini] First text after %lu ms\n", millis() - startTime);
+                        firstDelta = false;
+                    }
+                    response += delta;
+                    if (onDelta && !onDelta(delta)) stopped = true;
+                }
+            }
+            line = "";
+        }
+    }
+
+    // Only a fully read stream leaves the connection reusable
+    if (!request.isBodyComplete() || !request.isKeepAlive()) {
+        request.abort();
+        client.discard();
+    }
+
+    if (n < 0 && !_hasError) {
+        setError(response.length() > 0 ? "Response stream interrupted" : "Response stream timed out");
+    }
+
+    if (_hasError || stopped) {
+        return response;
+    }
+
+    if (response.length() == 0) {
+        setError("No response content found");
+        return "";
+    }
+
+    metricsEnd(Span::GEMINI_TOTAL);
+    Serial.printf("[Gemini] Streamed %d chars in %lu ms\n", response.length(), millis() - startTime);
+    addToHistory(userMessage, response);
+    return response;
+}
+
+String GeminiClient::parseStreamEvent(const char* data) {
+    String text, error;
+    if (!geminiParseStreamEvent(data, &_jsonAllocator, text, error)) {
+        setError(error);
+        return "";
+    }
+    return text;
+}
+
+void GeminiClient::addToHistory(const String& userMessage, const String& response) {
+    // Oldest turns are dropped inside the history's byte budget
+    _history.add(userMessage, response);
+}
+
+void GeminiClient::buildRequestPrefix() {
+    _requestPrefix = "{";
+    if (_systemPrompt.length() > 0) {
+        JsonDocument doc(&_jsonAllocator);
+        doc["parts"][0]["text"] = _systemPrompt;
+
+        String json;
+        serializeJson(doc, json);
+        _requestPrefix += "\"systemInstruction\":";
+        _requestPrefix += json;
+        _requestPrefix += ",";
+    }
+    _requestPrefix += "\"contents\":[";
+}
+
+void GeminiClient::buildRequestSuffix() {
+    JsonDocument doc(&_jsonAllocator);
 
     // Generation config
     JsonObject genConfig = doc["generationConfig"].to<JsonObject>();
@@ -148,52 +303,49 @@ String GeminiClient::buildRequestBody(const String& userMessage) {
         setting["threshold"] = "BLOCK_NONE";
     }
 
-    String output;
-    serializeJson(doc, output);
-    return output;
+    // Closes the contents array; the object's own brace is dropped
+    String json;
+    serializeJson(doc, json);
+    _requestSuffix = "],";
+    _requestSuffix += json.c_str() + 1;
 }
 
-String GeminiClient::parseResponse(const String& response) {
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, response);
+String GeminiClient::serializeUserMessage(const String& userMessage) {
+    size_t length = ChatHistory::serializeMessage("user", userMessage.c_str(), nullptr);
+    char* json = (char*)malloc(length + 1);
+    if (!json) return "";
 
-    if (error) {
-        setError("JSON parse error: " + String(error.c_str()));
-        return "";
-    }
+    ChatHistory::serializeMessage("user", userMessage.c_str(), json);
+    json[length] = '\0';
+    String result(json);
+    free(json);
+    return result;
+}
 
-    // Check for API error
-    if (doc.containsKey("error")) {
-        String errorMsg = doc["error"]["message"].as<String>();
-        setError("API error: " + errorMsg);
-        return "";
+String GeminiClient::buildRequestBody(const String& userMessage) {
+    String userJson = serializeUserMessage(userMessage);
+
+    String body;
+    body.reserve(_requestPrefix.length() + _history.size() + userJson.length() +
+                 _requestSuffix.length());
+    body += _requestPrefix;
+    if (_history.size() > 0) {
+        body += _history.data();
     }
+    body += userJson;
+    body += _requestSuffix;
+    return body;
+}
 
-    // Extract text from response
-    if (doc.containsKey("candidates") && doc["candidates"].size() > 0) {
-        JsonObject candidate = doc["candidates"][0];
-
-        if (candidate.containsKey("content")) {
-            JsonArray parts = candidate["content"]["parts"];
-            if (parts.size() > 0) {
-                String text = parts[0]["text"].as<String>();
-                Serial.println("[Gemini] Response received: " + String(text.length()) + " chars");
-                return text;
-            }
-        }
-
-        // Check for blocked content
-        if (candidate.containsKey("finishReason")) {
-            String reason = candidate["finishReason"].as<String>();
-            if (reason == "SAFETY") {
-                setError("Response blocked by safety filter");
-                return "";
-            }
-        }
+String GeminiClient::parseResponse(const String& response) {
+    String text, error;
+    if (!geminiParseResponse(response.c_str(), response.length(), &_jsonAllocator, text, error)) {
+        setError(error);
+        return "";
     }
 
-    setError("No response content found");
-    return "";
+    Serial.println("[Gemini] Response received: " + String(text.length()) + " chars");
+    return text;
 }
 
 void GeminiClient::setError(const String& error) {
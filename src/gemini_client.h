@@ -5,15 +5,22 @@
 #include <WiFiClientSecure.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
-#include <vector>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "connection_pool.h"
+#include "memory_arena.h"
+#include "chat_history.h"
 
-struct ChatMessage {
-    String role;    // "user" or "model"
-    String content;
-};
+// Stack for any task calling chat()/chatStream(): a TLS handshake, the 2 KB
+// chunked request, the read buffer and JSON filter, or the HTTPClient fallback
+#define GEMINI_TASK_STACK  12288
 
 class GeminiClient {
 public:
+    // Receives each text fragment as it is generated; return false to stop
+    using TextCallback = std::function<bool(const String& delta)>;
+
     GeminiClient();
 
     void begin(const char* apiKey);
@@ -21,33 +28,62 @@ public:
     void setMaxTokens(int maxTokens);
     void setSystemPrompt(const String& prompt);
 
+    // Send requests over a pooled keep-alive connection (optional)
+    void setConnectionPool(ConnectionPool* pool);
+
+    // Build and parse JSON documents in the turn arena (optional)
+    void setArena(TurnArena* arena) { _jsonAllocator.setArena(arena); }
+
     // Send a message and get response
     String chat(const String& userMessage);
 
+    // Streaming variant over streamGenerateContent (SSE): onDelta sees the
+    // reply while it is generated. Returns the full text, like chat()
+    String chatStream(const String& userMessage, TextCallback onDelta);
+
+    // Record a turn answered without a request (e.g. from the response cache)
+    void addToHistory(const String& userMessage, const String& response);
+
     // Clear conversation history
     void clearHistory();
 
     // Get conversation history
-    const std::vector<ChatMessage>& getHistory() const { return _history; }
+    const ChatHistory& getHistory() const { return _history; }
 
     // Error handling
     bool hasError() const { return _hasError; }
     String getLastError() const { return _lastError; }
 
+    // Serializes callers on different tasks (voice turn, web chat). Hold it
+    // across a request and the hasError()/getLastError() checks after it
+    void lock();
+    void unlock();
+
 private:
     const char* _apiKey;
     String _model;
     int _maxTokens;
     String _systemPrompt;
-    std::vector<ChatMessage> _history;
+    ChatHistory _history;
+
+    // Request JSON around the contents array, serialized once: system
+    // instruction before it, generation config and safety settings after
+    String _requestPrefix;
+    String _requestSuffix;
 
     bool _hasError;
     String _lastError;
 
-    WiFiClientSecure _client;
+    ConnectionPool* _pool;
+    ArenaJsonAllocator _jsonAllocator;
+    SemaphoreHandle_t _mutex;
 
+    void buildRequestPrefix();
+    void buildRequestSuffix();
+    String serializeUserMessage(const String& userMessage);
     String buildRequestBody(const String& userMessage);
     String parseResponse(const String& response);
+    String parseStreamEvent(const char* data);
     void setError(const String& error);
     void clearError();
 };
@@ -0,0 +1,61 @@
+#include "gemini_parse.h"
+
+// Bad JSON or an API error object instead of a reply
+static bool replyFailed(JsonDocument& doc, const DeserializationError& parseError, String& error) {
+    if (parseError) {
+        error = "JSON parse error: " + String(parseError.c_str());
+        return true;
+    }
+
+    if (!doc["error"].isNull()) {
+        error = "API error: " + String(doc["error"]["message"] | "");
+        return true;
+    }
+    return false;
+}
+
+static bool blockedBySafety(JsonObject candidate, String& error) {
+    String reason = candidate["finishReason"] | "";
+    if (reason != "SAFETY") return false;
+    error = "Response blocked by safety filter";
+    return true;
+}
+
+bool geminiParseResponse(const char* json, size_t length, ArduinoJson::Allocator* allocator,
+                         String& text, String& error) {
+    JsonDocument doc(allocator);
+    DeserializationError parseError = deserializeJson(doc, json, length);
+    if (replyFailed(doc, parseError, error)) return false;
+
+    // Extract text from the first candidate
+    JsonObject candidate = doc["candidates"][0];
+    JsonArray parts = candidate["content"]["parts"];
+    if (parts.size() > 0) {
+        text = parts[0]["text"] | "";
+        return true;
+    }
+
+    if (!blockedBySafety(candidate, error)) {
+        error = "No response content found";
+    }
+    return false;
+}
+
+bool geminiParseStreamEvent(const char* data, ArduinoJson::Allocator* allocator,
+                            String& text, String& error) {
+    // Keep only the fields we read; events also carry usage and safety metadata
+    JsonDocument filter(allocator);
+    filter["candidates"][0]["content"]["parts"][0]["text"] = true;
+    filter["candidates"][0]["finishReason"] = true;
+    filter["error"]["message"] = true;
+
+    JsonDocument doc(allocator);
+    DeserializationError parseError = deserializeJson(doc, data, DeserializationOption::Filter(filter));
+    if (replyFailed(doc, parseError, error)) return false;
+
+    JsonObject candidate = doc["candidates"][0];
+    if (blockedBySafety(candidate, error)) return false;
+
+    text = candidate["content"]["parts"][0]["text"] | "";
+    return true;
+}
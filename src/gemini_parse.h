@@ -0,0 +1,22 @@
+#ifndef GEMINI_PARSE_H
+#define GEMINI_PARSE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Gemini response parsing, kept apart from the network code so the host
+// benchmarks link and time exactly what GeminiClient runs. JSON documents
+// are built with allocator (the turn arena on the device).
+// Both return false with error set for bad JSON, an API error or a reply
+// blocked by the safety filter.
+
+// Full generateContent response: text of the first candidate
+bool geminiParseResponse(const char* json, size_t length, ArduinoJson::Allocator* allocator,
+                         String& text, String& error);
+
+// One streamGenerateContent SSE event (the data after "data:"): its text
+// fragment, which may be empty. Only the fields read are kept from the JSON
+bool geminiParseStreamEvent(const char* data, ArduinoJson::Allocator* allocator,
+                            String& text, String& error);
+
+#endif // GEMINI_PARSE_H
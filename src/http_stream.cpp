@@ -0,0 +1,277 @@
+#include "http_stream.h"
+
+#define HTTPS_PORT 443
+
+ChunkedRequest::ChunkedRequest()
+    : _client(nullptr)
+    , _cancel(nullptr)
+    , _used(0)
+    , _bytesSent(0)
+    , _failed(false)
+    , _keepAlive(false)
+    , _chunkedResponse(false)
+    , _contentLength(-1)
+    , _bodyRemaining(0)
+    , _bodyDone(false)
+{
+}
+
+bool ChunkedRequest::begin(WiFiClient& client, const char* host, const String& path,
+                           const char* contentType, bool keepAlive) {
+    _client = &client;
+    _used = 0;
+    _bytesSent = 0;
+    _failed = false;
+    _keepAlive = keepAlive;
+    _chunkedResponse = false;
+    _contentLength = -1;
+    _bodyRemaining = 0;
+    _bodyDone = false;
+
+    if (!_client->connected() && !_client->connect(host, HTTPS_PORT)) {
+        Serial.printf("[HTTP] Failed to connect to %s\n", host);
+        _failed = true;
+        return false;
+    }
+
+    String head = "POST " + path + " HTTP/1.1\r\n";
+    head += "Host: ";
+    head += host;
+    head += "\r\nContent-Type: ";
+    head += contentType;
+    head += "\r\nTransfer-Encoding: chunked\r\nConnection: ";
+    head += keepAlive ? "keep-alive" : "close";
+    head += "\r\n\r\n";
+
+    return writeRaw((const uint8_t*)head.c_str(), head.length());
+}
+
+bool ChunkedRequest::write(const uint8_t* data, size_t length) {
+    while (length > 0 && !_failed) {
+        size_t toCopy = min(length, sizeof(_buffer) - _used);
+        memcpy(_buffer + _used, data, toCopy);
+        _used += toCopy;
+        data += toCopy;
+        length -= toCopy;
+
+        if (_used == sizeof(_buffer) && !flushChunk()) {
+            return false;
+        }
+    }
+    return !_failed;
+}
+
+bool ChunkedRequest::print(const char* text) {
+    return write((const uint8_t*)text, strlen(text));
+}
+
+bool ChunkedRequest::flushChunk() {
+    if (_used == 0) return true;
+
+    char sizeLine[12];
+    int n = snprintf(sizeLine, sizeof(sizeLine), "%X\r\n", (unsigned)_used);
+
+    bool ok = writeRaw((const uint8_t*)sizeLine, n) &&
+              writeRaw(_buffer, _used) &&
+              writeRaw((const uint8_t*)"\r\n", 2);
+
+    _bytesSent += _used;
+    _used = 0;
+    return ok;
+}
+
+bool ChunkedRequest::writeRaw(const uint8_t* data, size_t length) {
+    if (_failed || !_client) return false;
+    if (cancelled()) {
+        _failed = true;
+        return false;
+    }
+
+    while (length > 0) {
+        size_t written = _client->write(data, length);
+        if (written == 0) {
+            Serial.println("[HTTP] Socket write failed");
+            _failed = true;
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+int ChunkedRequest::finish(uint32_t timeoutMs) {
+    if (!flushChunk() || !writeRaw((const uint8_t*)"0\r\n\r\n", 5)) {
+        return -1;
+    }
+
+    // Status line: "HTTP/1.1 200 OK"
+    String line;
+    if (!readLine(line, timeoutMs)) {
+        _failed = true;
+        _keepAlive = false;
+        return -1;
+    }
+
+    int space = line.indexOf(' ');
+    int statusCode = space > 0 ? line.substring(space + 1).toInt() : -1;
+
+    // Headers: only the framing ones matter here. Losing the connection
+    // before the blank line leaves the framing unknown
+    while (true) {
+        if (!readLine(line, timeoutMs)) {
+            _failed = true;
+            _keepAlive = false;
+            return -1;
+        }
+        if (line.length() == 0) break;
+
+        String header = line;
+        header.toLowerCase();
+        if (header.startsWith("transfer-encoding:") && header.indexOf("chunked") > 0) {
+            _chunkedResponse = true;
+        } else if (header.startsWith("content-length:")) {
+            _contentLength = header.substring(15).toInt();
+        } else if (header.startsWith("connection:") && header.indexOf("close") > 0) {
+            _keepAlive = false;
+        }
+    }
+
+    // Framing for readBody: chunk sizes are read lazily, one chunk at a time
+    if (_chunkedResponse) {
+        _bodyRemaining = 0;
+    } else if (_contentLength >= 0) {
+        _bodyRemaining = _contentLength;
+        _bodyDone = _contentLength == 0;
+    } else {
+        _bodyRemaining = -1;
+        _keepAlive = false;  // Close-delimited body
+    }
+
+    return statusCode;
+}
+
+String ChunkedRequest::readBody(size_t maxLength, uint32_t timeoutMs) {
+    String body;
+    if (_failed || !_client) return body;
+
+    if (_contentLength >= 0) {
+        body.reserve(min((size_t)_contentLength, maxLength));
+    }
+
+    uint8_t buffer[256];
+    int n;
+    while ((n = readBody(buffer, sizeof(buffer), timeoutMs)) > 0) {
+        for (int i = 0; i < n && body.length() < maxLength; i++) {
+            body += (char)buffer[i];
+        }
+    }
+
+    if (!_keepAlive) {
+        _client->stop();
+    }
+
+    return body;
+}
+
+int ChunkedRequest::readBody(uint8_t* buffer, size_t length, uint32_t timeoutMs) {
+    if (_failed || !_client) return -1;
+    if (_bodyDone) return 0;
+
+    if (_chunkedResponse && _bodyRemaining == 0) {
+        String sizeLine;
+        if (!readLine(sizeLine, timeoutMs)) {
+            _failed = true;
+            _keepAlive = false;
+            return -1;
+        }
+
+        long chunkSize = strtol(sizeLine.c_str(), nullptr, 16);
+        if (chunkSize <= 0) {
+            // Last chunk: skip any trailers up to the blank line
+            while (readLine(sizeLine, timeoutMs) && sizeLine.length() > 0) {}
+            _bodyDone = true;
+            return 0;
+        }
+        _bodyRemaining = chunkSize;
+    }
+
+    // Wait for data
+    uint32_t start = millis();
+    while (!_client->available()) {
+        if (cancelled()) {
+            _keepAlive = false;
+            _failed = true;
+            return -1;
+        }
+        if (!_client->connected() || millis() - start > timeoutMs) {
+            _keepAlive = false;
+            if (_bodyRemaining < 0) {
+                _bodyDone = true;  // Server closed: end of a close-delimited body
+                return 0;
+            }
+            _failed = true;
+            return -1;
+        }
+        delay(1);
+    }
+
+    size_t toRead = length;
+    if (_bodyRemaining > 0) {
+        toRead = min(toRead, (size_t)_bodyRemaining);
+    }
+    toRead = min(toRead, (size_t)_client->available());
+
+    int n = _client->read(buffer, toRead);
+    if (n <= 0) return 0;
+
+    if (_bodyRemaining > 0) {
+        _bodyRemaining -= n;
+        if (_bodyRemaining == 0) {
+            if (_chunkedResponse) {
+                String crlf;
+                readLine(crlf, timeoutMs);  // CRLF after chunk data
+            } else {
+                _bodyDone = true;
+            }
+        }
+    }
+
+    return n;
+}
+
+bool ChunkedRequest::skipBody(uint32_t timeoutMs) {
+    uint8_t buffer[256];
+    int n;
+    while ((n = readBody(buffer, sizeof(buffer), timeoutMs)) > 0) {}
+    return n == 0 && _bodyDone;
+}
+
+void ChunkedRequest::abort() {
+    if (_client) {
+        _client->stop();
+    }
+    _failed = true;
+}
+
+bool ChunkedRequest::readLine(String& line, uint32_t timeoutMs) {
+    line = "";
+    while (true) {
+        int c = readByte(timeoutMs);
+        if (c < 0) return false;
+        if (c == '\n') break;
+        if (c != '\r') line += (char)c;
+    }
+    return true;
+}
+
+int ChunkedRequest::readByte(uint32_t timeoutMs) {
+    uint32_t start = millis();
+    while (!_client->available()) {
+        if (cancelled() || !_client->connected() || millis() - start > timeoutMs) {
+            return -1;
+        }
+        delay(1);
+    }
+    return _client->read();
+}
@@ -0,0 +1,74 @@
+#ifndef HTTP_STREAM_H
+#define HTTP_STREAM_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+#define HTTP_STREAM_CHUNK_SIZE  2048  // Body bytes buffered per transfer chunk
+
+// Minimal HTTP/1.1 client for request bodies too large to hold in memory.
+// The body is written through a small fixed buffer and sent with chunked
+// transfer encoding; the response body is de-chunked on read.
+class ChunkedRequest {
+public:
+    ChunkedRequest();
+
+    // Connects (if needed) and sends the request line and headers
+    bool begin(WiFiClient& client, const char* host, const String& path,
+               const char* contentType = "application/json", bool keepAlive = false);
+
+    // Append body data (sent whenever the chunk buffer fills)
+    bool write(const uint8_t* data, size_t length);
+    bool print(const char* text);
+    bool print(const String& text) { return print(text.c_str()); }
+
+    // Terminate the body and read the response status line and headers
+    // Returns the HTTP status code, or -1 on failure
+    int finish(uint32_t timeoutMs = 30000);
+
+    // Read the response body (after finish), up to maxLength bytes
+    String readBody(size_t maxLength = 16384, uint32_t timeoutMs = 10000);
+
+    // Stream the response body (after finish), de-chunked
+    // Returns bytes read, 0 at end of body, or -1 on error/timeout
+    int readBody(uint8_t* buffer, size_t length, uint32_t timeoutMs = 10000);
+
+    // Discard the rest of the body so the connection can be reused
+    bool skipBody(uint32_t timeoutMs = 10000);
+    bool isBodyComplete() const { return _bodyDone; }
+
+    // Drop the connection without waiting for a response
+    void abort();
+
+    // Another task sets *cancel to make every socket wait give up (the
+    // request fails) instead of running to its timeout
+    void setCancelFlag(const volatile bool* cancel) { _cancel = cancel; }
+
+    bool hasFailed() const { return _failed; }
+    size_t getBytesSent() const { return _bytesSent; }
+    // True when the body was fully read and the server allows reuse
+    bool isKeepAlive() const { return _keepAlive; }
+
+private:
+    WiFiClient* _client;
+    const volatile bool* _cancel;
+    uint8_t _buffer[HTTP_STREAM_CHUNK_SIZE];
+    size_t _used;
+    size_t _bytesSent;
+    bool _failed;
+    bool _keepAlive;
+
+    // Response framing
+    bool _chunkedResponse;
+    int _contentLength;
+    long _bodyRemaining;  // Bytes left in the current chunk / body, -1 = until close
+    bool _bodyDone;
+
+    bool flushChunk();
+    bool writeRaw(const uint8_t* data, size_t length);
+    bool cancelled() const { return _cancel && *_cancel; }
+    bool readLine(String& line, uint32_t timeoutMs);
+    int readByte(uint32_t timeoutMs);
+};
+
+#endif // HTTP_STREAM_H
@@ -0,0 +1,33 @@
+#ifndef INTENT_MATCHER_H
+#define INTENT_MATCHER_H
+
+#include <Arduino.h>
+
+// Device commands recognized in the transcript and handled on the device,
+// without a Gemini or TTS round trip
+enum class Intent {
+    NONE,
+    VOLUME_UP,
+    VOLUME_DOWN,
+    VOLUME_SET,     // value: 0-100 (mute is 0)
+    STOP,
+    STATUS          // IP address, signal and volume
+};
+
+struct IntentMatch {
+    Intent intent;
+    int value;
+};
+
+// A command is a short phrase from a fixed grammar: the transcript is
+// lowercased, punctuation dropped and filler words ("please", "the", "can
+// you") skipped, and what is left has to be one of the phrases exactly.
+// Everything else goes to Gemini, so "what is the volume of a sphere"
+// ("volume of sphere") is never taken for a command. More than
+// INTENT_MAX_WORDS words left is never a command.
+#define INTENT_MAX_WORDS   8
+
+bool matchIntent(const String& transcript, IntentMatch& match);
+const char* intentName(Intent intent);
+
+#endif // INTENT_MATCHER_H
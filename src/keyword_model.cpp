@@ -0,0 +1,283 @@
+#include "keyword_model.h"
+#include "config.h"
+#include <cmath>
+#include <esp_heap_caps.h>
+
+#if WAKE_WORD_MODEL_TFLITE
+#include <tensorflow/lite/micro/micro_interpreter.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+#endif
+
+#define MFCC_LOW_HZ       20.0f
+#define MFCC_LOG_FLOOR    1e-6f   // Keeps log() finite on silent bands
+
+static float hzToMel(float hz) {
+    return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+static float melToHz(float mel) {
+    return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+// -----------------------------------------------------------------------------
+// MfccFrontEnd
+// -----------------------------------------------------------------------------
+
+MfccFrontEnd::MfccFrontEnd()
+    : _head(0)
+    , _frames(0)
+{
+}
+
+void MfccFrontEnd::begin(int sampleRate) {
+    for (size_t n = 0; n < FRAME_SIZE; n++) {
+        _window[n] = 0.5f - 0.5f * cosf(2.0f * M_PI * n / (FRAME_SIZE - 1));
+    }
+    for (size_t k = 0; k < FRAME_SIZE / 2; k++) {
+        _cos[k] = cosf(2.0f * M_PI * k / FRAME_SIZE);
+        _sin[k] = -sinf(2.0f * M_PI * k / FRAME_SIZE);
+    }
+
+    // Triangular bands evenly spaced on the mel scale up to Nyquist
+    float melLow = hzToMel(MFCC_LOW_HZ);
+    float melHigh = hzToMel(sampleRate / 2.0f);
+    for (size_t i = 0; i < MEL_BANDS + 2; i++) {
+        float hz = melToHz(melLow + (melHigh - melLow) * i / (MEL_BANDS + 1));
+        _melEdges[i] = min((size_t)lroundf(hz * FRAME_SIZE / sampleRate), FFT_BINS - 1);
+    }
+
+    // DCT-II, orthonormal
+    for (size_t c = 0; c < COEFFS; c++) {
+        float norm = sqrtf((c == 0 ? 1.0f : 2.0f) / MEL_BANDS);
+        for (size_t m = 0; m < MEL_BANDS; m++) {
+            _dct[c][m] = norm * cosf(M_PI * c * (m + 0.5f) / MEL_BANDS);
+        }
+    }
+
+    for (size_t c = 0; c < COEFFS; c++) {
+        _silence[c] = 0;
+        for (size_t m = 0; m < MEL_BANDS; m++) {
+            _silence[c] += _dct[c][m] * logf(MFCC_LOG_FLOOR);
+        }
+    }
+
+    reset();
+}
+
+void MfccFrontEnd::reset() {
+    _head = 0;
+    _frames = 0;
+}
+
+void MfccFrontEnd::process(const int16_t* samples) {
+    for (size_t n = 0; n < FRAME_SIZE; n++) {
+        _re[n] = samples[n] / 32768.0f * _window[n];
+        _im[n] = 0;
+    }
+    fft();
+
+    // Power spectrum, reusing _re for bins 0..N/2
+    for (size_t k = 0; k < FFT_BINS; k++) {
+        _re[k] = _re[k] * _re[k] + _im[k] * _im[k];
+    }
+
+    float logMel[MEL_BANDS];
+    for (size_t b = 0; b < MEL_BANDS; b++) {
+        size_t lo = _melEdges[b];
+        size_t center = _melEdges[b + 1];
+        size_t hi = _melEdges[b + 2];
+
+        float energy = 0;
+        for (size_t k = lo; k <= hi; k++) {
+            float weight;
+            if (k <= center) {
+                weight = center == lo ? 1.0f : (float)(k - lo) / (center - lo);
+            } else {
+                weight = (float)(hi - k) / (hi - center);
+            }
+            energy += weight * _re[k];
+        }
+        logMel[b] = logf(energy + MFCC_LOG_FLOOR);
+    }
+
+    float* out = _history[_head];
+    for (size_t c = 0; c < COEFFS; c++) {
+        float sum = 0;
+        for (size_t m = 0; m < MEL_BANDS; m++) {
+            sum += _dct[c][m] * logMel[m];
+        }
+        out[c] = sum;
+    }
+
+    _head = (_head + 1) % WINDOW_FRAMES;
+    if (_frames < WINDOW_FRAMES) _frames++;
+}
+
+void MfccFrontEnd::copyWindow(float* out) const {
+    size_t missing = WINDOW_FRAMES - _frames;
+    for (size_t f = 0; f < missing; f++) {
+        memcpy(out + f * COEFFS, _silence, sizeof(_silence));
+    }
+
+    size_t oldest = (_head + WINDOW_FRAMES - _frames) % WINDOW_FRAMES;
+    for (size_t f = 0; f < _frames; f++) {
+        memcpy(out + (missing + f) * COEFFS, _history[(oldest + f) % WINDOW_FRAMES], COEFFS * sizeof(float));
+    }
+}
+
+const float* MfccFrontEnd::getLatest() const {
+    if (_frames == 0) return _silence;
+    return _history[(_head + WINDOW_FRAMES - 1) % WINDOW_FRAMES];
+}
+
+void MfccFrontEnd::fft() {
+    // Iterative radix-2: bit-reverse, then butterflies of growing span
+    for (size_t i = 1, j = 0; i < FRAME_SIZE; i++) {
+        size_t bit = FRAME_SIZE >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            float t = _re[i]; _re[i] = _re[j]; _re[j] = t;
+            t = _im[i]; _im[i] = _im[j]; _im[j] = t;
+        }
+    }
+
+    for (size_t span = 2; span <= FRAME_SIZE; span <<= 1) {
+        size_t half = span >> 1;
+        size_t step = FRAME_SIZE / span;
+        for (size_t start = 0; start < FRAME_SIZE; start += span) {
+            for (size_t k = 0; k < half; k++) {
+                float wr = _cos[k * step];
+                float wi = _sin[k * step];
+                size_t a = start + k;
+                size_t b = a + half;
+                float tr = _re[b] * wr - _im[b] * wi;
+                float ti = _re[b] * wi + _im[b] * wr;
+                _re[b] = _re[a] - tr;
+                _im[b] = _im[a] - ti;
+                _re[a] += tr;
+                _im[a] += ti;
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// TfliteKeywordModel
+// -----------------------------------------------------------------------------
+
+TfliteKeywordModel::TfliteKeywordModel(const uint8_t* modelData, size_t arenaBytes)
+    : _modelData(modelData)
+    , _arenaBytes(arenaBytes)
+    , _arena(nullptr)
+    , _interpreter(nullptr)
+{
+}
+
+TfliteKeywordModel::~TfliteKeywordModel() {
+    release();
+}
+
+// Frees the interpreter and arena so a failed begin() can be retried
+void TfliteKeywordModel::release() {
+#if WAKE_WORD_MODEL_TFLITE
+    delete (tflite::MicroInterpreter*)_interpreter;
+#endif
+    _interpreter = nullptr;
+    if (_arena) {
+        heap_caps_free(_arena);
+        _arena = nullptr;
+    }
+}
+
+bool TfliteKeywordModel::begin() {
+#if WAKE_WORD_MODEL_TFLITE
+    if (_interpreter) return true;
+
+    const tflite::Model* model = tflite::GetModel(_modelData);
+    if (model->version() != TFLITE_SCHEMA_VERSION) {
+        Serial.printf("[Keyword] Model schema %d, expected %d\n", model->version(), TFLITE_SCHEMA_VERSION);
+        return false;
+    }
+
+    // Internal RAM keeps inference fast; PSRAM if it doesn't fit
+    _arena = (uint8_t*)heap_caps_malloc(_arenaBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!_arena) {
+        _arena = (uint8_t*)heap_caps_malloc(_arenaBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (!_arena) {
+        Serial.println("[Keyword] Failed to allocate tensor arena");
+        return false;
+    }
+
+    // Ops used by the usual small keyword-spotting CNNs
+    static tflite::MicroMutableOpResolver<8> resolver;
+    static bool resolverReady = false;
+    if (!resolverReady) {
+        resolver.AddConv2D();
+        resolver.AddDepthwiseConv2D();
+        resolver.AddFullyConnected();
+        resolver.AddAveragePool2D();
+        resolver.AddMaxPool2D();
+        resolver.AddReshape();
+        resolver.AddSoftmax();
+        resolver.AddLogistic();
+        resolverReady = true;
+    }
+
+    tflite::MicroInterpreter* interpreter = new tflite::MicroInterpreter(model, resolver, _arena, _arenaBytes);
+    if (interpreter->AllocateTensors() != kTfLiteOk) {
+        Serial.println("[Keyword] AllocateTensors failed (arena too small?)");
+        delete interpreter;
+        release();
+        return false;
+    }
+
+    TfLiteTensor* input = interpreter->input(0);
+    if (input->type != kTfLiteInt8 || input->bytes != sizeof(_input) / sizeof(float)) {
+        Serial.printf("[Keyword] Model input must be int8[%d], got %d bytes\n",
+                      sizeof(_input) / sizeof(float), input->bytes);
+        delete interpreter;
+        release();
+        return false;
+    }
+
+    _interpreter = interpreter;
+    Serial.printf("[Keyword] Model ready, %d of %d arena bytes used\n",
+                  interpreter->arena_used_bytes(), _arenaBytes);
+    return true;
+#else
+    Serial.println("[Keyword] Built without WAKE_WORD_MODEL_TFLITE");
+    return false;
+#endif
+}
+
+float TfliteKeywordModel::score(const MfccFrontEnd& features) {
+#if WAKE_WORD_MODEL_TFLITE
+    tflite::MicroInterpreter* interpreter = (tflite::MicroInterpreter*)_interpreter;
+    if (!interpreter) return 0;
+
+    features.copyWindow(_input);
+
+    // Quantize with the input tensor's own scale and zero point
+    TfLiteTensor* input = interpreter->input(0);
+    float scale = input->params.scale;
+    int zeroPoint = input->params.zero_point;
+    for (size_t i = 0; i < sizeof(_input) / sizeof(float); i++) {
+        int q = (int)lroundf(_input[i] / scale) + zeroPoint;
+        input->data.int8[i] = (int8_t)constrain(q, -128, 127);
+    }
+
+    if (interpreter->Invoke() != kTfLiteOk) {
+        Serial.println("[Keyword] Invoke failed");
+        return 0;
+    }
+
+    TfLiteTensor* output = interpreter->output(0);
+    int8_t q = output->data.int8[output->bytes - 1];
+    return (q - output->params.zero_point) * output->params.scale;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,87 @@
+#ifndef KEYWORD_MODEL_H
+#define KEYWORD_MODEL_H
+
+#include <Arduino.h>
+
+// MFCC features computed incrementally, one 512-sample wake word frame at a
+// time (32 ms at 16 kHz, no overlap). The last WINDOW_FRAMES frames are kept
+// so a model always sees the most recent ~1 s of audio.
+class MfccFrontEnd {
+public:
+    static const size_t FRAME_SIZE = 512;
+    static const size_t MEL_BANDS = 26;
+    static const size_t COEFFS = 13;
+    static const size_t WINDOW_FRAMES = 32;
+
+    MfccFrontEnd();
+
+    void begin(int sampleRate);
+    void reset();
+
+    // Append one frame of FRAME_SIZE samples
+    void process(const int16_t* samples);
+
+    // Frames held, up to WINDOW_FRAMES
+    size_t getFrameCount() const { return _frames; }
+
+    // Oldest-first copy of the window (WINDOW_FRAMES x COEFFS); frames not
+    // yet seen are filled with silence
+    void copyWindow(float* out) const;
+
+    // Coefficients of the newest frame
+    const float* getLatest() const;
+
+private:
+    static const size_t FFT_BINS = FRAME_SIZE / 2 + 1;
+
+    void fft();
+
+    float _window[FRAME_SIZE];
+    float _re[FRAME_SIZE];
+    float _im[FRAME_SIZE];
+    float _cos[FRAME_SIZE / 2];
+    float _sin[FRAME_SIZE / 2];
+    uint16_t _melEdges[MEL_BANDS + 2];  // FFT bins: band b spans edges b..b+2
+    float _dct[COEFFS][MEL_BANDS];
+    float _silence[COEFFS];             // Coefficients of an all-zero frame
+
+    float _history[WINDOW_FRAMES][COEFFS];
+    size_t _head;                       // Next slot to write
+    size_t _frames;
+};
+
+// Detection backend run on the MFCC window while the heuristic sees a burst
+class KeywordModel {
+public:
+    virtual ~KeywordModel() {}
+
+    virtual bool begin() = 0;
+    virtual const char* getName() const = 0;
+
+    // Probability (0-1) that the window ends with the keyword
+    virtual float score(const MfccFrontEnd& features) = 0;
+};
+
+// int8 TensorFlow Lite Micro model. Input is the MFCC window
+// [1, WINDOW_FRAMES, COEFFS]; the last output class is the keyword.
+// Needs WAKE_WORD_MODEL_TFLITE and the TFLM library; begin() fails otherwise
+class TfliteKeywordModel : public KeywordModel {
+public:
+    TfliteKeywordModel(const uint8_t* modelData, size_t arenaBytes);
+    ~TfliteKeywordModel();
+
+    bool begin() override;
+    const char* getName() const override { return "tflite-micro"; }
+    float score(const MfccFrontEnd& features) override;
+
+private:
+    void release();
+
+    const uint8_t* _modelData;
+    size_t _arenaBytes;
+    uint8_t* _arena;
+    void* _interpreter;  // tflite::MicroInterpreter, kept out of this header
+    float _input[MfccFrontEnd::WINDOW_FRAMES * MfccFrontEnd::COEFFS];
+};
+
+#endif // KEYWORD_MODEL_H
@@ -0,0 +1,23 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+
+// Serial log levels. LOG_LEVEL (config.h) is the most verbose one kept;
+// calls above it are constant-false branches the compiler removes, so
+// per-step detail costs nothing on the hot path unless asked for
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4
+
+#define LOG_AT(level, ...) \
+    do { if (LOG_LEVEL >= (level)) Serial.printf(__VA_ARGS__); } while (0)
+
+#define LOG_ERROR(...)  LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)   LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)   LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...)  LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#endif // LOG_H
@@ -13,27 +13,54 @@
  */
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include "config.h"
 #include "wifi_manager.h"
+#include "connection_pool.h"
 #include "gemini_client.h"
 #include "speech_client.h"
 #include "display.h"
+#include "mic_capture.h"
 #include "audio_input.h"
 #include "audio_output.h"
 #include "buttons.h"
 #include "led.h"
 #include "wake_word.h"
+#include "barge_in.h"
+#include "tts_pipeline.h"
+#include "memory_arena.h"
+#include "response_cache.h"
+#include "web_server.h"
+#include "metrics.h"
+#include "power_manager.h"
+#include "intent_matcher.h"
 
 // Global objects
 WiFiManager wifiManager;
+ConnectionPool connectionPool;
 GeminiClient gemini;
 SpeechClient speech;
 Display display;
+MicCapture mic;
 AudioInput audioInput;
 AudioOutput audioOutput;
 Buttons buttons;
 StatusLED statusLed;
 WakeWordDetector wakeWord;
+BargeInDetector bargeIn;
+TtsPipeline ttsPipeline;
+TurnArena turnArena;
+DmaPool dmaPool;
+ResponseCache responseCache;
+WebInterface webInterface;
+PowerManager power;
+
+#if WAKE_WORD_MODEL_TFLITE
+extern const unsigned char g_wake_word_model[];
+TfliteKeywordModel keywordModel(g_wake_word_model, WAKE_WORD_MODEL_ARENA_BYTES);
+#endif
 
 // TTS audio buffer (allocated in PSRAM)
 int16_t* ttsBuffer = nullptr;
@@ -54,61 +81,170 @@ AssistantState currentState = AssistantState::INIT;
 String lastError = "";
 int currentVolume = DEFAULT_VOLUME;
 
+// Voice turn worker: STT, Gemini and TTS block on the network for seconds,
+// so they run in their own task and loop() keeps the UI and buttons live
+#define VOICE_TASK_STACK   GEMINI_TASK_STACK
+#define VOICE_TASK_PRIO    1
+#define VOICE_TASK_CORE    1
+#define UI_EVENT_QUEUE_LEN 16  // Room for streamed reply fragments
+
+// Display and LED are not thread-safe: the worker posts events, loop() applies them
+enum class UiEventType {
+    STATE,
+    USER_MESSAGE,
+    AI_MESSAGE,
+    AI_DELTA,      // Fragment of a streamed reply
+    AI_DONE,       // Full text of a streamed reply
+    ERROR
+};
+
+struct UiEvent {
+    UiEventType type;
+    AssistantState state;
+    uint32_t turn;
+    String* text;  // Heap copy, deleted by the receiver
+};
+
+QueueHandle_t uiEvents = nullptr;
+volatile bool voiceTurnActive = false;
+volatile uint32_t currentTurn = 0;  // Bumped on cancel so stale events are dropped
+uint32_t workerTurn = 0;            // Turn the worker is running (worker-owned)
+
+// Network bring-up (WiFi, API clients, TLS warm-up, prompt synthesis) runs
+// on its own task while setup() brings up the buttons and audio
+#define NET_INIT_TASK_STACK  12288
+#define NET_INIT_TASK_PRIO   1
+#define NET_INIT_TASK_CORE   0  // setup() runs on core 1
+
+SemaphoreHandle_t networkReady = nullptr;
+volatile bool networkConnected = false;
+volatile bool responseCacheReady = false;
+
 // Forward declarations
 void setState(AssistantState newState);
+bool initNetwork();
+void startNetworkInit();
+bool waitNetworkInit();
 void handleButtonEvent(Button button, ButtonEvent event);
 void processVoiceInput();
+bool handleIntent(const IntentMatch& intent);
+int applyVolume(int volume);
+bool handleWebChat(const String& message, const WebInterface::TokenCallback& onToken, String& reply);
+void preparePrompts();
+bool playPrompt(const char* text);
 String getTextFromAudio();
 void onWakeWordDetected();
+void startVoiceInput(size_t prerollSamples = 0);
+bool voiceTurnIdle();
+void startVoiceTurn();
+void cancelVoiceTurn();
+void postUiEvent(UiEventType type, AssistantState state, const String& text);
+void applyUiEvents();
 
 // Wake word detection flag (set from callback, processed in main loop)
 volatile bool wakeWordTriggered = false;
 
+// Set by the playback task once the reply (or prompt) has played out
+volatile bool speechDone = false;
+
+// Barge-in flag (set from the detector task); the new turn waits for the
+// cancelled worker, which still owns the speech client
+volatile bool bargeInTriggered = false;
+bool bargeInPending = false;
+
 // Wake word callback - called from detection task
 void onWakeWordDetected() {
+    metricsBegin(Span::WAKE_TO_RECORD);
     wakeWordTriggered = true;
+    power.boost();  // Also wakes loop() to start recording
+}
+
+void onBargeIn() {
+    bargeInTriggered = true;
+}
+
+void voiceTurnTask(void* param) {
+    workerTurn = (uint32_t)(uintptr_t)param;
+    processVoiceInput();
+    connectionPool.printStats();
+    voiceTurnActive = false;
+    vTaskDelete(NULL);
 }
 
 void setup() {
     Serial.begin(SERIAL_BAUD_RATE);
-    delay(1000);
+    if (BOOT_SERIAL_WAIT_MS > 0) {
+        delay(BOOT_SERIAL_WAIT_MS);
+    }
 
     Serial.println("\n========================================");
     Serial.println("   ESP32-S3 AI Assistant Starting...");
     Serial.println("========================================\n");
 
-    // Initialize display first for visual feedback
+    // Initialize display first for visual feedback; the splash stays up
+    // until the network is ready
     display.begin();
     display.showSplash();
-    delay(1500);
 
     // Initialize status LED
     statusLed.begin();
-    statusLed.setConnecting();
+
+    // Turn buffers come from fixed pools instead of the heap; without them
+    // allocations fall back to malloc as before
+    turnArena.begin(TURN_ARENA_BYTES);
+    dmaPool.begin(DMA_POOL_BLOCK_BYTES, DMA_POOL_BLOCKS);
+
+    // Connect to WiFi and set up the API clients on another task while the
+    // buttons and audio come up
+    setState(AssistantState::CONNECTING_WIFI);
+    startNetworkInit();
 
     // Initialize buttons
     buttons.begin();
     buttons.setCallback(handleButtonEvent);
 
+    uiEvents = xQueueCreate(UI_EVENT_QUEUE_LEN, sizeof(UiEvent));
+
     // Ensure BOOT button pin is configured correctly (GPIO 0)
     pinMode(BTN_BOOT_PIN, INPUT_PULLUP);
     Serial.println("[Buttons] BOOT pin configured: GPIO " + String(BTN_BOOT_PIN));
 
+    // Idle CPU frequency, loop pacing and backlight timeouts
+    if (POWER_MANAGEMENT_ENABLED) {
+        power.begin(display, buttons);
+    }
+
     // Initialize audio
-    if (!audioInput.begin()) {
+    // One capture task owns the mic; recorder and wake word subscribe to it
+    if (!mic.begin() || !audioInput.begin(mic)) {
         Serial.println("[ERROR] Audio input initialization failed");
     }
 
+    // Feed live transcription while recording
+    audioInput.setAudioCallback([](const int16_t* samples, size_t count) {
+        if (audioInput.isRecording() && speech.isTranscribing()) {
+            speech.feedTranscription(samples, count);
+        }
+    });
+
+    audioOutput.setArena(&turnArena);
+    audioOutput.setDmaPool(&dmaPool);
     if (!audioOutput.begin()) {
         Serial.println("[ERROR] Audio output initialization failed");
     }
 
     audioOutput.setVolume(currentVolume);
+    audioOutput.setDoneCallback([](Voice voice) {
+        if (voice == Voice::SPEECH) {
+            metricsEnd(Span::TURN);
+            speechDone = true;
+        }
+    });
 
-    // Connect to WiFi
-    setState(AssistantState::CONNECTING_WIFI);
+    bool connected = waitNetworkInit();
+    Serial.printf("[System] Network ready after %lu ms\n", millis());
 
-    wifiManager.begin(WIFI_SSID, WIFI_PASSWORD);
+    // Later connection changes are reported from loop(), which owns the display
     wifiManager.setStatusCallback([](WiFiManager::State state, const String& message) {
         switch (state) {
             case WiFiManager::State::CONNECTING:
@@ -120,45 +256,48 @@ void setup() {
             case WiFiManager::State::ERROR:
                 display.showError(message);
                 break;
+            case WiFiManager::State::DISCONNECTED:
+                // Pooled TLS sessions don't survive a drop; reconnect fresh
+                connectionPool.closeAll();
+                break;
             default:
                 break;
         }
     });
 
-    if (wifiManager.connect(WIFI_CONNECT_TIMEOUT_MS)) {
-        Serial.println("[WiFi] Connected successfully");
-        Serial.println("[WiFi] IP: " + wifiManager.getIP());
-
-        // Initialize Gemini client
-        gemini.begin(GEMINI_API_KEY);
-        gemini.setSystemPrompt(
-            "You are a voice assistant on an ESP32. CRITICAL: Keep ALL responses under 50 words. "
-            "Be brief and conversational - this is spoken output, not text. "
-            "Never use bullet points, lists, or markdown. Just speak naturally in 1-2 short sentences."
-        );
-
-        // Initialize Speech client (STT/TTS)
-        speech.begin(GOOGLE_CLOUD_API_KEY);
-        speech.setLanguage(SPEECH_LANGUAGE);
-        speech.setVoice(TTS_VOICE);
-
-        // Allocate TTS buffer in PSRAM
-        ttsBufferSize = TTS_MAX_SAMPLES;
-        if (psramFound()) {
-            ttsBuffer = (int16_t*)ps_malloc(ttsBufferSize * sizeof(int16_t));
-            Serial.println("[System] TTS buffer allocated in PSRAM");
-        } else {
-            ttsBuffer = (int16_t*)malloc(ttsBufferSize * sizeof(int16_t));
-            Serial.println("[System] TTS buffer allocated in RAM");
+    if (connected) {
+        // Allocate TTS clip buffer in PSRAM (streaming TTS only needs AudioOutput's ring);
+        // the pipeline splits it into two slots, so one sentence can be ~15 s
+        if (!TTS_STREAMING_ENABLED) {
+            ttsBufferSize = TTS_MAX_SAMPLES;
+            if (psramFound()) {
+                ttsBuffer = (int16_t*)ps_malloc(ttsBufferSize * sizeof(int16_t));
+                Serial.println("[System] TTS buffer allocated in PSRAM");
+            } else {
+                ttsBuffer = (int16_t*)malloc(ttsBufferSize * sizeof(int16_t));
+                Serial.println("[System] TTS buffer allocated in RAM");
+            }
+
+            if (!ttsBuffer) {
+                Serial.println("[ERROR] Failed to allocate TTS buffer");
+            }
+            ttsPipeline.setClipBuffer(ttsBuffer, ttsBufferSize);
         }
 
-        if (!ttsBuffer) {
-            Serial.println("[ERROR] Failed to allocate TTS buffer");
+        // Speaks replies sentence by sentence while the next one downloads
+        if (responseCacheReady) {
+            ttsPipeline.setAudioSink(&responseCache);
+        }
+        if (!ttsPipeline.begin(speech, audioOutput, I2S_SPK_SAMPLE_RATE)) {
+            Serial.println("[ERROR] TTS pipeline initialization failed");
         }
 
         // Initialize wake word detector
         if (WAKE_WORD_ENABLED) {
-            if (wakeWord.begin()) {
+#if WAKE_WORD_MODEL_TFLITE
+            wakeWord.setModel(&keywordModel, WAKE_WORD_MODEL_THRESHOLD);
+#endif
+            if (wakeWord.begin(mic)) {
                 wakeWord.setSensitivity(WAKE_WORD_SENSITIVITY);
                 wakeWord.setCallback(onWakeWordDetected);
                 Serial.println("[System] Wake word detection enabled");
@@ -167,7 +306,24 @@ void setup() {
             }
         }
 
-        delay(1000);
+        // Listens over replies so the user can interrupt by talking
+        if (BARGE_IN_ENABLED && bargeIn.begin(mic, audioOutput)) {
+            bargeIn.setCallback(onBargeIn);
+        }
+
+        // Browser chat shares the Gemini conversation; requests run on the
+        // web worker task, not on AsyncTCP
+        if (WEB_SERVER_ENABLED) {
+            webInterface.setChatCallback(handleWebChat);
+            webInterface.setVolumeCallback([](int volume) {
+                currentVolume = constrain(volume, MIN_VOLUME, MAX_VOLUME);
+                audioOutput.setVolume(currentVolume);
+            });
+            if (webInterface.begin()) {
+                Serial.println("[System] Web interface at http://" + wifiManager.getIP());
+            }
+        }
+
         setState(AssistantState::IDLE);
     } else {
         Serial.println("[WiFi] Connection failed");
@@ -179,15 +335,96 @@ void setup() {
     display.showChat();
 
     Serial.println("\n[System] Ready! Press BOOT button to talk.");
+    if (currentState == AssistantState::IDLE) {
+        playPrompt(PROMPT_GREETING);
+    }
+}
+
+// Runs on the network task. Touches nothing the main init uses at the same
+// time: no display (the status callback is set afterwards) and no audio
+bool initNetwork() {
+    wifiManager.begin(WIFI_SSID, WIFI_PASSWORD);
+    if (!wifiManager.connect(WIFI_CONNECT_TIMEOUT_MS)) {
+        return false;
+    }
+
+    Serial.println("[WiFi] Connected successfully");
+    Serial.println("[WiFi] IP: " + wifiManager.getIP());
+
+    // Initialize Gemini client
+    gemini.begin(GEMINI_API_KEY);
+    gemini.setSystemPrompt(
+        "You are a voice assistant on an ESP32. CRITICAL: Keep ALL responses under 50 words. "
+        "Be brief and conversational - this is spoken output, not text. "
+        "Never use bullet points, lists, or markdown. Just speak naturally in 1-2 short sentences."
+    );
+
+    // Initialize Speech client (STT/TTS)
+    speech.begin(GOOGLE_CLOUD_API_KEY);
+    speech.setLanguage(SPEECH_LANGUAGE);
+    speech.setVoice(TTS_VOICE);
+    speech.setEncoding(SPEECH_AUDIO_ENCODING);
+
+    gemini.setArena(&turnArena);
+    speech.setArena(&turnArena);
+
+    // Keep TLS connections to the API hosts open between turns; the
+    // handshakes start now, alongside the prompt synthesis below
+    if (CONNECTION_POOL_ENABLED && connectionPool.begin()) {
+        gemini.setConnectionPool(&connectionPool);
+        speech.setConnectionPool(&connectionPool);
+        connectionPool.setWarmEnabled(true);
+    }
+
+    // Repeated questions are answered from the audio of the first answer
+    if (RESPONSE_CACHE_ENABLED &&
+        responseCache.begin(RESPONSE_CACHE_BYTES, I2S_SPK_SAMPLE_RATE, TTS_VOICE)) {
+        responseCache.setArena(&turnArena);
+        responseCache.loadPersisted();
+        preparePrompts();
+        responseCacheReady = true;
+    }
+
+    return true;
+}
+
+void networkInitTask(void* param) {
+    networkConnected = initNetwork();
+    xSemaphoreGive(networkReady);
+    vTaskDelete(NULL);
+}
+
+void startNetworkInit() {
+    networkReady = xSemaphoreCreateBinary();
+
+    BaseType_t result = networkReady ? xTaskCreatePinnedToCore(
+        networkInitTask, "net_init", NET_INIT_TASK_STACK, nullptr,
+        NET_INIT_TASK_PRIO, nullptr, NET_INIT_TASK_CORE) : pdFAIL;
+
+    if (result != pdPASS) {
+        // Still boots, just without the overlap
+        Serial.println("[System] Network init task failed, connecting inline");
+        networkConnected = initNetwork();
+        if (networkReady) {
+            xSemaphoreGive(networkReady);
+        }
+    }
+}
+
+bool waitNetworkInit() {
+    if (networkReady) {
+        xSemaphoreTake(networkReady, portMAX_DELAY);
+        vSemaphoreDelete(networkReady);
+        networkReady = nullptr;
+    }
+    return networkConnected;
 }
 
 void loop() {
     // Ensure GPIO 0 stays configured as INPUT_PULLUP (something may be resetting it)
     static bool gpioConfigured = false;
     if (!gpioConfigured) {
-        pinMode(BTN_BOOT_PIN, INPUT_PULLUP);
-        pinMode(BTN_VOL_UP_PIN, INPUT_PULLUP);
-        pinMode(BTN_VOL_DOWN_PIN, INPUT_PULLUP);
+        buttons.begin();  // Pull-ups and button interrupts again
         gpioConfigured = true;
     }
 
@@ -196,16 +433,36 @@ void loop() {
     statusLed.update();
     display.update();
     wifiManager.update();
-    audioOutput.update();  // Handle async audio playback
+    applyUiEvents();  // Results posted by the voice turn worker
+    power.update();
 
     // Check for wake word trigger
-    if (wakeWordTriggered && currentState == AssistantState::IDLE) {
+    if (wakeWordTriggered && currentState == AssistantState::IDLE && voiceTurnIdle()) {
         wakeWordTriggered = false;
         Serial.println("[WakeWord] Triggered - starting voice input");
-        wakeWord.stopListening();  // Stop wake word to free I2S for recording
+        // Recording starts with the pre-roll, so the wake word and the first
+        // syllables of the command are kept; the cue plays once capture is live
+        startVoiceInput(mic.getPrerollCapacity());
+        metricsEnd(Span::WAKE_TO_RECORD);
+        audioOutput.playStartSound();
+    }
+
+    // User talked over the reply: cut it off and listen to them instead
+    if (bargeInTriggered) {
+        bargeInTriggered = false;
+        if (currentState == AssistantState::RESPONDING) {
+            Serial.println("[BargeIn] Interrupting response");
+            cancelVoiceTurn();
+            audioOutput.stop();
+            setState(AssistantState::IDLE);
+            bargeInPending = true;
+        }
+    }
+    if (bargeInPending && currentState == AssistantState::IDLE && voiceTurnIdle()) {
+        bargeInPending = false;
+        // The pre-roll holds the words that triggered the barge-in
+        startVoiceInput(mic.getPrerollCapacity());
         audioOutput.playStartSound();
-        audioInput.startRecording();
-        setState(AssistantState::LISTENING);
     }
 
     // Process audio if listening
@@ -225,22 +482,21 @@ void loop() {
             if (!audioInput.detectVoice()) {
                 // Silence detected, stop recording
                 Serial.println("[Voice] Silence detected, stopping...");
+                metricsEnd(Span::RECORDING);
+                metricsBegin(Span::FIRST_AUDIO);
+                metricsBegin(Span::TURN);
                 audioInput.stopRecording();
                 audioOutput.playStopSound();
-                setState(AssistantState::PROCESSING);
+                startVoiceTurn();
             }
         }
     }
 
     // State machine processing
     switch (currentState) {
-        case AssistantState::PROCESSING:
-            processVoiceInput();
-            break;
-
         case AssistantState::RESPONDING:
-            // Check if audio playback finished
-            if (!audioOutput.isPlaying()) {
+            // The output reports the end once the last sentence has played
+            if (speechDone && !voiceTurnActive) {
                 Serial.println("[Voice] Response playback complete");
                 setState(AssistantState::IDLE);
             }
@@ -262,8 +518,19 @@ void loop() {
             break;
     }
 
-    // Small delay to prevent watchdog issues
-    delay(10);
+    // Recycle turn memory once nothing from the last turn can still touch it
+    if (currentState == AssistantState::IDLE && voiceTurnIdle() && !audioOutput.isPlaying()) {
+        responseCache.abandonCapture();
+        turnArena.reset();
+    }
+
+    // Small delay to prevent watchdog issues; longer while idle, cut short
+    // by a button edge or the wake word
+    if (POWER_MANAGEMENT_ENABLED) {
+        power.sleep(10);
+    } else {
+        delay(10);
+    }
 }
 
 void setState(AssistantState newState) {
@@ -272,6 +539,19 @@ void setState(AssistantState newState) {
     Serial.printf("[State] %d -> %d\n", (int)currentState, (int)newState);
     currentState = newState;
 
+    // Reconnect dropped API connections only while nothing else needs the radio
+    connectionPool.setWarmEnabled(newState == AssistantState::IDLE);
+
+    // Full speed for anything but waiting
+    power.setBusy(newState != AssistantState::IDLE && newState != AssistantState::ERROR);
+
+    // Only a reply playing can be barged in on
+    if (newState == AssistantState::RESPONDING) {
+        bargeIn.startListening();
+    } else {
+        bargeIn.stopListening();
+    }
+
     switch (newState) {
         case AssistantState::CONNECTING_WIFI:
             statusLed.setConnecting();
@@ -319,18 +599,21 @@ void setState(AssistantState newState) {
 }
 
 void handleButtonEvent(Button button, ButtonEvent event) {
+    power.boost();
+
     switch (button) {
         case Button::BOOT:
             if (event == ButtonEvent::PRESSED) {
                 if (currentState == AssistantState::IDLE) {
                     // Start listening
                     Serial.println("[Button] Starting voice input...");
-                    audioInput.startRecording();
-                    setState(AssistantState::LISTENING);
+                    startVoiceInput();
                 } else {
                     // Any other state: stop and reset to IDLE
                     Serial.println("[Button] Stopping and resetting...");
+                    bargeInPending = false;
                     audioInput.stopRecording();
+                    cancelVoiceTurn();
                     audioOutput.stop();
                     setState(AssistantState::IDLE);
                 }
@@ -339,28 +622,139 @@ void handleButtonEvent(Button button, ButtonEvent event) {
 
         case Button::VOL_UP:
             if (event == ButtonEvent::PRESSED || event == ButtonEvent::LONG_PRESS) {
-                currentVolume = min(currentVolume + VOLUME_STEP, MAX_VOLUME);
-                audioOutput.setVolume(currentVolume);
+                applyVolume(currentVolume + VOLUME_STEP);
                 audioOutput.playBeep();
                 display.updateStatusBar(wifiManager.getRSSI(), currentVolume,
                     currentState == AssistantState::LISTENING);
-                Serial.printf("[Volume] %d%%\n", currentVolume);
             }
             break;
 
         case Button::VOL_DOWN:
             if (event == ButtonEvent::PRESSED || event == ButtonEvent::LONG_PRESS) {
-                currentVolume = max(currentVolume - VOLUME_STEP, MIN_VOLUME);
-                audioOutput.setVolume(currentVolume);
-                if (currentVolume > 0) audioOutput.playBeep();
+                if (applyVolume(currentVolume - VOLUME_STEP) > 0) audioOutput.playBeep();
                 display.updateStatusBar(wifiManager.getRSSI(), currentVolume,
                     currentState == AssistantState::LISTENING);
-                Serial.printf("[Volume] %d%%\n", currentVolume);
             }
             break;
     }
 }
 
+int applyVolume(int volume) {
+    currentVolume = constrain(volume, MIN_VOLUME, MAX_VOLUME);
+    audioOutput.setVolume(currentVolume);
+    Serial.printf("[Volume] %d%%\n", currentVolume);
+    return currentVolume;
+}
+
+// Nothing from the last turn is still running. After a cancel the TTS
+// worker may be finishing a request on the same SpeechClient (and its
+// error string) that the next recording's live STT upload uses
+bool voiceTurnIdle() {
+    return !voiceTurnActive && ttsPipeline.isIdle();
+}
+
+void startVoiceInput(size_t prerollSamples) {
+    if (!voiceTurnIdle()) {
+        Serial.println("[Voice] Previous request still finishing, ignoring");
+        return;
+    }
+
+    // Entering LISTENING pauses wake word frame delivery
+    speechDone = false;
+    setState(AssistantState::LISTENING);
+    // The wake word detector has been measuring the room while idle
+    float noiseRms = (WAKE_WORD_ENABLED && wakeWord.isEnabled()) ? wakeWord.getNoiseFloor() : 0;
+    audioInput.startRecording(prerollSamples, noiseRms);
+    metricsBegin(Span::RECORDING);
+
+    // Open the STT request now so only the tail is left to send at end of speech
+    if (STT_LIVE_UPLOAD && !speech.beginTranscription(I2S_MIC_SAMPLE_RATE)) {
+        Serial.println("[STT] Live upload unavailable, will send after recording");
+    }
+}
+
+void startVoiceTurn() {
+    setState(AssistantState::PROCESSING);
+
+    voiceTurnActive = true;
+    if (xTaskCreatePinnedToCore(voiceTurnTask, "voice_turn", VOICE_TASK_STACK,
+                                (void*)(uintptr_t)currentTurn, VOICE_TASK_PRIO,
+                                nullptr, VOICE_TASK_CORE) != pdPASS) {
+        // No memory for the worker: run the turn inline as before
+        Serial.println("[Voice] Failed to start worker, processing inline");
+        workerTurn = currentTurn;
+        processVoiceInput();
+        voiceTurnActive = false;
+    }
+}
+
+void cancelVoiceTurn() {
+    ttsPipeline.cancel();
+    metricsCancel(Span::FIRST_AUDIO);
+    metricsCancel(Span::TURN);
+
+    if (voiceTurnActive) {
+        // The worker finishes its current network call, then sees the new turn id
+        currentTurn++;
+    } else {
+        speech.abortTranscription();
+    }
+}
+
+bool turnCancelled() {
+    return workerTurn != currentTurn;
+}
+
+void postUiEvent(UiEventType type, AssistantState state, const String& text) {
+    UiEvent event = { type, state, workerTurn, text.length() > 0 ? new String(text) : nullptr };
+    if (!uiEvents || xQueueSend(uiEvents, &event, pdMS_TO_TICKS(100)) != pdTRUE) {
+        delete event.text;
+    }
+}
+
+void postState(AssistantState state) {
+    postUiEvent(UiEventType::STATE, state, "");
+}
+
+void postError(const String& message) {
+    Serial.println("[Voice] " + message);
+    postUiEvent(UiEventType::ERROR, AssistantState::ERROR, message);
+}
+
+void applyUiEvents() {
+    UiEvent event;
+    while (uiEvents && xQueueReceive(uiEvents, &event, 0) == pdTRUE) {
+        power.noteActivity();
+        if (event.turn == currentTurn) {
+            switch (event.type) {
+                case UiEventType::STATE:
+                    setState(event.state);
+                    break;
+                case UiEventType::USER_MESSAGE:
+                    display.showUserMessage(*event.text);
+                    break;
+                case UiEventType::AI_MESSAGE:
+                    display.showAIMessage(*event.text);
+                    break;
+                case UiEventType::AI_DELTA:
+                    display.appendAIMessage(*event.text);
+                    break;
+                case UiEventType::AI_DONE:
+                    display.endAIMessage(*event.text);
+                    break;
+                case UiEventType::ERROR:
+                    lastError = event.text ? *event.text : "Unknown error";
+                    setState(AssistantState::ERROR);
+                    if (!playPrompt(PROMPT_ERROR)) {
+                        audioOutput.playErrorSound();
+                    }
+                    break;
+            }
+        }
+        delete event.text;
+    }
+}
+
 void processVoiceInput() {
     // Get recorded audio info
     size_t audioSamples = audioInput.getBufferSize();
@@ -369,98 +763,242 @@ void processVoiceInput() {
     if (audioSamples < 1000) {
         // Not enough audio captured
         Serial.println("[Voice] Too short, ignoring...");
-        setState(AssistantState::IDLE);
+        speech.abortTranscription();
+        audioInput.clearBuffer();
+        postState(AssistantState::IDLE);
         return;
     }
 
     // Step 1: Speech-to-Text - Convert audio to text
     Serial.println("[STT] Transcribing audio...");
 
-    String userText = speech.transcribe(
-        audioInput.getBuffer(),
-        audioSamples,
-        I2S_MIC_SAMPLE_RATE
-    );
+    String userText;
+    bool transcribed = false;
+    if (speech.isTranscribing()) {
+        userText = speech.finishTranscription();
+        transcribed = !speech.hasError();
+        if (!transcribed) {
+            Serial.println("[STT] Live upload failed, resending full recording");
+        }
+    }
+
+    if (!transcribed) {
+        const CaptureBuffer& audio = audioInput.getCapture();
+        size_t offset = audioInput.getSpeechOffset();
+        userText = STT_STREAMING_UPLOAD
+            ? speech.transcribeStream(audio, offset, audioSamples, I2S_MIC_SAMPLE_RATE)
+            : speech.transcribe(audio, offset, audioSamples, I2S_MIC_SAMPLE_RATE);
+    }
+
+    // The recording isn't needed past STT; give its blocks back while the
+    // reply is generated
+    audioInput.clearBuffer();
+
+    if (turnCancelled()) return;
 
     if (speech.hasError()) {
-        lastError = "STT Error: " + speech.getLastError();
-        Serial.println("[STT] " + lastError);
-        setState(AssistantState::ERROR);
-        audioOutput.playErrorSound();
+        postError("STT Error: " + speech.getLastError());
         return;
     }
 
     if (userText.length() == 0) {
         Serial.println("[STT] No speech detected");
-        setState(AssistantState::IDLE);
+        postState(playPrompt(PROMPT_NOT_UNDERSTOOD) ? AssistantState::RESPONDING : AssistantState::IDLE);
         return;
     }
 
     // Show user message on display
-    display.showUserMessage(userText);
+    postUiEvent(UiEventType::USER_MESSAGE, AssistantState::PROCESSING, userText);
     Serial.println("[User] " + userText);
 
-    // Step 2: Send to Gemini for AI response
+    // Device commands are carried out here and answered with a cue
+    IntentMatch intent;
+    if (INTENT_FAST_PATH_ENABLED && matchIntent(userText, intent)) {
+        handleIntent(intent);
+        return;
+    }
+
+    // Asked before: replay the cached answer without Gemini or TTS
+    ResponseCache::Hit hit;
+    if (responseCache.lookup(userText, hit)) {
+        postUiEvent(UiEventType::AI_MESSAGE, AssistantState::PROCESSING, hit.text);
+        Serial.println("[AI] (cached) " + hit.text);
+        gemini.lock();
+        gemini.addToHistory(userText, hit.text);
+        gemini.unlock();
+        postState(AssistantState::RESPONDING);
+        audioOutput.playBuffer(hit.samples, hit.count);
+        return;
+    }
+
+    // Step 2: Send to Gemini for AI response. Step 3 (TTS) runs alongside:
+    // each finished sentence is queued for synthesis while the rest arrives
     Serial.println("[Gemini] Sending request...");
-    String response = gemini.chat(userText);
+    String response;
+    bool streamed = false;
+    bool responding = false;
+
+    responseCache.beginCapture(userText);
+    ttsPipeline.startReply();
+    auto speakText = [&responding](const String& text) {
+        if (ttsPipeline.feed(text) > 0 && !responding) {
+            responding = true;
+            postState(AssistantState::RESPONDING);
+        }
+    };
+
+    // A web chat request may be using the client; wait for it
+    gemini.lock();
+    if (GEMINI_STREAMING_ENABLED) {
+        // Fragments go on screen and into the TTS pipeline as they are generated
+        response = gemini.chatStream(userText, [&streamed, &speakText](const String& delta) {
+            if (turnCancelled()) return false;
+            streamed = true;
+            postUiEvent(UiEventType::AI_DELTA, AssistantState::PROCESSING, delta);
+            speakText(delta);
+            return true;
+        });
+
+        if (!streamed && gemini.hasError() && !turnCancelled()) {
+            Serial.println("[Gemini] Stream failed, retrying without streaming");
+            response = gemini.chat(userText);
+        }
+    } else {
+        response = gemini.chat(userText);
+    }
+    bool geminiFailed = gemini.hasError();
+    String geminiError = gemini.getLastError();
+    gemini.unlock();
 
-    if (gemini.hasError()) {
-        lastError = gemini.getLastError();
-        setState(AssistantState::ERROR);
-        audioOutput.playErrorSound();
+    if (turnCancelled()) return;
+
+    if (geminiFailed) {
+        ttsPipeline.cancel();
+        postError(geminiError);
         return;
     }
 
     // Show AI response on display
-    display.showAIMessage(response);
+    postUiEvent(streamed ? UiEventType::AI_DONE : UiEventType::AI_MESSAGE,
+                AssistantState::PROCESSING, response);
     Serial.println("[AI] " + response);
 
-    // Step 3: Text-to-Speech - Convert response to audio
-    // Truncate very long responses to prevent TTS memory issues
-    String ttsText = response;
-    const int MAX_TTS_CHARS = 500;  // ~30 seconds of speech max
-    if (ttsText.length() > MAX_TTS_CHARS) {
-        // Find a good break point (end of sentence)
-        int breakPoint = ttsText.lastIndexOf('.', MAX_TTS_CHARS);
-        if (breakPoint < MAX_TTS_CHARS / 2) {
-            breakPoint = MAX_TTS_CHARS;  // No good break, just truncate
+    if (!streamed) {
+        speakText(response);
+    }
+    responseCache.setCaptureText(response);
+    ttsPipeline.finishReply();
+
+    // State will change to IDLE when the pipeline and playback finish (in loop)
+    if (!responding) {
+        postState(AssistantState::RESPONDING);
+    }
+}
+
+bool handleWebChat(const String& message, const WebInterface::TokenCallback& onToken, String& reply) {
+    gemini.lock();
+
+    // The loop recycles the turn arena whenever no voice turn is running,
+    // which is exactly when web requests tend to arrive: use the heap
+    gemini.setArena(nullptr);
+
+    bool streamed = false;
+    if (GEMINI_STREAMING_ENABLED) {
+        reply = gemini.chatStream(message, [&streamed, &onToken](const String& delta) {
+            streamed = true;
+            onToken(delta);
+            return true;
+        });
+        if (!streamed && gemini.hasError()) {
+            reply = gemini.chat(message);
         }
-        ttsText = ttsText.substring(0, breakPoint + 1);
-        Serial.printf("[TTS] Truncated from %d to %d chars\n", response.length(), ttsText.length());
+    } else {
+        reply = gemini.chat(message);
     }
 
-    Serial.println("[TTS] Synthesizing speech...");
-    setState(AssistantState::RESPONDING);
+    bool ok = !gemini.hasError();
+    if (!ok) {
+        reply = gemini.getLastError();
+    }
 
-    if (ttsBuffer) {
-        size_t ttsSamples = speech.synthesize(
-            ttsText,
-            ttsBuffer,
-            ttsBufferSize,
-            I2S_SPK_SAMPLE_RATE
-        );
+    gemini.setArena(&turnArena);
+    gemini.unlock();
+    return ok;
+}
 
-        if (speech.hasError()) {
-            Serial.println("[TTS] Error: " + speech.getLastError());
-            // Fall back to just showing text
-            delay(2000);  // Give time to read
-            setState(AssistantState::IDLE);
-            return;
-        }
+// Runs on the voice worker in place of Gemini and TTS. The reply is a cue
+// from the sound bank; the display shows what was done, and the status bar
+// picks up the volume when the state goes back to IDLE
+bool handleIntent(const IntentMatch& intent) {
+    Serial.printf("[Intent] %s (%d)\n", intentName(intent.intent), intent.value);
+
+    String reply;
+    switch (intent.intent) {
+        case Intent::VOLUME_UP:
+            applyVolume(currentVolume + VOLUME_STEP);
+            reply = "Volume " + String(currentVolume) + "%";
+            break;
+        case Intent::VOLUME_DOWN:
+            applyVolume(currentVolume - VOLUME_STEP);
+            reply = "Volume " + String(currentVolume) + "%";
+            break;
+        case Intent::VOLUME_SET:
+            applyVolume(intent.value);
+            reply = currentVolume > 0 ? "Volume " + String(currentVolume) + "%" : String("Muted");
+            break;
+        case Intent::STOP:
+            // Whatever was playing was cut off when recording began
+            audioOutput.stop();
+            break;
+        case Intent::STATUS:
+            reply = "IP " + wifiManager.getIP() + ", WiFi " + String(wifiManager.getRSSI()) +
+                    " dBm, volume " + String(currentVolume) + "%";
+            break;
+        default:
+            return false;
+    }
+
+    if (intent.intent == Intent::STOP) {
+        audioOutput.playStopSound();
+    } else if (currentVolume > 0) {
+        audioOutput.playBeep();
+    }
 
-        if (ttsSamples > 0) {
-            Serial.printf("[TTS] Playing %d samples\n", ttsSamples);
-            audioOutput.playAsync(ttsBuffer, ttsSamples);
-            // State will change to IDLE when playback completes (in loop)
+    // The cue is the answer: the turn ends here
+    metricsEnd(Span::FIRST_AUDIO);
+    metricsEnd(Span::TURN);
+
+    if (reply.length() > 0) {
+        postUiEvent(UiEventType::AI_MESSAGE, AssistantState::PROCESSING, reply);
+    }
+    postState(AssistantState::IDLE);
+    return true;
+}
+
+void preparePrompts() {
+    // Synthesize fixed prompts once; persisted ones are already loaded
+    const char* prompts[] = { PROMPT_GREETING, PROMPT_NOT_UNDERSTOOD, PROMPT_ERROR };
+    size_t maxSamples = RESPONSE_CACHE_MAX_CLIP_SAMPLES;
+    int16_t* buffer = (int16_t*)arenaAlloc(&turnArena, maxSamples * sizeof(int16_t));
+    if (!buffer) return;
+
+    for (const char* prompt : prompts) {
+        if (responseCache.hasPrompt(prompt)) continue;
+
+        size_t samples = speech.synthesize(prompt, buffer, maxSamples, I2S_SPK_SAMPLE_RATE);
+        if (samples > 0) {
+            responseCache.storePrompt(prompt, buffer, samples);
         } else {
-            Serial.println("[TTS] No audio generated");
-            delay(2000);
-            setState(AssistantState::IDLE);
+            Serial.println("[Cache] Prompt synthesis failed: " + String(prompt));
         }
-    } else {
-        // No TTS buffer, just show text
-        Serial.println("[TTS] No buffer available, text-only mode");
-        delay(2000);
-        setState(AssistantState::IDLE);
     }
+    arenaFree(&turnArena, buffer);
+}
+
+bool playPrompt(const char* text) {
+    ResponseCache::Hit hit;
+    if (!responseCache.findPrompt(text, hit)) return false;
+
+    audioOutput.playBuffer(hit.samples, hit.count);
+    return true;
 }
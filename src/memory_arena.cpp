@@ -0,0 +1,319 @@
+#include "memory_arena.h"
+#include <esp_heap_caps.h>
+
+// -----------------------------------------------------------------------------
+// TurnArena
+// -----------------------------------------------------------------------------
+
+TurnArena::TurnArena()
+    : _raw(nullptr)
+    , _memory(nullptr)
+    , _capacity(0)
+    , _top(0)
+    , _last(NO_BLOCK)
+    , _highWater(0)
+    , _turnPeak(0)
+    , _turnAllocations(0)
+    , _liveBlocks(0)
+    , _fallbacks(0)
+    , _lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+TurnArena::~TurnArena() {
+    end();
+}
+
+bool TurnArena::begin(size_t bytes) {
+    if (_memory) return true;
+
+    _raw = psramFound() ? (uint8_t*)ps_malloc(bytes + ALIGN) : (uint8_t*)malloc(bytes + ALIGN);
+    if (!_raw) {
+        Serial.printf("[Arena] Failed to allocate %d KB\n", bytes / 1024);
+        return false;
+    }
+
+    _memory = (uint8_t*)(((uintptr_t)_raw + ALIGN - 1) & ~(uintptr_t)(ALIGN - 1));
+    _capacity = bytes;
+    _top = 0;
+    _last = NO_BLOCK;
+
+    Serial.printf("[Arena] %d KB turn arena in %s\n", bytes / 1024, psramFound() ? "PSRAM" : "heap");
+    return true;
+}
+
+void TurnArena::end() {
+    if (_raw) {
+        free(_raw);
+        _raw = nullptr;
+    }
+    _memory = nullptr;
+    _capacity = 0;
+    _top = 0;
+    _last = NO_BLOCK;
+    _liveBlocks = 0;
+}
+
+void* TurnArena::allocate(size_t size) {
+    size_t payload = (size + ALIGN - 1) & ~(ALIGN - 1);
+    size_t need = sizeof(Block) + payload;
+
+    portENTER_CRITICAL(&_lock);
+    if (!_memory || _top + need > _capacity) {
+        portEXIT_CRITICAL(&_lock);
+        return nullptr;
+    }
+
+    Block* block = (Block*)(_memory + _top);
+    block->size = payload;
+    block->prev = _last;
+    block->released = 0;
+
+    _last = _top;
+    _top += need;
+    _liveBlocks++;
+    _turnAllocations++;
+    if (_top > _turnPeak) _turnPeak = _top;
+    if (_top > _highWater) _highWater = _top;
+    portEXIT_CRITICAL(&_lock);
+
+    return block + 1;
+}
+
+void* TurnArena::reallocate(void* ptr, size_t size) {
+    if (!ptr) return allocate(size);
+
+    size_t payload = (size + ALIGN - 1) & ~(ALIGN - 1);
+    size_t oldSize;
+
+    portENTER_CRITICAL(&_lock);
+    Block* block = blockOf(ptr);
+    if (!block) {
+        portEXIT_CRITICAL(&_lock);
+        return nullptr;
+    }
+
+    uint32_t offset = (uint8_t*)block - _memory;
+    oldSize = block->size;
+
+    // Growing strings are usually the newest block: extend it where it is
+    if (offset == _last && offset + sizeof(Block) + payload <= _capacity) {
+        block->size = payload;
+        _top = offset + sizeof(Block) + payload;
+        if (_top > _turnPeak) _turnPeak = _top;
+        if (_top > _highWater) _highWater = _top;
+        portEXIT_CRITICAL(&_lock);
+        return ptr;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (payload <= oldSize) return ptr;
+
+    void* moved = allocate(size);
+    if (!moved) return nullptr;
+
+    memcpy(moved, ptr, oldSize);
+    release(ptr);
+    return moved;
+}
+
+void TurnArena::release(void* ptr) {
+    if (!ptr) return;
+
+    portENTER_CRITICAL(&_lock);
+    Block* block = blockOf(ptr);
+    if (block && !block->released) {
+        block->released = 1;
+        _liveBlocks--;
+        collapse();
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+bool TurnArena::owns(const void* ptr) const {
+    const uint8_t* p = (const uint8_t*)ptr;
+    return _memory && p >= _memory && p < _memory + _capacity;
+}
+
+size_t TurnArena::getBlockSize(const void* ptr) const {
+    Block* block = blockOf(ptr);
+    return block ? block->size : 0;
+}
+
+TurnArena::Block* TurnArena::blockOf(const void* ptr) const {
+    const uint8_t* p = (const uint8_t*)ptr;
+    if (!_memory || p < _memory + sizeof(Block) || p >= _memory + _top) return nullptr;
+    return (Block*)p - 1;
+}
+
+void TurnArena::collapse() {
+    // Rewind past every released block at the top of the stack
+    while (_last != NO_BLOCK) {
+        Block* block = (Block*)(_memory + _last);
+        if (!block->released) break;
+        _top = _last;
+        _last = block->prev;
+    }
+}
+
+void TurnArena::reset() {
+    portENTER_CRITICAL(&_lock);
+    uint32_t allocations = _turnAllocations;
+    uint32_t liveBlocks = _liveBlocks;
+    size_t turnPeak = _turnPeak;
+
+    _top = 0;
+    _last = NO_BLOCK;
+    _liveBlocks = 0;
+    _turnAllocations = 0;
+    _turnPeak = 0;
+    portEXIT_CRITICAL(&_lock);
+
+    if (allocations == 0) return;
+
+    Serial.printf("[Arena] Turn: %d allocations, peak %d KB, high water %d / %d KB, %d heap fallbacks\n",
+                  allocations, turnPeak / 1024, _highWater / 1024, _capacity / 1024, _fallbacks);
+    if (liveBlocks > 0) {
+        Serial.printf("[Arena] %d blocks were still held at end of turn\n", liveBlocks);
+    }
+}
+
+void* arenaAlloc(TurnArena* arena, size_t size) {
+    if (arena) {
+        void* ptr = arena->allocate(size);
+        if (ptr) return ptr;
+
+        if (arena->getCapacity() > 0) {
+            arena->countFallback();
+            Serial.printf("[Arena] Full, %d bytes from the heap\n", size);
+        }
+    }
+    return psramFound() ? ps_malloc(size) : malloc(size);
+}
+
+void arenaFree(TurnArena* arena, void* ptr) {
+    if (!ptr) return;
+
+    if (arena && arena->owns(ptr)) {
+        arena->release(ptr);
+    } else {
+        free(ptr);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// ArenaJsonAllocator
+// -----------------------------------------------------------------------------
+
+void* ArenaJsonAllocator::allocate(size_t size) {
+    return arenaAlloc(_arena, size);
+}
+
+void ArenaJsonAllocator::deallocate(void* ptr) {
+    arenaFree(_arena, ptr);
+}
+
+void* ArenaJsonAllocator::reallocate(void* ptr, size_t newSize) {
+    if (!ptr) return allocate(newSize);
+
+    if (!_arena || !_arena->owns(ptr)) {
+        return realloc(ptr, newSize);
+    }
+
+    void* moved = _arena->reallocate(ptr, newSize);
+    if (moved) return moved;
+
+    // Arena full: continue on the heap
+    moved = psramFound() ? ps_malloc(newSize) : malloc(newSize);
+    if (!moved) return nullptr;
+
+    _arena->countFallback();
+    memcpy(moved, ptr, min(_arena->getBlockSize(ptr), newSize));
+    _arena->release(ptr);
+    return moved;
+}
+
+// -----------------------------------------------------------------------------
+// DmaPool
+// -----------------------------------------------------------------------------
+
+DmaPool::DmaPool()
+    : _memory(nullptr)
+    , _blockBytes(0)
+    , _blockCount(0)
+    , _freeMask(0)
+    , _inUse(0)
+    , _highWater(0)
+    , _failures(0)
+    , _lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+DmaPool::~DmaPool() {
+    end();
+}
+
+bool DmaPool::begin(size_t blockBytes, size_t blockCount) {
+    if (_memory) return true;
+
+    _blockBytes = (blockBytes + 3) & ~(size_t)3;
+    _blockCount = min(blockCount, MAX_BLOCKS);
+
+    _memory = (uint8_t*)heap_caps_malloc(_blockBytes * _blockCount, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (!_memory) {
+        Serial.println("[DmaPool] Failed to allocate blocks");
+        _blockCount = 0;
+        return false;
+    }
+
+    _freeMask = _blockCount == 32 ? 0xFFFFFFFF : (1u << _blockCount) - 1;
+    _inUse = 0;
+
+    Serial.printf("[DmaPool] %d x %d byte blocks in internal RAM\n", _blockCount, _blockBytes);
+    return true;
+}
+
+void DmaPool::end() {
+    if (_memory) {
+        heap_caps_free(_memory);
+        _memory = nullptr;
+    }
+    _blockCount = 0;
+    _freeMask = 0;
+    _inUse = 0;
+}
+
+void* DmaPool::acquire() {
+    portENTER_CRITICAL(&_lock);
+    if (_freeMask == 0) {
+        _failures++;
+        portEXIT_CRITICAL(&_lock);
+        return nullptr;
+    }
+
+    int index = __builtin_ctz(_freeMask);
+    _freeMask &= ~(1u << index);
+    _inUse++;
+    if (_inUse > _highWater) _highWater = _inUse;
+    portEXIT_CRITICAL(&_lock);
+
+    return _memory + index * _blockBytes;
+}
+
+void DmaPool::release(void* block) {
+    if (!block || !_memory) return;
+
+    size_t offset = (uint8_t*)block - _memory;
+    size_t index = offset / _blockBytes;
+    if ((uint8_t*)block < _memory || index >= _blockCount || offset % _blockBytes != 0) {
+        Serial.println("[DmaPool] Release of a foreign block ignored");
+        return;
+    }
+
+    portENTER_CRITICAL(&_lock);
+    if (!(_freeMask & (1u << index))) {
+        _freeMask |= 1u << index;
+        _inUse--;
+    }
+    portEXIT_CRITICAL(&_lock);
+}
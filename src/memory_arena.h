@@ -0,0 +1,119 @@
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+
+// Turn-scoped bump allocator carved from PSRAM once at boot.
+// Voice-turn buffers (decode, clip copies, JSON documents) come from here
+// instead of the heap, so days of uptime can't fragment it. Blocks are
+// stacked: releasing the newest block rewinds the arena, and blocks released
+// out of order are reclaimed once everything above them is gone. reset()
+// drops whatever is left at the end of the turn. Safe to use from any task.
+class TurnArena {
+public:
+    TurnArena();
+    ~TurnArena();
+
+    bool begin(size_t bytes);
+    void end();
+
+    // nullptr when the arena is full (callers fall back to the heap)
+    void* allocate(size_t size);
+
+    // Grows the newest block in place; otherwise moves it. nullptr when full
+    void* reallocate(void* ptr, size_t size);
+
+    void release(void* ptr);
+    bool owns(const void* ptr) const;
+    size_t getBlockSize(const void* ptr) const;  // Payload bytes of an arena block
+
+    // End of turn: frees every block and reports the turn's usage
+    void reset();
+
+    size_t getCapacity() const { return _capacity; }
+    size_t getUsed() const { return _top; }
+    size_t getHighWater() const { return _highWater; }
+    uint32_t getFallbackCount() const { return _fallbacks; }
+    void countFallback() { _fallbacks++; }
+
+private:
+    struct Block {
+        uint32_t size;      // Payload bytes
+        uint32_t prev;      // Offset of the block below, NO_BLOCK for the first
+        uint32_t released;  // Freed, waiting for the blocks above to go
+        uint32_t reserved;  // Keeps the payload 16-byte aligned
+    };
+
+    static const uint32_t NO_BLOCK = 0xFFFFFFFF;
+    static const size_t ALIGN = 16;
+
+    Block* blockOf(const void* ptr) const;
+    void collapse();
+
+    uint8_t* _raw;
+    uint8_t* _memory;       // _raw aligned to ALIGN
+    size_t _capacity;
+    size_t _top;            // First free byte
+    uint32_t _last;         // Offset of the newest block
+    size_t _highWater;      // Since boot
+    size_t _turnPeak;       // Since the last reset
+    uint32_t _turnAllocations;
+    uint32_t _liveBlocks;
+    uint32_t _fallbacks;
+    portMUX_TYPE _lock;
+};
+
+// Arena memory when an arena is set and has room, otherwise PSRAM/heap
+void* arenaAlloc(TurnArena* arena, size_t size);
+void arenaFree(TurnArena* arena, void* ptr);
+
+// Lets a JsonDocument take its pools and strings from the turn arena
+class ArenaJsonAllocator : public ArduinoJson::Allocator {
+public:
+    ArenaJsonAllocator() : _arena(nullptr) {}
+
+    void setArena(TurnArena* arena) { _arena = arena; }
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t newSize) override;
+
+private:
+    TurnArena* _arena;
+};
+
+// Fixed-size blocks in internal RAM for short audio chunks (cues, tones).
+// Allocated once, so every beep no longer costs a malloc/free pair
+class DmaPool {
+public:
+    DmaPool();
+    ~DmaPool();
+
+    bool begin(size_t blockBytes, size_t blockCount);
+    void end();
+
+    // nullptr when every block is in use
+    void* acquire();
+    void release(void* block);
+
+    size_t getBlockSize() const { return _blockBytes; }
+    size_t getInUse() const { return _inUse; }
+    size_t getHighWater() const { return _highWater; }
+    uint32_t getFailures() const { return _failures; }
+
+private:
+    static const size_t MAX_BLOCKS = 32;
+
+    uint8_t* _memory;
+    size_t _blockBytes;
+    size_t _blockCount;
+    uint32_t _freeMask;     // Bit set = block free
+    size_t _inUse;
+    size_t _highWater;
+    uint32_t _failures;
+    portMUX_TYPE _lock;
+};
+
+#endif // MEMORY_ARENA_H
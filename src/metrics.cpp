@@ -0,0 +1,170 @@
+#include "metrics.h"
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+static const uint32_t BUCKET_LIMITS_MS[LatencyHistogram::BUCKETS - 1] = {
+    50, 100, 200, 500, 1000, 2000, 5000
+};
+
+static const char* const SPAN_NAMES[(int)Span::COUNT] = {
+    "wake_to_record",
+    "recording",
+    "stt_upload",
+    "stt_response",
+    "gemini_ttfb",
+    "gemini_total",
+    "tts_ttfb",
+    "tts_total",
+    "first_audio",
+    "turn",
+};
+
+static const char* const COUNTER_NAMES[(int)Counter::COUNT] = {
+    "i2s_underrun",
+};
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    memset(_ring, 0, sizeof(_ring));
+    memset(_buckets, 0, sizeof(_buckets));
+    _pos = 0;
+    _count = 0;
+}
+
+void LatencyHistogram::add(uint32_t us) {
+    _ring[_pos] = us;
+    _pos = (_pos + 1) % RING_SIZE;
+    _count++;
+
+    uint32_t ms = us / 1000;
+    size_t index = 0;
+    while (index < BUCKETS - 1 && ms >= BUCKET_LIMITS_MS[index]) {
+        index++;
+    }
+    _buckets[index]++;
+}
+
+uint32_t LatencyHistogram::last() const {
+    return _count > 0 ? _ring[(_pos + RING_SIZE - 1) % RING_SIZE] : 0;
+}
+
+uint32_t LatencyHistogram::percentile(int percent) const {
+    size_t n = min((size_t)_count, RING_SIZE);
+    if (n == 0) return 0;
+
+    uint32_t sorted[RING_SIZE];
+    memcpy(sorted, _ring, n * sizeof(uint32_t));  // Unfilled slots are past n
+    std::sort(sorted, sorted + n);
+
+    // Nearest rank
+    size_t rank = (n * constrain(percent, 0, 100) + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+uint32_t LatencyHistogram::peak() const {
+    size_t n = min((size_t)_count, RING_SIZE);
+    uint32_t highest = 0;
+    for (size_t i = 0; i < n; i++) {
+        highest = std::max(highest, _ring[i]);
+    }
+    return highest;
+}
+
+uint32_t LatencyHistogram::bucketLimitMs(size_t index) {
+    return index < BUCKETS - 1 ? BUCKET_LIMITS_MS[index] : 0;
+}
+
+// ----------------------------------------------------------------------------
+
+static portMUX_TYPE metricsLock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t spanStart[(int)Span::COUNT];  // 0 = not running
+static LatencyHistogram spanHistograms[(int)Span::COUNT];
+static uint32_t counters[(int)Counter::COUNT];
+
+void metricsBegin(Span span) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&metricsLock);
+    spanStart[(int)span] = now;
+    portEXIT_CRITICAL(&metricsLock);
+}
+
+void metricsEnd(Span span) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&metricsLock);
+    int64_t start = spanStart[(int)span];
+    if (start != 0) {
+        spanStart[(int)span] = 0;
+        spanHistograms[(int)span].add((uint32_t)(now - start));
+    }
+    portEXIT_CRITICAL(&metricsLock);
+}
+
+void metricsCancel(Span span) {
+    portENTER_CRITICAL(&metricsLock);
+    spanStart[(int)span] = 0;
+    portEXIT_CRITICAL(&metricsLock);
+}
+
+void metricsRecord(Span span, uint32_t us) {
+    portENTER_CRITICAL(&metricsLock);
+    spanHistograms[(int)span].add(us);
+    portEXIT_CRITICAL(&metricsLock);
+}
+
+void metricsCount(Counter counter) {
+    portENTER_CRITICAL(&metricsLock);
+    counters[(int)counter]++;
+    portEXIT_CRITICAL(&metricsLock);
+}
+
+const char* metricsSpanName(Span span) {
+    return span < Span::COUNT ? SPAN_NAMES[(int)span] : "";
+}
+
+String metricsToJson() {
+    JsonDocument doc;
+    doc["uptime_ms"] = millis();
+
+    JsonArray limits = doc["bucket_limits_ms"].to<JsonArray>();
+    for (size_t i = 0; i < LatencyHistogram::BUCKETS - 1; i++) {
+        limits.add(LatencyHistogram::bucketLimitMs(i));
+    }
+
+    JsonObject spans = doc["spans"].to<JsonObject>();
+    for (int i = 0; i < (int)Span::COUNT; i++) {
+        // Copy under the lock, sort and format outside it
+        portENTER_CRITICAL(&metricsLock);
+        LatencyHistogram histogram = spanHistograms[i];
+        portEXIT_CRITICAL(&metricsLock);
+
+        JsonObject span = spans[SPAN_NAMES[i]].to<JsonObject>();
+        span["count"] = histogram.count();
+        span["last_ms"] = histogram.last() / 1000;
+        span["p50_ms"] = histogram.percentile(50) / 1000;
+        span["p90_ms"] = histogram.percentile(90) / 1000;
+        span["max_ms"] = histogram.peak() / 1000;
+
+        JsonArray buckets = span["histogram"].to<JsonArray>();
+        for (size_t b = 0; b < LatencyHistogram::BUCKETS; b++) {
+            buckets.add(histogram.bucket(b));
+        }
+    }
+
+    JsonObject counts = doc["counters"].to<JsonObject>();
+    portENTER_CRITICAL(&metricsLock);
+    uint32_t snapshot[(int)Counter::COUNT];
+    memcpy(snapshot, counters, sizeof(snapshot));
+    portEXIT_CRITICAL(&metricsLock);
+    for (int i = 0; i < (int)Counter::COUNT; i++) {
+        counts[COUNTER_NAMES[i]] = snapshot[i];
+    }
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
@@ -0,0 +1,71 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+
+// Latency spans of a voice turn, roughly in the order they happen
+enum class Span : uint8_t {
+    WAKE_TO_RECORD,  // Wake word detected -> recording started
+    RECORDING,       // Recording started -> end of speech (VAD)
+    STT_UPLOAD,      // Audio upload (only the tail with live upload)
+    STT_RESPONSE,    // Upload finished -> transcript received
+    GEMINI_TTFB,     // Request sent -> first reply text
+    GEMINI_TOTAL,
+    TTS_TTFB,        // Sentence request -> first PCM
+    TTS_TOTAL,
+    FIRST_AUDIO,     // End of speech -> first reply sample written to I2S
+    TURN,            // End of speech -> reply played out
+    COUNT
+};
+
+enum class Counter : uint8_t {
+    I2S_UNDERRUN,    // Speech ran dry mid-reply (network slower than playback)
+    COUNT
+};
+
+// Recent samples of one span for percentiles, plus all-time counts in
+// fixed buckets. Plain data, so a copy is a consistent snapshot
+class LatencyHistogram {
+public:
+    static const size_t RING_SIZE = 32;
+    static const size_t BUCKETS = 8;
+
+    LatencyHistogram();
+
+    void reset();
+    void add(uint32_t us);
+
+    uint32_t count() const { return _count; }
+    uint32_t last() const;
+
+    // Over the ring (the last RING_SIZE samples); 0 when empty
+    uint32_t percentile(int percent) const;
+    uint32_t peak() const;
+
+    uint32_t bucket(size_t index) const { return _buckets[index]; }
+
+    // Upper bound of bucket index in ms; the last bucket has none (0)
+    static uint32_t bucketLimitMs(size_t index);
+
+private:
+    uint32_t _ring[RING_SIZE];
+    size_t _pos;
+    uint32_t _count;
+    uint32_t _buckets[BUCKETS];
+};
+
+// Spans are timed with esp_timer and may begin and end on different tasks.
+// Each span has one start time: beginning it again restarts it, and ending
+// a span that was never begun (or was cancelled) records nothing
+void metricsBegin(Span span);
+void metricsEnd(Span span);
+void metricsCancel(Span span);
+void metricsRecord(Span span, uint32_t us);
+void metricsCount(Counter counter);
+
+const char* metricsSpanName(Span span);
+
+// Every span and counter as JSON, times in ms (served at /api/metrics)
+String metricsToJson();
+
+#endif // METRICS_H
@@ -0,0 +1,244 @@
+#include "mic_capture.h"
+#include "config.h"
+
+#define MIC_TASK_STACK  3072
+
+MicCapture::MicCapture()
+    : _initialized(false)
+    , _subscriberCount(0)
+    , _task(nullptr)
+    , _taskRunning(false)
+    , _frame(nullptr)
+    , _preroll(nullptr)
+    , _prerollSize(0)
+    , _prerollPos(0)
+    , _prerollFill(0)
+    , _level(0)
+{
+    memset(_subscribers, 0, sizeof(_subscribers));
+}
+
+MicCapture::~MicCapture() {
+    end();
+}
+
+bool MicCapture::begin() {
+    if (_initialized) return true;
+
+    // Frame buffer in internal RAM, history in PSRAM if available
+    _frame = (int16_t*)malloc(MIC_FRAME_SAMPLES * sizeof(int16_t));
+    _prerollSize = I2S_MIC_SAMPLE_RATE * MIC_PREROLL_MS / 1000;
+    _preroll = psramFound() ? (int16_t*)ps_malloc(_prerollSize * sizeof(int16_t))
+                            : (int16_t*)malloc(_prerollSize * sizeof(int16_t));
+
+    if (!_frame || !_preroll) {
+        Serial.println("[Mic] Failed to allocate buffers");
+        end();
+        return false;
+    }
+
+    _prerollPos = 0;
+    _prerollFill = 0;
+
+    if (!configureI2S()) {
+        Serial.println("[Mic] Failed to configure I2S");
+        end();
+        return false;
+    }
+
+    _taskRunning = true;
+    if (xTaskCreatePinnedToCore(captureTask, "mic", MIC_TASK_STACK, this,
+                                AUDIO_CAPTURE_TASK_PRIO, &_task, AUDIO_TASK_CORE) != pdPASS) {
+        Serial.println("[Mic] Failed to start capture task");
+        _taskRunning = false;
+        _task = nullptr;
+        i2s_driver_uninstall(I2S_MIC_PORT);
+        end();
+        return false;
+    }
+
+    _initialized = true;
+    Serial.printf("[Mic] Initialized (%d ms pre-roll)\n", MIC_PREROLL_MS);
+    return true;
+}
+
+void MicCapture::end() {
+    if (_initialized) {
+        _taskRunning = false;
+        uint32_t start = millis();
+        while (_task && millis() - start < 500) {
+            delay(5);
+        }
+
+        i2s_driver_uninstall(I2S_MIC_PORT);
+        _initialized = false;
+    }
+
+    if (_frame) {
+        free(_frame);
+        _frame = nullptr;
+    }
+    if (_preroll) {
+        free(_preroll);
+        _preroll = nullptr;
+    }
+    _prerollSize = 0;
+}
+
+bool MicCapture::configureI2S() {
+    i2s_config_t i2s_config = {
+        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
+        .sample_rate = I2S_MIC_SAMPLE_RATE,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .dma_buf_count = 8,
+        .dma_buf_len = 256,
+        .use_apll = false,
+        .tx_desc_auto_clear = false,
+        .fixed_mclk = 0
+    };
+
+    i2s_pin_config_t pin_config = {
+        .bck_io_num = I2S_MIC_SCK_PIN,
+        .ws_io_num = I2S_MIC_WS_PIN,
+        .data_out_num = I2S_PIN_NO_CHANGE,
+        .data_in_num = I2S_MIC_SD_PIN
+    };
+
+    esp_err_t err = i2s_driver_install(I2S_MIC_PORT, &i2s_config, 0, NULL);
+    if (err != ESP_OK) {
+        Serial.printf("[Mic] i2s_driver_install failed: %d\n", err);
+        return false;
+    }
+
+    err = i2s_set_pin(I2S_MIC_PORT, &pin_config);
+    if (err != ESP_OK) {
+        Serial.printf("[Mic] i2s_set_pin failed: %d\n", err);
+        i2s_driver_uninstall(I2S_MIC_PORT);
+        return false;
+    }
+
+    i2s_zero_dma_buffer(I2S_MIC_PORT);
+
+    return true;
+}
+
+int MicCapture::subscribe(SpscRing<int16_t>* ring, TaskHandle_t notifyTask) {
+    if (!ring || _subscriberCount >= MIC_MAX_SUBSCRIBERS) return -1;
+
+    int id = _subscriberCount;
+    Subscriber& sub = _subscribers[id];
+    sub.ring = ring;
+    sub.notifyTask = notifyTask;
+    sub.active = false;
+    sub.prerollRequest = 0;
+    sub.dropped = 0;
+
+    // Publish only once the slot is filled in
+    _subscriberCount = id + 1;
+    return id;
+}
+
+void MicCapture::setActive(int id, bool active, size_t prerollSamples) {
+    if (id < 0 || id >= _subscriberCount) return;
+
+    Subscriber& sub = _subscribers[id];
+    if (active) {
+        // The request is picked up by the capture task before the next frame
+        sub.dropped = 0;
+        sub.prerollRequest = prerollSamples;
+        sub.active = true;
+    } else {
+        sub.active = false;
+        sub.prerollRequest = 0;
+    }
+}
+
+bool MicCapture::isActive(int id) const {
+    return id >= 0 && id < _subscriberCount && _subscribers[id].active;
+}
+
+uint32_t MicCapture::getDroppedSamples(int id) const {
+    return (id >= 0 && id < _subscriberCount) ? _subscribers[id].dropped : 0;
+}
+
+void MicCapture::captureTask(void* param) {
+    MicCapture* mic = (MicCapture*)param;
+
+    Serial.println("[Mic] Capture task started");
+
+    while (mic->_taskRunning) {
+        size_t bytesRead = 0;
+        esp_err_t result = i2s_read(
+            I2S_MIC_PORT,
+            mic->_frame,
+            MIC_FRAME_SAMPLES * sizeof(int16_t),
+            &bytesRead,
+            pdMS_TO_TICKS(100)
+        );
+
+        if (result != ESP_OK || bytesRead == 0) continue;
+
+        mic->distribute(mic->_frame, bytesRead / sizeof(int16_t));
+    }
+
+    Serial.println("[Mic] Capture task stopped");
+    mic->_task = nullptr;
+    vTaskDelete(NULL);
+}
+
+void MicCapture::distribute(const int16_t* samples, size_t count) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += abs(samples[i]);
+    }
+    _level = sum / count;
+
+    int subscriberCount = _subscriberCount;
+    for (int i = 0; i < subscriberCount; i++) {
+        Subscriber& sub = _subscribers[i];
+        if (!sub.active) continue;
+
+        // History first, so it runs straight into this frame
+        if (sub.prerollRequest > 0) {
+            pushPreroll(sub, sub.prerollRequest);
+            sub.prerollRequest = 0;
+        }
+
+        size_t queued = sub.ring->write(samples, count);
+        if (queued < count) {
+            sub.dropped += count - queued;
+        }
+
+        if (sub.notifyTask) {
+            xTaskNotifyGive(sub.notifyTask);
+        }
+    }
+
+    // Append to history after delivery so it never duplicates the live frame
+    for (size_t i = 0; i < count; i++) {
+        _preroll[_prerollPos] = samples[i];
+        _prerollPos = (_prerollPos + 1) % _prerollSize;
+    }
+    _prerollFill = min(_prerollFill + count, _prerollSize);
+}
+
+void MicCapture::pushPreroll(Subscriber& sub, size_t count) {
+    count = min(count, _prerollFill);
+    if (count == 0) return;
+
+    // Oldest of the requested samples first, in at most two runs
+    size_t start = (_prerollPos + _prerollSize - count) % _prerollSize;
+    size_t firstRun = min(count, _prerollSize - start);
+
+    size_t queued = sub.ring->write(_preroll + start, firstRun);
+    if (count > firstRun) {
+        queued += sub.ring->write(_preroll, count - firstRun);
+    }
+
+    if (queued < count) {
+        sub.dropped += count - queued;
+    }
+}
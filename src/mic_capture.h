@@ -0,0 +1,75 @@
+#ifndef MIC_CAPTURE_H
+#define MIC_CAPTURE_H
+
+#include <Arduino.h>
+#include <driver/i2s.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "ring_buffer.h"
+
+#define MIC_MAX_SUBSCRIBERS  4
+#define MIC_FRAME_SAMPLES    512  // Samples per I2S read (32 ms at 16 kHz)
+
+// Single owner of the I2S microphone port.
+// One capture task reads the mic continuously and copies every frame into the
+// ring of each active subscriber (wake word, recorder, ...). The last
+// MIC_PREROLL_MS of audio is kept so a subscriber can start with the audio
+// that came just before it was activated.
+class MicCapture {
+public:
+    MicCapture();
+    ~MicCapture();
+
+    bool begin();
+    void end();
+
+    // Register a consumer ring (call during setup). notifyTask, if set, is
+    // woken after each frame. Returns a subscriber id, or -1 if full
+    int subscribe(SpscRing<int16_t>* ring, TaskHandle_t notifyTask = nullptr);
+
+    // Start/stop delivering frames. prerollSamples of history are queued
+    // ahead of the first live frame, with no gap between them
+    void setActive(int id, bool active, size_t prerollSamples = 0);
+    bool isActive(int id) const;
+
+    // Frames lost because a subscriber ring was full
+    uint32_t getDroppedSamples(int id) const;
+
+    // Mean absolute level of the latest frame (for meters)
+    int getLevel() const { return _level; }
+
+    size_t getPrerollCapacity() const { return _prerollSize; }
+
+private:
+    struct Subscriber {
+        SpscRing<int16_t>* ring;
+        TaskHandle_t notifyTask;
+        volatile bool active;
+        volatile size_t prerollRequest;
+        volatile uint32_t dropped;
+    };
+
+    bool _initialized;
+    Subscriber _subscribers[MIC_MAX_SUBSCRIBERS];
+    volatile int _subscriberCount;
+
+    // Capture task
+    TaskHandle_t _task;
+    volatile bool _taskRunning;
+    int16_t* _frame;
+
+    // Pre-roll history (written only by the capture task)
+    int16_t* _preroll;
+    size_t _prerollSize;
+    size_t _prerollPos;
+    size_t _prerollFill;
+
+    volatile int _level;
+
+    bool configureI2S();
+    static void captureTask(void* param);
+    void distribute(const int16_t* samples, size_t count);
+    void pushPreroll(Subscriber& sub, size_t count);
+};
+
+#endif // MIC_CAPTURE_H
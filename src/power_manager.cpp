@@ -0,0 +1,204 @@
+#include "power_manager.h"
+#include "config.h"
+#include <esp_idf_version.h>
+#include <esp_sleep.h>
+
+#define BRIGHTNESS_FULL  255
+
+PowerManager::PowerManager()
+    : _display(nullptr)
+    , _buttons(nullptr)
+    , _loopTask(nullptr)
+    , _pmEnabled(false)
+    , _busyLock(nullptr)
+    , _boostLock(nullptr)
+    , _busyHeld(false)
+    , _boostHeld(false)
+    , _maxMhz(0)
+    , _appliedMhz(0)
+    , _busy(true)
+    , _boostPending(false)
+    , _boostUntil(0)
+    , _lastActivity(0)
+    , _brightness(BRIGHTNESS_FULL)
+{
+}
+
+PowerManager::~PowerManager() {
+    end();
+}
+
+bool PowerManager::begin(Display& display, Buttons& buttons) {
+    _display = &display;
+    _buttons = &buttons;
+    _loopTask = xTaskGetCurrentTaskHandle();
+    _buttons->setWakeTask(_loopTask);
+
+    // Full speed is whatever the board was built for (board_build.f_cpu)
+    _maxMhz = getCpuFrequencyMhz();
+    _appliedMhz = _maxMhz;
+    _lastActivity = millis();
+
+    // Light sleep needs tickless idle in the build; without it, frequency
+    // scaling alone still works
+    _pmEnabled = configurePm(POWER_LIGHT_SLEEP) || (POWER_LIGHT_SLEEP && configurePm(false));
+
+    if (_pmEnabled) {
+        if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "busy", &_busyLock) != ESP_OK ||
+            esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "boost", &_boostLock) != ESP_OK) {
+            Serial.println("[Power] Failed to create PM locks");
+            end();
+            return false;
+        }
+    } else {
+        Serial.println("[Power] No PM support in this build, scaling the CPU clock directly");
+    }
+
+    // Held until setup() reaches IDLE (setBusy() may have run before the lock existed)
+    _busyHeld = false;
+    setLock(_busyLock, _busyHeld, _busy);
+
+    Serial.printf("[Power] Initialized: %lu/%d MHz%s\n", _maxMhz, POWER_IDLE_CPU_MHZ,
+                  _pmEnabled ? " with PM locks" : "");
+    return true;
+}
+
+bool PowerManager::configurePm(bool lightSleep) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t config;
+#else
+    esp_pm_config_esp32s3_t config;
+#endif
+    config.max_freq_mhz = _maxMhz;
+    config.min_freq_mhz = POWER_IDLE_CPU_MHZ;
+    config.light_sleep_enable = lightSleep;
+
+    esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK) {
+        Serial.printf("[Power] PM config%s not supported: %s\n",
+                      lightSleep ? " with light sleep" : "", esp_err_to_name(err));
+        return false;
+    }
+
+    // The chip wakes on its own timers; the buttons have to be told to
+    // wake it too
+    if (lightSleep) {
+        _buttons->enableSleepWakeup();
+        esp_sleep_enable_gpio_wakeup();
+        Serial.println("[Power] Light sleep enabled");
+    }
+    return true;
+}
+
+void PowerManager::end() {
+    if (_busyLock) {
+        setLock(_busyLock, _busyHeld, false);
+        esp_pm_lock_delete(_busyLock);
+        _busyLock = nullptr;
+    }
+    if (_boostLock) {
+        setLock(_boostLock, _boostHeld, false);
+        esp_pm_lock_delete(_boostLock);
+        _boostLock = nullptr;
+    }
+    if (_buttons) {
+        _buttons->setWakeTask(nullptr);
+    }
+    _pmEnabled = false;
+}
+
+void PowerManager::setBusy(bool busy) {
+    _busy = busy;
+    if (busy) {
+        noteActivity();
+    }
+    setLock(_busyLock, _busyHeld, busy);
+    applyFrequency();
+}
+
+void PowerManager::boost() {
+    _boostPending = true;
+    wakeLoop();
+}
+
+void PowerManager::noteActivity() {
+    _lastActivity = millis();
+    if (_brightness != BRIGHTNESS_FULL) {
+        setBrightness(BRIGHTNESS_FULL);
+    }
+}
+
+void PowerManager::update() {
+    if (!_display) return;
+
+    uint32_t now = millis();
+
+    if (_boostPending) {
+        _boostPending = false;
+        _boostUntil = now + POWER_BOOST_MS;
+        setLock(_boostLock, _boostHeld, true);
+        noteActivity();
+    } else if (_boostHeld && (int32_t)(now - _boostUntil) >= 0) {
+        setLock(_boostLock, _boostHeld, false);
+    }
+    applyFrequency();
+
+    if (_busy) {
+        _lastActivity = now;
+        return;
+    }
+
+    // Dim, then off; POWER_BLANK_AFTER_MS 0 stays dimmed
+    uint32_t idleFor = now - _lastActivity;
+    uint8_t level = BRIGHTNESS_FULL;
+    if (POWER_BLANK_AFTER_MS > 0 && idleFor >= POWER_BLANK_AFTER_MS) {
+        level = 0;
+    } else if (idleFor >= POWER_DIM_AFTER_MS) {
+        level = POWER_DIM_BRIGHTNESS;
+    }
+    if (level != _brightness) {
+        setBrightness(level);
+    }
+}
+
+void PowerManager::sleep(uint32_t busyMs) {
+    // Presses being debounced or timed need the short period too
+    bool idle = !_busy && !_boostHeld && !(_buttons && _buttons->isSettling());
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idle ? POWER_IDLE_LOOP_MS : busyMs));
+}
+
+void PowerManager::wakeLoop() {
+    if (_loopTask) {
+        xTaskNotifyGive(_loopTask);
+    }
+}
+
+void PowerManager::setLock(esp_pm_lock_handle_t lock, bool& held, bool want) {
+    if (held == want) return;
+
+    // Without PM the flag alone drives applyFrequency()
+    if (lock && (want ? esp_pm_lock_acquire(lock) : esp_pm_lock_release(lock)) != ESP_OK) {
+        return;
+    }
+    held = want;
+}
+
+void PowerManager::applyFrequency() {
+    if (_pmEnabled || _maxMhz == 0) return;
+
+    // No PM locks: switch the clock between passes of loop()
+    uint32_t mhz = (_busy || _boostHeld) ? _maxMhz : POWER_IDLE_CPU_MHZ;
+    if (mhz != _appliedMhz && setCpuFrequencyMhz(mhz)) {
+        _appliedMhz = mhz;
+    }
+}
+
+void PowerManager::setBrightness(uint8_t level) {
+    if (_display) {
+        _display->setBrightness(level);
+    }
+    if (level == 0 || _brightness == 0) {
+        Serial.printf("[Power] Backlight %s\n", level ? "on" : "off");
+    }
+    _brightness = level;
+}
@@ -0,0 +1,74 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_pm.h>
+#include "display.h"
+#include "buttons.h"
+
+// Saves power while the assistant waits for the wake word. Through ESP-IDF
+// power management the CPU runs at the idle frequency unless a lock asks for
+// full speed: one is held for the whole of a voice turn, another for a short
+// boost after a button press or the wake word. Without PM support in the
+// build, the frequency is switched by hand instead. loop() sleeps between
+// passes while idle (a button edge wakes it at once), and the backlight
+// dims and then goes off after a stretch of inactivity.
+class PowerManager {
+public:
+    PowerManager();
+    ~PowerManager();
+
+    // Call from setup() (the loop task): its handle is what gets woken
+    bool begin(Display& display, Buttons& buttons);
+    void end();
+
+    // A voice turn or connection is in progress: full speed, backlight on
+    void setBusy(bool busy);
+
+    // Full speed for POWER_BOOST_MS from the next update(); wakes loop()
+    // so that is right away. Safe from any task
+    void boost();
+
+    // Something the user should see: restores the backlight (loop only)
+    void noteActivity();
+
+    // Call in loop: ends boosts and applies the backlight timeouts
+    void update();
+
+    // End of a loop pass: busyMs while busy, longer while idle. Returns
+    // early when woken by a button, boost() or wakeLoop()
+    void sleep(uint32_t busyMs);
+    void wakeLoop();
+
+    uint32_t getCpuMhz() const { return getCpuFrequencyMhz(); }
+    bool hasPmLocks() const { return _pmEnabled; }
+    uint8_t getBrightness() const { return _brightness; }
+
+private:
+    bool configurePm(bool lightSleep);
+    void setLock(esp_pm_lock_handle_t lock, bool& held, bool want);
+    void applyFrequency();
+    void setBrightness(uint8_t level);
+
+    Display* _display;
+    Buttons* _buttons;
+    TaskHandle_t _loopTask;
+
+    bool _pmEnabled;
+    esp_pm_lock_handle_t _busyLock;
+    esp_pm_lock_handle_t _boostLock;
+    bool _busyHeld;
+    bool _boostHeld;
+    uint32_t _maxMhz;
+    uint32_t _appliedMhz;
+
+    bool _busy;
+    volatile bool _boostPending;
+    uint32_t _boostUntil;
+    uint32_t _lastActivity;
+    uint8_t _brightness;
+};
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,542 @@
+#include "response_cache.h"
+#include "config.h"
+#include <esp_heap_caps.h>
+
+#if RESPONSE_CACHE_PERSIST
+#include <LittleFS.h>
+#endif
+
+#define CACHE_ALIGN        16
+#define CACHE_DIR          "/rcache"
+#define CACHE_FILE_MAGIC   0x31454352  // "RCE1"
+#define PROMPT_KEY_PREFIX  "#prompt:"  // normalize() never keeps '#'
+
+struct CacheFileHeader {
+    uint32_t magic;
+    uint32_t sampleRate;
+    uint32_t voiceHash;
+    uint32_t samples;
+    uint16_t keyLength;
+    uint16_t textLength;
+    uint8_t pinned;
+    uint8_t reserved[3];
+};
+
+static size_t alignedBytes(size_t samples) {
+    return (samples * sizeof(int16_t) + CACHE_ALIGN - 1) & ~(size_t)(CACHE_ALIGN - 1);
+}
+
+ResponseCache::ResponseCache()
+    : _memory(nullptr)
+    , _capacity(0)
+    , _sampleRate(16000)
+    , _voiceHash(0)
+    , _used(0)
+    , _useClock(0)
+    , _hits(0)
+    , _misses(0)
+    , _mutex(nullptr)
+    , _arena(nullptr)
+    , _capture(nullptr)
+    , _captureSamples(0)
+    , _capturing(false)
+    , _captureFailed(false)
+{
+    for (size_t i = 0; i < MAX_ENTRIES; i++) {
+        _entries[i].used = false;
+    }
+}
+
+ResponseCache::~ResponseCache() {
+    end();
+}
+
+bool ResponseCache::begin(size_t bytes, int sampleRate, const char* voice) {
+    if (_memory) return true;
+
+    _mutex = xSemaphoreCreateMutex();
+    _memory = (uint8_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!_memory || !_mutex) {
+        Serial.println("[Cache] Failed to allocate response cache");
+        end();
+        return false;
+    }
+
+    _capacity = bytes;
+    _sampleRate = sampleRate;
+    _voiceHash = hash(String(voice) + ":" + String(sampleRate));
+    Serial.printf("[Cache] %d KB for cached replies\n", bytes / 1024);
+    return true;
+}
+
+void ResponseCache::end() {
+    abandonCapture();
+
+    for (size_t i = 0; i < MAX_ENTRIES; i++) {
+        _entries[i].used = false;
+        _entries[i].key = "";
+        _entries[i].text = "";
+    }
+    _used = 0;
+
+    if (_memory) {
+        heap_caps_free(_memory);
+        _memory = nullptr;
+    }
+    _capacity = 0;
+
+    if (_mutex) {
+        vSemaphoreDelete(_mutex);
+        _mutex = nullptr;
+    }
+}
+
+String ResponseCache::normalize(const String& transcript) {
+    // Lowercase words separated by single spaces; punctuation and
+    // apostrophes are dropped so "What's the time?" matches "whats the time"
+    String key;
+    bool space = false;
+    for (size_t i = 0; i < transcript.length(); i++) {
+        char c = transcript[i];
+        if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (uint8_t)c >= 0x80) {
+            if (space && key.length() > 0) key += ' ';
+            key += c;
+            space = false;
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '-') {
+            space = true;
+        }
+    }
+    return key;
+}
+
+bool ResponseCache::isCacheable(const String& reply) {
+    if (reply.length() == 0) return false;
+    if (RESPONSE_CACHE_SKIP_DIGITS) {
+        for (size_t i = 0; i < reply.length(); i++) {
+            if (reply[i] >= '0' && reply[i] <= '9') return false;
+        }
+    }
+    return true;
+}
+
+String ResponseCache::promptKey(const String& text) {
+    return PROMPT_KEY_PREFIX + text;
+}
+
+uint32_t ResponseCache::hash(const String& text) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < text.length(); i++) {
+        h = (h ^ (uint8_t)text[i]) * 16777619u;
+    }
+    return h;
+}
+
+bool ResponseCache::expired(const Entry& entry) const {
+    return !entry.pinned && RESPONSE_CACHE_TTL_MS > 0 &&
+           millis() - entry.storedAt > RESPONSE_CACHE_TTL_MS;
+}
+
+ResponseCache::Entry* ResponseCache::find(const String& key) {
+    for (size_t i = 0; i < MAX_ENTRIES; i++) {
+        if (_entries[i].used && _entries[i].key == key) return &_entries[i];
+    }
+    return nullptr;
+}
+
+bool ResponseCache::lookup(const String& transcript, Hit& hit) {
+    if (!_memory) return false;
+
+    String key = normalize(transcript);
+    if (key.length() == 0) return false;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    Entry* entry = find(key);
+    if (entry && expired(*entry)) {
+        evict(*entry);
+        entry = nullptr;
+    }
+
+    bool found = entry != nullptr;
+    if (found) {
+        entry->lastUsed = ++_useClock;
+        hit.text = entry->text;
+        hit.samples = (const int16_t*)(_memory + entry->offset);
+        hit.count = entry->samples;
+        _hits++;
+    } else {
+        _misses++;
+    }
+    xSemaphoreGive(_mutex);
+
+    if (found) {
+        Serial.printf("[Cache] Hit for \"%s\" (%d hits, %d misses)\n", key.c_str(), _hits, _misses);
+    }
+    return found;
+}
+
+bool ResponseCache::store(const String& transcript, const String& reply,
+                          const int16_t* samples, size_t count) {
+    if (!_memory || !isCacheable(reply)) return false;
+
+    String key = normalize(transcript);
+    if (key.length() == 0) return false;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    bool stored = insert(key, reply, samples, count, false);
+    xSemaphoreGive(_mutex);
+    return stored;
+}
+
+bool ResponseCache::hasPrompt(const String& text) {
+    if (!_memory) return false;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    bool found = find(promptKey(text)) != nullptr;
+    xSemaphoreGive(_mutex);
+    return found;
+}
+
+bool ResponseCache::storePrompt(const String& text, const int16_t* samples, size_t count) {
+    if (!_memory) return false;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    bool stored = insert(promptKey(text), text, samples, count, true);
+    xSemaphoreGive(_mutex);
+    return stored;
+}
+
+bool ResponseCache::findPrompt(const String& text, Hit& hit) {
+    if (!_memory || text.length() == 0) return false;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    Entry* entry = find(promptKey(text));
+    if (entry) {
+        hit.text = entry->text;
+        hit.samples = (const int16_t*)(_memory + entry->offset);
+        hit.count = entry->samples;
+    }
+    xSemaphoreGive(_mutex);
+    return entry != nullptr;
+}
+
+size_t ResponseCache::getBytesUsed() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < MAX_ENTRIES; i++) {
+        if (_entries[i].used) bytes += alignedBytes(_entries[i].samples);
+    }
+    return bytes;
+}
+
+bool ResponseCache::insert(const String& key, const String& text,
+                           const int16_t* samples, size_t count, bool pinned) {
+    size_t bytes = alignedBytes(count);
+    if (count == 0 || bytes > _capacity) return false;
+
+    Entry* existing = find(key);
+    if (existing) {
+        evict(*existing);
+    }
+
+    // A free slot and a gap in the region, evicting the oldest until both fit
+    Entry* slot = nullptr;
+    size_t offset = 0;
+    while (true) {
+        slot = nullptr;
+        for (size_t i = 0; i < MAX_ENTRIES && !slot; i++) {
+            if (!_entries[i].used) slot = &_entries[i];
+        }
+
+        if (slot && findGap(bytes, offset)) break;
+
+        if (slot && _capacity - getBytesUsed() >= bytes) {
+            // Enough room in total, just scattered
+            compact();
+            if (findGap(bytes, offset)) break;
+        }
+
+        if (!evictOldest()) {
+            Serial.println("[Cache] No room for reply (pinned prompts fill the cache)");
+            return false;
+        }
+    }
+
+    memcpy(_memory + offset, samples, count * sizeof(int16_t));
+    slot->used = true;
+    slot->pinned = pinned;
+    slot->key = key;
+    slot->text = text;
+    slot->offset = offset;
+    slot->samples = count;
+    slot->lastUsed = ++_useClock;
+    slot->storedAt = millis();
+    _used++;
+
+    Serial.printf("[Cache] Stored \"%s\" (%d samples, %d/%d KB used)\n",
+                  key.c_str(), count, getBytesUsed() / 1024, _capacity / 1024);
+    persist(*slot);
+    return true;
+}
+
+void ResponseCache::evict(Entry& entry) {
+    unpersist(entry);
+    entry.used = false;
+    entry.key = "";
+    entry.text = "";
+    _used--;
+}
+
+bool ResponseCache::evictOldest() {
+    Entry* oldest = nullptr;
+    for (size_t i = 0; i < MAX_ENTRIES; i++) {
+        Entry& entry = _entries[i];
+        if (!entry.used || entry.pinned) continue;
+        if (!oldest || entry.lastUsed < oldest->lastUsed) oldest = &entry;
+    }
+    if (!oldest) return false;
+
+    evict(*oldest);
+    return true;
+}
+
+bool ResponseCache::findGap(size_t bytes, size_t& offset) const {
+    // First fit: candidates are the region start and the end of every entry
+    for (size_t c = 0; c <= MAX_ENTRIES; c++) {
+        size_t start = 0;
+        if (c < MAX_ENTRIES) {
+            if (!_entries[c].used) continue;
+            start = _entries[c].offset + alignedBytes(_entries[c].samples);
+        }
+        if (start + bytes > _capacity) continue;
+
+        bool overlaps = false;
+        for (size_t i = 0; i < MAX_ENTRIES && !overlaps; i++) {
+            const Entry& entry = _entries[i];
+            if (!entry.used) continue;
+            size_t end = entry.offset + alignedBytes(entry.samples);
+            overlaps = start < end && entry.offset < start + bytes;
+        }
+
+        if (!overlaps) {
+            offset = start;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ResponseCache::compact() {
+    // Slide entries down in address order so the free space is one gap
+    size_t cursor = 0;
+    bool moved[MAX_ENTRIES] = {false};
+    while (true) {
+        Entry* lowest = nullptr;
+        for (size_t i = 0; i < MAX_ENTRIES; i++) {
+            if (!_entries[i].used || moved[i]) continue;
+            if (!lowest || _entries[i].offset < lowest->offset) lowest = &_entries[i];
+        }
+        if (!lowest) break;
+
+        moved[lowest - _entries] = true;
+        size_t bytes = alignedBytes(lowest->samples);
+        if (lowest->offset != cursor) {
+            memmove(_memory + cursor, _memory + lowest->offset, bytes);
+            lowest->offset = cursor;
+        }
+        cursor += bytes;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Reply capture
+// -----------------------------------------------------------------------------
+
+void ResponseCache::beginCapture(const String& transcript) {
+    abandonCapture();
+    if (!_memory) return;
+
+    String key = normalize(transcript);
+    if (key.length() == 0) return;
+
+    int16_t* buffer = (int16_t*)arenaAlloc(_arena, RESPONSE_CACHE_MAX_CLIP_SAMPLES * sizeof(int16_t));
+    if (!buffer) return;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _capture = buffer;
+    _captureSamples = 0;
+    _captureFailed = false;
+    _captureKey = key;
+    _captureText = "";
+    _capturing = true;
+    xSemaphoreGive(_mutex);
+}
+
+void ResponseCache::setCaptureText(const String& reply) {
+    if (!_mutex) return;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (_capturing) {
+        _captureText = reply;
+        if (!isCacheable(reply)) _captureFailed = true;
+    }
+    xSemaphoreGive(_mutex);
+}
+
+void ResponseCache::abandonCapture() {
+    if (!_mutex) return;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    int16_t* buffer = _capture;
+    _capture = nullptr;
+    _capturing = false;
+    _captureKey = "";
+    _captureText = "";
+    xSemaphoreGive(_mutex);
+
+    if (buffer) {
+        arenaFree(_arena, buffer);
+    }
+}
+
+void ResponseCache::replyAudio(const int16_t* samples, size_t count) {
+    if (!_mutex) return;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (_capturing && !_captureFailed) {
+        if (_captureSamples + count > RESPONSE_CACHE_MAX_CLIP_SAMPLES) {
+            _captureFailed = true;  // Too long to be worth keeping
+        } else {
+            memcpy(_capture + _captureSamples, samples, count * sizeof(int16_t));
+            _captureSamples += count;
+        }
+    }
+    xSemaphoreGive(_mutex);
+}
+
+void ResponseCache::replyDone(bool complete) {
+    if (!_mutex) return;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (_capturing && complete && !_captureFailed && _captureText.length() > 0) {
+        insert(_captureKey, _captureText, _capture, _captureSamples, false);
+    }
+    xSemaphoreGive(_mutex);
+
+    abandonCapture();
+}
+
+// -----------------------------------------------------------------------------
+// Persistence
+// -----------------------------------------------------------------------------
+
+#if RESPONSE_CACHE_PERSIST
+
+static String entryPath(uint32_t keyHash) {
+    char name[32];
+    snprintf(name, sizeof(name), CACHE_DIR "/%08lx.pcm", (unsigned long)keyHash);
+    return String(name);
+}
+
+bool ResponseCache::loadPersisted() {
+    if (!_memory) return false;
+
+    if (!LittleFS.begin(true)) {
+        Serial.println("[Cache] LittleFS mount failed, not persisting");
+        return false;
+    }
+    if (!LittleFS.exists(CACHE_DIR)) {
+        LittleFS.mkdir(CACHE_DIR);
+    }
+
+    File dir = LittleFS.open(CACHE_DIR);
+    int loaded = 0;
+    for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+        CacheFileHeader header;
+        bool valid = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                     header.magic == CACHE_FILE_MAGIC &&
+                     header.sampleRate == (uint32_t)_sampleRate &&
+                     header.voiceHash == _voiceHash &&
+                     alignedBytes(header.samples) <= _capacity;
+
+        String key, text;
+        int16_t* samples = nullptr;
+        if (valid) {
+            key.reserve(header.keyLength);
+            text.reserve(header.textLength);
+            for (uint16_t i = 0; i < header.keyLength; i++) key += (char)file.read();
+            for (uint16_t i = 0; i < header.textLength; i++) text += (char)file.read();
+
+            samples = (int16_t*)arenaAlloc(_arena, header.samples * sizeof(int16_t));
+            size_t bytes = header.samples * sizeof(int16_t);
+            valid = samples && file.read((uint8_t*)samples, bytes) == bytes;
+        }
+
+        String path = String(CACHE_DIR "/") + file.name();
+        file.close();
+
+        if (valid) {
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+            valid = insert(key, text, samples, header.samples, header.pinned);
+            xSemaphoreGive(_mutex);
+            loaded += valid;
+        }
+        if (samples) {
+            arenaFree(_arena, samples);
+        }
+        if (!valid) {
+            LittleFS.remove(path);  // Other voice, corrupt, or no longer fits
+        }
+    }
+
+    Serial.printf("[Cache] Loaded %d persisted replies\n", loaded);
+    return true;
+}
+
+void ResponseCache::persist(const Entry& entry) {
+    // insert() of a loaded entry rewrites the same file; skip while loading
+    String path = entryPath(hash(entry.key));
+    if (LittleFS.exists(path)) return;
+
+    File file = LittleFS.open(path, "w");
+    if (!file) return;
+
+    CacheFileHeader header = {};
+    header.magic = CACHE_FILE_MAGIC;
+    header.sampleRate = _sampleRate;
+    header.voiceHash = _voiceHash;
+    header.samples = entry.samples;
+    header.keyLength = entry.key.length();
+    header.textLength = entry.text.length();
+    header.pinned = entry.pinned;
+
+    size_t bytes = entry.samples * sizeof(int16_t);
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              file.write((const uint8_t*)entry.key.c_str(), header.keyLength) == header.keyLength &&
+              file.write((const uint8_t*)entry.text.c_str(), header.textLength) == header.textLength &&
+              file.write(_memory + entry.offset, bytes) == bytes;
+    file.close();
+
+    if (!ok) {
+        Serial.println("[Cache] Flash write failed (partition full?)");
+        LittleFS.remove(path);
+    }
+}
+
+void ResponseCache::unpersist(const Entry& entry) {
+    LittleFS.remove(entryPath(hash(entry.key)));
+}
+
+#else
+
+bool ResponseCache::loadPersisted() {
+    return false;
+}
+
+void ResponseCache::persist(const Entry& entry) {
+}
+
+void ResponseCache::unpersist(const Entry& entry) {
+}
+
+#endif
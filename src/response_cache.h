@@ -0,0 +1,118 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "memory_arena.h"
+#include "tts_pipeline.h"
+
+// Answers to repeated questions with the audio they were spoken with, so
+// asking again skips Gemini and TTS and goes straight to playback.
+// Entries are keyed by the normalized transcript and their PCM lives in
+// one PSRAM region; the least recently used entry goes when it is full.
+// Pinned entries (boot-time prompts) are never evicted.
+class ResponseCache : public ReplyAudioSink {
+public:
+    struct Hit {
+        String text;
+        const int16_t* samples;  // Valid until the next store (turns don't overlap)
+        size_t count;
+    };
+
+    static const size_t MAX_ENTRIES = 32;
+
+    ResponseCache();
+    ~ResponseCache();
+
+    // voice identifies the TTS settings; persisted audio from another voice
+    // or sample rate is discarded
+    bool begin(size_t bytes, int sampleRate, const char* voice);
+    void end();
+
+    // Capture staging comes from the turn arena (optional, else PSRAM/heap)
+    void setArena(TurnArena* arena) { _arena = arena; }
+
+    // Keep entries in LittleFS across reboots (RESPONSE_CACHE_PERSIST)
+    bool loadPersisted();
+
+    // "What's the time?" -> "whats the time"
+    static String normalize(const String& transcript);
+
+    // Replies that would go stale (times, dates, numbers) are not kept
+    static bool isCacheable(const String& reply);
+
+    bool lookup(const String& transcript, Hit& hit);
+    bool store(const String& transcript, const String& reply,
+               const int16_t* samples, size_t count);
+
+    // Fixed prompts, synthesized once and pinned
+    bool hasPrompt(const String& text);
+    bool storePrompt(const String& text, const int16_t* samples, size_t count);
+    bool findPrompt(const String& text, Hit& hit);
+
+    // Record the reply the TTS pipeline is about to speak. The pipeline
+    // reports its audio through ReplyAudioSink; the entry is stored when the
+    // reply completes with its text set
+    void beginCapture(const String& transcript);
+    void setCaptureText(const String& reply);
+    void abandonCapture();
+
+    void replyAudio(const int16_t* samples, size_t count) override;
+    void replyDone(bool complete) override;
+
+    size_t getCount() const { return _used; }
+    size_t getBytesUsed() const;
+    uint32_t getHits() const { return _hits; }
+    uint32_t getMisses() const { return _misses; }
+
+private:
+    struct Entry {
+        bool used;
+        bool pinned;
+        String key;
+        String text;
+        size_t offset;    // Into _memory
+        size_t samples;
+        uint32_t lastUsed;
+        uint32_t storedAt;
+    };
+
+    Entry* find(const String& key);
+    bool insert(const String& key, const String& text,
+                const int16_t* samples, size_t count, bool pinned);
+    void evict(Entry& entry);
+    bool evictOldest();
+    bool findGap(size_t bytes, size_t& offset) const;
+    void compact();
+    bool expired(const Entry& entry) const;
+
+    static String promptKey(const String& text);
+    static uint32_t hash(const String& text);
+
+    // Persistence (no-ops unless RESPONSE_CACHE_PERSIST)
+    void persist(const Entry& entry);
+    void unpersist(const Entry& entry);
+
+    uint8_t* _memory;
+    size_t _capacity;
+    int _sampleRate;
+    uint32_t _voiceHash;
+    Entry _entries[MAX_ENTRIES];
+    size_t _used;
+    uint32_t _useClock;   // Monotonic counter for LRU order
+    uint32_t _hits;
+    uint32_t _misses;
+    SemaphoreHandle_t _mutex;
+
+    // Reply being captured
+    TurnArena* _arena;
+    int16_t* _capture;
+    size_t _captureSamples;
+    bool _capturing;
+    bool _captureFailed;
+    String _captureKey;
+    String _captureText;
+};
+
+#endif // RESPONSE_CACHE_H
@@ -0,0 +1,130 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Lock-free single-producer / single-consumer ring.
+// One task writes and one other task reads without locking: the head index
+// is only stored by the producer and the tail only by the consumer.
+// One slot is kept empty to tell a full ring from an empty one.
+template <typename T>
+class SpscRing {
+public:
+    SpscRing() : _data(nullptr), _slots(0), _head(0), _tail(0) {}
+    ~SpscRing() { release(); }
+
+    // Allocate room for capacity items (PSRAM if available)
+    bool begin(size_t capacity) {
+        if (_data) return true;
+        _slots = capacity + 1;
+        _data = psramFound() ? (T*)ps_malloc(_slots * sizeof(T))
+                             : (T*)malloc(_slots * sizeof(T));
+        if (!_data) {
+            _slots = 0;
+            return false;
+        }
+        reset();
+        return true;
+    }
+
+    void release() {
+        if (_data) {
+            free(_data);
+            _data = nullptr;
+        }
+        _slots = 0;
+    }
+
+    // Only safe while neither side is active
+    void reset() {
+        _head.store(0, std::memory_order_relaxed);
+        _tail.store(0, std::memory_order_relaxed);
+    }
+
+    bool isAllocated() const { return _data != nullptr; }
+    size_t capacity() const { return _slots ? _slots - 1 : 0; }
+
+    size_t available() const {
+        size_t head = _head.load(std::memory_order_acquire);
+        size_t tail = _tail.load(std::memory_order_acquire);
+        return head >= tail ? head - tail : _slots - tail + head;
+    }
+
+    size_t space() const { return _slots ? capacity() - available() : 0; }
+
+    // Producer: copy in up to count items, returns the number written
+    size_t write(const T* items, size_t count) {
+        size_t written = 0;
+        while (written < count) {
+            size_t run;
+            T* dst = writePtr(run);
+            if (run == 0) break;
+            run = min(run, count - written);
+            memcpy(dst, items + written, run * sizeof(T));
+            commit(run);
+            written += run;
+        }
+        return written;
+    }
+
+    // Producer: contiguous free run for in-place writes, then commit
+    T* writePtr(size_t& count) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t tail = _tail.load(std::memory_order_acquire);
+        if (head >= tail) {
+            count = _slots - head - (tail == 0 ? 1 : 0);
+        } else {
+            count = tail - head - 1;
+        }
+        return _data + head;
+    }
+
+    void commit(size_t count) {
+        size_t head = _head.load(std::memory_order_relaxed) + count;
+        if (head >= _slots) head -= _slots;
+        _head.store(head, std::memory_order_release);
+    }
+
+    // Consumer: copy out up to count items, returns the number read
+    size_t read(T* items, size_t count) {
+        size_t done = 0;
+        while (done < count) {
+            size_t run;
+            const T* src = peek(run);
+            if (run == 0) break;
+            run = min(run, count - done);
+            memcpy(items + done, src, run * sizeof(T));
+            consume(run);
+            done += run;
+        }
+        return done;
+    }
+
+    // Consumer: contiguous readable run for zero-copy reads, then consume
+    const T* peek(size_t& count) const {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t head = _head.load(std::memory_order_acquire);
+        count = head >= tail ? head - tail : _slots - tail;
+        return _data + tail;
+    }
+
+    void consume(size_t count) {
+        size_t tail = _tail.load(std::memory_order_relaxed) + count;
+        if (tail >= _slots) tail -= _slots;
+        _tail.store(tail, std::memory_order_release);
+    }
+
+    // Consumer: drop everything currently readable
+    void clear() {
+        _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    T* _data;
+    size_t _slots;
+    std::atomic<size_t> _head;
+    std::atomic<size_t> _tail;
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,110 @@
+#include "sound_bank.h"
+#include <esp_heap_caps.h>
+#include <cmath>
+
+#define TONE_AMPLITUDE  16000
+#define MAX_CUE_TONES   3
+
+struct Tone {
+    int frequency;   // 0 = gap
+    int durationMs;
+};
+
+// Same tones the cues were synthesized from at runtime before
+static const Tone CUE_TONES[(int)Cue::COUNT][MAX_CUE_TONES] = {
+    { { 1000, 50 } },                          // BEEP
+    { { 800, 100 }, { 0, 50 }, { 1200, 100 } }, // START
+    { { 1200, 100 }, { 0, 50 }, { 800, 100 } }, // STOP
+    { { 400, 200 }, { 0, 100 }, { 300, 300 } }, // ERROR
+};
+
+static size_t toneSamples(const Tone& tone, int sampleRate) {
+    return (size_t)sampleRate * tone.durationMs / 1000;
+}
+
+SoundBank::SoundBank()
+    : _samples(nullptr)
+{
+    for (int i = 0; i < (int)Cue::COUNT; i++) {
+        _offsets[i] = 0;
+        _counts[i] = 0;
+    }
+}
+
+SoundBank::~SoundBank() {
+    end();
+}
+
+bool SoundBank::begin(int sampleRate) {
+    if (_samples) return true;
+
+    size_t total = 0;
+    for (int c = 0; c < (int)Cue::COUNT; c++) {
+        _offsets[c] = total;
+        _counts[c] = 0;
+        for (int t = 0; t < MAX_CUE_TONES; t++) {
+            _counts[c] += toneSamples(CUE_TONES[c][t], sampleRate);
+        }
+        total += _counts[c];
+    }
+
+    // Internal RAM keeps cue reads off the PSRAM bus while TTS streams
+    _samples = (int16_t*)heap_caps_malloc(total * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!_samples) {
+        _samples = (int16_t*)heap_caps_malloc(total * sizeof(int16_t), MALLOC_CAP_8BIT);
+    }
+    if (!_samples) {
+        Serial.println("[SoundBank] Failed to allocate cue buffer");
+        return false;
+    }
+
+    for (int c = 0; c < (int)Cue::COUNT; c++) {
+        int16_t* out = _samples + _offsets[c];
+        for (int t = 0; t < MAX_CUE_TONES; t++) {
+            out += renderTone(out, CUE_TONES[c][t].frequency, CUE_TONES[c][t].durationMs, sampleRate);
+        }
+    }
+
+    Serial.printf("[SoundBank] %d cues rendered (%d bytes)\n", (int)Cue::COUNT, total * sizeof(int16_t));
+    return true;
+}
+
+void SoundBank::end() {
+    if (_samples) {
+        heap_caps_free(_samples);
+        _samples = nullptr;
+    }
+}
+
+const int16_t* SoundBank::get(Cue cue, size_t& count) const {
+    int index = (int)cue;
+    if (!_samples || index < 0 || index >= (int)Cue::COUNT) {
+        count = 0;
+        return nullptr;
+    }
+    count = _counts[index];
+    return _samples + _offsets[index];
+}
+
+size_t SoundBank::renderTone(int16_t* out, int frequency, int durationMs, int sampleRate) {
+    size_t sampleCount = (size_t)sampleRate * durationMs / 1000;
+    if (frequency <= 0) {
+        memset(out, 0, sampleCount * sizeof(int16_t));
+        return sampleCount;
+    }
+
+    // Linear fade over the first and last 10% avoids clicks
+    size_t fadeLen = sampleCount / 10;
+    float phaseIncrement = (2.0f * M_PI * frequency) / sampleRate;
+
+    for (size_t i = 0; i < sampleCount; i++) {
+        float envelope = 1.0f;
+        if (i < fadeLen) {
+            envelope = (float)i / fadeLen;
+        } else if (i > sampleCount - fadeLen) {
+            envelope = (float)(sampleCount - i) / fadeLen;
+        }
+        out[i] = (int16_t)(sinf(phaseIncrement * i) * TONE_AMPLITUDE * envelope);
+    }
+    return sampleCount;
+}
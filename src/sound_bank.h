@@ -0,0 +1,38 @@
+#ifndef SOUND_BANK_H
+#define SOUND_BANK_H
+
+#include <Arduino.h>
+
+enum class Cue {
+    BEEP,    // Button press / volume change
+    START,   // Listening started
+    STOP,    // Listening stopped
+    ERROR,   // Something failed
+    COUNT
+};
+
+// Feedback cues rendered once at boot into one internal RAM block, so
+// playing one is a pointer handoff instead of per-sample sin() and a
+// malloc. Each cue is a short sequence of enveloped tones and gaps.
+class SoundBank {
+public:
+    SoundBank();
+    ~SoundBank();
+
+    bool begin(int sampleRate);
+    void end();
+    bool isReady() const { return _samples != nullptr; }
+
+    // nullptr (count 0) before begin()
+    const int16_t* get(Cue cue, size_t& count) const;
+
+    // One enveloped tone (frequency 0 = silence); returns samples written
+    static size_t renderTone(int16_t* out, int frequency, int durationMs, int sampleRate);
+
+private:
+    int16_t* _samples;
+    size_t _offsets[(int)Cue::COUNT];
+    size_t _counts[(int)Cue::COUNT];
+};
+
+#endif // SOUND_BANK_H
@@ -1,16 +1,57 @@
 #include "speech_client.h"
 #include "config.h"
 #include <ArduinoJson.h>
+#include <new>
 #include <WiFiClientSecure.h>
-
-// Base64 encoding table
-static const char base64_chars[] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+#include "http_stream.h"
+#include "log.h"
+#include "metrics.h"
+
+// Streaming TTS read size
+#define TTS_STREAM_READ_SIZE    1024   // Bytes read from the socket per pass
+#define TTS_STREAM_TIMEOUT_MS   15000  // Max gap between received bytes
+#define TTS_STREAM_DECODE_CHARS 256    // Base64 decoded per slice (keeps the stack small)
+
+// API hosts (each gets one pooled connection)
+#define STT_API_HOST            "speech.googleapis.com"
+#define TTS_API_HOST            "texttospeech.googleapis.com"
+
+// Streaming STT upload
+#define STT_REQUEST_SUFFIX      "\"}}"
+#define STT_ENCODE_BLOCK_BYTES  1536   // Wire bytes per base64 block (multiple of 3)
+
+// Live transcription upload task
+#define STT_UPLOAD_TASK_STACK   10240  // TLS handshake needs a deep stack; buffers live on the heap
+#define STT_UPLOAD_TASK_PRIO    2
+#define STT_UPLOAD_POLL_MS      20
+
+// Everything the upload task writes through, kept out of its stack frame
+struct SpeechClient::UploadBuffers {
+    ChunkedRequest request;
+    uint8_t wire[STT_ENCODE_BLOCK_BYTES];
+    char encoded[base64EncodedLength(STT_ENCODE_BLOCK_BYTES)];
+    int16_t samples[STT_ENCODE_BLOCK_BYTES / 2];
+};
 
 SpeechClient::SpeechClient()
     : _languageCode("en-US")
     , _voiceName("en-US-Neural2-A")
     , _hasError(false)
+    , _encoding(AudioEncoding::LINEAR16)
+    , _pool(nullptr)
+    , _arena(nullptr)
+    , _uploadStream(nullptr)
+    , _uploadStorage(nullptr)
+    , _uploadBuffers(nullptr)
+    , _uploadTask(nullptr)
+    , _uploadSampleRate(16000)
+    , _uploadSession(false)
+    , _uploadRunning(false)
+    , _uploadFinishing(false)
+    , _uploadAbort(false)
+    , _uploadDone(false)
+    , _uploadOverflow(false)
+    , _uploadStatus(-1)
 {
 }
 
@@ -19,6 +60,19 @@ void SpeechClient::begin(const char* apiKey) {
     Serial.println("[SpeechClient] Initialized");
 }
 
+void SpeechClient::setConnectionPool(ConnectionPool* pool) {
+    _pool = pool;
+    if (_pool) {
+        _pool->addHost(STT_API_HOST);
+        _pool->addHost(TTS_API_HOST);
+    }
+}
+
+void SpeechClient::setArena(TurnArena* arena) {
+    _arena = arena;
+    _jsonAllocator.setArena(arena);
+}
+
 void SpeechClient::setError(const String& error) {
     _hasError = true;
     _lastError = error;
@@ -30,192 +84,87 @@ void SpeechClient::clearError() {
     _lastError = "";
 }
 
-String SpeechClient::base64Encode(const uint8_t* data, size_t length) {
-    String encoded;
-    encoded.reserve((length + 2) / 3 * 4);
-
-    int i = 0;
-    uint8_t byte3[3];
-    uint8_t byte4[4];
-
-    while (length--) {
-        byte3[i++] = *(data++);
-        if (i == 3) {
-            byte4[0] = (byte3[0] & 0xfc) >> 2;
-            byte4[1] = ((byte3[0] & 0x03) << 4) + ((byte3[1] & 0xf0) >> 4);
-            byte4[2] = ((byte3[1] & 0x0f) << 2) + ((byte3[2] & 0xc0) >> 6);
-            byte4[3] = byte3[2] & 0x3f;
-
-            for (i = 0; i < 4; i++) {
-                encoded += base64_chars[byte4[i]];
-            }
-            i = 0;
-        }
-    }
-
-    if (i) {
-        for (int j = i; j < 3; j++) {
-            byte3[j] = 0;
-        }
-
-        byte4[0] = (byte3[0] & 0xfc) >> 2;
-        byte4[1] = ((byte3[0] & 0x03) << 4) + ((byte3[1] & 0xf0) >> 4);
-        byte4[2] = ((byte3[1] & 0x0f) << 2) + ((byte3[2] & 0xc0) >> 6);
-        byte4[3] = byte3[2] & 0x3f;
-
-        for (int j = 0; j < i + 1; j++) {
-            encoded += base64_chars[byte4[j]];
-        }
-
-        while (i++ < 3) {
-            encoded += '=';
-        }
+const uint8_t* SpeechClient::encodeSamples(const int16_t* samples, size_t count,
+                                           uint8_t* scratch, size_t& length) const {
+    if (_encoding == AudioEncoding::MULAW) {
+        mulawEncodeBlock(samples, count, scratch);
+        length = count;
+        return scratch;
     }
 
-    return encoded;
-}
-
-// Helper to get base64 character value
-static int base64CharValue(char c) {
-    if (c >= 'A' && c <= 'Z') return c - 'A';
-    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
-    if (c >= '0' && c <= '9') return c - '0' + 52;
-    if (c == '+') return 62;
-    if (c == '/') return 63;
-    if (c == '=') return 0;  // Padding
-    return -1;  // Invalid
+    // LINEAR16 is already the wire format
+    length = count * sizeof(int16_t);
+    return (const uint8_t*)samples;
 }
 
-// Robust base64 decode that handles whitespace and validates input
-size_t SpeechClient::base64Decode(const char* input, size_t inputLen, uint8_t* output, size_t maxLength) {
-    Serial.println("[BASE64] Step 1: Starting decode");
-    Serial.printf("[BASE64] Input length: %d, Max output: %d\n", inputLen, maxLength);
-
-    if (inputLen == 0) {
-        Serial.println("[BASE64] Error: Empty input");
-        return 0;
-    }
-
-    // Count valid base64 characters
-    size_t validCount = 0;
-    size_t paddingCount = 0;
-
-    for (size_t i = 0; i < inputLen; i++) {
-        char c = input[i];
-        if (c == '=') {
-            paddingCount++;
-            validCount++;
-        } else if (base64CharValue(c) >= 0) {
-            validCount++;
-        }
-        // Skip whitespace and other chars
+size_t SpeechClient::encodeNextBlock(const CaptureBuffer& audio, size_t& offset, size_t& remaining,
+                                     Base64Encoder& base64, uint8_t* wire, char* encoded) const {
+    // Blocks stop at capture block boundaries, which aren't whole 3-byte
+    // groups; the encoder carries the odd bytes into the next one
+    size_t count;
+    const int16_t* pcm = audio.span(offset, count);
+    count = min(min(count, remaining), STT_ENCODE_BLOCK_BYTES / audioBytesPerSample(_encoding));
+    if (count == 0) {
+        remaining = 0;
+        return base64.finish(encoded);
     }
 
-    Serial.printf("[BASE64] Step 2: Found %d valid base64 chars, %d padding\n", validCount, paddingCount);
+    size_t wireLen;
+    const uint8_t* bytes = encodeSamples(pcm, count, wire, wireLen);
+    offset += count;
+    remaining -= count;
 
-    // Adjust to multiple of 4 by truncating if necessary
-    size_t adjustedLen = (validCount / 4) * 4;
-    if (adjustedLen == 0) {
-        Serial.println("[BASE64] Error: Not enough valid characters");
-        return 0;
+    size_t written = base64.update(bytes, wireLen, encoded);
+    if (remaining == 0) {
+        written += base64.finish(encoded + written);
     }
-
-    Serial.printf("[BASE64] Step 3: Adjusted length to %d (multiple of 4)\n", adjustedLen);
-
-    // Calculate output size
-    size_t outputLen = (adjustedLen / 4) * 3;
-    // Account for padding
-    if (paddingCount >= 1) outputLen--;
-    if (paddingCount >= 2) outputLen--;
-
-    Serial.printf("[BASE64] Step 4: Expected output size: %d bytes\n", outputLen);
-
-    if (outputLen > maxLength) {
-        Serial.printf("[BASE64] Error: Output too large (%d > %d)\n", outputLen, maxLength);
-        return 0;
-    }
-
-    // Decode
-    Serial.println("[BASE64] Step 5: Decoding...");
-    size_t outPos = 0;
-    size_t validIdx = 0;
-    uint8_t quad[4];
-
-    for (size_t i = 0; i < inputLen && validIdx < adjustedLen; i++) {
-        char c = input[i];
-        int val = base64CharValue(c);
-
-        if (val < 0 && c != '=') continue;  // Skip invalid chars
-
-        quad[validIdx % 4] = (c == '=') ? 0 : val;
-        validIdx++;
-
-        if (validIdx % 4 == 0) {
-            // Decode quad
-            if (outPos < maxLength) output[outPos++] = (quad[0] << 2) | (quad[1] >> 4);
-            if (outPos < maxLength && outPos < outputLen) output[outPos++] = (quad[1] << 4) | (quad[2] >> 2);
-            if (outPos < maxLength && outPos < outputLen) output[outPos++] = (quad[2] << 6) | quad[3];
-        }
-    }
-
-    Serial.printf("[BASE64] Step 6: Decoded %d bytes\n", outPos);
-
-    // Show first few decoded bytes
-    if (outPos >= 8) {
-        Serial.printf("[BASE64] First 8 bytes: %02X %02X %02X %02X %02X %02X %02X %02X\n",
-                      output[0], output[1], output[2], output[3],
-                      output[4], output[5], output[6], output[7]);
-    }
-
-    return outPos;
-}
-
-// Keep old signature for compatibility with transcribe
-size_t SpeechClient::base64Decode(const String& input, uint8_t* output, size_t maxLength) {
-    return base64Decode(input.c_str(), input.length(), output, maxLength);
+    return written;
 }
 
-String SpeechClient::transcribe(const int16_t* audioBuffer, size_t sampleCount, int sampleRate) {
+String SpeechClient::transcribe(const CaptureBuffer& audio, size_t offset, size_t sampleCount,
+                                int sampleRate) {
     clearError();
 
-    if (!audioBuffer || sampleCount == 0) {
+    if (sampleCount == 0 || offset + sampleCount > audio.size()) {
         setError("Invalid audio buffer");
         return "";
     }
 
     Serial.printf("[SpeechClient] Transcribing %d samples at %d Hz\n", sampleCount, sampleRate);
 
-    // Encode audio as base64
-    String audioContent = base64Encode((const uint8_t*)audioBuffer, sampleCount * sizeof(int16_t));
+    // Build request JSON manually (ArduinoJson can't handle 66KB+ strings).
+    // The audio is encoded block by block straight into the body (mu-law
+    // is converted first, half the size of PCM)
+    size_t contentLength = base64EncodedLength(sampleCount * audioBytesPerSample(_encoding));
+    String requestBody;
+    requestBody.reserve(contentLength + 256);  // Pre-allocate
 
-    Serial.printf("[SpeechClient] Encoded audio size: %d bytes\n", audioContent.length());
+    requestBody = buildRecognizePrefix(sampleRate);
 
-    // Build request JSON manually (ArduinoJson can't handle 66KB+ strings)
-    String requestBody;
-    requestBody.reserve(audioContent.length() + 256);  // Pre-allocate
-
-    requestBody = "{\"config\":{";
-    requestBody += "\"encoding\":\"LINEAR16\",";
-    requestBody += "\"sampleRateHertz\":" + String(sampleRate) + ",";
-    requestBody += "\"languageCode\":\"" + _languageCode + "\",";
-    requestBody += "\"enableAutomaticPunctuation\":true,";
-    requestBody += "\"model\":\"latest_short\"";
-    requestBody += "},\"audio\":{\"content\":\"";
-    requestBody += audioContent;
-    requestBody += "\"}}";
+    Base64Encoder base64;
+    uint8_t wire[STT_ENCODE_BLOCK_BYTES];
+    char encoded[base64EncodedLength(STT_ENCODE_BLOCK_BYTES) + 5];
+    size_t remaining = sampleCount;
+
+    while (remaining > 0) {
+        encoded[encodeNextBlock(audio, offset, remaining, base64, wire, encoded)] = '\0';
+        requestBody += encoded;
+    }
+
+    requestBody += STT_REQUEST_SUFFIX;
 
     Serial.printf("[SpeechClient] Request body size: %d bytes\n", requestBody.length());
 
     // Make HTTP request
-    WiFiClientSecure client;
-    client.setInsecure();  // Skip certificate verification for simplicity
+    PooledClient client(_pool, STT_API_HOST);
 
     HTTPClient http;
+    http.setReuse(true);
     String url = "https://speech.googleapis.com/v1/speech:recognize?key=" + _apiKey;
 
     Serial.println("[SpeechClient] Sending request to Speech-to-Text API...");
 
-    if (!http.begin(client, url)) {
+    if (!http.begin(client.get(), url)) {
         setError("Failed to connect to Speech API");
         return "";
     }
@@ -223,16 +172,20 @@ String SpeechClient::transcribe(const int16_t* audioBuffer, size_t sampleCount,
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(30000);  // 30 second timeout
 
+    // One blocking POST: the upload is counted in the response time
+    metricsBegin(Span::STT_RESPONSE);
     int httpCode = http.POST(requestBody);
 
     if (httpCode <= 0) {
         setError("HTTP request failed: " + String(http.errorToString(httpCode).c_str()));
         http.end();
+        client.discard();
         return "";
     }
 
     String response = http.getString();
     http.end();
+    metricsEnd(Span::STT_RESPONSE);
 
     Serial.printf("[SpeechClient] Response code: %d\n", httpCode);
 
@@ -241,8 +194,23 @@ String SpeechClient::transcribe(const int16_t* audioBuffer, size_t sampleCount,
         return "";
     }
 
-    // Parse response
-    JsonDocument responseDoc;
+    return parseTranscript(response);
+}
+
+String SpeechClient::buildRecognizePrefix(int sampleRate) {
+    // Built manually: the audio content is far too large for a JsonDocument
+    String prefix = "{\"config\":{";
+    prefix += "\"encoding\":\"" + String(audioEncodingName(_encoding)) + "\",";
+    prefix += "\"sampleRateHertz\":" + String(sampleRate) + ",";
+    prefix += "\"languageCode\":\"" + _languageCode + "\",";
+    prefix += "\"enableAutomaticPunctuation\":true,";
+    prefix += "\"model\":\"latest_short\"";
+    prefix += "},\"audio\":{\"content\":\"";
+    return prefix;
+}
+
+String SpeechClient::parseTranscript(const String& response) {
+    JsonDocument responseDoc(&_jsonAllocator);
     DeserializationError error = deserializeJson(responseDoc, response);
 
     if (error) {
@@ -264,6 +232,297 @@ String SpeechClient::transcribe(const int16_t* audioBuffer, size_t sampleCount,
     return "";
 }
 
+String SpeechClient::transcribeStream(const CaptureBuffer& audio, size_t offset, size_t sampleCount,
+                                      int sampleRate) {
+    clearError();
+
+    if (sampleCount == 0 || offset + sampleCount > audio.size()) {
+        setError("Invalid audio buffer");
+        return "";
+    }
+
+    Serial.printf("[SpeechClient] Streaming %d samples at %d Hz\n", sampleCount, sampleRate);
+
+    PooledClient client(_pool, STT_API_HOST);
+    ChunkedRequest request;
+    String path = "/v1/speech:recognize?key=" + _apiKey;
+    uint8_t wire[STT_ENCODE_BLOCK_BYTES];
+    char encoded[base64EncodedLength(STT_ENCODE_BLOCK_BYTES) + 4];
+    int httpCode = -1;
+
+    // A pooled connection the server already closed fails before any
+    // response; the audio is all in memory, so retry once on a fresh one
+    for (int attempt = 0; attempt < 2 && httpCode <= 0; attempt++) {
+        if (attempt > 0) {
+            if (!client.isPooled()) break;
+            Serial.println("[SpeechClient] Pooled connection lost, reconnecting");
+            client.get().stop();
+        }
+
+        metricsBegin(Span::STT_UPLOAD);
+        if (!request.begin(client.get(), STT_API_HOST, path, "application/json", true)) {
+            continue;
+        }
+
+        request.print(buildRecognizePrefix(sampleRate).c_str());
+
+        // Encode fixed blocks straight into the chunk buffer
+        Base64Encoder base64;
+        size_t position = offset;
+        size_t remaining = sampleCount;
+
+        while (remaining > 0 && !request.hasFailed()) {
+            request.write((const uint8_t*)encoded,
+                          encodeNextBlock(audio, position, remaining, base64, wire, encoded));
+        }
+
+        request.print(STT_REQUEST_SUFFIX);
+        metricsEnd(Span::STT_UPLOAD);
+        metricsBegin(Span::STT_RESPONSE);
+        httpCode = request.finish(30000);
+    }
+
+    if (httpCode <= 0) {
+        setError("HTTP request failed");
+        request.abort();
+        return "";
+    }
+
+    String response = request.readBody();
+    metricsEnd(Span::STT_RESPONSE);
+
+    Serial.printf("[SpeechClient] Response code: %d (%d bytes uploaded)\n",
+                  httpCode, request.getBytesSent());
+
+    if (httpCode != 200) {
+        setError("API error: " + response.substring(0, 200));
+        return "";
+    }
+
+    return parseTranscript(response);
+}
+
+bool SpeechClient::beginTranscription(int sampleRate) {
+    if (_uploadSession) {
+        abortTranscription();
+    }
+    clearError();
+
+    // An aborted task still owns the stream and buffers until it exits;
+    // the caller sends the recording in one go instead
+    if (_uploadRunning) {
+        setError("Previous upload still closing");
+        return false;
+    }
+    releaseTranscription();
+
+    const size_t streamBytes = STT_STREAM_BUFFER_SAMPLES * sizeof(int16_t);
+
+    // Storage is kept between sessions; PSRAM is plenty fast for 32 KB/s
+    if (!_uploadStorage) {
+        _uploadStorage = psramFound() ? (uint8_t*)ps_malloc(streamBytes + 1)
+                                      : (uint8_t*)malloc(streamBytes + 1);
+        if (!_uploadStorage) {
+            setError("Failed to allocate upload buffer");
+            return false;
+        }
+    }
+    if (!_uploadBuffers) {
+        _uploadBuffers = new (std::nothrow) UploadBuffers();
+        if (!_uploadBuffers) {
+            setError("Failed to allocate upload buffer");
+            return false;
+        }
+    }
+
+    _uploadStream = xStreamBufferCreateStatic(streamBytes, 1, _uploadStorage, &_uploadStreamStruct);
+    if (!_uploadStream) {
+        setError("Failed to create upload stream");
+        return false;
+    }
+
+    _uploadSampleRate = sampleRate;
+    _uploadFinishing = false;
+    _uploadAbort = false;
+    _uploadDone = false;
+    _uploadOverflow = false;
+    _uploadStatus = -1;
+    _uploadResponse = "";
+
+    _uploadRunning = true;
+    if (xTaskCreatePinnedToCore(uploadTask, "stt_upload", STT_UPLOAD_TASK_STACK, this,
+                                STT_UPLOAD_TASK_PRIO, &_uploadTask, 0) != pdPASS) {
+        _uploadRunning = false;
+        releaseTranscription();
+        setError("Failed to start upload task");
+        return false;
+    }
+
+    _uploadSession = true;
+    Serial.println("[SpeechClient] Live transcription started");
+    return true;
+}
+
+bool SpeechClient::feedTranscription(const int16_t* samples, size_t count) {
+    if (!_uploadSession || _uploadOverflow || _uploadFinishing) return false;
+
+    size_t bytes = count * sizeof(int16_t);
+    if (xStreamBufferSend(_uploadStream, samples, bytes, 0) != bytes) {
+        // A gap would corrupt the audio; the caller falls back to a full upload
+        _uploadOverflow = true;
+        return false;
+    }
+    return true;
+}
+
+String SpeechClient::finishTranscription(uint32_t timeoutMs) {
+    if (!_uploadSession) {
+        setError("No transcription in progress");
+        return "";
+    }
+
+    if (_uploadOverflow) {
+        abortTranscription();
+        setError("Upload fell behind, audio dropped");
+        return "";
+    }
+
+    // Only the audio still queued is left to send
+    metricsBegin(Span::STT_UPLOAD);
+    _uploadFinishing = true;
+
+    uint32_t start = millis();
+    while (!_uploadDone && millis() - start < timeoutMs) {
+        delay(5);
+    }
+
+    if (!_uploadDone) {
+        abortTranscription();
+        setError("Transcription timeout");
+        return "";
+    }
+
+    // The task has handed over its result; it only has to exit now
+    int status = _uploadStatus;
+    String response = _uploadResponse;
+    _uploadResponse = "";
+    _uploadSession = false;
+
+    Serial.printf("[SpeechClient] Live transcription response code: %d\n", status);
+
+    if (status <= 0) {
+        setError("HTTP request failed");
+        return "";
+    }
+    if (status != 200) {
+        setError("API error: " + response.substring(0, 200));
+        return "";
+    }
+
+    return parseTranscript(response);
+}
+
+void SpeechClient::abortTranscription() {
+    if (!_uploadSession) return;
+
+    // The task checks the flag between blocks and in every socket wait,
+    // then drops the request and releases its pooled connection itself.
+    // Closing the socket from here would free the mbedTLS context under it
+    _uploadAbort = true;
+    _uploadSession = false;
+    Serial.println("[SpeechClient] Live transcription aborted");
+}
+
+void SpeechClient::releaseTranscription() {
+    _uploadTask = nullptr;
+    if (_uploadStream) {
+        vStreamBufferDelete(_uploadStream);
+        _uploadStream = nullptr;
+    }
+}
+
+void SpeechClient::uploadTask(void* param) {
+    SpeechClient* self = static_cast<SpeechClient*>(param);
+    self->runUpload();
+    LOG_DEBUG("[SpeechClient] Upload task stack left: %u bytes\n",
+              (unsigned)uxTaskGetStackHighWaterMark(nullptr));
+    self->_uploadDone = true;
+    self->_uploadRunning = false;
+    vTaskDelete(nullptr);
+}
+
+void SpeechClient::runUpload() {
+    // Connect while the user is talking; audio queues in the stream buffer meanwhile
+    PooledClient client(_pool, STT_API_HOST);
+
+    ChunkedRequest& request = _uploadBuffers->request;
+    request.setCancelFlag(&_uploadAbort);
+    String path = "/v1/speech:recognize?key=" + _apiKey;
+
+    if (_uploadAbort || !request.begin(client.get(), STT_API_HOST, path, "application/json", true)) {
+        return;
+    }
+
+    request.print(buildRecognizePrefix(_uploadSampleRate));
+
+    // The encoder carries a partial 3-byte group over to the next block, so
+    // no padding appears inside the content
+    Base64Encoder base64;
+    uint8_t* wire = _uploadBuffers->wire;
+    char* encoded = _uploadBuffers->encoded;
+    int16_t* samples = _uploadBuffers->samples;
+    const size_t wireBytes = sizeof(_uploadBuffers->wire);
+    const size_t sampleCount = sizeof(_uploadBuffers->samples) / sizeof(int16_t);
+    size_t pending = 0;
+
+    while (!_uploadAbort && !request.hasFailed()) {
+        size_t got;
+        if (_encoding == AudioEncoding::MULAW) {
+            // The stream holds PCM; one wire byte per sample
+            size_t count = min(wireBytes - pending, sampleCount);
+            got = xStreamBufferReceive(_uploadStream, samples, count * sizeof(int16_t),
+                                       pdMS_TO_TICKS(STT_UPLOAD_POLL_MS)) / sizeof(int16_t);
+            mulawEncodeBlock(samples, got, wire + pending);
+        } else {
+            got = xStreamBufferReceive(_uploadStream, wire + pending, wireBytes - pending,
+                                       pdMS_TO_TICKS(STT_UPLOAD_POLL_MS));
+        }
+        pending += got;
+
+        bool draining = _uploadFinishing && xStreamBufferBytesAvailable(_uploadStream) == 0;
+
+        if (pending > 0 && (pending == wireBytes || got == 0 || draining)) {
+            request.write((const uint8_t*)encoded, base64.update(wire, pending, encoded));
+            pending = 0;
+        }
+
+        if (draining) {
+            request.write((const uint8_t*)encoded, base64.finish(encoded));
+            break;
+        }
+    }
+
+    if (_uploadAbort || request.hasFailed()) {
+        request.abort();
+        return;
+    }
+
+    request.print(STT_REQUEST_SUFFIX);
+    metricsEnd(Span::STT_UPLOAD);
+
+    metricsBegin(Span::STT_RESPONSE);
+    _uploadStatus = request.finish(30000);
+    if (_uploadStatus > 0) {
+        _uploadResponse = request.readBody();
+        metricsEnd(Span::STT_RESPONSE);
+    }
+    if (_uploadStatus <= 0 || request.hasFailed()) {
+        request.abort();
+    }
+
+    Serial.printf("[SpeechClient] Live upload complete (%d bytes)\n", request.getBytesSent());
+}
+
 size_t SpeechClient::getEstimatedSamples(const String& text, int sampleRate) {
     // Rough estimate: about 150 words per minute speaking rate
     // Average 5 characters per word
@@ -277,10 +536,6 @@ size_t SpeechClient::getEstimatedSamples(const String& text, int sampleRate) {
 size_t SpeechClient::synthesize(const String& text, int16_t* outputBuffer, size_t maxSamples, int sampleRate) {
     clearError();
 
-    Serial.println("\n[TTS] ====================================================");
-    Serial.println("[TTS] STEP 1: VALIDATE INPUT");
-    Serial.println("[TTS] ====================================================");
-
     if (text.length() == 0) {
         setError("Empty text");
         return 0;
@@ -291,46 +546,19 @@ size_t SpeechClient::synthesize(const String& text, int16_t* outputBuffer, size_
         return 0;
     }
 
-    Serial.println("[TTS] Text to synthesize:");
-    Serial.println(text);
-    Serial.printf("[TTS] Text length: %d chars\n", text.length());
-    Serial.printf("[TTS] Output buffer: %d max samples (%d bytes)\n", maxSamples, maxSamples * 2);
-    Serial.println("[TTS] Input validation: OK");
-
-    Serial.println("\n[TTS] ====================================================");
-    Serial.println("[TTS] STEP 2: BUILD HTTP REQUEST");
-    Serial.println("[TTS] ====================================================");
+    LOG_DEBUG("[TTS] Synthesizing %d chars into %d max samples\n", text.length(), maxSamples);
 
     // Build request JSON
-    JsonDocument doc;
-    JsonObject input = doc["input"].to<JsonObject>();
-    input["text"] = text;
-
-    JsonObject voice = doc["voice"].to<JsonObject>();
-    voice["languageCode"] = _languageCode.substring(0, 5);
-    voice["name"] = _voiceName;
-
-    JsonObject audioConfig = doc["audioConfig"].to<JsonObject>();
-    audioConfig["audioEncoding"] = "LINEAR16";
-    audioConfig["sampleRateHertz"] = sampleRate;
-
-    String requestBody;
-    serializeJson(doc, requestBody);
-
-    Serial.printf("[TTS] Request body size: %d bytes\n", requestBody.length());
-    Serial.println("[TTS] Request JSON: OK");
-
-    Serial.println("\n[TTS] ====================================================");
-    Serial.println("[TTS] STEP 3: SEND HTTP REQUEST");
-    Serial.println("[TTS] ====================================================");
+    String requestBody = buildSynthesizeRequest(text, sampleRate);
+    LOG_DEBUG("[TTS] Request body size: %d bytes\n", requestBody.length());
 
-    WiFiClientSecure client;
-    client.setInsecure();
+    PooledClient client(_pool, TTS_API_HOST);
 
     HTTPClient http;
+    http.setReuse(true);
     String url = "https://texttospeech.googleapis.com/v1/text:synthesize?key=" + _apiKey;
 
-    if (!http.begin(client, url)) {
+    if (!http.begin(client.get(), url)) {
         setError("Failed to connect to TTS API");
         return 0;
     }
@@ -338,14 +566,17 @@ size_t SpeechClient::synthesize(const String& text, int16_t* outputBuffer, size_
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(30000);
 
-    Serial.println("[TTS] Sending POST request...");
+    metricsBegin(Span::TTS_TTFB);
+    metricsBegin(Span::TTS_TOTAL);
+    unsigned long startTime = millis();
     int httpCode = http.POST(requestBody);
 
-    Serial.printf("[TTS] HTTP response code: %d\n", httpCode);
+    LOG_DEBUG("[TTS] HTTP response code: %d\n", httpCode);
 
     if (httpCode <= 0) {
         setError("HTTP request failed: " + String(http.errorToString(httpCode).c_str()));
         http.end();
+        client.discard();
         return 0;
     }
 
@@ -356,42 +587,23 @@ size_t SpeechClient::synthesize(const String& text, int16_t* outputBuffer, size_
         return 0;
     }
 
-    Serial.println("[TTS] HTTP request: OK");
-
-    Serial.println("\n[TTS] ====================================================");
-    Serial.println("[TTS] STEP 4: READ RESPONSE");
-    Serial.println("[TTS] ====================================================");
-
-    int contentLength = http.getSize();
-    Serial.printf("[TTS] Content-Length: %d\n", contentLength);
+    // The whole clip arrives in one JSON body, so headers are the first byte
+    metricsEnd(Span::TTS_TTFB);
+    LOG_DEBUG("[TTS] Content-Length: %d\n", http.getSize());
 
     // Use getString() which properly handles chunked transfer encoding
     // For TTS responses under ~1MB this works reliably
-    Serial.println("[TTS] Reading response with getString()...");
-    unsigned long startTime = millis();
-
     String response = http.getString();
     http.end();
 
     size_t totalRead = response.length();
-    Serial.printf("[TTS] Total bytes read: %d\n", totalRead);
-    Serial.printf("[TTS] Read time: %d ms\n", millis() - startTime);
+    LOG_DEBUG("[TTS] Read %d bytes in %lu ms\n", totalRead, millis() - startTime);
 
     if (totalRead < 50) {
         setError("Response too short");
         return 0;
     }
 
-    // Show first 100 chars of response
-    Serial.println("[TTS] Response preview (first 100 chars):");
-    Serial.println(response.substring(0, 100));
-
-    Serial.println("[TTS] Response read: OK");
-
-    Serial.println("\n[TTS] ====================================================");
-    Serial.println("[TTS] STEP 5: EXTRACT BASE64 DATA");
-    Serial.println("[TTS] ====================================================");
-
     // Find "audioContent": marker
     int markerPos = response.indexOf("\"audioContent\":");
     if (markerPos < 0) {
@@ -403,8 +615,6 @@ size_t SpeechClient::synthesize(const String& text, int16_t* outputBuffer, size_
         return 0;
     }
 
-    Serial.printf("[TTS] Found marker at position: %d\n", markerPos);
-
     // Find the opening quote of the value (after the colon)
     int valueStart = response.indexOf('"', markerPos + 15);
     if (valueStart < 0) {
@@ -413,8 +623,6 @@ size_t SpeechClient::synthesize(const String& text, int16_t* outputBuffer, size_
     }
     valueStart++;  // Skip the opening quote
 
-    Serial.printf("[TTS] Base64 value starts at position: %d\n", valueStart);
-
     // Find the closing quote by searching backwards from end
     int valueEnd = -1;
     for (int i = response.length() - 1; i > valueStart; i--) {
@@ -430,132 +638,222 @@ size_t SpeechClient::synthesize(const String& text, int16_t* outputBuffer, size_
     }
 
     size_t base64Len = valueEnd - valueStart;
-    Serial.printf("[TTS] Raw base64 length: %d bytes\n", base64Len);
+    LOG_DEBUG("[TTS] Base64 audio: %d bytes at %d\n", base64Len, valueStart);
 
-    // Extract base64 substring
-    String base64Data = response.substring(valueStart, valueEnd);
+    // Allocate decode buffer, sized by the payload rather than the output limit
+    size_t maxDecodeSize = base64DecodedMaxLength(base64Len);
+    uint8_t* decodeBuffer = (uint8_t*)arenaAlloc(_arena, maxDecodeSize);
 
-    // Show first and last 30 chars
-    Serial.println("[TTS] Base64 first 30 chars:");
-    Serial.println(base64Data.substring(0, 30));
-
-    Serial.println("[TTS] Base64 last 30 chars:");
-    if (base64Len > 30) {
-        Serial.println(base64Data.substring(base64Len - 30));
+    if (!decodeBuffer) {
+        setError("Failed to allocate decode buffer");
+        return 0;
     }
 
-    Serial.println("[TTS] Base64 extraction: OK");
+    // Decoded in place from the response, without a copy of the payload
+    size_t decodedBytes = base64Decode(response.c_str() + valueStart, base64Len, decodeBuffer);
 
-    // Free the response string to save memory before decoding
+    // Free the response string to save memory
     response = "";
 
-    Serial.println("\n[TTS] ====================================================");
-    Serial.println("[TTS] STEP 6: DECODE BASE64");
-    Serial.println("[TTS] ====================================================");
+    if (decodedBytes == 0) {
+        arenaFree(_arena, decodeBuffer);
+        setError("Failed to decode base64");
+        return 0;
+    }
+
+    // The decoder skips the WAV header and expands mu-law to PCM
+    size_t samples = 0;
+    bool truncated = false;
+    WavDecoder decoder(_encoding, [&](const int16_t* pcm, size_t count) {
+        size_t room = maxSamples - samples;
+        if (count > room) {
+            truncated = true;
+            count = room;
+        }
+        memcpy(outputBuffer + samples, pcm, count * sizeof(int16_t));
+        samples += count;
+        return count;
+    });
+
+    decoder.write(decodeBuffer, decodedBytes);
+    decoder.flush();
+    arenaFree(_arena, decodeBuffer);
 
-    // Allocate decode buffer
-    size_t maxDecodeSize = maxSamples * sizeof(int16_t) + 100;
-    Serial.printf("[TTS] Allocating %d bytes for decode buffer...\n", maxDecodeSize);
+    LOG_DEBUG("[TTS] Encoding: %s, WAV sample rate: %d Hz\n",
+              audioEncodingName(decoder.getEncoding()), decoder.getSampleRate());
 
-    uint8_t* decodeBuffer = nullptr;
-    if (psramFound()) {
-        decodeBuffer = (uint8_t*)ps_malloc(maxDecodeSize);
-    } else {
-        decodeBuffer = (uint8_t*)malloc(maxDecodeSize);
+    if (truncated) {
+        LOG_WARN("[TTS] WARNING: Truncated to %d samples\n", maxSamples);
     }
 
-    if (!decodeBuffer) {
-        setError("Failed to allocate decode buffer");
+    if (samples == 0) {
+        setError("No audio in TTS response");
         return 0;
     }
 
-    Serial.println("[TTS] Decode buffer allocated: OK");
+    metricsEnd(Span::TTS_TOTAL);
+    Serial.printf("[TTS] Output: %d samples (%.2f seconds) in %lu ms\n",
+                  samples, (float)samples / sampleRate, millis() - startTime);
 
-    // Decode base64 using robust decoder
-    size_t decodedBytes = base64Decode(base64Data.c_str(), base64Data.length(), decodeBuffer, maxDecodeSize);
+    return samples;
+}
 
-    // Free base64 string to save memory
-    base64Data = "";
+String SpeechClient::buildSynthesizeRequest(const String& text, int sampleRate) {
+    JsonDocument doc(&_jsonAllocator);
+    JsonObject input = doc["input"].to<JsonObject>();
+    input["text"] = text;
 
-    if (decodedBytes == 0) {
-        free(decodeBuffer);
-        setError("Failed to decode base64");
+    JsonObject voice = doc["voice"].to<JsonObject>();
+    voice["languageCode"] = _languageCode.substring(0, 5);
+    voice["name"] = _voiceName;
+
+    JsonObject audioConfig = doc["audioConfig"].to<JsonObject>();
+    audioConfig["audioEncoding"] = audioEncodingName(_encoding);
+    audioConfig["sampleRateHertz"] = sampleRate;
+
+    String requestBody;
+    serializeJson(doc, requestBody);
+    return requestBody;
+}
+
+size_t SpeechClient::synthesizeStream(const String& text, AudioSink sink, int sampleRate) {
+    clearError();
+
+    if (text.length() == 0) {
+        setError("Empty text");
+        return 0;
+    }
+
+    if (!sink) {
+        setError("No audio sink");
         return 0;
     }
 
-    Serial.printf("[TTS] Decoded %d bytes\n", decodedBytes);
-    Serial.println("[TTS] Base64 decode: OK");
+    String requestBody = buildSynthesizeRequest(text, sampleRate);
 
-    Serial.println("\n[TTS] ====================================================");
-    Serial.println("[TTS] STEP 7: PARSE WAV HEADER");
-    Serial.println("[TTS] ====================================================");
+    // Chunk framing is undone by ChunkedRequest, so the body can be parsed
+    // off the socket and the connection kept for the next sentence
+    PooledClient client(_pool, TTS_API_HOST);
+    ChunkedRequest request;
+    String path = "/v1/text:synthesize?key=" + _apiKey;
 
-    // Check for WAV header
-    size_t pcmOffset = 0;
-    size_t pcmBytes = decodedBytes;
+    metricsBegin(Span::TTS_TTFB);
+    metricsBegin(Span::TTS_TOTAL);
+    unsigned long startTime = millis();
+    int httpCode = -1;
+
+    // A pooled connection the server already closed fails before any
+    // response; retry once on a fresh one
+    for (int attempt = 0; attempt < 2 && httpCode <= 0; attempt++) {
+        if (attempt > 0) {
+            if (!client.isPooled()) break;
+            Serial.println("[TTS] Pooled connection lost, reconnecting");
+            client.get().stop();
+        }
 
-    if (decodedBytes > 44 &&
-        decodeBuffer[0] == 'R' && decodeBuffer[1] == 'I' &&
-        decodeBuffer[2] == 'F' && decodeBuffer[3] == 'F') {
+        if (request.begin(client.get(), TTS_API_HOST, path, "application/json", true)) {
+            request.print(requestBody.c_str());
+            httpCode = request.finish(30000);
+        }
+    }
+    requestBody = "";
 
-        Serial.println("[TTS] WAV header detected");
+    if (httpCode <= 0) {
+        setError("HTTP request failed");
+        request.abort();
+        return 0;
+    }
 
-        // Parse WAV header
-        uint32_t chunkSize = *(uint32_t*)(decodeBuffer + 4);
-        uint16_t audioFormat = *(uint16_t*)(decodeBuffer + 20);
-        uint16_t numChannels = *(uint16_t*)(decodeBuffer + 22);
-        uint32_t wavSampleRate = *(uint32_t*)(decodeBuffer + 24);
-        uint16_t bitsPerSample = *(uint16_t*)(decodeBuffer + 34);
-        uint32_t dataSize = *(uint32_t*)(decodeBuffer + 40);
+    if (httpCode != 200) {
+        String errorResp = request.readBody();
+        setError("API error: " + errorResp.substring(0, 200));
+        return 0;
+    }
 
-        Serial.printf("[TTS] WAV chunk size: %d\n", chunkSize);
-        Serial.printf("[TTS] Audio format: %d (1=PCM)\n", audioFormat);
-        Serial.printf("[TTS] Channels: %d\n", numChannels);
-        Serial.printf("[TTS] Sample rate: %d Hz\n", wavSampleRate);
-        Serial.printf("[TTS] Bits per sample: %d\n", bitsPerSample);
-        Serial.printf("[TTS] Data size: %d bytes\n", dataSize);
+    LOG_DEBUG("[TTS] Stream headers after %lu ms\n", millis() - startTime);
 
-        pcmOffset = 44;
-        pcmBytes = decodedBytes - 44;
+    // Parse state: find the audioContent key, its opening quote, then decode
+    static const char marker[] = "\"audioContent\"";
+    enum { FIND_MARKER, FIND_QUOTE, DECODE } phase = FIND_MARKER;
+    size_t markerPos = 0;
 
-        Serial.println("[TTS] WAV header parse: OK");
-    } else {
-        Serial.println("[TTS] No WAV header - assuming raw PCM");
-    }
+    // Decode state: base64 in slices of the read, then the WAV decoder stage
+    uint8_t readBuf[TTS_STREAM_READ_SIZE];
+    uint8_t decoded[base64DecodedMaxLength(TTS_STREAM_DECODE_CHARS)];
+    Base64Decoder base64;
+    WavDecoder decoder(_encoding, sink);
 
-    Serial.println("\n[TTS] ====================================================");
-    Serial.println("[TTS] STEP 8: COPY PCM DATA");
-    Serial.println("[TTS] ====================================================");
+    bool done = false;
+    bool sinkClosed = false;
+    bool firstAudio = false;
 
-    size_t samples = pcmBytes / sizeof(int16_t);
-    Serial.printf("[TTS] PCM bytes: %d\n", pcmBytes);
-    Serial.printf("[TTS] Samples: %d\n", samples);
-    Serial.printf("[TTS] Duration: %.2f seconds\n", (float)samples / sampleRate);
+    while (!done && !sinkClosed) {
+        int n = request.readBody(readBuf, sizeof(readBuf), TTS_STREAM_TIMEOUT_MS);
+        if (n <= 0) break;
 
-    if (samples > maxSamples) {
-        Serial.printf("[TTS] WARNING: Truncating from %d to %d samples\n", samples, maxSamples);
-        samples = maxSamples;
-    }
+        int i = 0;
+        while (phase != DECODE && i < n) {
+            char c = (char)readBuf[i++];
 
-    // Copy PCM data to output buffer
-    memcpy(outputBuffer, decodeBuffer + pcmOffset, samples * sizeof(int16_t));
-    free(decodeBuffer);
+            if (phase == FIND_MARKER) {
+                // The key has no inner quote, so restarting on '"' is enough
+                markerPos = c == marker[markerPos] ? markerPos + 1 : (c == '"' ? 1 : 0);
+                if (marker[markerPos] == '\0') phase = FIND_QUOTE;
+            } else if (c == '"') {
+                phase = DECODE;
+            }
+        }
 
-    // Show first and last few samples
-    Serial.printf("[TTS] First 4 samples: %d %d %d %d\n",
-                  outputBuffer[0], outputBuffer[1], outputBuffer[2], outputBuffer[3]);
-    if (samples > 4) {
-        Serial.printf("[TTS] Last 4 samples: %d %d %d %d\n",
-                      outputBuffer[samples-4], outputBuffer[samples-3],
-                      outputBuffer[samples-2], outputBuffer[samples-1]);
+        // The value runs to the closing quote (base64 has none inside)
+        while (i < n && !done && !sinkClosed) {
+            const char* slice = (const char*)readBuf + i;
+            size_t len = min((size_t)(n - i), (size_t)TTS_STREAM_DECODE_CHARS);
+            const char* quote = (const char*)memchr(slice, '"', len);
+            if (quote) {
+                len = quote - slice;
+                done = true;
+            }
+            i += len;
+
+            size_t bytes = base64.update(slice, len, decoded);
+            if (done) {
+                bytes += base64.finish(decoded + bytes);
+            }
+            if (bytes > 0) {
+                sinkClosed = !decoder.write(decoded, bytes);
+            }
+
+            if (!firstAudio && decoder.getSamplesDelivered() > 0) {
+                firstAudio = true;
+                metricsEnd(Span::TTS_TTFB);
+            }
+        }
     }
 
-    Serial.println("[TTS] PCM copy: OK");
+    // Read the rest of the JSON so the connection can carry the next request;
+    // after an early stop the remaining audio isn't worth downloading
+    if (!done || sinkClosed || !request.skipBody(TTS_STREAM_TIMEOUT_MS) || !request.isKeepAlive()) {
+        request.abort();
+        client.discard();
+    }
 
-    Serial.println("\n[TTS] ====================================================");
-    Serial.println("[TTS] SYNTHESIS COMPLETE");
-    Serial.printf("[TTS] Output: %d samples (%.2f seconds)\n", samples, (float)samples / sampleRate);
-    Serial.println("[TTS] ====================================================\n");
+    // Flush the last partial block
+    decoder.flush();
+    size_t samplesDelivered = decoder.getSamplesDelivered();
 
-    return samples;
+    if (phase == FIND_MARKER) {
+        setError("No audioContent in response");
+    } else if (phase == FIND_QUOTE) {
+        setError("No opening quote for audioContent");
+    } else if (!done && !sinkClosed) {
+        setError(samplesDelivered > 0 ? "TTS stream interrupted" : "TTS stream timed out");
+    }
+
+    if (done) {
+        metricsEnd(Span::TTS_TOTAL);
+    }
+    Serial.printf("[TTS] Streamed %d samples (%.2f sec) in %lu ms\n",
+                  samplesDelivered, (float)samplesDelivered / sampleRate, millis() - startTime);
+
+    return samplesDelivered;
 }
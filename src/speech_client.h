@@ -4,24 +4,66 @@
 #include <Arduino.h>
 #include <WiFiClientSecure.h>
 #include <HTTPClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/stream_buffer.h>
+#include <functional>
+#include "connection_pool.h"
+#include "audio_codec.h"
+#include "base64.h"
+#include "capture_buffer.h"
+#include "memory_arena.h"
 
 class SpeechClient {
 public:
+    // Receives decoded PCM blocks; returns the number of samples accepted
+    using AudioSink = std::function<size_t(const int16_t* samples, size_t count)>;
+
     SpeechClient();
 
     void begin(const char* apiKey);
 
-    // Speech-to-Text: Convert audio buffer to text
-    // audioBuffer: 16-bit PCM samples
-    // sampleCount: number of samples
+    // Send requests over pooled keep-alive connections (optional)
+    void setConnectionPool(ConnectionPool* pool);
+
+    // Take decode buffers and JSON documents from the turn arena (optional)
+    void setArena(TurnArena* arena);
+
+    // Speech-to-Text: Convert recorded audio to text
+    // audio: the recording (16-bit PCM blocks)
+    // offset, sampleCount: the samples to send
     // sampleRate: sample rate in Hz (e.g., 16000)
-    String transcribe(const int16_t* audioBuffer, size_t sampleCount, int sampleRate = 16000);
+    String transcribe(const CaptureBuffer& audio, size_t offset, size_t sampleCount,
+                      int sampleRate = 16000);
+
+    // Streaming Speech-to-Text: base64-encodes the PCM in fixed blocks and
+    // sends it with chunked transfer encoding, so no full-size request string is built
+    String transcribeStream(const CaptureBuffer& audio, size_t offset, size_t sampleCount,
+                            int sampleRate = 16000);
+
+    // Live Speech-to-Text session: the request is opened when recording starts
+    // and audio is uploaded by a background task while the user is still talking.
+    // feedTranscription never blocks (safe from an AudioInput callback);
+    // finishTranscription sends the tail and waits for the transcript.
+    // If the session fails or overflows, finish returns "" with an error set
+    // and the caller should fall back to transcribeStream on the full buffer
+    bool beginTranscription(int sampleRate = 16000);
+    bool feedTranscription(const int16_t* samples, size_t count);
+    String finishTranscription(uint32_t timeoutMs = 30000);
+    // Never blocks: the upload task drops its request and exits on its own
+    void abortTranscription();
+    bool isTranscribing() const { return _uploadSession; }
 
     // Text-to-Speech: Convert text to audio
     // Returns number of samples written to outputBuffer
     // outputBuffer should be pre-allocated (use getEstimatedSamples to estimate size)
     size_t synthesize(const String& text, int16_t* outputBuffer, size_t maxSamples, int sampleRate = 16000);
 
+    // Streaming Text-to-Speech: decodes audioContent straight off the socket
+    // and hands PCM (WAV header stripped) to sink as it arrives.
+    // Returns total number of samples delivered to sink
+    size_t synthesizeStream(const String& text, AudioSink sink, int sampleRate = 16000);
+
     // Estimate output buffer size needed for TTS
     size_t getEstimatedSamples(const String& text, int sampleRate = 16000);
 
@@ -33,16 +75,57 @@ public:
     void setLanguage(const String& languageCode) { _languageCode = languageCode; }
     void setVoice(const String& voiceName) { _voiceName = voiceName; }
 
+    // Wire format for STT uploads and TTS replies; MULAW halves the payload
+    void setEncoding(AudioEncoding encoding) { _encoding = encoding; }
+    AudioEncoding getEncoding() const { return _encoding; }
+
 private:
     String _apiKey;
     String _languageCode;
     String _voiceName;
     bool _hasError;
     String _lastError;
+    AudioEncoding _encoding;
+    ConnectionPool* _pool;
+    TurnArena* _arena;
+    ArenaJsonAllocator _jsonAllocator;
+
+    // Live transcription session (shared with the upload task). The
+    // request and encode buffers are allocated once, off the task's stack,
+    // which is left to the TLS handshake
+    struct UploadBuffers;
+    StreamBufferHandle_t _uploadStream;
+    StaticStreamBuffer_t _uploadStreamStruct;
+    uint8_t* _uploadStorage;
+    UploadBuffers* _uploadBuffers;
+    TaskHandle_t _uploadTask;
+    int _uploadSampleRate;
+    bool _uploadSession;            // Caller side: begun and not yet finished/aborted
+    volatile bool _uploadRunning;   // Task side: cleared as the task exits
+    volatile bool _uploadFinishing;
+    volatile bool _uploadAbort;
+    volatile bool _uploadDone;
+    volatile bool _uploadOverflow;
+    int _uploadStatus;
+    String _uploadResponse;
+
+    static void uploadTask(void* param);
+    void runUpload();
+    void releaseTranscription();
+
+    // Samples in the configured encoding; returns scratch or the PCM itself
+    const uint8_t* encodeSamples(const int16_t* samples, size_t count,
+                                 uint8_t* scratch, size_t& length) const;
+
+    // Next upload block of a recording as base64 (the final call adds the
+    // padding); advances offset and remaining. encoded holds
+    // base64EncodedLength(STT_ENCODE_BLOCK_BYTES) + 4
+    size_t encodeNextBlock(const CaptureBuffer& audio, size_t& offset, size_t& remaining,
+                           Base64Encoder& base64, uint8_t* wire, char* encoded) const;
 
-    String base64Encode(const uint8_t* data, size_t length);
-    size_t base64Decode(const String& input, uint8_t* output, size_t maxLength);
-    size_t base64Decode(const char* input, size_t inputLen, uint8_t* output, size_t maxLength);
+    String buildRecognizePrefix(int sampleRate);
+    String parseTranscript(const String& response);
+    String buildSynthesizeRequest(const String& text, int sampleRate);
 
     void setError(const String& error);
     void clearError();
@@ -0,0 +1,320 @@
+#include "tts_pipeline.h"
+#include "config.h"
+
+#define TTS_PIPELINE_TASK_STACK  8192   // Covers a TLS reconnect inside synthesize
+#define TTS_PIPELINE_TASK_PRIO   1
+#define TTS_PIPELINE_TASK_CORE   1
+#define TTS_PIPELINE_SEND_MS     30000  // Producer waits this long for a free slot
+#define TTS_PIPELINE_POLL_MS     5
+
+// -----------------------------------------------------------------------------
+// SentenceSplitter
+// -----------------------------------------------------------------------------
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+SentenceSplitter::SentenceSplitter(size_t minChars, size_t maxChars)
+    : _minChars(minChars)
+    , _maxChars(maxChars)
+{
+}
+
+void SentenceSplitter::reset() {
+    _pending = "";
+}
+
+void SentenceSplitter::push(const String& text) {
+    _pending += text;
+}
+
+int SentenceSplitter::findBoundary() const {
+    int length = _pending.length();
+
+    // A terminator only counts once the next character shows it isn't
+    // part of a number or an ellipsis still arriving ("3.5", "...")
+    for (int i = 0; i + 1 < length; i++) {
+        char c = _pending[i];
+        bool terminator = c == '.' || c == '!' || c == '?' || c == ':' || c == ';';
+        if ((c == '\n' || (terminator && isSpace(_pending[i + 1]))) && (size_t)(i + 1) >= _minChars) {
+            return i + 1;
+        }
+    }
+
+    if ((size_t)length <= _maxChars) return -1;
+
+    // No sentence end in sight: prefer a clause break, then a word break
+    for (int i = _maxChars; i > (int)_maxChars / 2; i--) {
+        if (_pending[i - 1] == ',' && isSpace(_pending[i])) return i;
+    }
+    for (int i = _maxChars; i > 0; i--) {
+        if (isSpace(_pending[i])) return i;
+    }
+    return _maxChars;
+}
+
+void SentenceSplitter::take(int end, String& sentence) {
+    sentence = _pending.substring(0, end);
+    sentence.trim();
+
+    // Drop the separator; trailing text stays as-is for the next boundary check
+    while (end < (int)_pending.length() && isSpace(_pending[end])) end++;
+    _pending = _pending.substring(end);
+}
+
+bool SentenceSplitter::next(String& sentence) {
+    while (true) {
+        int end = findBoundary();
+        if (end < 0) return false;
+
+        take(end, sentence);
+        if (sentence.length() > 0) return true;
+    }
+}
+
+bool SentenceSplitter::flush(String& sentence) {
+    take(_pending.length(), sentence);
+    return sentence.length() > 0;
+}
+
+// -----------------------------------------------------------------------------
+// TtsPipeline
+// -----------------------------------------------------------------------------
+
+TtsPipeline::TtsPipeline()
+    : _speech(nullptr)
+    , _output(nullptr)
+    , _sampleRate(16000)
+    , _splitter(TTS_SENTENCE_MIN_CHARS, TTS_SENTENCE_MAX_CHARS)
+    , _queuedSentences(0)
+    , _queue(nullptr)
+    , _task(nullptr)
+    , _taskRunning(false)
+    , _reply(0)
+    , _busy(false)
+    , _working(false)
+    , _streamReply(0)
+    , _failedReply(0)
+    , _sink(nullptr)
+    , _clipSlotSamples(0)
+    , _nextSlot(0)
+{
+    _clipSlots[0] = nullptr;
+    _clipSlots[1] = nullptr;
+}
+
+TtsPipeline::~TtsPipeline() {
+    end();
+}
+
+bool TtsPipeline::begin(SpeechClient& speech, AudioOutput& output, int sampleRate) {
+    if (_task) return true;
+
+    _speech = &speech;
+    _output = &output;
+    _sampleRate = sampleRate;
+
+    _queue = xQueueCreate(TTS_PIPELINE_QUEUE_LEN, sizeof(Job));
+    if (!_queue) {
+        Serial.println("[TTS] Failed to create sentence queue");
+        return false;
+    }
+
+    _taskRunning = true;
+    BaseType_t result = xTaskCreatePinnedToCore(
+        workerTask,
+        "tts_pipeline",
+        TTS_PIPELINE_TASK_STACK,
+        this,
+        TTS_PIPELINE_TASK_PRIO,
+        &_task,
+        TTS_PIPELINE_TASK_CORE
+    );
+
+    if (result != pdPASS) {
+        Serial.println("[TTS] Failed to create pipeline task");
+        _taskRunning = false;
+        _task = nullptr;
+        vQueueDelete(_queue);
+        _queue = nullptr;
+        return false;
+    }
+
+    Serial.println("[TTS] Sentence pipeline started");
+    return true;
+}
+
+void TtsPipeline::end() {
+    if (_task) {
+        cancel();
+        _taskRunning = false;
+
+        // The task clears its handle on the way out
+        uint32_t start = millis();
+        while (_task && millis() - start < 2000) {
+            delay(10);
+        }
+    }
+
+    if (_queue && !_task) {
+        Job job;
+        while (xQueueReceive(_queue, &job, 0) == pdTRUE) {
+            delete job.text;
+        }
+        vQueueDelete(_queue);
+        _queue = nullptr;
+    }
+}
+
+void TtsPipeline::setClipBuffer(int16_t* buffer, size_t samples) {
+    _clipSlotSamples = buffer ? samples / 2 : 0;
+    _clipSlots[0] = buffer;
+    _clipSlots[1] = buffer ? buffer + _clipSlotSamples : nullptr;
+}
+
+void TtsPipeline::startReply() {
+    _reply++;
+    _splitter.reset();
+    _queuedSentences = 0;
+    _busy = true;
+}
+
+size_t TtsPipeline::feed(const String& text) {
+    _splitter.push(text);
+
+    String sentence;
+    while (_splitter.next(sentence)) {
+        enqueue(new String(sentence));
+    }
+    return _queuedSentences;
+}
+
+void TtsPipeline::finishReply() {
+    String sentence;
+    if (_splitter.flush(sentence)) {
+        enqueue(new String(sentence));
+    }
+
+    // End marker: closes the output stream once the last sentence is in
+    if (!enqueue(nullptr)) {
+        _busy = false;
+        if (_output) _output->endQueue();
+    }
+}
+
+void TtsPipeline::cancel() {
+    _reply++;
+    _busy = false;
+    if (_output) {
+        _output->stop();
+    }
+}
+
+bool TtsPipeline::enqueue(String* text) {
+    Job job = { _reply, text };
+    if (!_queue || xQueueSend(_queue, &job, pdMS_TO_TICKS(TTS_PIPELINE_SEND_MS)) != pdTRUE) {
+        Serial.println("[TTS] Sentence queue full, dropping text");
+        delete text;
+        return false;
+    }
+
+    if (text) {
+        _queuedSentences++;
+        Serial.printf("[TTS] Queued sentence %d: %s\n", _queuedSentences, text->c_str());
+    }
+    return true;
+}
+
+void TtsPipeline::workerTask(void* param) {
+    TtsPipeline* self = static_cast<TtsPipeline*>(param);
+    self->runWorker();
+    self->_task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void TtsPipeline::runWorker() {
+    bool streamOpen = false;
+
+    while (_taskRunning) {
+        Job job;
+        if (xQueueReceive(_queue, &job, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+
+        // Set before the reply check: a cancel after it still waits on this
+        _working = true;
+        if (isCurrent(job.reply)) {
+            if (job.text) {
+                if (TTS_STREAMING_ENABLED && (!streamOpen || _streamReply != job.reply)) {
+                    // One stream per reply keeps sentences back to back
+                    streamOpen = _output->beginStream();
+                    _streamReply = job.reply;
+                }
+                speak(job.reply, *job.text);
+            } else {
+                // Either way the output reports when the reply has played out
+                if (streamOpen && _streamReply == job.reply) {
+                    _output->endStream();
+                    streamOpen = false;
+                } else {
+                    _output->endQueue();
+                }
+                if (_sink) {
+                    _sink->replyDone(_failedReply != job.reply);
+                }
+                _busy = false;
+            }
+        }
+
+        delete job.text;
+        _working = false;
+    }
+}
+
+void TtsPipeline::speak(uint32_t reply, const String& sentence) {
+    unsigned long startTime = millis();
+    size_t samples = 0;
+
+    if (TTS_STREAMING_ENABLED) {
+        // Decoded audio goes straight onto the end of the playing stream
+        samples = _speech->synthesizeStream(
+            sentence,
+            [this, reply](const int16_t* pcm, size_t count) {
+                if (!isCurrent(reply)) return (size_t)0;
+                if (_sink) _sink->replyAudio(pcm, count);
+                return _output->writeStream(pcm, count);
+            },
+            _sampleRate
+        );
+    } else if (_clipSlots[0]) {
+        // The slot's previous clip has to be done; only the other slot's
+        // clip may still be queued, and it keeps playing while this one is made
+        int16_t* slot = _clipSlots[_nextSlot];
+        while (_output->getQueuedBuffers() > 1 && isCurrent(reply)) {
+            delay(TTS_PIPELINE_POLL_MS);
+        }
+        if (!isCurrent(reply)) return;
+
+        samples = _speech->synthesize(sentence, slot, _clipSlotSamples, _sampleRate);
+
+        if (samples > 0 && isCurrent(reply)) {
+            // Queued behind the playing clip, so sentences run back to back
+            if (_sink) _sink->replyAudio(slot, samples);
+            _output->queueBuffer(slot, samples);
+            _nextSlot ^= 1;
+        }
+    } else {
+        Serial.println("[TTS] No buffer available, text-only mode");
+        _failedReply = reply;
+        return;
+    }
+
+    // A stream cut off partway still returns what it delivered; the reply
+    // is incomplete either way (and must not be cached as whole)
+    if ((samples == 0 || _speech->hasError()) && isCurrent(reply)) {
+        _failedReply = reply;
+        Serial.printf("[TTS] %s for sentence%s\n", samples ? "Partial audio" : "No audio",
+            _speech->hasError() ? (": " + _speech->getLastError()).c_str() : "");
+    } else {
+        Serial.printf("[TTS] Sentence done in %lu ms (%d samples)\n", millis() - startTime, samples);
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef TTS_PIPELINE_H
+#define TTS_PIPELINE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "speech_client.h"
+#include "audio_output.h"
+
+// Cuts reply text into sentences as it arrives
+class SentenceSplitter {
+public:
+    SentenceSplitter(size_t minChars, size_t maxChars);
+
+    void reset();
+    void push(const String& text);
+
+    // Pop the next complete sentence; false if none is ready yet
+    bool next(String& sentence);
+
+    // Pop whatever is left (end of the reply)
+    bool flush(String& sentence);
+
+private:
+    int findBoundary() const;
+    void take(int end, String& sentence);
+
+    String _pending;
+    size_t _minChars;  // Shorter sentences are merged with the next one
+    size_t _maxChars;  // Longer runs are cut at a comma or space
+};
+
+// Receives the audio of the current reply as the pipeline speaks it
+class ReplyAudioSink {
+public:
+    virtual ~ReplyAudioSink() {}
+    virtual void replyAudio(const int16_t* samples, size_t count) = 0;
+    // End of the reply; complete is false if a sentence produced no audio
+    virtual void replyDone(bool complete) = 0;
+};
+
+// Speaks a reply sentence by sentence: while one sentence plays, the next
+// is synthesized, so speech starts after one short TTS request instead of
+// the whole reply. With TTS streaming every sentence is appended to one
+// AudioOutput stream; otherwise clips alternate between two buffer halves.
+class TtsPipeline {
+public:
+    TtsPipeline();
+    ~TtsPipeline();
+
+    bool begin(SpeechClient& speech, AudioOutput& output, int sampleRate);
+    void end();
+
+    // Clip storage for non-streaming TTS (split into two slots)
+    void setClipBuffer(int16_t* buffer, size_t samples);
+
+    // Optional listener for the spoken audio (called from the worker task)
+    void setAudioSink(ReplyAudioSink* sink) { _sink = sink; }
+
+    // Reply text, fed from the producer task (the voice turn worker)
+    void startReply();     // Drops anything left of the previous reply
+    size_t feed(const String& text);  // Returns sentences queued so far
+    void finishReply();    // Queue the remainder; playback continues
+
+    // Stop speaking (any task)
+    void cancel();
+
+    // True from startReply until the last sentence has been handed to audio
+    // (cleared at once by cancel)
+    bool isBusy() const { return _busy; }
+
+    // Not busy and the worker is not inside a sentence: after a cancel it
+    // may still be in the TTS request, writing into turn arena memory
+    bool isIdle() const { return !_busy && !_working; }
+
+private:
+    struct Job {
+        uint32_t reply;
+        String* text;  // Heap copy, deleted by the worker; nullptr = end of reply
+    };
+
+    static void workerTask(void* param);
+    void runWorker();
+    void speak(uint32_t reply, const String& sentence);
+    bool enqueue(String* text);
+    bool isCurrent(uint32_t reply) const { return reply == _reply; }
+
+    SpeechClient* _speech;
+    AudioOutput* _output;
+    int _sampleRate;
+
+    SentenceSplitter _splitter;
+    size_t _queuedSentences;
+
+    QueueHandle_t _queue;
+    TaskHandle_t _task;
+    volatile bool _taskRunning;
+
+    std::atomic<uint32_t> _reply;  // Bumped to drop queued sentences
+    volatile bool _busy;
+    volatile bool _working;        // Worker holds a job (set before the reply check)
+    uint32_t _streamReply;         // Reply the open output stream belongs to
+    uint32_t _failedReply;         // Last reply with a sentence that got no audio
+    ReplyAudioSink* _sink;
+
+    // Non-streaming clip slots
+    int16_t* _clipSlots[2];
+    size_t _clipSlotSamples;
+    int _nextSlot;
+};
+
+#endif // TTS_PIPELINE_H
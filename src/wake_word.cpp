@@ -1,6 +1,13 @@
 #include "wake_word.h"
 #include "config.h"
+#include "audio_dsp.h"
 #include <cmath>
+#include <esp_heap_caps.h>
+
+#define WAKE_WORD_TASK_STACK         (WAKE_WORD_MODEL_TFLITE ? 8192 : 4096)  // Inference is stack hungry
+#define MODEL_STRIDE_FRAMES          4      // Score every ~128 ms during a burst
+#define NOISE_FLOOR_FALL_RATE        0.1f   // Per frame; quieter background within ~0.5 s
+#define NOISE_FLOOR_RISE_RATE        0.004f // Per frame; louder background over ~8 s
 
 WakeWordDetector::WakeWordDetector()
     : _initialized(false)
@@ -9,17 +16,28 @@ WakeWordDetector::WakeWordDetector()
     , _callback(nullptr)
     , _taskHandle(nullptr)
     , _taskRunning(false)
+    , _resetPending(false)
+    , _mic(nullptr)
+    , _subscriberId(-1)
     , _audioBuffer(nullptr)
-    , _energyHistory(nullptr)
-    , _zcrHistory(nullptr)
-    , _historyIndex(0)
+    , _currentZcr(0)
+    , _noiseFloor(NOISE_FLOOR_FALL_RATE, NOISE_FLOOR_RISE_RATE)
     , _sensitivity(0.5f)
+    , _baseThreshold(WAKE_WORD_ENERGY_THRESHOLD)
+    , _noiseMargin(3.0f)
     , _energyThreshold(WAKE_WORD_ENERGY_THRESHOLD)
     , _triggerThreshold(WAKE_WORD_TRIGGER_THRESHOLD)
+    , _adaptive(WAKE_WORD_ADAPTIVE_THRESHOLD)
     , _patternState(PatternState::IDLE)
     , _patternStartTime(0)
     , _sustainedFrames(0)
+    , _model(nullptr)
+    , _frontEnd(nullptr)
+    , _modelThreshold(WAKE_WORD_MODEL_THRESHOLD)
+    , _modelPeak(0)
+    , _framesSinceInference(0)
     , _detectionCount(0)
+    , _rejectedCount(0)
     , _lastDetectionTime(0)
 {
 }
@@ -28,34 +46,62 @@ WakeWordDetector::~WakeWordDetector() {
     end();
 }
 
-bool WakeWordDetector::begin() {
+bool WakeWordDetector::begin(MicCapture& mic) {
     if (_initialized) return true;
 
-    // Allocate audio buffer in PSRAM if available
-    if (psramFound()) {
-        _audioBuffer = (int16_t*)ps_malloc(FRAME_SIZE * sizeof(int16_t));
-        _energyHistory = (float*)ps_malloc(HISTORY_SIZE * sizeof(float));
-        _zcrHistory = (float*)ps_malloc(HISTORY_SIZE * sizeof(float));
-    } else {
-        _audioBuffer = (int16_t*)malloc(FRAME_SIZE * sizeof(int16_t));
-        _energyHistory = (float*)malloc(HISTORY_SIZE * sizeof(float));
-        _zcrHistory = (float*)malloc(HISTORY_SIZE * sizeof(float));
-    }
+    // The frame is read several times per frame, so keep it out of PSRAM
+    _audioBuffer = (int16_t*)heap_caps_malloc(FRAME_SIZE * sizeof(int16_t),
+                                              MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
 
-    if (!_audioBuffer || !_energyHistory || !_zcrHistory) {
+    if (!_audioBuffer || !_ring.begin(FRAME_SIZE * BUFFER_FRAMES)) {
         Serial.println("[WakeWord] Failed to allocate buffers");
         end();
         return false;
     }
 
-    // Initialize history buffers
-    memset(_energyHistory, 0, HISTORY_SIZE * sizeof(float));
-    memset(_zcrHistory, 0, HISTORY_SIZE * sizeof(float));
+    // The front end only exists when a model loaded; otherwise heuristic only
+    if (_model) {
+        if (_model->begin()) {
+            _frontEnd = new MfccFrontEnd();
+            _frontEnd->begin(I2S_MIC_SAMPLE_RATE);
+            Serial.printf("[WakeWord] Keyword model: %s (threshold %.2f)\n",
+                          _model->getName(), _modelThreshold);
+        } else {
+            Serial.println("[WakeWord] Keyword model failed to load, heuristic only");
+            _model = nullptr;
+        }
+    }
+
+    // Create detection task; it idles until frames are delivered
+    _taskRunning = true;
+    if (xTaskCreatePinnedToCore(
+            detectionTask,
+            "wake_word",
+            WAKE_WORD_TASK_STACK,
+            this,
+            1,  // Low priority
+            &_taskHandle,
+            0   // Core 0 (let main app run on Core 1)
+        ) != pdPASS) {
+        Serial.println("[WakeWord] Failed to start detection task");
+        _taskRunning = false;
+        _taskHandle = nullptr;
+        end();
+        return false;
+    }
+
+    _mic = &mic;
+    _subscriberId = mic.subscribe(&_ring, _taskHandle);
+    if (_subscriberId < 0) {
+        Serial.println("[WakeWord] No free mic subscriber slot");
+        end();
+        return false;
+    }
 
     _initialized = true;
     Serial.println("[WakeWord] Initialized");
-    Serial.printf("[WakeWord] Sensitivity: %.2f, Energy threshold: %.0f\n",
-                  _sensitivity, _energyThreshold);
+    Serial.printf("[WakeWord] Sensitivity: %.2f, Energy threshold: %.0f%s\n",
+                  _sensitivity, _energyThreshold, _adaptive ? " (adaptive)" : "");
 
     return true;
 }
@@ -63,18 +109,23 @@ bool WakeWordDetector::begin() {
 void WakeWordDetector::end() {
     stopListening();
 
-    if (_audioBuffer) {
-        free(_audioBuffer);
-        _audioBuffer = nullptr;
+    // Let the task exit on its own before its buffers go away
+    _taskRunning = false;
+    if (_taskHandle) {
+        xTaskNotifyGive(_taskHandle);
     }
-    if (_energyHistory) {
-        free(_energyHistory);
-        _energyHistory = nullptr;
+    uint32_t start = millis();
+    while (_taskHandle && millis() - start < 500) {
+        delay(5);
     }
-    if (_zcrHistory) {
-        free(_zcrHistory);
-        _zcrHistory = nullptr;
+    _ring.release();
+
+    if (_audioBuffer) {
+        heap_caps_free(_audioBuffer);
+        _audioBuffer = nullptr;
     }
+    delete _frontEnd;
+    _frontEnd = nullptr;
 
     _initialized = false;
 }
@@ -82,112 +133,70 @@ void WakeWordDetector::end() {
 void WakeWordDetector::startListening() {
     if (!_initialized || _listening || !_enabled) return;
 
-    // Configure I2S for wake word detection
-    if (!configureI2S()) {
-        Serial.println("[WakeWord] Failed to configure I2S");
-        return;
-    }
-
-    // Reset detection state
-    _patternState = PatternState::IDLE;
-    _historyIndex = 0;
-    _sustainedFrames = 0;
-    memset(_energyHistory, 0, HISTORY_SIZE * sizeof(float));
-    memset(_zcrHistory, 0, HISTORY_SIZE * sizeof(float));
-
-    // Create detection task
-    _taskRunning = true;
-    xTaskCreatePinnedToCore(
-        detectionTask,
-        "wake_word",
-        4096,
-        this,
-        1,  // Low priority
-        &_taskHandle,
-        0   // Core 0 (let main app run on Core 1)
-    );
-
+    // Detection state is reset by the task before its next frame
+    _resetPending = true;
     _listening = true;
+    _mic->setActive(_subscriberId, true);
+
     Serial.println("[WakeWord] Started listening");
 }
 
 void WakeWordDetector::stopListening() {
     if (!_listening) return;
 
-    // Stop the detection task
-    _taskRunning = false;
-    if (_taskHandle) {
-        vTaskDelay(pdMS_TO_TICKS(100));  // Give task time to exit
-        vTaskDelete(_taskHandle);
-        _taskHandle = nullptr;
-    }
-
-    // Release I2S
-    releaseI2S();
-
+    // No teardown: the task just stops receiving frames
+    _mic->setActive(_subscriberId, false);
     _listening = false;
     Serial.println("[WakeWord] Stopped listening");
 }
 
+void WakeWordDetector::resetDetection() {
+    // The noise floor is kept: the room hasn't changed between turns
+    _patternState = PatternState::IDLE;
+    _sustainedFrames = 0;
+    _energy.reset();
+    _currentZcr = 0;
+    _modelPeak = 0;
+    _framesSinceInference = 0;
+    if (_frontEnd) {
+        _frontEnd->reset();
+    }
+}
+
+void WakeWordDetector::setModel(KeywordModel* model, float threshold) {
+    if (_initialized) {
+        Serial.println("[WakeWord] setModel() must be called before begin()");
+        return;
+    }
+    _model = model;
+    _modelThreshold = constrain(threshold, 0.0f, 1.0f);
+}
+
 void WakeWordDetector::setSensitivity(float sensitivity) {
     _sensitivity = constrain(sensitivity, 0.0f, 1.0f);
 
     // Adjust thresholds based on sensitivity
     // Higher sensitivity = lower thresholds = easier to trigger
     float factor = 1.0f + (1.0f - _sensitivity);  // 1.0 to 2.0
-    _energyThreshold = WAKE_WORD_ENERGY_THRESHOLD / factor;
+    _baseThreshold = WAKE_WORD_ENERGY_THRESHOLD / factor;
     _triggerThreshold = WAKE_WORD_TRIGGER_THRESHOLD / factor;
+    _noiseMargin = 2.0f * factor;                  // 2x to 4x the noise floor
+    _energyThreshold = _baseThreshold;             // Task re-adds the floor
 
-    Serial.printf("[WakeWord] Sensitivity: %.2f, Thresholds: %.0f / %.2f\n",
-                  _sensitivity, _energyThreshold, _triggerThreshold);
+    Serial.printf("[WakeWord] Sensitivity: %.2f, Thresholds: %.0f / %.2f, Noise margin: %.1fx\n",
+                  _sensitivity, _baseThreshold, _triggerThreshold, _noiseMargin);
 }
 
-bool WakeWordDetector::configureI2S() {
-    // Note: I2S mic may already be configured by AudioInput
-    // We'll use the same port but need to ensure it's available
-
-    i2s_config_t i2s_config = {
-        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
-        .sample_rate = I2S_MIC_SAMPLE_RATE,
-        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 4,
-        .dma_buf_len = FRAME_SIZE,
-        .use_apll = false,
-        .tx_desc_auto_clear = false,
-        .fixed_mclk = 0
-    };
-
-    i2s_pin_config_t pin_config = {
-        .bck_io_num = I2S_MIC_SCK_PIN,
-        .ws_io_num = I2S_MIC_WS_PIN,
-        .data_out_num = I2S_PIN_NO_CHANGE,
-        .data_in_num = I2S_MIC_SD_PIN
-    };
-
-    // Try to install driver (may already be installed)
-    esp_err_t err = i2s_driver_install(I2S_MIC_PORT, &i2s_config, 0, NULL);
-    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
-        Serial.printf("[WakeWord] i2s_driver_install failed: %d\n", err);
-        return false;
-    }
+void WakeWordDetector::updateThreshold() {
+    // Only quiet stretches teach the floor; a burst must not raise its own bar
+    if (_patternState != PatternState::IDLE) return;
 
-    // Set pins (always needed)
-    err = i2s_set_pin(I2S_MIC_PORT, &pin_config);
-    if (err != ESP_OK) {
-        Serial.printf("[WakeWord] i2s_set_pin failed: %d\n", err);
-        return false;
+    _noiseFloor.update(_energy.latest());
+    float threshold = _baseThreshold;
+    if (_adaptive) {
+        threshold = max(threshold, _noiseFloor.get() * _noiseMargin);
     }
-
-    return true;
-}
-
-void WakeWordDetector::releaseI2S() {
-    // Don't uninstall driver - it may be shared with AudioInput
-    // Just stop reading
-    i2s_stop(I2S_MIC_PORT);
+    _energyThreshold = threshold;
 }
 
 void WakeWordDetector::detectionTask(void* param) {
@@ -196,26 +205,25 @@ void WakeWordDetector::detectionTask(void* param) {
     Serial.println("[WakeWord] Detection task started");
 
     while (detector->_taskRunning) {
-        // Read audio frame from I2S
-        size_t bytesRead = 0;
-        esp_err_t err = i2s_read(
-            I2S_MIC_PORT,
-            detector->_audioBuffer,
-            FRAME_SIZE * sizeof(int16_t),
-            &bytesRead,
-            pdMS_TO_TICKS(100)
-        );
-
-        if (err == ESP_OK && bytesRead > 0) {
-            size_t samplesRead = bytesRead / sizeof(int16_t);
-            detector->processAudioFrame(detector->_audioBuffer, samplesRead);
+        // Woken by the mic service after each delivered frame
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+
+        if (detector->_resetPending) {
+            detector->_resetPending = false;
+            detector->resetDetection();
         }
 
-        // Small delay to prevent tight loop
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // Frames left over from before stopListening() are drained and dropped
+        while (detector->_ring.available() >= FRAME_SIZE) {
+            detector->_ring.read(detector->_audioBuffer, FRAME_SIZE);
+            if (detector->_listening) {
+                detector->processAudioFrame(detector->_audioBuffer, FRAME_SIZE);
+            }
+        }
     }
 
     Serial.println("[WakeWord] Detection task stopped");
+    detector->_taskHandle = nullptr;
     vTaskDelete(NULL);
 }
 
@@ -224,13 +232,17 @@ void WakeWordDetector::processAudioFrame(int16_t* samples, size_t count) {
     float energy = calculateEnergy(samples, count);
     float zcr = calculateZeroCrossingRate(samples, count);
 
-    // Store in history buffer
-    _energyHistory[_historyIndex] = energy;
-    _zcrHistory[_historyIndex] = zcr;
-    _historyIndex = (_historyIndex + 1) % HISTORY_SIZE;
+    _energy.push(energy);
+    _currentZcr = zcr;
+    updateThreshold();
+
+    // Features run on every frame so the model sees the lead-in to a burst
+    if (_frontEnd) {
+        _frontEnd->process(samples);
+    }
 
     // Check for wake word pattern
-    if (detectWakePattern()) {
+    if (confirmWithModel(detectWakePattern())) {
         // Check cooldown
         uint32_t now = millis();
         if (now - _lastDetectionTime >= DETECTION_COOLDOWN_MS) {
@@ -247,44 +259,46 @@ void WakeWordDetector::processAudioFrame(int16_t* samples, size_t count) {
 }
 
 float WakeWordDetector::calculateEnergy(int16_t* samples, size_t count) {
-    float sum = 0;
-    for (size_t i = 0; i < count; i++) {
-        float normalized = samples[i] / 32768.0f;
-        sum += normalized * normalized;
-    }
-    return sqrt(sum / count) * 32768.0f;  // RMS energy
+    return dspRms(samples, count);  // RMS energy
 }
 
 float WakeWordDetector::calculateZeroCrossingRate(int16_t* samples, size_t count) {
-    int crossings = 0;
-    for (size_t i = 1; i < count; i++) {
-        if ((samples[i-1] >= 0 && samples[i] < 0) ||
-            (samples[i-1] < 0 && samples[i] >= 0)) {
-            crossings++;
-        }
-    }
-    return (float)crossings / count;
+    if (count <= 1) return 0.0f;
+    return (float)dspZeroCrossings(samples, count) / count;
 }
 
-bool WakeWordDetector::detectWakePattern() {
-    // Calculate recent average energy
-    float avgEnergy = 0;
-    for (size_t i = 0; i < HISTORY_SIZE; i++) {
-        avgEnergy += _energyHistory[i];
+bool WakeWordDetector::confirmWithModel(bool candidate) {
+    if (!_frontEnd) return candidate;
+
+    if (_patternState == PatternState::IDLE) {
+        // Quiet or unvoiced: no inference at all
+        _modelPeak = 0;
+        _framesSinceInference = 0;
+        return false;
     }
-    avgEnergy /= HISTORY_SIZE;
 
-    // Calculate recent average ZCR
-    float avgZcr = 0;
-    for (size_t i = 0; i < HISTORY_SIZE; i++) {
-        avgZcr += _zcrHistory[i];
+    // Score periodically through the burst and once more at its end
+    if (candidate || ++_framesSinceInference >= MODEL_STRIDE_FRAMES) {
+        _framesSinceInference = 0;
+        _modelPeak = max(_modelPeak, _model->score(*_frontEnd));
     }
-    avgZcr /= HISTORY_SIZE;
 
-    // Get current frame values
-    size_t currentIdx = (_historyIndex + HISTORY_SIZE - 1) % HISTORY_SIZE;
-    float currentEnergy = _energyHistory[currentIdx];
-    float currentZcr = _zcrHistory[currentIdx];
+    if (!candidate) return false;
+
+    float peak = _modelPeak;
+    _modelPeak = 0;
+    if (peak >= _modelThreshold) return true;
+
+    _rejectedCount++;
+    Serial.printf("[WakeWord] Burst rejected by model (score %.2f)\n", peak);
+    return false;
+}
+
+bool WakeWordDetector::detectWakePattern() {
+    // Running statistics: O(1) per frame
+    float avgEnergy = _energy.mean();
+    float currentEnergy = _energy.latest();
+    float currentZcr = _currentZcr;
 
     // Pattern detection state machine
     // Looking for: silence -> voiced speech (low ZCR, high energy) -> silence
@@ -4,26 +4,86 @@
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <driver/i2s.h>
+#include "mic_capture.h"
+#include "ring_buffer.h"
+#include "keyword_model.h"
 
 // Wake word detection callback
 typedef void (*WakeWordCallback)(void);
 
+// Mean of the last N values in O(1) per push. The sum is rebuilt from the
+// ring on every wrap so float rounding can't drift over days of uptime
+template <size_t N>
+class RunningMean {
+public:
+    RunningMean() { reset(); }
+
+    void reset() {
+        memset(_values, 0, sizeof(_values));
+        _sum = 0;
+        _index = 0;
+    }
+
+    void push(float value) {
+        _sum += value - _values[_index];
+        _values[_index] = value;
+        if (++_index == N) {
+            _index = 0;
+            _sum = 0;
+            for (size_t i = 0; i < N; i++) _sum += _values[i];
+        }
+    }
+
+    float mean() const { return _sum / N; }
+    float latest() const { return _values[(_index + N - 1) % N]; }
+
+private:
+    float _values[N];
+    float _sum;
+    size_t _index;
+};
+
+// Background energy level: follows quieter frames down quickly and creeps
+// up slowly, so a word barely moves it but a fan switched on is learned
+class NoiseFloor {
+public:
+    NoiseFloor(float fallRate, float riseRate)
+        : _fallRate(fallRate), _riseRate(riseRate), _level(0) {}
+
+    void reset() { _level = 0; }
+
+    void update(float energy) {
+        if (_level <= 0) {
+            _level = energy;
+            return;
+        }
+        float rate = energy < _level ? _fallRate : _riseRate;
+        _level += (energy - _level) * rate;
+    }
+
+    float get() const { return _level; }
+
+private:
+    float _fallRate;
+    float _riseRate;
+    float _level;
+};
+
 class WakeWordDetector {
 public:
     WakeWordDetector();
     ~WakeWordDetector();
 
-    // Initialize the wake word detector
-    bool begin();
+    // Initialize the wake word detector (subscribes to the shared mic)
+    bool begin(MicCapture& mic);
 
     // Stop the wake word detector
     void end();
 
-    // Start listening for wake word
+    // Start listening for wake word (cheap: only resumes frame delivery)
     void startListening();
 
-    // Stop listening (when main recording takes over)
+    // Stop listening (when main recording takes over); the mic keeps running
     void stopListening();
 
     // Check if currently listening
@@ -32,8 +92,23 @@ public:
     // Set callback for wake word detection
     void setCallback(WakeWordCallback callback) { _callback = callback; }
 
-    // Adjust detection sensitivity (0.0 - 1.0)
+    // Adjust detection sensitivity (0.0 - 1.0). Sets the fixed minimum
+    // threshold and how far above the noise floor speech has to be
     void setSensitivity(float sensitivity);
+    float getSensitivity() const { return _sensitivity; }
+
+    // Keep the energy threshold a margin above the measured background
+    void setAdaptiveThreshold(bool enabled) { _adaptive = enabled; }
+    bool isAdaptiveThreshold() const { return _adaptive; }
+    float getNoiseFloor() const { return _noiseFloor.get(); }
+    float getEnergyThreshold() const { return _energyThreshold; }
+
+    // Optional model confirming heuristic candidates (call before begin()).
+    // The energy/ZCR pattern stays as a pre-gate: the model only runs while
+    // a voiced burst is in progress, and a burst triggers only if it scores
+    // at least threshold
+    void setModel(KeywordModel* model, float threshold);
+    bool hasModel() const { return _frontEnd != nullptr; }
 
     // Enable/disable wake word detection
     void setEnabled(bool enabled) { _enabled = enabled; }
@@ -41,6 +116,7 @@ public:
 
     // Get detection statistics
     int getDetectionCount() const { return _detectionCount; }
+    int getRejectedCount() const { return _rejectedCount; }  // Bursts the model turned down
 
 private:
     // FreeRTOS task for background audio processing
@@ -51,36 +127,44 @@ private:
     float calculateEnergy(int16_t* samples, size_t count);
     float calculateZeroCrossingRate(int16_t* samples, size_t count);
     bool detectWakePattern();
-
-    // I2S configuration (shares mic with main audio)
-    bool configureI2S();
-    void releaseI2S();
+    void updateThreshold();
+    bool confirmWithModel(bool candidate);
+    void resetDetection();
 
     // State
     bool _initialized;
-    bool _listening;
+    volatile bool _listening;
     bool _enabled;
     WakeWordCallback _callback;
 
-    // Detection task
+    // Detection task (lives from begin() to end())
     TaskHandle_t _taskHandle;
     volatile bool _taskRunning;
+    volatile bool _resetPending;
+
+    // Frames from the mic service
+    MicCapture* _mic;
+    int _subscriberId;
+    SpscRing<int16_t> _ring;
 
     // Audio buffer
     int16_t* _audioBuffer;
     static const size_t FRAME_SIZE = 512;
     static const size_t BUFFER_FRAMES = 16;  // ~0.5 seconds at 16kHz
 
-    // Feature buffers for pattern detection
-    float* _energyHistory;
-    float* _zcrHistory;
-    size_t _historyIndex;
+    // Frame features, kept in internal RAM
     static const size_t HISTORY_SIZE = 32;
+    RunningMean<HISTORY_SIZE> _energy;
+    float _currentZcr;
+    NoiseFloor _noiseFloor;
 
     // Detection parameters
     float _sensitivity;
-    float _energyThreshold;
+    float _baseThreshold;      // Fixed minimum, from sensitivity
+    float _noiseMargin;        // Threshold = max(base, floor * margin)
+    volatile float _energyThreshold;
     float _triggerThreshold;
+    bool _adaptive;
 
     // Pattern state machine
     enum class PatternState {
@@ -94,8 +178,16 @@ private:
     uint32_t _patternStartTime;
     int _sustainedFrames;
 
+    // Keyword model backend
+    KeywordModel* _model;
+    MfccFrontEnd* _frontEnd;
+    float _modelThreshold;
+    float _modelPeak;          // Best score during the current burst
+    int _framesSinceInference;
+
     // Statistics
     int _detectionCount;
+    int _rejectedCount;
     uint32_t _lastDetectionTime;
     static const uint32_t DETECTION_COOLDOWN_MS = 2000;
 };
@@ -1,16 +1,60 @@
 #include "web_server.h"
 #include "config.h"
+#include "metrics.h"
 #include <ArduinoJson.h>
+#include "gemini_client.h"
+
+#define WEB_CHAT_TASK_STACK  GEMINI_TASK_STACK   // Runs the same chat path as the voice worker
+#define WEB_CHAT_TASK_PRIO   1
+#define WEB_CHAT_TASK_CORE   1
 
 WebInterface::WebInterface()
     : _server(WEB_SERVER_PORT)
     , _ws("/ws")
     , _chatCallback(nullptr)
     , _volumeCallback(nullptr)
+    , _jobs(nullptr)
+    , _worker(nullptr)
+    , _resultsMutex(nullptr)
+    , _nextJobId(1)
 {
+    for (size_t i = 0; i < RESULT_SLOTS; i++) {
+        _results[i].id = 0;
+        _results[i].status = JobStatus::PENDING;
+    }
 }
 
-void WebInterface::begin() {
+WebInterface::~WebInterface() {
+    if (_worker) {
+        vTaskDelete(_worker);
+    }
+    if (_jobs) {
+        ChatJob job;
+        while (xQueueReceive(_jobs, &job, 0) == pdTRUE) {
+            delete job.message;
+        }
+        vQueueDelete(_jobs);
+    }
+    if (_resultsMutex) {
+        vSemaphoreDelete(_resultsMutex);
+    }
+}
+
+bool WebInterface::begin() {
+    _jobs = xQueueCreate(WEB_CHAT_QUEUE_LEN, sizeof(ChatJob));
+    _resultsMutex = xSemaphoreCreateMutex();
+    if (!_jobs || !_resultsMutex) {
+        Serial.println("[WebServer] Failed to create chat queue");
+        return false;
+    }
+
+    if (xTaskCreatePinnedToCore(workerTask, "web_chat", WEB_CHAT_TASK_STACK, this,
+                                WEB_CHAT_TASK_PRIO, &_worker, WEB_CHAT_TASK_CORE) != pdPASS) {
+        Serial.println("[WebServer] Failed to start chat worker");
+        _worker = nullptr;
+        return false;
+    }
+
     setupRoutes();
 
     _ws.onEvent([this](AsyncWebSocket* server, AsyncWebSocketClient* client,
@@ -22,6 +66,7 @@ void WebInterface::begin() {
     _server.begin();
 
     Serial.printf("[WebServer] Started on port %d\n", WEB_SERVER_PORT);
+    return true;
 }
 
 void WebInterface::setChatCallback(ChatCallback callback) {
@@ -53,43 +98,113 @@ void WebInterface::sendMessage(const String& role, const String& message) {
     _ws.textAll(json);
 }
 
+void WebInterface::sendJobEvent(const char* type, uint32_t id, const char* field, const String& value) {
+    JsonDocument doc;
+    doc["type"] = type;
+    doc["job"] = id;
+    if (field) {
+        doc[field] = value;
+    }
+
+    String json;
+    serializeJson(doc, json);
+    _ws.textAll(json);
+}
+
+bool WebInterface::collectBody(void** buffer, const uint8_t* data, size_t len,
+                               size_t index, size_t total) {
+    if (index == 0) {
+        free(*buffer);
+        *buffer = malloc(total + 1);
+    }
+    if (!*buffer || index + len > total) return false;
+
+    memcpy((uint8_t*)*buffer + index, data, len);
+    if (index + len < total) return false;
+
+    ((char*)*buffer)[total] = '\0';
+    return true;
+}
+
 void WebInterface::setupRoutes() {
     // Main page
     _server.on("/", HTTP_GET, [](AsyncWebServerRequest* request) {
         request->send(200, "text/html", getIndexHtml());
     });
 
-    // API endpoint for chat (fallback for non-WebSocket)
+    // API endpoint for chat (fallback for non-WebSocket). Answers 202 with a
+    // job id at once; poll GET /api/chat?job=<id> for the reply
     _server.on("/api/chat", HTTP_POST, [](AsyncWebServerRequest* request) {},
         NULL,
         [this](AsyncWebServerRequest* request, uint8_t* data, size_t len,
                size_t index, size_t total) {
-            String body = String((char*)data).substring(0, len);
+            if (total > WEB_CHAT_MAX_BODY) {
+                if (index == 0) {
+                    request->send(413, "application/json", "{\"error\":\"Message too long\"}");
+                }
+                return;
+            }
+
+            // The body can arrive over several TCP segments; the request
+            // frees _tempObject when it is destroyed
+            if (!collectBody(&request->_tempObject, data, len, index, total)) return;
 
             JsonDocument doc;
-            DeserializationError error = deserializeJson(doc, body);
+            DeserializationError error = deserializeJson(doc, (const char*)request->_tempObject, total);
 
-            if (error) {
+            if (error || !doc["message"].is<const char*>()) {
                 request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
                 return;
             }
 
-            String message = doc["message"].as<String>();
+            if (!_chatCallback) {
+                request->send(503, "application/json", "{\"error\":\"Service unavailable\"}");
+                return;
+            }
 
-            if (_chatCallback) {
-                String response = _chatCallback(message);
+            uint32_t id = submitChat(doc["message"].as<String>());
+            if (id == 0) {
+                request->send(503, "application/json", "{\"error\":\"Busy, try again\"}");
+                return;
+            }
 
-                JsonDocument respDoc;
-                respDoc["response"] = response;
+            JsonDocument respDoc;
+            respDoc["job"] = id;
 
-                String respJson;
-                serializeJson(respDoc, respJson);
-                request->send(200, "application/json", respJson);
-            } else {
-                request->send(503, "application/json", "{\"error\":\"Service unavailable\"}");
-            }
+            String respJson;
+            serializeJson(respDoc, respJson);
+            request->send(202, "application/json", respJson);
         });
 
+    _server.on("/api/chat", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        JobResult result;
+        uint32_t id = request->arg("job").toInt();
+        if (id == 0 || !getResult(id, result)) {
+            request->send(404, "application/json", "{\"error\":\"Unknown job\"}");
+            return;
+        }
+
+        JsonDocument doc;
+        doc["job"] = id;
+        switch (result.status) {
+            case JobStatus::PENDING:
+                doc["status"] = "pending";
+                break;
+            case JobStatus::DONE:
+                doc["status"] = "done";
+                doc["response"] = result.reply;
+                break;
+            case JobStatus::FAILED:
+                doc["status"] = "error";
+                doc["error"] = result.reply;
+                break;
+        }
+
+        String json;
+        serializeJson(doc, json);
+        request->send(200, "application/json", json);
+    });
+
     // Status endpoint
     _server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest* request) {
         JsonDocument doc;
@@ -101,6 +216,11 @@ void WebInterface::setupRoutes() {
         serializeJson(doc, json);
         request->send(200, "application/json", json);
     });
+
+    // Voice turn latency spans and counters
+    _server.on("/api/metrics", HTTP_GET, [](AsyncWebServerRequest* request) {
+        request->send(200, "application/json", metricsToJson());
+    });
 }
 
 void WebInterface::handleWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
@@ -114,30 +234,43 @@ void WebInterface::handleWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketCl
 
         case WS_EVT_DISCONNECT:
             Serial.printf("[WebSocket] Client #%u disconnected\n", client->id());
+            free(client->_tempObject);
+            client->_tempObject = nullptr;
             break;
 
         case WS_EVT_DATA: {
+            // A frame larger than one TCP segment arrives in pieces; messages
+            // split into several frames are not used by the page and dropped
             AwsFrameInfo* info = (AwsFrameInfo*)arg;
-            if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
-                String message = String((char*)data).substring(0, len);
-
-                JsonDocument doc;
-                DeserializationError error = deserializeJson(doc, message);
-
-                if (!error) {
-                    String msgType = doc["type"].as<String>();
-
-                    if (msgType == "chat" && _chatCallback) {
-                        String userMsg = doc["message"].as<String>();
-                        sendMessage("user", userMsg);
-
-                        String response = _chatCallback(userMsg);
-                        sendMessage("assistant", response);
+            if (info->num > 0 || !info->final || info->opcode != WS_TEXT ||
+                info->len > WEB_CHAT_MAX_BODY) {
+                break;
+            }
+            if (!collectBody(&client->_tempObject, data, len, info->index, info->len)) break;
 
-                    } else if (msgType == "volume" && _volumeCallback) {
-                        int volume = doc["value"].as<int>();
-                        _volumeCallback(volume);
+            JsonDocument doc;
+            DeserializationError error = deserializeJson(doc, (const char*)client->_tempObject, info->len);
+            free(client->_tempObject);
+            client->_tempObject = nullptr;
+
+            if (!error) {
+                String msgType = doc["type"].as<String>();
+
+                if (msgType == "chat" && _chatCallback) {
+                    String userMsg = doc["message"].as<String>();
+                    sendMessage("user", userMsg);
+
+                    // The reply follows as "delta" events and a final "message"
+                    uint32_t id = submitChat(userMsg);
+                    if (id == 0) {
+                        sendJobEvent("error", 0, "error", "Busy, try again");
+                    } else {
+                        sendJobEvent("queued", id, nullptr, "");
                     }
+
+                } else if (msgType == "volume" && _volumeCallback) {
+                    int volume = doc["value"].as<int>();
+                    _volumeCallback(volume);
                 }
             }
             break;
@@ -149,6 +282,86 @@ void WebInterface::handleWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketCl
     }
 }
 
+uint32_t WebInterface::submitChat(const String& message) {
+    if (!_jobs) return 0;
+
+    xSemaphoreTake(_resultsMutex, portMAX_DELAY);
+    uint32_t id = _nextJobId++;
+    if (_nextJobId == 0) _nextJobId = 1;
+    xSemaphoreGive(_resultsMutex);
+
+    // Recorded before queueing so the worker's result can't be overwritten
+    setResult(id, JobStatus::PENDING, "");
+
+    ChatJob job = { id, new String(message) };
+    if (xQueueSend(_jobs, &job, 0) != pdTRUE) {
+        Serial.println("[WebServer] Chat queue full, rejecting request");
+        setResult(id, JobStatus::FAILED, "Busy");
+        delete job.message;
+        return 0;
+    }
+
+    Serial.printf("[WebServer] Chat job %u queued\n", id);
+    return id;
+}
+
+void WebInterface::workerTask(void* param) {
+    WebInterface* web = (WebInterface*)param;
+    ChatJob job;
+
+    while (true) {
+        if (xQueueReceive(web->_jobs, &job, portMAX_DELAY) == pdTRUE) {
+            web->runJob(job);
+            delete job.message;
+        }
+    }
+}
+
+void WebInterface::runJob(const ChatJob& job) {
+    uint32_t id = job.id;
+    String reply;
+    bool ok = _chatCallback(*job.message, [this, id](const String& delta) {
+        sendJobEvent("delta", id, "content", delta);
+    }, reply);
+
+    setResult(id, ok ? JobStatus::DONE : JobStatus::FAILED, reply);
+    if (ok) {
+        // Same shape as sendMessage(), tagged with the job it completes
+        JsonDocument doc;
+        doc["type"] = "message";
+        doc["role"] = "assistant";
+        doc["content"] = reply;
+        doc["job"] = id;
+
+        String json;
+        serializeJson(doc, json);
+        _ws.textAll(json);
+    } else {
+        sendJobEvent("error", id, "error", reply);
+    }
+    Serial.printf("[WebServer] Chat job %u %s\n", id, ok ? "done" : "failed");
+}
+
+void WebInterface::setResult(uint32_t id, JobStatus status, const String& reply) {
+    xSemaphoreTake(_resultsMutex, portMAX_DELAY);
+    JobResult& slot = _results[id % RESULT_SLOTS];
+    slot.id = id;
+    slot.status = status;
+    slot.reply = reply;
+    xSemaphoreGive(_resultsMutex);
+}
+
+bool WebInterface::getResult(uint32_t id, JobResult& result) {
+    xSemaphoreTake(_resultsMutex, portMAX_DELAY);
+    const JobResult& slot = _results[id % RESULT_SLOTS];
+    bool found = slot.id == id;
+    if (found) {
+        result = slot;
+    }
+    xSemaphoreGive(_resultsMutex);
+    return found;
+}
+
 const char* WebInterface::getIndexHtml() {
     return R"rawliteral(
 <!DOCTYPE html>
@@ -402,6 +615,7 @@ const char* WebInterface::getIndexHtml() {
         const volumeValue = document.getElementById('volumeValue');
 
         let ws = null;
+        const replies = {};  // job id -> bubble being streamed into
 
         function connectWebSocket() {
             ws = new WebSocket(`ws://${location.host}/ws`);
@@ -420,8 +634,24 @@ const char* WebInterface::getIndexHtml() {
             ws.onmessage = (event) => {
                 const data = JSON.parse(event.data);
 
-                if (data.type === 'message') {
-                    addMessage(data.role, data.content);
+                if (data.type === 'delta') {
+                    if (!replies[data.job]) {
+                        replies[data.job] = addMessage('assistant', '');
+                        typingIndicator.classList.remove('active');
+                    }
+                    replies[data.job].textContent += data.content;
+                    chatContainer.scrollTop = chatContainer.scrollHeight;
+                } else if (data.type === 'message') {
+                    if (data.job && replies[data.job]) {
+                        replies[data.job].textContent = data.content;
+                        delete replies[data.job];
+                    } else {
+                        addMessage(data.role, data.content);
+                    }
+                    if (data.role === 'assistant') typingIndicator.classList.remove('active');
+                } else if (data.type === 'error') {
+                    delete replies[data.job];
+                    addMessage('assistant', 'Error: ' + data.error);
                     typingIndicator.classList.remove('active');
                 } else if (data.type === 'status') {
                     console.log('Status:', data.status);
@@ -438,6 +668,7 @@ const char* WebInterface::getIndexHtml() {
             `;
             chatContainer.appendChild(msgDiv);
             chatContainer.scrollTop = chatContainer.scrollHeight;
+            return msgDiv.querySelector('.bubble');
         }
 
         function escapeHtml(text) {
@@ -3,16 +3,27 @@
 
 #include <Arduino.h>
 #include <ESPAsyncWebServer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 #include <functional>
 
 class WebInterface {
 public:
-    using ChatCallback = std::function<String(const String& message)>;
+    // Receives each reply fragment while it is generated
+    using TokenCallback = std::function<void(const String& delta)>;
+
+    // Runs on the chat worker task, never on the async_tcp task, so it may
+    // block for the whole request. Returns false with the error in reply
+    using ChatCallback = std::function<bool(const String& message, const TokenCallback& onToken,
+                                            String& reply)>;
     using VolumeCallback = std::function<void(int volume)>;
 
     WebInterface();
+    ~WebInterface();
 
-    void begin();
+    bool begin();
     void setChatCallback(ChatCallback callback);
     void setVolumeCallback(VolumeCallback callback);
 
@@ -21,16 +32,57 @@ public:
     void sendMessage(const String& role, const String& message);
 
 private:
+    // Queued chat request; the worker owns and deletes message
+    struct ChatJob {
+        uint32_t id;
+        String* message;
+    };
+
+    enum class JobStatus {
+        PENDING,
+        DONE,
+        FAILED
+    };
+
+    // Outcome of a recent job, for clients polling GET /api/chat?job=
+    struct JobResult {
+        uint32_t id;
+        JobStatus status;
+        String reply;
+    };
+
+    static const size_t RESULT_SLOTS = 4;
+
     AsyncWebServer _server;
     AsyncWebSocket _ws;
 
     ChatCallback _chatCallback;
     VolumeCallback _volumeCallback;
 
+    // Chat worker
+    QueueHandle_t _jobs;
+    TaskHandle_t _worker;
+    SemaphoreHandle_t _resultsMutex;
+    JobResult _results[RESULT_SLOTS];
+    uint32_t _nextJobId;
+
     void setupRoutes();
     void handleWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
                              AwsEventType type, void* arg, uint8_t* data, size_t len);
 
+    // Queue a chat message; returns its job id, or 0 when the queue is full
+    uint32_t submitChat(const String& message);
+    static void workerTask(void* param);
+    void runJob(const ChatJob& job);
+    void setResult(uint32_t id, JobStatus status, const String& reply);
+    bool getResult(uint32_t id, JobResult& result);
+    void sendJobEvent(const char* type, uint32_t id, const char* field, const String& value);
+
+    // Collects a body arriving in pieces into a malloc'd buffer at *buffer.
+    // True once the last piece is in; the buffer is then NUL terminated
+    static bool collectBody(void** buffer, const uint8_t* data, size_t len,
+                            size_t index, size_t total);
+
     // Embedded HTML/CSS/JS
     static const char* getIndexHtml();
 };
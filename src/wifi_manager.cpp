@@ -1,5 +1,19 @@
 #include "wifi_manager.h"
 #include "config.h"
+#include <Preferences.h>
+
+#define WIFI_CACHE_NAMESPACE  "wifi"
+#define WIFI_CACHE_KEY        "net"
+#define WIFI_CACHE_VERSION    1
+
+static uint32_t hashSsid(const char* ssid) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*ssid) {
+        hash = (hash ^ (uint8_t)*ssid++) * 16777619u;
+    }
+    return hash;
+}
 
 WiFiManager::WiFiManager()
     : _ssid(nullptr)
@@ -7,13 +21,21 @@ WiFiManager::WiFiManager()
     , _state(State::DISCONNECTED)
     , _statusCallback(nullptr)
     , _lastCheckTime(0)
+    , _connectTimeMs(0)
+    , _cacheValid(false)
+    , _pinned(false)
+    , _lostTime(0)
 {
+    memset(&_cache, 0, sizeof(_cache));
 }
 
 void WiFiManager::begin(const char* ssid, const char* password) {
     _ssid = ssid;
     _password = password;
 
+    // The driver's own copy of the config isn't needed: the remembered
+    // network lives in our NVS entry, written only when it changes
+    WiFi.persistent(false);
     WiFi.mode(WIFI_STA);
     WiFi.setAutoReconnect(true);
 }
@@ -30,21 +52,125 @@ bool WiFiManager::connect(uint32_t timeoutMs) {
 
     setState(State::CONNECTING, String("Connecting to ") + _ssid);
 
+    uint32_t startTime = millis();
+
+    if (WIFI_FAST_CONNECT && loadCache()) {
+        if (connectCached()) {
+            _connectTimeMs = millis() - startTime;
+            Serial.printf("[WiFi] Fast connect in %lu ms (channel %d)\n", _connectTimeMs, _cache.channel);
+            setState(State::CONNECTED, "Connected: " + getIP());
+            return true;
+        }
+        // The AP moved channel or was replaced
+        Serial.println("[WiFi] Remembered network unavailable, scanning");
+        forgetNetwork();
+    }
+
     WiFi.begin(_ssid, _password);
 
+    if (!waitConnected(timeoutMs)) {
+        setState(State::ERROR, "Connection timeout");
+        return false;
+    }
+
+    _connectTimeMs = millis() - startTime;
+    Serial.printf("[WiFi] Connected in %lu ms\n", _connectTimeMs);
+    saveCache();
+    setState(State::CONNECTED, "Connected: " + getIP());
+    return true;
+}
+
+bool WiFiManager::waitConnected(uint32_t timeoutMs) {
     uint32_t startTime = millis();
     while (WiFi.status() != WL_CONNECTED) {
         if (millis() - startTime > timeoutMs) {
-            setState(State::ERROR, "Connection timeout");
             return false;
         }
-        delay(100);
+        delay(20);
     }
-
-    setState(State::CONNECTED, "Connected: " + getIP());
     return true;
 }
 
+bool WiFiManager::connectCached() {
+    // Optionally skip DHCP with the lease from the last connection. Only
+    // the association is checked below: an address the router has since
+    // given to another host goes unnoticed, hence off by default
+    if (WIFI_FAST_CONNECT_STATIC_IP && _cache.ip != 0) {
+        WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway),
+                    IPAddress(_cache.subnet), IPAddress(_cache.dns));
+    }
+
+    WiFi.begin(_ssid, _password, _cache.channel, _cache.bssid);
+    _pinned = waitConnected(WIFI_FAST_CONNECT_TIMEOUT_MS);
+    if (!_pinned) {
+        WiFi.disconnect();
+        useDhcp();
+    }
+    return _pinned;
+}
+
+void WiFiManager::useDhcp() {
+    if (WIFI_FAST_CONNECT_STATIC_IP) {
+        WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+    }
+}
+
+bool WiFiManager::loadCache() {
+    if (_cacheValid) return true;
+
+    Preferences prefs;
+    if (!prefs.begin(WIFI_CACHE_NAMESPACE, true)) return false;
+    size_t length = prefs.getBytes(WIFI_CACHE_KEY, &_cache, sizeof(_cache));
+    prefs.end();
+
+    _cacheValid = length == sizeof(_cache) &&
+                  _cache.version == WIFI_CACHE_VERSION &&
+                  _cache.ssidHash == hashSsid(_ssid) &&
+                  _cache.channel != 0;
+    return _cacheValid;
+}
+
+void WiFiManager::saveCache() {
+    if (!WIFI_FAST_CONNECT) return;
+
+    const uint8_t* bssid = WiFi.BSSID();
+    if (!bssid) return;
+
+    NetworkCache cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.version = WIFI_CACHE_VERSION;
+    cache.channel = WiFi.channel();
+    memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    cache.ssidHash = hashSsid(_ssid);
+    cache.ip = WiFi.localIP();
+    cache.gateway = WiFi.gatewayIP();
+    cache.subnet = WiFi.subnetMask();
+    cache.dns = WiFi.dnsIP(0);
+
+    // Unchanged after most connects; skip the flash write
+    if (_cacheValid && memcmp(&cache, &_cache, sizeof(cache)) == 0) return;
+
+    Preferences prefs;
+    if (!prefs.begin(WIFI_CACHE_NAMESPACE, false)) return;
+    prefs.putBytes(WIFI_CACHE_KEY, &cache, sizeof(cache));
+    prefs.end();
+
+    _cache = cache;
+    _cacheValid = true;
+    Serial.printf("[WiFi] Remembered network on channel %d\n", cache.channel);
+}
+
+void WiFiManager::forgetNetwork() {
+    _cacheValid = false;
+    _pinned = false;
+
+    Preferences prefs;
+    if (prefs.begin(WIFI_CACHE_NAMESPACE, false)) {
+        prefs.remove(WIFI_CACHE_KEY);
+        prefs.end();
+    }
+}
+
 void WiFiManager::disconnect() {
     WiFi.disconnect();
     setState(State::DISCONNECTED, "Disconnected");
@@ -74,9 +200,19 @@ void WiFiManager::update() {
         bool connected = isConnected();
 
         if (connected && _state != State::CONNECTED) {
+            saveCache();
             setState(State::CONNECTED, "Reconnected: " + getIP());
         } else if (!connected && _state == State::CONNECTED) {
+            _lostTime = millis();
             setState(State::DISCONNECTED, "Connection lost");
+        } else if (!connected && _pinned && millis() - _lostTime > WIFI_FAST_CONNECT_TIMEOUT_MS) {
+            // Auto-reconnect retries the remembered AP and channel; if that
+            // AP isn't coming back, look for any AP with the SSID instead
+            Serial.println("[WiFi] Remembered AP not back, scanning");
+            forgetNetwork();
+            WiFi.disconnect();
+            useDhcp();
+            WiFi.begin(_ssid, _password);
         }
     }
 }
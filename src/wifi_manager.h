@@ -21,6 +21,8 @@ public:
     void begin(const char* ssid, const char* password);
     void setStatusCallback(StatusCallback callback);
 
+    // Tries the access point, channel and IP address remembered from the
+    // last connection first (no scan, no DHCP), then a full connect
     bool connect(uint32_t timeoutMs = 10000);
     void disconnect();
     bool isConnected();
@@ -29,16 +31,43 @@ public:
     String getIP() const;
     String getSSID() const;
     int8_t getRSSI() const;
+    uint32_t getConnectTime() const { return _connectTimeMs; }
+
+    // Drop the remembered network (next connect scans)
+    void forgetNetwork();
 
     void update();  // Call in loop for connection monitoring
 
 private:
+    // Stored in NVS after every successful connection
+    struct NetworkCache {
+        uint8_t version;
+        uint8_t channel;
+        uint8_t bssid[6];
+        uint32_t ssidHash;      // Only used for the SSID it was saved with
+        uint32_t ip;
+        uint32_t gateway;
+        uint32_t subnet;
+        uint32_t dns;
+    };
+
     const char* _ssid;
     const char* _password;
     State _state;
     StatusCallback _statusCallback;
     uint32_t _lastCheckTime;
+    uint32_t _connectTimeMs;
+
+    NetworkCache _cache;
+    bool _cacheValid;
+    bool _pinned;           // Joined through the cache (fixed AP and channel)
+    uint32_t _lostTime;
 
+    bool loadCache();
+    void saveCache();
+    bool connectCached();
+    bool waitConnected(uint32_t timeoutMs);
+    void useDhcp();
     void setState(State state, const String& message = "");
 };
 
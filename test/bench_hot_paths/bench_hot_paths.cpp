@@ -0,0 +1,440 @@
+/**
+ * Micro-benchmarks for the voice turn hot paths
+ * Times base64 encode/decode, volume scaling and mixing, frame energy, mu-law
+ * and the Gemini response and stream-event parses over realistic sizes
+ * (10 s mic recordings, 30 s TTS payloads). The host build reports ns per item; the on-device build
+ * (esp32s3-bench env) reports CPU cycles read with esp_cpu_get_cycle_count.
+ *
+ *   pio test -e native_bench
+ *   pio test -e esp32s3-bench
+ */
+
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <cstdio>
+#include <cstring>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#include <chrono>
+#else
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp_idf_version.h>
+#include <esp_cpu.h>
+#if ESP_IDF_VERSION_MAJOR < 5
+#define esp_cpu_get_cycle_count esp_cpu_get_ccount  // Arduino core 2.x (IDF 4.4)
+#endif
+#endif
+
+// The DSP, codec, base64 and Gemini parse code are the shipped sources (see build_src_filter)
+#include "../../src/audio_dsp.h"
+#include "../../src/audio_codec.h"
+#include "../../src/base64.h"
+#include "../../src/gemini_parse.h"
+
+// ============================================================================
+// Harness
+// ============================================================================
+
+#define BENCH_SAMPLE_RATE   16000
+#define BENCH_MIC_SAMPLES   (BENCH_SAMPLE_RATE * 10)  // MAX_RECORDING_SECONDS
+#define BENCH_TTS_SAMPLES   (BENCH_SAMPLE_RATE * 30)  // TTS_MAX_SAMPLES
+#define BENCH_FRAME_SIZE    512                       // WakeWordDetector::FRAME_SIZE
+
+#ifdef NATIVE_BUILD
+#define BENCH_REPEATS  20
+#define BENCH_PRINTF(...) printf(__VA_ARGS__)
+#else
+#define BENCH_REPEATS  3
+#define BENCH_PRINTF(...) Serial.printf(__VA_ARGS__)
+#endif
+
+// Nanoseconds on the host, CPU cycles on the device
+static uint64_t benchTicks() {
+#ifdef NATIVE_BUILD
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return esp_cpu_get_cycle_count();
+#endif
+}
+
+static double benchTicksToSeconds(uint64_t ticks) {
+#ifdef NATIVE_BUILD
+    return ticks / 1e9;
+#else
+    return ticks / (getCpuFrequencyMhz() * 1e6);
+#endif
+}
+
+// Large buffers live in PSRAM on the device, like the ones they stand in for
+static void* benchAlloc(size_t size) {
+#ifdef NATIVE_BUILD
+    return malloc(size);
+#else
+    return heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+}
+
+// Results are folded in here so the optimizer cannot drop a kernel
+static volatile uint32_t benchSink = 0;
+
+// Best of BENCH_REPEATS runs: the least disturbed by the scheduler and caches
+template <typename Body>
+static uint64_t benchBest(Body body) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < BENCH_REPEATS; i++) {
+        uint64_t start = benchTicks();
+        body();
+#ifdef NATIVE_BUILD
+        uint64_t elapsed = benchTicks() - start;
+#else
+        // The cycle counter is 32 bits: wraps every ~17 s at 240 MHz
+        uint64_t elapsed = (uint32_t)(benchTicks() - start);
+#endif
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// One line per kernel: per-item cost and throughput over the input bytes
+static void benchReport(const char* name, uint64_t ticks, size_t items,
+                        const char* unit, size_t bytes) {
+    double perItem = (double)ticks / items;
+    double seconds = benchTicksToSeconds(ticks);
+    double mbPerSec = seconds > 0 ? bytes / seconds / 1e6 : 0;
+
+#ifdef NATIVE_BUILD
+    BENCH_PRINTF("[Bench] %-22s %9.2f ns/%-6s %9.1f MB/s  (%.3f ms)\n",
+                 name, perItem, unit, mbPerSec, seconds * 1e3);
+#else
+    BENCH_PRINTF("[Bench] %-22s %9.2f cycles/%-6s %9.1f MB/s  (%.3f ms)\n",
+                 name, perItem, unit, mbPerSec, seconds * 1e3);
+#endif
+}
+
+// Speech-like test signal: a few harmonics under an envelope, plus noise
+static void benchFillSpeech(int16_t* samples, size_t count) {
+    uint32_t noise = 12345;
+    for (size_t i = 0; i < count; i++) {
+        float t = (float)i / BENCH_SAMPLE_RATE;
+        float envelope = 0.5f + 0.5f * sinf(2.0f * (float)M_PI * 3.0f * t);
+        float voice = sinf(2.0f * (float)M_PI * 180.0f * t)
+                    + 0.5f * sinf(2.0f * (float)M_PI * 360.0f * t)
+                    + 0.25f * sinf(2.0f * (float)M_PI * 1100.0f * t);
+        noise = noise * 1103515245 + 12345;
+        int32_t hiss = (int32_t)((noise >> 16) & 0x1FF) - 256;
+        samples[i] = (int16_t)(voice * envelope * 9000.0f) + hiss;
+    }
+}
+
+// ============================================================================
+// Gemini response parse (gemini_parse.cpp, as GeminiClient runs it)
+// ============================================================================
+
+// GeminiClient passes its turn arena allocator; the arena needs the device
+// heap setup, so documents here come straight from malloc
+class BenchJsonAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override { return malloc(size); }
+    void deallocate(void* ptr) override { free(ptr); }
+    void* reallocate(void* ptr, size_t newSize) override { return realloc(ptr, newSize); }
+};
+
+static BenchJsonAllocator benchJsonAllocator;
+
+// A full-length reply (GEMINI_MAX_TOKENS ~ 4 KB of text) with the metadata
+// the API sends alongside it
+static String buildGeminiResponse(size_t textBytes) {
+    static const char sentence[] =
+        "The quick brown fox jumps over the lazy dog, and then \\\"naps\\\" in the sun.\\n";
+
+    String text;
+    text.reserve(textBytes + sizeof(sentence));
+    while (text.length() < textBytes) {
+        text += sentence;
+    }
+
+    String json;
+    json.reserve(text.length() + 1024);
+    json += "{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\"";
+    json += text;
+    json += "\"}],\"role\":\"model\"},\"finishReason\":\"STOP\",\"index\":0,"
+            "\"safetyRatings\":["
+            "{\"category\":\"HARM_CATEGORY_SEXUALLY_EXPLICIT\",\"probability\":\"NEGLIGIBLE\"},"
+            "{\"category\":\"HARM_CATEGORY_HATE_SPEECH\",\"probability\":\"NEGLIGIBLE\"},"
+            "{\"category\":\"HARM_CATEGORY_HARASSMENT\",\"probability\":\"NEGLIGIBLE\"},"
+            "{\"category\":\"HARM_CATEGORY_DANGEROUS_CONTENT\",\"probability\":\"NEGLIGIBLE\"}]}],"
+            "\"usageMetadata\":{\"promptTokenCount\":1480,\"candidatesTokenCount\":1024,"
+            "\"totalTokenCount\":2504},\"modelVersion\":\"gemini-1.5-flash\"}";
+    return json;
+}
+
+// One streamGenerateContent event: a sentence-sized fragment plus the
+// metadata the filter drops
+static String buildGeminiStreamEvent() {
+    return "{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\""
+           "The quick brown fox jumps over the lazy dog, and then \\\"naps\\\" in the sun. "
+           "It stays there until the shade moves.\"}],\"role\":\"model\"},\"index\":0,"
+           "\"safetyRatings\":["
+           "{\"category\":\"HARM_CATEGORY_SEXUALLY_EXPLICIT\",\"probability\":\"NEGLIGIBLE\"},"
+           "{\"category\":\"HARM_CATEGORY_HATE_SPEECH\",\"probability\":\"NEGLIGIBLE\"},"
+           "{\"category\":\"HARM_CATEGORY_HARASSMENT\",\"probability\":\"NEGLIGIBLE\"},"
+           "{\"category\":\"HARM_CATEGORY_DANGEROUS_CONTENT\",\"probability\":\"NEGLIGIBLE\"}]}],"
+           "\"usageMetadata\":{\"promptTokenCount\":1480,\"candidatesTokenCount\":24,"
+           "\"totalTokenCount\":1504},\"modelVersion\":\"gemini-1.5-flash\"}";
+}
+
+// ============================================================================
+// Fixtures
+// ============================================================================
+
+static int16_t* micSamples = nullptr;   // 10 s recording
+static int16_t* ttsSamples = nullptr;   // 30 s reply
+static int16_t* scratchSamples = nullptr;
+static char* ttsBase64 = nullptr;       // 30 s reply as the TTS API sends it
+static size_t ttsBase64Len = 0;
+static uint8_t* decodeBuffer = nullptr;
+
+static const size_t TTS_BYTES = BENCH_TTS_SAMPLES * sizeof(int16_t);
+static const size_t TTS_BASE64_BYTES = base64EncodedLength(TTS_BYTES);
+
+static bool benchSetup() {
+    micSamples = (int16_t*)benchAlloc(BENCH_MIC_SAMPLES * sizeof(int16_t));
+    ttsSamples = (int16_t*)benchAlloc(TTS_BYTES);
+    scratchSamples = (int16_t*)benchAlloc(TTS_BYTES);
+    ttsBase64 = (char*)benchAlloc(TTS_BASE64_BYTES + 1);
+    decodeBuffer = (uint8_t*)benchAlloc(base64DecodedMaxLength(TTS_BASE64_BYTES));
+
+    if (!micSamples || !ttsSamples || !scratchSamples || !ttsBase64 || !decodeBuffer) {
+        BENCH_PRINTF("[Bench] Not enough memory for the fixtures\n");
+        return false;
+    }
+
+    benchFillSpeech(micSamples, BENCH_MIC_SAMPLES);
+    benchFillSpeech(ttsSamples, BENCH_TTS_SAMPLES);
+    ttsBase64Len = base64EncodeBlock((const uint8_t*)ttsSamples, TTS_BYTES, ttsBase64);
+    ttsBase64[ttsBase64Len] = '\0';
+    return true;
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+void bench_base64_encode_recording() {
+    const size_t bytes = BENCH_MIC_SAMPLES * sizeof(int16_t);
+    size_t encodedLen = 0;
+
+    uint64_t ticks = benchBest([&]() {
+        String encoded = base64Encode((const uint8_t*)micSamples, bytes);
+        encodedLen = encoded.length();
+        benchSink += encoded[encodedLen / 2];
+    });
+
+    TEST_ASSERT_EQUAL(base64EncodedLength(bytes), encodedLen);
+    benchReport("base64Encode", ticks, bytes, "byte", bytes);
+}
+
+void bench_base64_encode_blocks() {
+    // Same block size as the streaming STT upload
+    const size_t bytes = BENCH_MIC_SAMPLES * sizeof(int16_t);
+    const size_t blockBytes = 3 * 512;
+    char* out = (char*)scratchSamples;
+    size_t encodedLen = 0;
+
+    uint64_t ticks = benchBest([&]() {
+        encodedLen = 0;
+        for (size_t offset = 0; offset < bytes; offset += blockBytes) {
+            size_t n = min(blockBytes, bytes - offset);
+            encodedLen += base64EncodeBlock((const uint8_t*)micSamples + offset, n,
+                                            out + encodedLen);
+        }
+        benchSink += out[encodedLen / 2];
+    });
+
+    TEST_ASSERT_EQUAL(base64EncodedLength(bytes), encodedLen);
+    benchReport("base64EncodeBlock", ticks, bytes, "byte", bytes);
+}
+
+void bench_base64_decode_tts() {
+    // Batch TTS: the whole audioContent value at once
+    size_t decodedLen = 0;
+
+    uint64_t ticks = benchBest([&]() {
+        decodedLen = base64Decode(ttsBase64, ttsBase64Len, decodeBuffer);
+        benchSink += decodeBuffer[decodedLen / 2];
+    });
+
+    TEST_ASSERT_EQUAL(TTS_BYTES, decodedLen);
+    TEST_ASSERT_EQUAL_MEMORY(ttsSamples, decodeBuffer, TTS_BYTES);
+    benchReport("base64Decode", ticks, ttsBase64Len, "char", ttsBase64Len);
+}
+
+void bench_base64_decode_stream() {
+    // Streaming TTS: socket reads decoded in 256-character slices
+    const size_t sliceChars = 256;
+    size_t decodedLen = 0;
+
+    uint64_t ticks = benchBest([&]() {
+        Base64Decoder decoder;
+        decodedLen = 0;
+        for (size_t offset = 0; offset < ttsBase64Len; offset += sliceChars) {
+            size_t n = min(sliceChars, ttsBase64Len - offset);
+            decodedLen += decoder.update(ttsBase64 + offset, n, decodeBuffer + decodedLen);
+        }
+        decodedLen += decoder.finish(decodeBuffer + decodedLen);
+        benchSink += decodeBuffer[decodedLen / 2];
+    });
+
+    TEST_ASSERT_EQUAL(TTS_BYTES, decodedLen);
+    TEST_ASSERT_EQUAL_MEMORY(ttsSamples, decodeBuffer, TTS_BYTES);
+    benchReport("Base64Decoder (stream)", ticks, ttsBase64Len, "char", ttsBase64Len);
+}
+
+void bench_volume_scale() {
+    // AudioMixer applies volume with dspScaleQ15 on single-voice chunks
+    const int32_t gain = dspGainFromPercent(70);
+
+    uint64_t ticks = benchBest([&]() {
+        dspScaleQ15(ttsSamples, scratchSamples, BENCH_TTS_SAMPLES, gain);
+        benchSink += scratchSamples[BENCH_TTS_SAMPLES / 2];
+    });
+
+    TEST_ASSERT_EQUAL_INT16((ttsSamples[1000] * gain + 0x4000) >> 15, scratchSamples[1000]);
+    benchReport("dspScaleQ15 (volume)", ticks, BENCH_TTS_SAMPLES, "sample", TTS_BYTES);
+}
+
+void bench_volume_mix() {
+    // Speech mixed under a cue: accumulate with gain and saturate
+    const int32_t gain = dspGainFromPercent(40);
+
+    uint64_t ticks = benchBest([&]() {
+        memset(scratchSamples, 0, TTS_BYTES);
+        dspMixQ15(scratchSamples, ttsSamples, BENCH_TTS_SAMPLES, gain);
+        benchSink += scratchSamples[BENCH_TTS_SAMPLES / 2];
+    });
+
+    TEST_ASSERT_EQUAL_INT16((ttsSamples[1000] * gain + 0x4000) >> 15, scratchSamples[1000]);
+    benchReport("dspMixQ15 (+memset)", ticks, BENCH_TTS_SAMPLES, "sample", TTS_BYTES);
+}
+
+void bench_frame_energy() {
+    // WakeWordDetector::calculateEnergy runs per 512-sample frame
+    float total = 0;
+
+    uint64_t ticks = benchBest([&]() {
+        total = 0;
+        for (size_t offset = 0; offset + BENCH_FRAME_SIZE <= BENCH_MIC_SAMPLES;
+             offset += BENCH_FRAME_SIZE) {
+            total += dspRms(micSamples + offset, BENCH_FRAME_SIZE);
+        }
+        benchSink += (uint32_t)total;
+    });
+
+    TEST_ASSERT_TRUE(total > 0);
+    benchReport("calculateEnergy (RMS)", ticks, BENCH_MIC_SAMPLES, "sample",
+                BENCH_MIC_SAMPLES * sizeof(int16_t));
+}
+
+void bench_mulaw_encode_recording() {
+    // SpeechClient::encodeSamples before upload with SPEECH_AUDIO_ENCODING MULAW
+    uint8_t* out = (uint8_t*)scratchSamples;
+
+    uint64_t ticks = benchBest([&]() {
+        mulawEncodeBlock(micSamples, BENCH_MIC_SAMPLES, out);
+        benchSink += out[BENCH_MIC_SAMPLES / 2];
+    });
+
+    TEST_ASSERT_EQUAL_UINT8(mulawEncode(micSamples[1000]), out[1000]);
+    benchReport("mulawEncodeBlock", ticks, BENCH_MIC_SAMPLES, "sample",
+                BENCH_MIC_SAMPLES * sizeof(int16_t));
+}
+
+void bench_parse_gemini_response() {
+    String json = buildGeminiResponse(4096);
+    size_t textLen = 0;
+
+    uint64_t ticks = benchBest([&]() {
+        String text, error;
+        geminiParseResponse(json.c_str(), json.length(), &benchJsonAllocator, text, error);
+        textLen = text.length();
+        benchSink += textLen;
+    });
+
+    TEST_ASSERT_TRUE(textLen > 3 * 1024);  // Escapes shrink when decoded
+    benchReport("parseResponse", ticks, json.length(), "byte", json.length());
+}
+
+void bench_parse_gemini_stream() {
+    // A 4 KB reply arrives as ~40 events of this size
+    const int events = 40;
+    String event = buildGeminiStreamEvent();
+    size_t textLen = 0;
+
+    uint64_t ticks = benchBest([&]() {
+        for (int i = 0; i < events; i++) {
+            String text, error;
+            geminiParseStreamEvent(event.c_str(), &benchJsonAllocator, text, error);
+            textLen = text.length();
+            benchSink += textLen;
+        }
+    });
+
+    TEST_ASSERT_TRUE(textLen > 64);
+    benchReport("parseStreamEvent", ticks, event.length() * events, "byte",
+                event.length() * events);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+static int runBenchmarks() {
+    UNITY_BEGIN();
+
+    if (!benchSetup()) {
+        return UNITY_END();
+    }
+
+    BENCH_PRINTF("[Bench] 10 s recording: %u samples, 30 s reply: %u samples, best of %d\n",
+                 (unsigned)BENCH_MIC_SAMPLES, (unsigned)BENCH_TTS_SAMPLES, BENCH_REPEATS);
+
+    // Speech-to-Text upload
+    RUN_TEST(bench_mulaw_encode_recording);
+    RUN_TEST(bench_base64_encode_recording);
+    RUN_TEST(bench_base64_encode_blocks);
+
+    // Text-to-Speech download and playback
+    RUN_TEST(bench_base64_decode_tts);
+    RUN_TEST(bench_base64_decode_stream);
+    RUN_TEST(bench_volume_scale);
+    RUN_TEST(bench_volume_mix);
+
+    // Wake word front end
+    RUN_TEST(bench_frame_energy);
+
+    // Gemini reply
+    RUN_TEST(bench_parse_gemini_response);
+    RUN_TEST(bench_parse_gemini_stream);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char** argv) {
+    return runBenchmarks();
+}
+#else
+void setup() {
+    Serial.begin(115200);
+    delay(2000);  // Let the USB CDC port enumerate before results scroll past
+    runBenchmarks();
+}
+
+void loop() {}
+#endif
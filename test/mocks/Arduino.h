@@ -35,6 +35,7 @@ public:
     const char* c_str() const { return _str.c_str(); }
     size_t length() const { return _str.length(); }
     bool isEmpty() const { return _str.empty(); }
+    bool reserve(size_t size) { _str.reserve(size); return true; }
 
     String& operator=(const char* s) { _str = s ? s : ""; return *this; }
     String& operator=(const String& s) { _str = s._str; return *this; }
@@ -48,6 +49,7 @@ public:
     bool operator==(const String& s) const { return _str == s._str; }
     bool operator==(const char* s) const { return _str == (s ? s : ""); }
     bool operator!=(const String& s) const { return _str != s._str; }
+    bool operator!=(const char* s) const { return _str != (s ? s : ""); }
 
     char operator[](size_t i) const { return _str[i]; }
     char& operator[](size_t i) { return _str[i]; }
@@ -7,6 +7,7 @@
 #include <cmath>
 #include <cstring>
 #include <vector>
+#include <atomic>
 
 #ifdef NATIVE_BUILD
 #include "../mocks/Arduino.h"
@@ -29,13 +30,141 @@
 // Extracted Functions for Testing
 // ============================================================================
 
-// Apply volume to audio samples (from audio_output.cpp)
-void applyVolume(int16_t* samples, size_t count, int volume) {
-    float volumeMultiplier = volume / 100.0f;
+// DSP kernels (from audio_dsp.cpp)
+static inline int16_t saturate16(int32_t value) {
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t)value;
+}
+
+static inline int16_t mulQ15(int16_t sample, int32_t gain) {
+    return (int16_t)((sample * gain + 0x4000) >> 15);
+}
+
+int32_t dspGainFromPercent(int percent) {
+    return (percent * 32768 + 50) / 100;
+}
+
+void dspScaleQ15(const int16_t* in, int16_t* out, size_t count, int32_t gain) {
+    // Gain is at most 1.0 (32768), so the product never leaves int16 range
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int16_t a = in[i], b = in[i + 1], c = in[i + 2], d = in[i + 3];
+        out[i]     = mulQ15(a, gain);
+        out[i + 1] = mulQ15(b, gain);
+        out[i + 2] = mulQ15(c, gain);
+        out[i + 3] = mulQ15(d, gain);
+    }
+    for (; i < count; i++) {
+        out[i] = mulQ15(in[i], gain);
+    }
+}
+
+void dspMixQ15(int16_t* dst, const int16_t* src, size_t count, int32_t gain) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        dst[i]     = saturate16(dst[i]     + mulQ15(src[i],     gain));
+        dst[i + 1] = saturate16(dst[i + 1] + mulQ15(src[i + 1], gain));
+        dst[i + 2] = saturate16(dst[i + 2] + mulQ15(src[i + 2], gain));
+        dst[i + 3] = saturate16(dst[i + 3] + mulQ15(src[i + 3], gain));
+    }
+    for (; i < count; i++) {
+        dst[i] = saturate16(dst[i] + mulQ15(src[i], gain));
+    }
+}
+
+uint64_t dspSumSquares(const int16_t* samples, size_t count) {
+    // Two squares fit in 32 bits (2 * 2^30); widen once per pair
+    uint64_t sum = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int32_t a = samples[i], b = samples[i + 1], c = samples[i + 2], d = samples[i + 3];
+        sum += (uint32_t)(a * a) + (uint32_t)(b * b);
+        sum += (uint32_t)(c * c) + (uint32_t)(d * d);
+    }
+    for (; i < count; i++) {
+        int32_t a = samples[i];
+        sum += (uint32_t)(a * a);
+    }
+    return sum;
+}
 
+float dspRms(const int16_t* samples, size_t count) {
+    if (count == 0) return 0;
+    return sqrtf((float)dspSumSquares(samples, count) / count);
+}
+
+int32_t dspMeanAbs(const int16_t* samples, size_t count) {
+    if (count == 0) return 0;
+
+    int32_t sum = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        sum += abs(samples[i]) + abs(samples[i + 1]) + abs(samples[i + 2]) + abs(samples[i + 3]);
+    }
+    for (; i < count; i++) {
+        sum += abs(samples[i]);
+    }
+    return sum / (int32_t)count;
+}
+
+int32_t dspPeak(const int16_t* samples, size_t count) {
+    int32_t peak = 0;
     for (size_t i = 0; i < count; i++) {
-        samples[i] = (int16_t)(samples[i] * volumeMultiplier);
+        int32_t level = abs(samples[i]);
+        if (level > peak) peak = level;
+    }
+    return peak;
+}
+
+uint32_t dspZeroCrossings(const int16_t* samples, size_t count) {
+    // Neighbours differ in sign exactly when their XOR is negative
+    uint32_t crossings = 0;
+    size_t i = 1;
+    for (; i + 4 <= count; i += 4) {
+        crossings += ((samples[i - 1] ^ samples[i])     < 0)
+                   + ((samples[i]     ^ samples[i + 1]) < 0)
+                   + ((samples[i + 1] ^ samples[i + 2]) < 0)
+                   + ((samples[i + 2] ^ samples[i + 3]) < 0);
+    }
+    for (; i < count; i++) {
+        crossings += (samples[i - 1] ^ samples[i]) < 0;
     }
+    return crossings;
+}
+
+size_t dspResample(const int16_t* in, size_t inCount, int16_t* out, size_t outMax,
+                   uint32_t inRate, uint32_t outRate) {
+    if (inCount == 0 || outRate == 0) return 0;
+
+    if (inRate == outRate) {
+        size_t n = min(inCount, outMax);
+        memmove(out, in, n * sizeof(int16_t));
+        return n;
+    }
+
+    // Read position in Q16; the fraction is taken as Q15 to stay in 32 bits
+    uint32_t step = ((uint64_t)inRate << 16) / outRate;
+    uint64_t position = 0;
+    size_t written = 0;
+
+    while (written < outMax) {
+        size_t index = position >> 16;
+        if (index >= inCount) break;
+
+        int32_t a = in[index];
+        int32_t b = index + 1 < inCount ? in[index + 1] : a;
+        int32_t frac = (position & 0xFFFF) >> 1;
+        out[written++] = (int16_t)(a + (((b - a) * frac) >> 15));
+
+        position += step;
+    }
+    return written;
+}
+
+// Apply volume to audio samples (from audio_output.cpp)
+void applyVolume(int16_t* samples, size_t count, int volume) {
+    dspScaleQ15(samples, samples, count, dspGainFromPercent(volume));
 }
 
 // Constrain volume to valid range
@@ -81,6 +210,48 @@ int calculateAverageLevel(const int16_t* samples, size_t count) {
     return sum / count;
 }
 
+// Reference scalar loops the DSP kernels replaced
+void referenceScale(const int16_t* in, int16_t* out, size_t count, int32_t gain) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (int16_t)((in[i] * gain + 0x4000) >> 15);
+    }
+}
+
+float referenceEnergy(const int16_t* samples, size_t count) {
+    float sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        float normalized = samples[i] / 32768.0f;
+        sum += normalized * normalized;
+    }
+    return sqrt(sum / count) * 32768.0f;
+}
+
+uint32_t referenceZeroCrossings(const int16_t* samples, size_t count) {
+    uint32_t crossings = 0;
+    for (size_t i = 1; i < count; i++) {
+        if ((samples[i-1] >= 0 && samples[i] < 0) ||
+            (samples[i-1] < 0 && samples[i] >= 0)) {
+            crossings++;
+        }
+    }
+    return crossings;
+}
+
+// Deterministic test signal: noise with full-scale and zero samples mixed in
+std::vector<int16_t> makeTestSignal(size_t count, uint32_t seed) {
+    std::vector<int16_t> samples(count);
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525 + 1013904223;
+        samples[i] = (int16_t)(seed >> 16);
+    }
+    if (count > 3) {
+        samples[0] = -32768;
+        samples[1] = 32767;
+        samples[2] = 0;
+    }
+    return samples;
+}
+
 // Voice Activity Detection logic (from audio_input.cpp)
 bool isVoiceDetected(int avgLevel, int threshold) {
     return avgLevel > threshold;
@@ -91,6 +262,98 @@ bool isSilenceTimeout(uint32_t lastSoundTime, uint32_t currentTime, uint32_t sil
     return (currentTime - lastSoundTime) > silenceMs;
 }
 
+// Lock-free SPSC ring (from ring_buffer.h)
+template <typename T>
+class SpscRing {
+public:
+    SpscRing() : _data(nullptr), _slots(0), _head(0), _tail(0) {}
+    ~SpscRing() { free(_data); }
+
+    bool begin(size_t capacity) {
+        _slots = capacity + 1;
+        _data = (T*)malloc(_slots * sizeof(T));
+        return _data != nullptr;
+    }
+
+    size_t capacity() const { return _slots ? _slots - 1 : 0; }
+
+    size_t available() const {
+        size_t head = _head.load(std::memory_order_acquire);
+        size_t tail = _tail.load(std::memory_order_acquire);
+        return head >= tail ? head - tail : _slots - tail + head;
+    }
+
+    size_t space() const { return _slots ? capacity() - available() : 0; }
+
+    size_t write(const T* items, size_t count) {
+        size_t written = 0;
+        while (written < count) {
+            size_t run;
+            T* dst = writePtr(run);
+            if (run == 0) break;
+            run = min(run, count - written);
+            memcpy(dst, items + written, run * sizeof(T));
+            commit(run);
+            written += run;
+        }
+        return written;
+    }
+
+    T* writePtr(size_t& count) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t tail = _tail.load(std::memory_order_acquire);
+        if (head >= tail) {
+            count = _slots - head - (tail == 0 ? 1 : 0);
+        } else {
+            count = tail - head - 1;
+        }
+        return _data + head;
+    }
+
+    void commit(size_t count) {
+        size_t head = _head.load(std::memory_order_relaxed) + count;
+        if (head >= _slots) head -= _slots;
+        _head.store(head, std::memory_order_release);
+    }
+
+    size_t read(T* items, size_t count) {
+        size_t done = 0;
+        while (done < count) {
+            size_t run;
+            const T* src = peek(run);
+            if (run == 0) break;
+            run = min(run, count - done);
+            memcpy(items + done, src, run * sizeof(T));
+            consume(run);
+            done += run;
+        }
+        return done;
+    }
+
+    const T* peek(size_t& count) const {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t head = _head.load(std::memory_order_acquire);
+        count = head >= tail ? head - tail : _slots - tail;
+        return _data + tail;
+    }
+
+    void consume(size_t count) {
+        size_t tail = _tail.load(std::memory_order_relaxed) + count;
+        if (tail >= _slots) tail -= _slots;
+        _tail.store(tail, std::memory_order_release);
+    }
+
+    void clear() {
+        _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    T* _data;
+    size_t _slots;
+    std::atomic<size_t> _head;
+    std::atomic<size_t> _tail;
+};
+
 // ============================================================================
 // Volume Control Tests
 // ============================================================================
@@ -138,6 +401,44 @@ void test_apply_volume_25_percent() {
     }
 }
 
+void test_volume_full_scale_unchanged() {
+    int16_t samples[] = {32767, -32768, 1, -1, 12345};
+    int16_t expected[] = {32767, -32768, 1, -1, 12345};
+
+    applyVolume(samples, 5, 100);
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_INT16(expected[i], samples[i]);
+    }
+}
+
+void test_scale_q15_leaves_source_untouched() {
+    // Playback scales into a scratch chunk, so the TTS buffer can be replayed
+    int16_t source[] = {2000, -2000, 30000};
+    int16_t out[3];
+
+    dspScaleQ15(source, out, 3, dspGainFromPercent(50));
+
+    TEST_ASSERT_EQUAL_INT16(2000, source[0]);
+    TEST_ASSERT_EQUAL_INT16(1000, out[0]);
+    TEST_ASSERT_EQUAL_INT16(-1000, out[1]);
+    TEST_ASSERT_EQUAL_INT16(15000, out[2]);
+}
+
+void test_scale_q15_matches_float_gain() {
+    // Within one LSB of the float multiply it replaced
+    for (int volume = 0; volume <= 100; volume += 7) {
+        int32_t gain = dspGainFromPercent(volume);
+        for (int s = -32768; s <= 32767; s += 251) {
+            int16_t in = (int16_t)s;
+            int16_t out;
+            dspScaleQ15(&in, &out, 1, gain);
+            float expected = s * (volume / 100.0f);
+            TEST_ASSERT_TRUE(fabsf(out - expected) <= 1.0f);
+        }
+    }
+}
+
 void test_constrain_volume_within_range() {
     TEST_ASSERT_EQUAL(50, constrainVolume(50));
     TEST_ASSERT_EQUAL(0, constrainVolume(0));
@@ -334,6 +635,176 @@ void test_buffer_partial_copy() {
     TEST_ASSERT_EQUAL_INT16(0, dest[3]);  // Not copied
 }
 
+// ============================================================================
+// SPSC Ring Tests
+// ============================================================================
+
+void test_ring_starts_empty() {
+    SpscRing<int16_t> ring;
+    TEST_ASSERT_TRUE(ring.begin(16));
+    TEST_ASSERT_EQUAL(16, ring.capacity());
+    TEST_ASSERT_EQUAL(0, ring.available());
+    TEST_ASSERT_EQUAL(16, ring.space());
+}
+
+void test_ring_write_stops_when_full() {
+    SpscRing<int16_t> ring;
+    ring.begin(8);
+    int16_t data[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+
+    TEST_ASSERT_EQUAL(8, ring.write(data, 12));
+    TEST_ASSERT_EQUAL(8, ring.available());
+    TEST_ASSERT_EQUAL(0, ring.space());
+    TEST_ASSERT_EQUAL(0, ring.write(data, 1));
+}
+
+void test_ring_preserves_order_across_wrap() {
+    SpscRing<int16_t> ring;
+    ring.begin(10);
+    int16_t in[7], out[7];
+
+    // Push and pop enough times that the indices wrap repeatedly
+    int16_t next = 0, expected = 0;
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 7; i++) in[i] = next++;
+        TEST_ASSERT_EQUAL(7, ring.write(in, 7));
+        TEST_ASSERT_EQUAL(7, ring.read(out, 7));
+        for (int i = 0; i < 7; i++) {
+            TEST_ASSERT_EQUAL(expected++, out[i]);
+        }
+    }
+    TEST_ASSERT_EQUAL(0, ring.available());
+}
+
+void test_ring_peek_returns_contiguous_runs() {
+    SpscRing<int16_t> ring;
+    ring.begin(8);
+    int16_t data[6] = {1, 2, 3, 4, 5, 6};
+    int16_t out[6];
+
+    ring.write(data, 6);
+    ring.read(out, 6);
+    ring.write(data, 6);  // Wraps: 3 slots at the end, 3 at the start
+
+    size_t run;
+    const int16_t* p = ring.peek(run);
+    TEST_ASSERT_EQUAL(3, run);
+    TEST_ASSERT_EQUAL(1, p[0]);
+    ring.consume(run);
+
+    p = ring.peek(run);
+    TEST_ASSERT_EQUAL(3, run);
+    TEST_ASSERT_EQUAL(4, p[0]);
+}
+
+void test_ring_clear_drops_readable() {
+    SpscRing<int16_t> ring;
+    ring.begin(8);
+    int16_t data[5] = {1, 2, 3, 4, 5};
+
+    ring.write(data, 5);
+    ring.clear();
+    TEST_ASSERT_EQUAL(0, ring.available());
+    TEST_ASSERT_EQUAL(8, ring.space());
+}
+
+// ============================================================================
+// DSP Kernel Tests
+// ============================================================================
+
+void test_dsp_scale_bit_exact() {
+    // Odd lengths exercise the unrolled body and the tail
+    for (size_t count : {0u, 1u, 3u, 4u, 7u, 1024u, 1029u}) {
+        auto in = makeTestSignal(count, count);
+        std::vector<int16_t> expected(count), actual(count);
+        for (int volume : {0, 1, 33, 50, 99, 100}) {
+            referenceScale(in.data(), expected.data(), count, dspGainFromPercent(volume));
+            dspScaleQ15(in.data(), actual.data(), count, dspGainFromPercent(volume));
+            TEST_ASSERT_TRUE(expected == actual);
+        }
+    }
+}
+
+void test_dsp_mean_abs_bit_exact() {
+    for (size_t count : {1u, 5u, 512u, 1023u}) {
+        auto in = makeTestSignal(count, 7 + count);
+        TEST_ASSERT_EQUAL(calculateAverageLevel(in.data(), count), dspMeanAbs(in.data(), count));
+    }
+    TEST_ASSERT_EQUAL(0, dspMeanAbs(nullptr, 0));
+}
+
+void test_dsp_zero_crossings_bit_exact() {
+    for (size_t count : {0u, 1u, 2u, 5u, 512u, 1027u}) {
+        auto in = makeTestSignal(count, 99 + count);
+        TEST_ASSERT_EQUAL(referenceZeroCrossings(in.data(), count), dspZeroCrossings(in.data(), count));
+    }
+
+    int16_t edges[] = {0, -1, 0, 1, -32768, 32767};
+    TEST_ASSERT_EQUAL(referenceZeroCrossings(edges, 6), dspZeroCrossings(edges, 6));
+}
+
+void test_dsp_sum_squares_exact() {
+    // Full-scale samples are the overflow case for 32-bit accumulation
+    std::vector<int16_t> loud(1024, -32768);
+    TEST_ASSERT_TRUE(dspSumSquares(loud.data(), 1024) == 1024ULL * 32768 * 32768);
+
+    auto in = makeTestSignal(777, 3);
+    uint64_t expected = 0;
+    for (int16_t x : in) expected += (int64_t)x * x;
+    TEST_ASSERT_TRUE(dspSumSquares(in.data(), in.size()) == expected);
+}
+
+void test_dsp_rms_matches_reference() {
+    auto in = makeTestSignal(512, 11);
+    float reference = referenceEnergy(in.data(), 512);
+    TEST_ASSERT_FLOAT_WITHIN(reference * 1e-4f, reference, dspRms(in.data(), 512));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, dspRms(in.data(), 0));
+}
+
+void test_dsp_peak() {
+    int16_t samples[] = {100, -2000, 1500, 0};
+    TEST_ASSERT_EQUAL(2000, dspPeak(samples, 4));
+
+    int16_t extreme[] = {5, -32768};
+    TEST_ASSERT_EQUAL(32768, dspPeak(extreme, 2));
+    TEST_ASSERT_EQUAL(0, dspPeak(samples, 0));
+}
+
+void test_dsp_mix_saturates() {
+    int16_t dst[] = {30000, -30000, 100, 0, 5};
+    int16_t src[] = {10000, -10000, 200, -32768, 5};
+
+    dspMixQ15(dst, src, 5, dspGainFromPercent(100));
+
+    TEST_ASSERT_EQUAL_INT16(32767, dst[0]);
+    TEST_ASSERT_EQUAL_INT16(-32768, dst[1]);
+    TEST_ASSERT_EQUAL_INT16(300, dst[2]);
+    TEST_ASSERT_EQUAL_INT16(-32768, dst[3]);
+    TEST_ASSERT_EQUAL_INT16(10, dst[4]);
+}
+
+void test_dsp_resample_lengths_and_endpoints() {
+    std::vector<int16_t> in(240);
+    for (size_t i = 0; i < in.size(); i++) in[i] = (int16_t)(i * 100);
+
+    // 24 kHz -> 16 kHz: two output samples for every three input samples
+    std::vector<int16_t> out(400);
+    size_t n = dspResample(in.data(), in.size(), out.data(), out.size(), 24000, 16000);
+    TEST_ASSERT_EQUAL(160, n);
+    TEST_ASSERT_EQUAL_INT16(0, out[0]);
+    TEST_ASSERT_EQUAL_INT16(150, out[1]);  // Halfway between 100 and 200 on a ramp
+
+    // 8 kHz -> 16 kHz doubles, bounded by outMax
+    n = dspResample(in.data(), in.size(), out.data(), 100, 8000, 16000);
+    TEST_ASSERT_EQUAL(100, n);
+    TEST_ASSERT_EQUAL_INT16(50, out[1]);
+
+    // Same rate is a copy
+    n = dspResample(in.data(), 10, out.data(), out.size(), 16000, 16000);
+    TEST_ASSERT_EQUAL(10, n);
+    TEST_ASSERT_EQUAL_INT16(900, out[9]);
+}
+
 // ============================================================================
 // Test Runner
 // ============================================================================
@@ -349,6 +820,9 @@ int main(int argc, char** argv) {
     RUN_TEST(test_apply_volume_50_percent);
     RUN_TEST(test_apply_volume_0_percent);
     RUN_TEST(test_apply_volume_25_percent);
+    RUN_TEST(test_volume_full_scale_unchanged);
+    RUN_TEST(test_scale_q15_leaves_source_untouched);
+    RUN_TEST(test_scale_q15_matches_float_gain);
     RUN_TEST(test_constrain_volume_within_range);
     RUN_TEST(test_constrain_volume_below_min);
     RUN_TEST(test_constrain_volume_above_max);
@@ -381,5 +855,22 @@ int main(int argc, char** argv) {
     RUN_TEST(test_buffer_copy_preserves_data);
     RUN_TEST(test_buffer_partial_copy);
 
+    // DSP kernel tests
+    RUN_TEST(test_dsp_scale_bit_exact);
+    RUN_TEST(test_dsp_mean_abs_bit_exact);
+    RUN_TEST(test_dsp_zero_crossings_bit_exact);
+    RUN_TEST(test_dsp_sum_squares_exact);
+    RUN_TEST(test_dsp_rms_matches_reference);
+    RUN_TEST(test_dsp_peak);
+    RUN_TEST(test_dsp_mix_saturates);
+    RUN_TEST(test_dsp_resample_lengths_and_endpoints);
+
+    // SPSC ring tests
+    RUN_TEST(test_ring_starts_empty);
+    RUN_TEST(test_ring_write_stops_when_full);
+    RUN_TEST(test_ring_preserves_order_across_wrap);
+    RUN_TEST(test_ring_peek_returns_contiguous_runs);
+    RUN_TEST(test_ring_clear_drops_readable);
+
     return UNITY_END();
 }
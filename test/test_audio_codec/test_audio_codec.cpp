@@ -0,0 +1,474 @@
+/**
+ * Unit tests for the speech audio codec
+ * Tests mu-law encode/decode and the WAV decoder stage from audio_codec.cpp
+ */
+
+#include <unity.h>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// Codec implementation (extracted from audio_codec.h / audio_codec.cpp)
+// ============================================================================
+
+#define MULAW_BIAS  0x84
+#define MULAW_CLIP  32635
+
+#define WAV_FORMAT_PCM    1
+#define WAV_FORMAT_MULAW  7
+#define WAV_CANONICAL_HEADER  44
+
+enum class AudioEncoding {
+    LINEAR16,  // 16-bit PCM, 2 bytes per sample
+    MULAW      // G.711 mu-law, 1 byte per sample (~14-bit dynamic range)
+};
+
+class AudioDecoder {
+public:
+    // Returns the number of samples accepted; fewer than offered stops decoding
+    using PcmSink = std::function<size_t(const int16_t* samples, size_t count)>;
+
+    virtual ~AudioDecoder() {}
+
+    virtual void reset() = 0;
+
+    // Feed encoded bytes; false once the sink has stopped accepting
+    virtual bool write(const uint8_t* data, size_t length) = 0;
+
+    // Deliver any buffered partial block (end of stream)
+    virtual void flush() = 0;
+
+    // Samples the sink accepted since reset()
+    virtual size_t getSamplesDelivered() const = 0;
+};
+
+// WAV container as returned by TTS (LINEAR16 or MULAW inside). Walks the
+// RIFF chunks to "data", so extra chunks (fact, LIST) are skipped. Data
+// without a RIFF header is decoded as the fallback encoding
+class WavDecoder : public AudioDecoder {
+public:
+    WavDecoder(AudioEncoding fallback, PcmSink sink);
+
+    void reset() override;
+    bool write(const uint8_t* data, size_t length) override;
+    void flush() override;
+    size_t getSamplesDelivered() const override { return _samplesDelivered; }
+
+    // Format found in the header (fallback until the header is parsed)
+    AudioEncoding getEncoding() const { return _encoding; }
+    uint32_t getSampleRate() const { return _sampleRate; }
+
+private:
+    static const size_t BLOCK_SAMPLES = 512;
+    static const size_t MAX_HEADER = 256;
+
+    bool parseHeader();
+    void startData(size_t from);
+    bool decodeByte(uint8_t byte);
+    bool pushSample(int16_t sample);
+
+    AudioEncoding _fallback;
+    AudioEncoding _encoding;
+    PcmSink _sink;
+
+    bool _inData;
+    bool _closed;
+    uint8_t _header[MAX_HEADER];
+    size_t _headerLen;
+    uint32_t _sampleRate;
+
+    int16_t _block[BLOCK_SAMPLES];
+    size_t _blockLen;
+    uint8_t _lowByte;       // First byte of a LINEAR16 sample split across writes
+    bool _haveLowByte;
+    size_t _samplesDelivered;
+};
+
+const char* audioEncodingName(AudioEncoding encoding) {
+    return encoding == AudioEncoding::MULAW ? "MULAW" : "LINEAR16";
+}
+
+size_t audioBytesPerSample(AudioEncoding encoding) {
+    return encoding == AudioEncoding::MULAW ? 1 : 2;
+}
+
+uint8_t mulawEncode(int16_t sample) {
+    int sign = (sample >> 8) & 0x80;
+    int magnitude = sign ? -(int)sample : sample;
+    if (magnitude > MULAW_CLIP) magnitude = MULAW_CLIP;
+    magnitude += MULAW_BIAS;
+
+    // Segment = position of the highest set bit above the 4-bit mantissa
+    int exponent = 7;
+    for (int mask = 0x4000; (magnitude & mask) == 0 && exponent > 0; mask >>= 1) {
+        exponent--;
+    }
+    int mantissa = (magnitude >> (exponent + 3)) & 0x0F;
+
+    return ~(sign | (exponent << 4) | mantissa);
+}
+
+int16_t mulawDecode(uint8_t code) {
+    code = ~code;
+    int exponent = (code >> 4) & 0x07;
+    int mantissa = code & 0x0F;
+    int magnitude = (((mantissa << 3) + MULAW_BIAS) << exponent) - MULAW_BIAS;
+    return (code & 0x80) ? -magnitude : magnitude;
+}
+
+void mulawEncodeBlock(const int16_t* samples, size_t count, uint8_t* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = mulawEncode(samples[i]);
+    }
+}
+
+static uint16_t readLE16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t readLE32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+WavDecoder::WavDecoder(AudioEncoding fallback, PcmSink sink)
+    : _fallback(fallback)
+    , _encoding(fallback)
+    , _sink(sink)
+{
+    reset();
+}
+
+void WavDecoder::reset() {
+    _encoding = _fallback;
+    _inData = false;
+    _closed = false;
+    _headerLen = 0;
+    _sampleRate = 0;
+    _blockLen = 0;
+    _lowByte = 0;
+    _haveLowByte = false;
+    _samplesDelivered = 0;
+}
+
+bool WavDecoder::write(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length && !_closed; i++) {
+        if (_inData) {
+            decodeByte(data[i]);
+            continue;
+        }
+
+        // Header bytes are held until the data chunk is found
+        _header[_headerLen++] = data[i];
+        parseHeader();
+    }
+    return !_closed;
+}
+
+bool WavDecoder::parseHeader() {
+    if (_headerLen < 4) return false;
+
+    if (memcmp(_header, "RIFF", 4) != 0) {
+        // Headerless: the held bytes are already audio
+        startData(0);
+        return true;
+    }
+
+    // "RIFF" size "WAVE", then chunks of id + size + body
+    size_t pos = 12;
+    while (pos + 8 <= _headerLen) {
+        const uint8_t* chunk = _header + pos;
+        uint32_t size = readLE32(chunk + 4);
+
+        if (memcmp(chunk, "data", 4) == 0) {
+            startData(pos + 8);
+            return true;
+        }
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && pos + 8 + 16 <= _headerLen) {
+            uint16_t format = readLE16(chunk + 8);
+            _sampleRate = readLE32(chunk + 12);
+            if (format == WAV_FORMAT_MULAW) {
+                _encoding = AudioEncoding::MULAW;
+            } else if (format == WAV_FORMAT_PCM) {
+                _encoding = AudioEncoding::LINEAR16;
+            }
+        }
+
+        pos += 8 + size + (size & 1);  // Chunks are word aligned
+    }
+
+    if (_headerLen == MAX_HEADER) {
+        // No data chunk in sight: assume the canonical 44-byte layout
+        Serial.println("[WAV] Header not recognised, assuming 44 bytes");
+        startData(WAV_CANONICAL_HEADER);
+        return true;
+    }
+
+    return false;
+}
+
+void WavDecoder::startData(size_t from) {
+    _inData = true;
+    for (size_t i = from; i < _headerLen && !_closed; i++) {
+        decodeByte(_header[i]);
+    }
+    _headerLen = 0;
+}
+
+bool WavDecoder::decodeByte(uint8_t byte) {
+    if (_encoding == AudioEncoding::MULAW) {
+        return pushSample(mulawDecode(byte));
+    }
+
+    // LINEAR16 little-endian; a sample may straddle two writes
+    if (!_haveLowByte) {
+        _lowByte = byte;
+        _haveLowByte = true;
+        return true;
+    }
+    _haveLowByte = false;
+    return pushSample((int16_t)(_lowByte | (byte << 8)));
+}
+
+bool WavDecoder::pushSample(int16_t sample) {
+    _block[_blockLen++] = sample;
+    if (_blockLen < BLOCK_SAMPLES) return true;
+
+    size_t accepted = _sink(_block, BLOCK_SAMPLES);
+    _samplesDelivered += accepted;
+    _blockLen = 0;
+    if (accepted < BLOCK_SAMPLES) {
+        _closed = true;
+    }
+    return !_closed;
+}
+
+void WavDecoder::flush() {
+    if (_closed || _blockLen == 0) return;
+
+    _samplesDelivered += _sink(_block, _blockLen);
+    _blockLen = 0;
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static void putLE16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back(v & 0xFF);
+    out.push_back(v >> 8);
+}
+
+static void putLE32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back((v >> (8 * i)) & 0xFF);
+}
+
+static void putTag(std::vector<uint8_t>& out, const char* tag) {
+    out.insert(out.end(), tag, tag + 4);
+}
+
+// WAV as TTS returns it; mu-law replies carry an extra fact chunk
+static std::vector<uint8_t> makeWav(uint16_t format, uint32_t sampleRate,
+                                    const std::vector<uint8_t>& data, bool factChunk) {
+    std::vector<uint8_t> wav;
+    putTag(wav, "RIFF");
+    putLE32(wav, 0);  // Size isn't used by the decoder
+    putTag(wav, "WAVE");
+
+    putTag(wav, "fmt ");
+    putLE32(wav, 18);
+    putLE16(wav, format);
+    putLE16(wav, 1);
+    putLE32(wav, sampleRate);
+    putLE32(wav, sampleRate * (format == WAV_FORMAT_MULAW ? 1 : 2));
+    putLE16(wav, format == WAV_FORMAT_MULAW ? 1 : 2);
+    putLE16(wav, format == WAV_FORMAT_MULAW ? 8 : 16);
+    putLE16(wav, 0);  // cbSize
+
+    if (factChunk) {
+        putTag(wav, "fact");
+        putLE32(wav, 4);
+        putLE32(wav, data.size());
+    }
+
+    putTag(wav, "data");
+    putLE32(wav, data.size());
+    wav.insert(wav.end(), data.begin(), data.end());
+    return wav;
+}
+
+// Feeds the bytes in pieces of writeSize and collects the decoded samples
+static std::vector<int16_t> decodeAll(AudioEncoding fallback, const std::vector<uint8_t>& bytes,
+                                      size_t writeSize, AudioEncoding* found = nullptr,
+                                      uint32_t* sampleRate = nullptr) {
+    std::vector<int16_t> collected;
+    WavDecoder decoder(fallback, [&](const int16_t* pcm, size_t count) {
+        collected.insert(collected.end(), pcm, pcm + count);
+        return count;
+    });
+
+    for (size_t pos = 0; pos < bytes.size(); pos += writeSize) {
+        decoder.write(bytes.data() + pos, min(writeSize, bytes.size() - pos));
+    }
+    decoder.flush();
+
+    if (found) *found = decoder.getEncoding();
+    if (sampleRate) *sampleRate = decoder.getSampleRate();
+    return collected;
+}
+
+// ============================================================================
+// Test Cases
+// ============================================================================
+
+void test_mulaw_known_values() {
+    TEST_ASSERT_EQUAL_HEX8(0xFF, mulawEncode(0));
+    TEST_ASSERT_EQUAL_HEX8(0x80, mulawEncode(32767));
+    TEST_ASSERT_EQUAL_HEX8(0x00, mulawEncode(-32768));
+
+    TEST_ASSERT_EQUAL(0, mulawDecode(0xFF));
+    TEST_ASSERT_EQUAL(32124, mulawDecode(0x80));
+    TEST_ASSERT_EQUAL(-32124, mulawDecode(0x00));
+}
+
+void test_mulaw_round_trip_error() {
+    // Quantization step grows with amplitude: error stays under ~3% + 8
+    for (int s = -32768; s <= 32767; s += 37) {
+        int16_t decoded = mulawDecode(mulawEncode((int16_t)s));
+        int error = abs(decoded - s);
+        int bound = abs(s) / 32 + 8;
+        if (abs(s) > MULAW_CLIP) bound += abs(s) - MULAW_CLIP;
+        TEST_ASSERT_TRUE_MESSAGE(error <= bound, "mu-law round trip outside bound");
+    }
+}
+
+void test_mulaw_decode_is_fixed_point() {
+    // Every code re-encodes to itself (except the negative zero code 0x7F)
+    for (int code = 0; code < 256; code++) {
+        if (code == 0x7F) continue;
+        TEST_ASSERT_EQUAL_HEX8(code, mulawEncode(mulawDecode((uint8_t)code)));
+    }
+}
+
+void test_mulaw_encode_block() {
+    int16_t pcm[4] = { 0, 1000, -1000, 32767 };
+    uint8_t out[4];
+    mulawEncodeBlock(pcm, 4, out);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_HEX8(mulawEncode(pcm[i]), out[i]);
+    }
+}
+
+void test_encoding_names() {
+    TEST_ASSERT_EQUAL_STRING("LINEAR16", audioEncodingName(AudioEncoding::LINEAR16));
+    TEST_ASSERT_EQUAL_STRING("MULAW", audioEncodingName(AudioEncoding::MULAW));
+    TEST_ASSERT_EQUAL(2, audioBytesPerSample(AudioEncoding::LINEAR16));
+    TEST_ASSERT_EQUAL(1, audioBytesPerSample(AudioEncoding::MULAW));
+}
+
+void test_wav_linear16_canonical() {
+    std::vector<uint8_t> data;
+    for (int i = 0; i < 1000; i++) putLE16(data, (uint16_t)(int16_t)(i * 30 - 15000));
+
+    AudioEncoding found;
+    uint32_t rate;
+    auto pcm = decodeAll(AudioEncoding::MULAW, makeWav(WAV_FORMAT_PCM, 24000, data, false), 4096, &found, &rate);
+
+    TEST_ASSERT_EQUAL(1000, pcm.size());
+    TEST_ASSERT_EQUAL(-15000, pcm[0]);
+    TEST_ASSERT_EQUAL(999 * 30 - 15000, pcm[999]);
+    TEST_ASSERT_TRUE(found == AudioEncoding::LINEAR16);
+    TEST_ASSERT_EQUAL(24000, rate);
+}
+
+void test_wav_mulaw_with_fact_chunk() {
+    std::vector<uint8_t> data;
+    for (int i = 0; i < 700; i++) data.push_back(mulawEncode((int16_t)(i * 40)));
+
+    AudioEncoding found;
+    auto pcm = decodeAll(AudioEncoding::LINEAR16, makeWav(WAV_FORMAT_MULAW, 16000, data, true), 4096, &found);
+
+    TEST_ASSERT_EQUAL(700, pcm.size());
+    TEST_ASSERT_EQUAL(mulawDecode(data[0]), pcm[0]);
+    TEST_ASSERT_EQUAL(mulawDecode(data[699]), pcm[699]);
+    TEST_ASSERT_TRUE(found == AudioEncoding::MULAW);
+}
+
+void test_wav_split_writes() {
+    // Base64 quads hand the decoder 1-3 bytes at a time
+    std::vector<uint8_t> data;
+    for (int i = 0; i < 1500; i++) putLE16(data, (uint16_t)(int16_t)(i - 750));
+    auto wav = makeWav(WAV_FORMAT_PCM, 16000, data, true);
+
+    auto whole = decodeAll(AudioEncoding::LINEAR16, wav, wav.size());
+    auto split = decodeAll(AudioEncoding::LINEAR16, wav, 3);
+
+    TEST_ASSERT_EQUAL(1500, split.size());
+    TEST_ASSERT_EQUAL_INT16_ARRAY(whole.data(), split.data(), 1500);
+}
+
+void test_headerless_uses_fallback() {
+    std::vector<uint8_t> data = { 0xFF, 0x80, 0x00, 0xFF, 0xFF };
+    auto pcm = decodeAll(AudioEncoding::MULAW, data, 2);
+
+    TEST_ASSERT_EQUAL(5, pcm.size());
+    TEST_ASSERT_EQUAL(0, pcm[0]);
+    TEST_ASSERT_EQUAL(32124, pcm[1]);
+    TEST_ASSERT_EQUAL(-32124, pcm[2]);
+}
+
+void test_sink_stop_closes_decoder() {
+    std::vector<uint8_t> data(4000, 0xFF);
+    size_t offered = 0;
+
+    WavDecoder decoder(AudioEncoding::MULAW, [&](const int16_t*, size_t count) {
+        offered += count;
+        return offered > 512 ? (size_t)0 : count;  // Stop after the first block
+    });
+
+    bool open = true;
+    for (size_t pos = 0; pos < data.size() && open; pos += 100) {
+        open = decoder.write(data.data() + pos, 100);
+    }
+    decoder.flush();
+
+    TEST_ASSERT_FALSE(open);
+    TEST_ASSERT_EQUAL(512, decoder.getSamplesDelivered());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {
+    // Setup before each test
+}
+
+void tearDown() {
+    // Cleanup after each test
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // mu-law
+    RUN_TEST(test_mulaw_known_values);
+    RUN_TEST(test_mulaw_round_trip_error);
+    RUN_TEST(test_mulaw_decode_is_fixed_point);
+    RUN_TEST(test_mulaw_encode_block);
+    RUN_TEST(test_encoding_names);
+
+    // WAV decoder stage
+    RUN_TEST(test_wav_linear16_canonical);
+    RUN_TEST(test_wav_mulaw_with_fact_chunk);
+    RUN_TEST(test_wav_split_writes);
+    RUN_TEST(test_headerless_uses_fallback);
+    RUN_TEST(test_sink_stop_closes_decoder);
+
+    return UNITY_END();
+}
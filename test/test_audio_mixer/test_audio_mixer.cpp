@@ -0,0 +1,496 @@
+/**
+ * Unit tests for the output mixer
+ * Tests clip queueing, ducking and completion from audio_mixer.cpp
+ */
+
+#include <unity.h>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// AudioMixer (extracted from audio_mixer.h / audio_mixer.cpp)
+// The streaming ring path is left out; critical sections are no-ops and
+// owned clips are counted instead of going back to the arena
+// ============================================================================
+
+#define portENTER_CRITICAL(lock)  ((void)(lock))
+#define portEXIT_CRITICAL(lock)   ((void)(lock))
+
+static int releasedClips = 0;
+
+static void releaseClip(const int16_t* samples) {
+    (void)samples;
+    releasedClips++;
+}
+
+static inline int16_t saturate16(int32_t value) {
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t)value;
+}
+
+static inline int16_t mulQ15(int16_t sample, int32_t gain) {
+    return (int16_t)((sample * gain + 0x4000) >> 15);
+}
+
+static int32_t dspGainFromPercent(int percent) {
+    return (percent * 32768 + 50) / 100;
+}
+
+static void dspMixQ15(int16_t* dst, const int16_t* src, size_t count, int32_t gain) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = saturate16(dst[i] + mulQ15(src[i], gain));
+    }
+}
+
+enum class Voice {
+    SPEECH,
+    NOTIFY,
+    CUE,
+    COUNT
+};
+
+#define UNITY_GAIN  32768
+
+class AudioMixer {
+public:
+    using DoneCallback = std::function<void(Voice voice)>;
+
+    static const size_t QUEUE_LEN = 4;
+    static const size_t MIX_BLOCK = 128;
+
+    AudioMixer() : _masterGain(UNITY_GAIN), _duckGain(UNITY_GAIN), _duckStep(UNITY_GAIN) {
+        for (int i = 0; i < (int)Voice::COUNT; i++) {
+            VoiceState& v = _voices[i];
+            v.head = 0;
+            v.queued = 0;
+            v.position = 0;
+            v.ending = false;
+            v.duck = UNITY_GAIN;
+        }
+    }
+
+    void setDoneCallback(DoneCallback callback) { _doneCallback = callback; }
+    void setMasterGain(int32_t gain) { _masterGain = gain; }
+
+    void setDuck(int32_t gain, int32_t rampStep) {
+        _duckGain = gain;
+        _duckStep = rampStep > 0 ? rampStep : UNITY_GAIN;
+    }
+
+    bool queue(Voice voice, const int16_t* samples, size_t count, bool owned) {
+        VoiceState& v = _voices[(int)voice];
+        bool queued = samples && count > 0 && v.queued < QUEUE_LEN;
+        if (queued) {
+            Clip& clip = v.clips[(v.head + v.queued) % QUEUE_LEN];
+            clip.samples = samples;
+            clip.count = count;
+            clip.owned = owned;
+            v.queued++;
+            v.ending = false;
+        }
+        if (!queued && owned && samples) releaseClip(samples);
+        return queued;
+    }
+
+    void end(Voice voice) { _voices[(int)voice].ending = true; }
+
+    void stop(Voice voice) {
+        VoiceState& v = _voices[(int)voice];
+        for (size_t i = 0; i < v.queued; i++) {
+            const Clip& clip = v.clips[(v.head + i) % QUEUE_LEN];
+            if (clip.owned) releaseClip(clip.samples);
+        }
+        v.head = 0;
+        v.queued = 0;
+        v.position = 0;
+        v.ending = false;
+    }
+
+    bool isActive(Voice voice) const { return _voices[(int)voice].queued > 0; }
+    size_t getQueued(Voice voice) const { return _voices[(int)voice].queued; }
+
+    size_t render(int16_t* out, size_t count) {
+        size_t total = 0;
+        for (int i = 0; i < (int)Voice::COUNT; i++) {
+            total = max(total, available(i, count));
+        }
+
+        if (total > 0) {
+            memset(out, 0, total * sizeof(int16_t));
+
+            for (size_t offset = 0; offset < total; offset += MIX_BLOCK) {
+                size_t block = min(MIX_BLOCK, total - offset);
+
+                for (int i = 0; i < (int)Voice::COUNT; i++) {
+                    VoiceState& v = _voices[i];
+                    if (v.queued == 0) {
+                        v.duck = UNITY_GAIN;
+                        continue;
+                    }
+
+                    int32_t target = ducked(i) ? _duckGain : UNITY_GAIN;
+                    if (v.duck < target) {
+                        v.duck = min(target, v.duck + _duckStep);
+                    } else if (v.duck > target) {
+                        v.duck = max(target, v.duck - _duckStep);
+                    }
+
+                    int32_t gain = (int32_t)(((int64_t)_masterGain * v.duck) >> 15);
+                    mixClips(i, out + offset, block, gain);
+                }
+            }
+        }
+
+        bool done[(int)Voice::COUNT];
+        for (int i = 0; i < (int)Voice::COUNT; i++) {
+            done[i] = checkDone(i);
+        }
+        for (int i = 0; i < (int)Voice::COUNT; i++) {
+            if (done[i] && _doneCallback) _doneCallback((Voice)i);
+        }
+        return total;
+    }
+
+private:
+    struct Clip {
+        const int16_t* samples;
+        size_t count;
+        bool owned;
+    };
+
+    struct VoiceState {
+        Clip clips[QUEUE_LEN];
+        size_t head;
+        size_t queued;
+        size_t position;
+        bool ending;
+        int32_t duck;
+    };
+
+    size_t available(int index, size_t limit) {
+        VoiceState& v = _voices[index];
+        size_t total = 0;
+        for (size_t i = 0; i < v.queued && total < limit; i++) {
+            total += v.clips[(v.head + i) % QUEUE_LEN].count;
+        }
+        if (v.queued > 0) total -= v.position;
+        return min(total, limit);
+    }
+
+    bool ducked(int index) const {
+        for (int i = index + 1; i < (int)Voice::COUNT; i++) {
+            if (_voices[i].queued > 0) return true;
+        }
+        return false;
+    }
+
+    size_t mixClips(int index, int16_t* out, size_t count, int32_t gain) {
+        VoiceState& v = _voices[index];
+        size_t mixed = 0;
+
+        while (mixed < count) {
+            if (v.queued == 0) break;
+            Clip clip = v.clips[v.head];
+            size_t position = v.position;
+
+            size_t n = min(count - mixed, clip.count - position);
+            dspMixQ15(out + mixed, clip.samples + position, n, gain);
+            mixed += n;
+            position += n;
+
+            if (position >= clip.count) {
+                popClip(index);
+            } else {
+                v.position = position;
+            }
+        }
+        return mixed;
+    }
+
+    void popClip(int index) {
+        VoiceState& v = _voices[index];
+        Clip finished = v.clips[v.head];
+        v.head = (v.head + 1) % QUEUE_LEN;
+        v.queued--;
+        v.position = 0;
+        if (finished.owned) releaseClip(finished.samples);
+    }
+
+    bool checkDone(int index) {
+        VoiceState& v = _voices[index];
+        bool done = v.ending && v.queued == 0;
+        if (done) v.ending = false;
+        return done;
+    }
+
+    VoiceState _voices[(int)Voice::COUNT];
+    DoneCallback _doneCallback;
+    int32_t _masterGain;
+    int32_t _duckGain;
+    int32_t _duckStep;
+};
+
+// ============================================================================
+// Test Helpers
+// ============================================================================
+
+static std::vector<int16_t> clip(size_t count, int16_t value) {
+    return std::vector<int16_t>(count, value);
+}
+
+static int doneCount[(int)Voice::COUNT];
+
+static void countDone(AudioMixer& mixer) {
+    memset(doneCount, 0, sizeof(doneCount));
+    mixer.setDoneCallback([](Voice voice) { doneCount[(int)voice]++; });
+}
+
+// ============================================================================
+// Queue Tests
+// ============================================================================
+
+void test_idle_mixer_renders_nothing() {
+    AudioMixer mixer;
+    int16_t out[256];
+    TEST_ASSERT_EQUAL(0, mixer.render(out, 256));
+}
+
+void test_single_clip_plays_at_unity() {
+    AudioMixer mixer;
+    std::vector<int16_t> a = clip(300, 1000);
+    int16_t out[1024];
+
+    mixer.queue(Voice::SPEECH, a.data(), a.size(), false);
+
+    TEST_ASSERT_EQUAL(300, mixer.render(out, 1024));
+    TEST_ASSERT_EQUAL(1000, out[0]);
+    TEST_ASSERT_EQUAL(1000, out[299]);
+    TEST_ASSERT_FALSE(mixer.isActive(Voice::SPEECH));
+}
+
+void test_queued_clips_are_gapless() {
+    AudioMixer mixer;
+    std::vector<int16_t> a = clip(300, 1000), b = clip(500, 2000);
+    int16_t out[1024];
+
+    mixer.queue(Voice::SPEECH, a.data(), a.size(), false);
+    mixer.queue(Voice::SPEECH, b.data(), b.size(), false);
+
+    // The second clip starts on the sample after the first one ends
+    TEST_ASSERT_EQUAL(800, mixer.render(out, 1024));
+    TEST_ASSERT_EQUAL(1000, out[299]);
+    TEST_ASSERT_EQUAL(2000, out[300]);
+    TEST_ASSERT_EQUAL(2000, out[799]);
+}
+
+void test_clip_spans_several_renders() {
+    AudioMixer mixer;
+    std::vector<int16_t> a(2500);
+    for (size_t i = 0; i < a.size(); i++) a[i] = (int16_t)i;
+    int16_t out[1024];
+
+    mixer.queue(Voice::SPEECH, a.data(), a.size(), false);
+
+    TEST_ASSERT_EQUAL(1024, mixer.render(out, 1024));
+    TEST_ASSERT_EQUAL(1024, mixer.render(out, 1024));
+    TEST_ASSERT_EQUAL(1024, out[0]);
+    TEST_ASSERT_EQUAL(452, mixer.render(out, 1024));
+    TEST_ASSERT_EQUAL(2499, out[451]);
+}
+
+void test_full_queue_rejects_and_releases_owned() {
+    AudioMixer mixer;
+    std::vector<int16_t> a = clip(100, 1);
+    releasedClips = 0;
+
+    for (size_t i = 0; i < AudioMixer::QUEUE_LEN; i++) {
+        TEST_ASSERT_TRUE(mixer.queue(Voice::SPEECH, a.data(), a.size(), false));
+    }
+    TEST_ASSERT_FALSE(mixer.queue(Voice::SPEECH, a.data(), a.size(), true));
+    TEST_ASSERT_EQUAL(1, releasedClips);
+    TEST_ASSERT_EQUAL(AudioMixer::QUEUE_LEN, mixer.getQueued(Voice::SPEECH));
+}
+
+void test_stop_drops_clips() {
+    AudioMixer mixer;
+    std::vector<int16_t> a = clip(100, 1);
+    int16_t out[256];
+    releasedClips = 0;
+    countDone(mixer);
+
+    mixer.queue(Voice::SPEECH, a.data(), a.size(), true);
+    mixer.queue(Voice::SPEECH, a.data(), a.size(), false);
+    mixer.end(Voice::SPEECH);
+    mixer.stop(Voice::SPEECH);
+
+    TEST_ASSERT_EQUAL(1, releasedClips);
+    TEST_ASSERT_EQUAL(0, mixer.render(out, 256));
+    TEST_ASSERT_EQUAL(0, doneCount[(int)Voice::SPEECH]);  // Stopped, not finished
+}
+
+// ============================================================================
+// Completion Tests
+// ============================================================================
+
+void test_done_fires_after_end_and_last_clip() {
+    AudioMixer mixer;
+    std::vector<int16_t> a = clip(1500, 1);
+    int16_t out[1024];
+    countDone(mixer);
+
+    mixer.queue(Voice::SPEECH, a.data(), a.size(), false);
+    mixer.end(Voice::SPEECH);
+
+    mixer.render(out, 1024);
+    TEST_ASSERT_EQUAL(0, doneCount[(int)Voice::SPEECH]);
+    mixer.render(out, 1024);
+    TEST_ASSERT_EQUAL(1, doneCount[(int)Voice::SPEECH]);
+    mixer.render(out, 1024);
+    TEST_ASSERT_EQUAL(1, doneCount[(int)Voice::SPEECH]);
+}
+
+void test_no_done_without_end() {
+    AudioMixer mixer;
+    std::vector<int16_t> a = clip(100, 1);
+    int16_t out[256];
+    countDone(mixer);
+
+    // Between sentences the queue runs dry without the reply being over
+    mixer.queue(Voice::SPEECH, a.data(), a.size(), false);
+    mixer.render(out, 256);
+    mixer.render(out, 256);
+    TEST_ASSERT_EQUAL(0, doneCount[(int)Voice::SPEECH]);
+
+    mixer.end(Voice::SPEECH);
+    mixer.render(out, 256);
+    TEST_ASSERT_EQUAL(1, doneCount[(int)Voice::SPEECH]);
+}
+
+void test_queue_after_end_reopens_voice() {
+    AudioMixer mixer;
+    std::vector<int16_t> a = clip(100, 1);
+    int16_t out[256];
+    countDone(mixer);
+
+    mixer.end(Voice::SPEECH);
+    mixer.queue(Voice::SPEECH, a.data(), a.size(), false);
+    mixer.render(out, 256);
+    TEST_ASSERT_EQUAL(0, doneCount[(int)Voice::SPEECH]);
+}
+
+// ============================================================================
+// Gain / Ducking Tests
+// ============================================================================
+
+void test_master_gain_scales_mix() {
+    AudioMixer mixer;
+    std::vector<int16_t> a = clip(128, 10000);
+    int16_t out[256];
+
+    mixer.setMasterGain(dspGainFromPercent(50));
+    mixer.queue(Voice::SPEECH, a.data(), a.size(), false);
+    mixer.render(out, 256);
+    TEST_ASSERT_EQUAL(5000, out[0]);
+}
+
+void test_cue_ducks_speech_with_ramp() {
+    AudioMixer mixer;
+    std::vector<int16_t> speech = clip(2048, 10000);
+    std::vector<int16_t> cue = clip(1024, 0);  // Silent, to read the speech level
+    int16_t out[1024];
+
+    int32_t duck = dspGainFromPercent(40);
+    mixer.setDuck(duck, (UNITY_GAIN - duck) / 4);
+    mixer.queue(Voice::SPEECH, speech.data(), speech.size(), false);
+    mixer.queue(Voice::CUE, cue.data(), cue.size(), false);
+
+    mixer.render(out, 1024);
+
+    // Four blocks down to the duck level, then it stays there
+    TEST_ASSERT_TRUE(out[0] < 10000 && out[0] > 8000);
+    TEST_ASSERT_TRUE(out[1 * 128] < out[0]);
+    TEST_ASSERT_INT_WITHIN(2, 4000, out[3 * 128]);
+    TEST_ASSERT_INT_WITHIN(2, 4000, out[1023]);
+}
+
+void test_duck_releases_after_cue() {
+    AudioMixer mixer;
+    std::vector<int16_t> speech = clip(4096, 10000);
+    std::vector<int16_t> cue = clip(256, 0);
+    int16_t out[1024];
+
+    int32_t duck = dspGainFromPercent(40);
+    mixer.setDuck(duck, (UNITY_GAIN - duck) / 4);
+    mixer.queue(Voice::SPEECH, speech.data(), speech.size(), false);
+    mixer.queue(Voice::CUE, cue.data(), cue.size(), false);
+
+    mixer.render(out, 1024);
+    TEST_ASSERT_EQUAL(10000, out[1023]);  // Ramped back up within the block
+}
+
+void test_cue_over_speech_is_summed() {
+    AudioMixer mixer;
+    std::vector<int16_t> speech = clip(256, 1000);
+    std::vector<int16_t> cue = clip(256, 3000);
+    int16_t out[256];
+
+    mixer.setDuck(dspGainFromPercent(50), UNITY_GAIN);  // No ramp
+    mixer.queue(Voice::SPEECH, speech.data(), speech.size(), false);
+    mixer.queue(Voice::CUE, cue.data(), cue.size(), false);
+
+    mixer.render(out, 256);
+    TEST_ASSERT_EQUAL(3500, out[0]);
+}
+
+void test_mix_saturates() {
+    AudioMixer mixer;
+    std::vector<int16_t> speech = clip(128, 30000);
+    std::vector<int16_t> cue = clip(128, 30000);
+    int16_t out[128];
+
+    mixer.queue(Voice::SPEECH, speech.data(), speech.size(), false);
+    mixer.queue(Voice::CUE, cue.data(), cue.size(), false);
+
+    mixer.render(out, 128);
+    TEST_ASSERT_EQUAL(32767, out[0]);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Queue tests
+    RUN_TEST(test_idle_mixer_renders_nothing);
+    RUN_TEST(test_single_clip_plays_at_unity);
+    RUN_TEST(test_queued_clips_are_gapless);
+    RUN_TEST(test_clip_spans_several_renders);
+    RUN_TEST(test_full_queue_rejects_and_releases_owned);
+    RUN_TEST(test_stop_drops_clips);
+
+    // Completion tests
+    RUN_TEST(test_done_fires_after_end_and_last_clip);
+    RUN_TEST(test_no_done_without_end);
+    RUN_TEST(test_queue_after_end_reopens_voice);
+
+    // Gain / ducking tests
+    RUN_TEST(test_master_gain_scales_mix);
+    RUN_TEST(test_cue_ducks_speech_with_ramp);
+    RUN_TEST(test_duck_releases_after_cue);
+    RUN_TEST(test_cue_over_speech_is_summed);
+    RUN_TEST(test_mix_saturates);
+
+    return UNITY_END();
+}
@@ -0,0 +1,205 @@
+/**
+ * Unit tests for barge-in detection
+ * Tests the echo gate from barge_in.h that tells speech from speaker echo
+ */
+
+#include <unity.h>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// EchoGate (extracted from barge_in.h)
+// ============================================================================
+
+class EchoGate {
+public:
+    EchoGate(float coupling, float margin, float minLevel, int triggerFrames)
+        : _initialCoupling(coupling), _margin(margin), _minLevel(minLevel),
+          _triggerFrames(triggerFrames) { reset(); }
+
+    void reset() {
+        _coupling = _initialCoupling;
+        _noise = 0;
+        _speechFrames = 0;
+        _triggered = false;
+    }
+
+    bool process(float micLevel, float speakerLevel) {
+        if (_triggered) return false;
+
+        float echo = _coupling * speakerLevel;
+        float threshold = max(_minLevel, _noise * 2.0f) + echo * _margin;
+        bool speech = micLevel > threshold;
+
+        if (speech) {
+            if (++_speechFrames >= _triggerFrames) {
+                _triggered = true;
+                return true;
+            }
+            return false;
+        }
+        _speechFrames = 0;
+
+        if (speakerLevel > _minLevel) {
+            float ratio = micLevel / speakerLevel;
+            _coupling += (ratio - _coupling) * (ratio < _coupling ? 0.2f : 0.02f);
+        } else {
+            _noise = _noise <= 0 ? micLevel
+                                 : _noise + (micLevel - _noise) * (micLevel < _noise ? 0.2f : 0.02f);
+        }
+        return false;
+    }
+
+    float getCoupling() const { return _coupling; }
+    float getNoise() const { return _noise; }
+
+private:
+    float _initialCoupling;
+    float _margin;
+    float _minLevel;
+    int _triggerFrames;
+
+    float _coupling;
+    float _noise;
+    int _speechFrames;
+    bool _triggered;
+};
+
+// Defaults from config.h.example
+static EchoGate makeGate() {
+    return EchoGate(0.3f, 3.0f, 400, 3);
+}
+
+// Feeds the same frame n times; returns the frame index that triggered, or -1
+static int feed(EchoGate& gate, int n, float mic, float speaker) {
+    for (int i = 0; i < n; i++) {
+        if (gate.process(mic, speaker)) return i;
+    }
+    return -1;
+}
+
+// ============================================================================
+// Threshold Tests
+// ============================================================================
+
+void test_quiet_room_does_not_trigger() {
+    EchoGate gate = makeGate();
+    TEST_ASSERT_EQUAL(-1, feed(gate, 100, 150, 0));
+}
+
+void test_speech_without_playback_triggers() {
+    EchoGate gate = makeGate();
+    TEST_ASSERT_EQUAL(2, feed(gate, 10, 2000, 0));  // Third frame
+}
+
+void test_echo_alone_does_not_trigger() {
+    EchoGate gate = makeGate();
+    // Mic hears 30% of a loud reply
+    TEST_ASSERT_EQUAL(-1, feed(gate, 200, 3000, 10000));
+}
+
+void test_speech_over_echo_triggers() {
+    EchoGate gate = makeGate();
+    feed(gate, 50, 3000, 10000);
+    // User talks: mic well above the expected echo
+    TEST_ASSERT_EQUAL(2, feed(gate, 10, 14000, 10000));
+}
+
+void test_short_burst_does_not_trigger() {
+    EchoGate gate = makeGate();
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_FALSE(gate.process(3000, 0));
+        TEST_ASSERT_FALSE(gate.process(3000, 0));
+        TEST_ASSERT_FALSE(gate.process(100, 0));  // Gap restarts the run
+    }
+}
+
+// ============================================================================
+// Adaptation Tests
+// ============================================================================
+
+void test_coupling_learns_quieter_echo() {
+    EchoGate gate = makeGate();
+    feed(gate, 50, 1000, 10000);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.1f, gate.getCoupling());
+}
+
+void test_coupling_rises_slowly() {
+    EchoGate gate = makeGate();
+    // Louder echo than assumed, still under the margin
+    gate.process(6000, 10000);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.306f, gate.getCoupling());
+}
+
+void test_learned_coupling_catches_softer_speech() {
+    EchoGate gate = makeGate();
+    // Speech at 1.5x the initial expected echo is not enough...
+    TEST_ASSERT_EQUAL(-1, feed(gate, 10, 4500 + 400, 10000));
+
+    // ...until the gate has learned the speaker is barely heard
+    gate.reset();
+    feed(gate, 50, 500, 10000);
+    TEST_ASSERT_EQUAL(2, feed(gate, 10, 4900, 10000));
+}
+
+void test_noise_floor_raises_threshold() {
+    EchoGate gate = makeGate();
+    feed(gate, 200, 300, 0);
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, 300.0f, gate.getNoise());
+
+    // Noisy room: 500 clears minLevel but not twice the floor
+    TEST_ASSERT_EQUAL(-1, feed(gate, 10, 550, 0));
+}
+
+// ============================================================================
+// Latch Tests
+// ============================================================================
+
+void test_triggers_once_until_reset() {
+    EchoGate gate = makeGate();
+    TEST_ASSERT_EQUAL(2, feed(gate, 10, 5000, 0));
+    TEST_ASSERT_EQUAL(-1, feed(gate, 10, 5000, 0));
+
+    gate.reset();
+    TEST_ASSERT_EQUAL(2, feed(gate, 10, 5000, 0));
+}
+
+void test_reset_restores_coupling() {
+    EchoGate gate = makeGate();
+    feed(gate, 50, 500, 10000);
+    gate.reset();
+    TEST_ASSERT_EQUAL_FLOAT(0.3f, gate.getCoupling());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, gate.getNoise());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Threshold tests
+    RUN_TEST(test_quiet_room_does_not_trigger);
+    RUN_TEST(test_speech_without_playback_triggers);
+    RUN_TEST(test_echo_alone_does_not_trigger);
+    RUN_TEST(test_speech_over_echo_triggers);
+    RUN_TEST(test_short_burst_does_not_trigger);
+
+    // Adaptation tests
+    RUN_TEST(test_coupling_learns_quieter_echo);
+    RUN_TEST(test_coupling_rises_slowly);
+    RUN_TEST(test_learned_coupling_catches_softer_speech);
+    RUN_TEST(test_noise_floor_raises_threshold);
+
+    // Latch tests
+    RUN_TEST(test_triggers_once_until_reset);
+    RUN_TEST(test_reset_restores_coupling);
+
+    return UNITY_END();
+}
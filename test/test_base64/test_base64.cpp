@@ -0,0 +1,499 @@
+/**
+ * Unit tests for the base64 codec
+ * Tests the block, string and incremental encoders and decoders from base64.cpp
+ */
+
+#include <unity.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// Codec implementation (extracted from base64.h / base64.cpp)
+// ============================================================================
+
+// Base64 (RFC 4648, standard alphabet, padded) for the STT upload and the
+// TTS download. Decoding is table driven; whole 4-character groups take a
+// fast path, and anything outside the alphabet (whitespace, line breaks, the
+// backslash of a JSON "\/" escape) is skipped.
+
+// Characters for length bytes, padding included
+constexpr size_t base64EncodedLength(size_t length) {
+    return (length + 2) / 3 * 4;
+}
+
+// Most bytes decoded from length characters (including up to 3 carried over
+// by a Base64Decoder from its previous update)
+constexpr size_t base64DecodedMaxLength(size_t length) {
+    return length / 4 * 3 + 3;
+}
+
+// One block into out (base64EncodedLength(length) chars, not terminated),
+// padded if length % 3 != 0. Returns characters written
+size_t base64EncodeBlock(const uint8_t* data, size_t length, char* out);
+
+// Whole buffer as a String (batch STT request body)
+String base64Encode(const uint8_t* data, size_t length);
+
+// Whole input into out, which holds base64DecodedMaxLength(length) bytes.
+// Stops at the first '='; returns bytes written
+size_t base64Decode(const char* input, size_t length, uint8_t* out);
+
+// Incremental encoder: data arrives in pieces of any size, and a trailing
+// partial 3-byte group is carried into the next update so padding only
+// appears at the end
+class Base64Encoder {
+public:
+    Base64Encoder() { reset(); }
+
+    void reset() { _carryLen = 0; }
+
+    // out holds base64EncodedLength(length); returns characters written
+    size_t update(const uint8_t* data, size_t length, char* out);
+
+    // Carried bytes, padded (at most 4 characters); resets the encoder
+    size_t finish(char* out);
+
+private:
+    uint8_t _carry[3];
+    size_t _carryLen;   // Bytes of an incomplete group (0-2 between calls)
+};
+
+// Incremental decoder: characters arrive in pieces split anywhere, with a
+// partial group carried between updates. Input after padding is ignored
+class Base64Decoder {
+public:
+    Base64Decoder() { reset(); }
+
+    void reset();
+
+    // out holds base64DecodedMaxLength(length); returns bytes written
+    size_t update(const char* input, size_t length, uint8_t* out);
+
+    // Bytes of an unpadded final group (at most 2); resets the decoder
+    size_t finish(uint8_t* out);
+
+    // Padding seen: the encoded data is complete
+    bool isDone() const { return _done; }
+
+private:
+    size_t emitPartial(uint8_t* out);
+
+    uint32_t _bits;     // Characters of the current group, 6 bits each
+    size_t _count;      // Characters in _bits (0-3)
+    bool _done;
+};
+
+#define XX  0x80    // Not in the alphabet: skipped
+#define PD  0xC0    // Padding
+
+static const char ENCODE[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Character -> 6-bit value; XX and PD both have the top bit set, so one OR
+// across a group tells whether it can take the fast path
+static const uint8_t DECODE[256] = {
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, XX, XX, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, PD, XX, XX,
+    XX,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, XX,
+    XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+};
+
+static inline void encodeGroup(uint32_t group, char* out) {
+    out[0] = ENCODE[group >> 18];
+    out[1] = ENCODE[(group >> 12) & 0x3F];
+    out[2] = ENCODE[(group >> 6) & 0x3F];
+    out[3] = ENCODE[group & 0x3F];
+}
+
+size_t base64EncodeBlock(const uint8_t* data, size_t length, char* out) {
+    char* p = out;
+
+    // Two groups per pass: 6 bytes in, 8 characters out
+    while (length >= 6) {
+        encodeGroup((uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2], p);
+        encodeGroup((uint32_t)data[3] << 16 | (uint32_t)data[4] << 8 | data[5], p + 4);
+        data += 6;
+        length -= 6;
+        p += 8;
+    }
+
+    if (length >= 3) {
+        encodeGroup((uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2], p);
+        data += 3;
+        length -= 3;
+        p += 4;
+    }
+
+    if (length > 0) {
+        uint32_t group = (uint32_t)data[0] << 16 | (length > 1 ? (uint32_t)data[1] << 8 : 0);
+        encodeGroup(group, p);
+        p[3] = '=';
+        if (length == 1) p[2] = '=';
+        p += 4;
+    }
+
+    return p - out;
+}
+
+String base64Encode(const uint8_t* data, size_t length) {
+    String encoded;
+    encoded.reserve(base64EncodedLength(length));
+
+    // Appended a piece at a time instead of a character at a time
+    const size_t pieceBytes = 384;
+    char piece[base64EncodedLength(pieceBytes) + 1];
+
+    while (length > 0) {
+        size_t n = min(length, pieceBytes);
+        piece[base64EncodeBlock(data, n, piece)] = '\0';
+        encoded += piece;
+        data += n;
+        length -= n;
+    }
+
+    return encoded;
+}
+
+size_t base64Decode(const char* input, size_t length, uint8_t* out) {
+    Base64Decoder decoder;
+    size_t written = decoder.update(input, length, out);
+    return written + decoder.finish(out + written);
+}
+
+// ---------------------------------------------------------------------------
+// Base64Encoder
+// ---------------------------------------------------------------------------
+
+size_t Base64Encoder::update(const uint8_t* data, size_t length, char* out) {
+    char* p = out;
+
+    // Complete the group carried from the last update
+    if (_carryLen > 0) {
+        while (_carryLen < 3 && length > 0) {
+            _carry[_carryLen++] = *data++;
+            length--;
+        }
+        if (_carryLen < 3) return 0;
+        p += base64EncodeBlock(_carry, 3, p);
+        _carryLen = 0;
+    }
+
+    size_t whole = length - length % 3;
+    p += base64EncodeBlock(data, whole, p);
+
+    _carryLen = length - whole;
+    memcpy(_carry, data + whole, _carryLen);
+    return p - out;
+}
+
+size_t Base64Encoder::finish(char* out) {
+    size_t written = base64EncodeBlock(_carry, _carryLen, out);
+    reset();
+    return written;
+}
+
+// ---------------------------------------------------------------------------
+// Base64Decoder
+// ---------------------------------------------------------------------------
+
+void Base64Decoder::reset() {
+    _bits = 0;
+    _count = 0;
+    _done = false;
+}
+
+size_t Base64Decoder::update(const char* input, size_t length, uint8_t* out) {
+    const uint8_t* in = (const uint8_t*)input;
+    const uint8_t* end = in + length;
+    uint8_t* p = out;
+
+    while (!_done) {
+        // Fast path: whole groups of alphabet characters, 4 in and 3 out
+        if (_count == 0) {
+            while (end - in >= 4) {
+                uint8_t a = DECODE[in[0]], b = DECODE[in[1]], c = DECODE[in[2]], d = DECODE[in[3]];
+                if ((a | b | c | d) & 0x80) break;
+
+                uint32_t group = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | d;
+                p[0] = group >> 16;
+                p[1] = group >> 8;
+                p[2] = group;
+                in += 4;
+                p += 3;
+            }
+        }
+
+        if (in == end) break;
+
+        // Slow path, one character: group split across updates, padding,
+        // or something to skip
+        uint8_t value = DECODE[*in++];
+        if (value == PD) {
+            p += emitPartial(p);
+            _done = true;
+        } else if (!(value & 0x80)) {
+            _bits = _bits << 6 | value;
+            if (++_count == 4) {
+                p[0] = _bits >> 16;
+                p[1] = _bits >> 8;
+                p[2] = _bits;
+                p += 3;
+                _bits = 0;
+                _count = 0;
+            }
+        }
+    }
+
+    return p - out;
+}
+
+size_t Base64Decoder::finish(uint8_t* out) {
+    size_t written = _done ? 0 : emitPartial(out);
+    reset();
+    return written;
+}
+
+size_t Base64Decoder::emitPartial(uint8_t* out) {
+    // 2 characters carry 1 byte, 3 carry 2; a lone character carries none
+    size_t written = 0;
+    if (_count == 2) {
+        out[0] = _bits >> 4;
+        written = 1;
+    } else if (_count == 3) {
+        out[0] = _bits >> 10;
+        out[1] = _bits >> 2;
+        written = 2;
+    }
+    _bits = 0;
+    _count = 0;
+    return written;
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static std::string encodeString(const char* text) {
+    size_t length = strlen(text);
+    std::vector<char> out(base64EncodedLength(length));
+    size_t n = base64EncodeBlock((const uint8_t*)text, length, out.data());
+    return std::string(out.data(), n);
+}
+
+static std::string decodeString(const char* encoded) {
+    size_t length = strlen(encoded);
+    std::vector<uint8_t> out(base64DecodedMaxLength(length));
+    size_t n = base64Decode(encoded, length, out.data());
+    return std::string((const char*)out.data(), n);
+}
+
+static std::vector<uint8_t> pattern(size_t length) {
+    std::vector<uint8_t> data(length);
+    uint32_t state = 0x1234567;
+    for (size_t i = 0; i < length; i++) {
+        state = state * 1103515245 + 12345;
+        data[i] = state >> 16;
+    }
+    return data;
+}
+
+// ============================================================================
+// Encode Tests
+// ============================================================================
+
+void test_encode_rfc4648_vectors() {
+    TEST_ASSERT_EQUAL_STRING("", encodeString("").c_str());
+    TEST_ASSERT_EQUAL_STRING("Zg==", encodeString("f").c_str());
+    TEST_ASSERT_EQUAL_STRING("Zm8=", encodeString("fo").c_str());
+    TEST_ASSERT_EQUAL_STRING("Zm9v", encodeString("foo").c_str());
+    TEST_ASSERT_EQUAL_STRING("Zm9vYg==", encodeString("foob").c_str());
+    TEST_ASSERT_EQUAL_STRING("Zm9vYmE=", encodeString("fooba").c_str());
+    TEST_ASSERT_EQUAL_STRING("Zm9vYmFy", encodeString("foobar").c_str());
+}
+
+void test_encode_all_byte_values() {
+    uint8_t data[3] = {0xFF, 0xFE, 0xFD};
+    char out[4];
+    TEST_ASSERT_EQUAL(4, base64EncodeBlock(data, 3, out));
+    TEST_ASSERT_EQUAL_STRING_LEN("//79", out, 4);
+
+    uint8_t zeros[2] = {0, 0};
+    TEST_ASSERT_EQUAL(4, base64EncodeBlock(zeros, 2, out));
+    TEST_ASSERT_EQUAL_STRING_LEN("AAA=", out, 4);
+}
+
+void test_encode_string_spans_pieces() {
+    // Longer than one 384-byte piece, with a padded tail
+    std::vector<uint8_t> data = pattern(1000);
+    std::vector<char> block(base64EncodedLength(data.size()));
+    size_t n = base64EncodeBlock(data.data(), data.size(), block.data());
+
+    String encoded = base64Encode(data.data(), data.size());
+    TEST_ASSERT_EQUAL(n, encoded.length());
+    TEST_ASSERT_EQUAL_STRING_LEN(block.data(), encoded.c_str(), n);
+}
+
+void test_encoder_pieces_match_one_shot() {
+    std::vector<uint8_t> data = pattern(200);
+    std::vector<char> expected(base64EncodedLength(data.size()));
+    size_t expectedLen = base64EncodeBlock(data.data(), data.size(), expected.data());
+
+    for (size_t piece = 1; piece <= 7; piece++) {
+        Base64Encoder encoder;
+        std::vector<char> out(expectedLen + 8);
+        size_t written = 0;
+        for (size_t offset = 0; offset < data.size(); offset += piece) {
+            size_t n = min(piece, data.size() - offset);
+            written += encoder.update(data.data() + offset, n, out.data() + written);
+        }
+        written += encoder.finish(out.data() + written);
+
+        TEST_ASSERT_EQUAL(expectedLen, written);
+        TEST_ASSERT_EQUAL_STRING_LEN(expected.data(), out.data(), written);
+    }
+}
+
+void test_encoder_pads_only_at_finish() {
+    Base64Encoder encoder;
+    char out[16];
+    size_t n = encoder.update((const uint8_t*)"foob", 4, out);
+    TEST_ASSERT_EQUAL_STRING_LEN("Zm9v", out, n);
+    n = encoder.finish(out);
+    TEST_ASSERT_EQUAL_STRING_LEN("Yg==", out, n);
+
+    // Reset by finish: nothing carried into the next stream
+    TEST_ASSERT_EQUAL(0, encoder.finish(out));
+}
+
+// ============================================================================
+// Decode Tests
+// ============================================================================
+
+void test_decode_rfc4648_vectors() {
+    TEST_ASSERT_EQUAL_STRING("", decodeString("").c_str());
+    TEST_ASSERT_EQUAL_STRING("f", decodeString("Zg==").c_str());
+    TEST_ASSERT_EQUAL_STRING("fo", decodeString("Zm8=").c_str());
+    TEST_ASSERT_EQUAL_STRING("foo", decodeString("Zm9v").c_str());
+    TEST_ASSERT_EQUAL_STRING("foob", decodeString("Zm9vYg==").c_str());
+    TEST_ASSERT_EQUAL_STRING("fooba", decodeString("Zm9vYmE=").c_str());
+    TEST_ASSERT_EQUAL_STRING("foobar", decodeString("Zm9vYmFy").c_str());
+}
+
+void test_decode_skips_whitespace() {
+    TEST_ASSERT_EQUAL_STRING("foobar", decodeString("Zm9v\r\nYmFy\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("foobar", decodeString(" Zm 9v\tYm Fy ").c_str());
+}
+
+void test_decode_json_escaped_slash() {
+    // "\/" in a JSON string is '/'; skipping the backslash decodes it
+    TEST_ASSERT_EQUAL_STRING("\xFF\xFE\xFD", decodeString("\\/\\/79").c_str());
+}
+
+void test_decode_ignores_input_after_padding() {
+    TEST_ASSERT_EQUAL_STRING("f", decodeString("Zg==Zm9v").c_str());
+}
+
+void test_decode_unpadded_tail() {
+    TEST_ASSERT_EQUAL_STRING("foob", decodeString("Zm9vYg").c_str());
+    TEST_ASSERT_EQUAL_STRING("fooba", decodeString("Zm9vYmE").c_str());
+    // A lone trailing character carries no whole byte
+    TEST_ASSERT_EQUAL_STRING("foo", decodeString("Zm9vY").c_str());
+}
+
+void test_roundtrip_all_lengths() {
+    for (size_t length = 0; length <= 64; length++) {
+        std::vector<uint8_t> data = pattern(length);
+        std::vector<char> encoded(base64EncodedLength(length));
+        size_t chars = base64EncodeBlock(data.data(), length, encoded.data());
+        TEST_ASSERT_EQUAL(base64EncodedLength(length), chars);
+
+        std::vector<uint8_t> decoded(base64DecodedMaxLength(chars));
+        size_t bytes = base64Decode(encoded.data(), chars, decoded.data());
+        TEST_ASSERT_EQUAL(length, bytes);
+        if (length > 0) {
+            TEST_ASSERT_EQUAL_MEMORY(data.data(), decoded.data(), length);
+        }
+    }
+}
+
+void test_decoder_split_anywhere() {
+    // Pieces of every size, breaking groups and the padding apart
+    std::vector<uint8_t> data = pattern(301);
+    std::vector<char> encoded(base64EncodedLength(data.size()));
+    size_t chars = base64EncodeBlock(data.data(), data.size(), encoded.data());
+
+    for (size_t piece = 1; piece <= 9; piece++) {
+        Base64Decoder decoder;
+        std::vector<uint8_t> out(data.size() + 8);
+        size_t written = 0;
+        for (size_t offset = 0; offset < chars; offset += piece) {
+            size_t n = min(piece, chars - offset);
+            written += decoder.update(encoded.data() + offset, n, out.data() + written);
+        }
+        TEST_ASSERT_TRUE(decoder.isDone());
+        written += decoder.finish(out.data() + written);
+
+        TEST_ASSERT_EQUAL(data.size(), written);
+        TEST_ASSERT_EQUAL_MEMORY(data.data(), out.data(), written);
+    }
+}
+
+void test_decoder_reset_by_finish() {
+    Base64Decoder decoder;
+    uint8_t out[8];
+    decoder.update("Zg==", 4, out);
+    TEST_ASSERT_TRUE(decoder.isDone());
+    decoder.finish(out);
+
+    TEST_ASSERT_FALSE(decoder.isDone());
+    size_t n = decoder.update("Zm9v", 4, out);
+    TEST_ASSERT_EQUAL(3, n);
+    TEST_ASSERT_EQUAL_STRING_LEN("foo", (const char*)out, 3);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Encoding
+    RUN_TEST(test_encode_rfc4648_vectors);
+    RUN_TEST(test_encode_all_byte_values);
+    RUN_TEST(test_encode_string_spans_pieces);
+    RUN_TEST(test_encoder_pieces_match_one_shot);
+    RUN_TEST(test_encoder_pads_only_at_finish);
+
+    // Decoding
+    RUN_TEST(test_decode_rfc4648_vectors);
+    RUN_TEST(test_decode_skips_whitespace);
+    RUN_TEST(test_decode_json_escaped_slash);
+    RUN_TEST(test_decode_ignores_input_after_padding);
+    RUN_TEST(test_decode_unpadded_tail);
+    RUN_TEST(test_roundtrip_all_lengths);
+    RUN_TEST(test_decoder_split_anywhere);
+    RUN_TEST(test_decoder_reset_by_finish);
+
+    return UNITY_END();
+}
@@ -0,0 +1,444 @@
+/**
+ * Unit tests for the block-based recording buffer
+ * Tests appending across blocks, the length limit, span walks and
+ * giving blocks back from capture_buffer.cpp
+ */
+
+#include <unity.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// CaptureBuffer (extracted from capture_buffer.h / capture_buffer.cpp)
+// Blocks come from malloc instead of heap_caps PSRAM; allocsLeft stands in
+// for running out of memory
+// ============================================================================
+
+static int allocsLeft = -1;     // -1: unlimited
+static int blocksLive = 0;
+
+static int16_t* allocBlock(size_t bytes) {
+    if (allocsLeft == 0) return nullptr;
+    if (allocsLeft > 0) allocsLeft--;
+    blocksLive++;
+    return (int16_t*)malloc(bytes);
+}
+
+static void freeBlock(int16_t* block) {
+    blocksLive--;
+    free(block);
+}
+
+class CaptureBuffer {
+public:
+    static const size_t BLOCK_BYTES = 4096;
+    static const size_t BLOCK_SAMPLES = BLOCK_BYTES / sizeof(int16_t);
+
+    CaptureBuffer()
+        : _blocks(nullptr), _maxBlocks(0), _maxSamples(0), _reserve(0)
+        , _allocated(0), _size(0), _failures(0) {}
+    ~CaptureBuffer() { end(); }
+
+    bool begin(size_t maxSamples, size_t reserveBlocks) {
+        if (_blocks) return true;
+
+        _maxBlocks = (maxSamples + BLOCK_SAMPLES - 1) / BLOCK_SAMPLES;
+        _blocks = (int16_t**)calloc(_maxBlocks, sizeof(int16_t*));
+        if (!_blocks) return false;
+
+        _maxSamples = maxSamples;
+        _reserve = min(reserveBlocks, _maxBlocks);
+        _allocated = 0;
+        _size = 0;
+
+        while (_allocated < _reserve) {
+            if (!addBlock()) {
+                end();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void end() {
+        if (_blocks) {
+            for (size_t i = 0; i < _allocated; i++) {
+                freeBlock(_blocks[i]);
+            }
+            free(_blocks);
+            _blocks = nullptr;
+        }
+        _maxBlocks = 0;
+        _maxSamples = 0;
+        _reserve = 0;
+        _allocated = 0;
+        _size = 0;
+    }
+
+    void clear() {
+        while (_allocated > _reserve) {
+            _allocated--;
+            freeBlock(_blocks[_allocated]);
+            _blocks[_allocated] = nullptr;
+        }
+        _size = 0;
+    }
+
+    size_t append(const int16_t* samples, size_t count) {
+        if (!_blocks) return 0;
+
+        size_t appended = 0;
+        count = min(count, _maxSamples - _size);
+
+        while (appended < count) {
+            size_t block = _size / BLOCK_SAMPLES;
+            if (block >= _allocated && !addBlock()) break;
+
+            size_t within = _size % BLOCK_SAMPLES;
+            size_t n = min(count - appended, BLOCK_SAMPLES - within);
+            memcpy(_blocks[block] + within, samples + appended, n * sizeof(int16_t));
+            _size += n;
+            appended += n;
+        }
+
+        return appended;
+    }
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _maxSamples; }
+    bool isFull() const { return _size >= _maxSamples; }
+
+    const int16_t* span(size_t offset, size_t& count) const {
+        if (offset >= _size) {
+            count = 0;
+            return nullptr;
+        }
+
+        size_t within = offset % BLOCK_SAMPLES;
+        count = min(BLOCK_SAMPLES - within, _size - offset);
+        return _blocks[offset / BLOCK_SAMPLES] + within;
+    }
+
+    size_t read(size_t offset, int16_t* out, size_t count) const {
+        size_t copied = 0;
+
+        while (copied < count) {
+            size_t run;
+            const int16_t* data = span(offset + copied, run);
+            if (run == 0) break;
+
+            run = min(run, count - copied);
+            memcpy(out + copied, data, run * sizeof(int16_t));
+            copied += run;
+        }
+
+        return copied;
+    }
+
+    size_t getBlockCount() const { return _allocated; }
+    uint32_t getAllocFailures() const { return _failures; }
+
+private:
+    bool addBlock() {
+        if (_allocated >= _maxBlocks) return false;
+
+        int16_t* block = allocBlock(BLOCK_BYTES);
+        if (!block) {
+            _failures++;
+            return false;
+        }
+        _blocks[_allocated++] = block;
+        return true;
+    }
+
+    int16_t** _blocks;
+    size_t _maxBlocks;
+    size_t _maxSamples;
+    size_t _reserve;
+    size_t _allocated;
+    size_t _size;
+    uint32_t _failures;
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static const size_t BLOCK = CaptureBuffer::BLOCK_SAMPLES;
+
+// Sample i of a recording (wraps, so any run can be checked)
+static int16_t sampleAt(size_t i) {
+    return (int16_t)(i * 7 - 3000);
+}
+
+static std::vector<int16_t> makeSamples(size_t from, size_t count) {
+    std::vector<int16_t> samples(count);
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = sampleAt(from + i);
+    }
+    return samples;
+}
+
+// Appends count samples in frames of frameSize, as AudioInput does
+static size_t record(CaptureBuffer& capture, size_t count, size_t frameSize) {
+    size_t total = 0;
+    while (total < count) {
+        size_t n = min(frameSize, count - total);
+        std::vector<int16_t> frame = makeSamples(capture.size(), n);
+        size_t appended = capture.append(frame.data(), n);
+        total += appended;
+        if (appended < n) break;
+    }
+    return total;
+}
+
+static bool matchesRecording(const int16_t* samples, size_t from, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i] != sampleAt(from + i)) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Append Tests
+// ============================================================================
+
+void test_begin_allocates_only_reserve() {
+    blocksLive = 0;
+    CaptureBuffer capture;
+    TEST_ASSERT_TRUE(capture.begin(16000 * 30, 4));
+
+    TEST_ASSERT_EQUAL(4, capture.getBlockCount());
+    TEST_ASSERT_EQUAL(4, blocksLive);
+    TEST_ASSERT_EQUAL(0, capture.size());
+    TEST_ASSERT_EQUAL(16000 * 30, capture.capacity());
+}
+
+void test_append_grows_one_block_at_a_time() {
+    CaptureBuffer capture;
+    capture.begin(16000 * 30, 2);
+
+    record(capture, BLOCK * 2, 256);
+    TEST_ASSERT_EQUAL(2, capture.getBlockCount());
+
+    record(capture, 1, 1);
+    TEST_ASSERT_EQUAL(3, capture.getBlockCount());
+
+    record(capture, BLOCK * 2, 512);
+    TEST_ASSERT_EQUAL(5, capture.getBlockCount());
+    TEST_ASSERT_EQUAL(BLOCK * 4 + 1, capture.size());
+}
+
+void test_append_across_block_boundary_keeps_samples() {
+    CaptureBuffer capture;
+    capture.begin(16000 * 10, 1);
+
+    // Frames that don't divide the block size straddle every boundary
+    record(capture, BLOCK * 3 + 100, 300);
+
+    std::vector<int16_t> out(capture.size());
+    TEST_ASSERT_EQUAL(capture.size(), capture.read(0, out.data(), out.size()));
+    TEST_ASSERT_TRUE(matchesRecording(out.data(), 0, out.size()));
+}
+
+void test_append_stops_at_length_limit() {
+    CaptureBuffer capture;
+    const size_t limit = BLOCK * 2 + 500;
+    capture.begin(limit, 0);
+
+    std::vector<int16_t> frame = makeSamples(0, 1000);
+    size_t total = 0;
+    while (total < limit) {
+        total += capture.append(frame.data(), frame.size());
+    }
+
+    TEST_ASSERT_EQUAL(limit, capture.size());
+    TEST_ASSERT_TRUE(capture.isFull());
+    TEST_ASSERT_EQUAL(0, capture.append(frame.data(), frame.size()));
+    TEST_ASSERT_EQUAL(3, capture.getBlockCount());
+}
+
+void test_append_short_when_memory_runs_out() {
+    CaptureBuffer capture;
+    capture.begin(16000 * 30, 1);
+
+    allocsLeft = 1;
+    size_t recorded = record(capture, BLOCK * 5, 512);
+    allocsLeft = -1;
+
+    // The reserve plus the one block that could be had
+    TEST_ASSERT_EQUAL(BLOCK * 2, recorded);
+    TEST_ASSERT_FALSE(capture.isFull());
+    TEST_ASSERT_EQUAL(1, capture.getAllocFailures());
+}
+
+void test_recording_longer_than_ten_seconds() {
+    CaptureBuffer capture;
+    capture.begin(16000 * 30, 16);
+
+    TEST_ASSERT_EQUAL(16000 * 20, record(capture, 16000 * 20, 512));
+    TEST_ASSERT_EQUAL(16000 * 20, capture.size());
+
+    std::vector<int16_t> tail(1000);
+    capture.read(16000 * 20 - 1000, tail.data(), tail.size());
+    TEST_ASSERT_TRUE(matchesRecording(tail.data(), 16000 * 20 - 1000, tail.size()));
+}
+
+// ============================================================================
+// Span Tests
+// ============================================================================
+
+void test_span_ends_at_block_boundary() {
+    CaptureBuffer capture;
+    capture.begin(16000 * 10, 0);
+    record(capture, BLOCK * 2 + 10, 512);
+
+    size_t count;
+    const int16_t* data = capture.span(100, count);
+    TEST_ASSERT_EQUAL(BLOCK - 100, count);
+    TEST_ASSERT_TRUE(matchesRecording(data, 100, count));
+
+    data = capture.span(BLOCK, count);
+    TEST_ASSERT_EQUAL(BLOCK, count);
+    TEST_ASSERT_TRUE(matchesRecording(data, BLOCK, count));
+}
+
+void test_span_stops_at_recorded_end() {
+    CaptureBuffer capture;
+    capture.begin(16000 * 10, 0);
+    record(capture, BLOCK + 10, 512);
+
+    size_t count;
+    capture.span(BLOCK + 4, count);
+    TEST_ASSERT_EQUAL(6, count);
+
+    TEST_ASSERT_NULL(capture.span(BLOCK + 10, count));
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_span_walk_covers_range_once() {
+    CaptureBuffer capture;
+    capture.begin(16000 * 10, 0);
+    record(capture, BLOCK * 4, 512);
+
+    // The walk AudioInput uses to hand trimmed speech to the uploader
+    const size_t from = 1234, to = BLOCK * 3 + 77;
+    size_t pos = from, spans = 0;
+    while (pos < to) {
+        size_t count;
+        const int16_t* data = capture.span(pos, count);
+        count = min(count, to - pos);
+        TEST_ASSERT_TRUE(matchesRecording(data, pos, count));
+        pos += count;
+        spans++;
+    }
+
+    TEST_ASSERT_EQUAL(to, pos);
+    TEST_ASSERT_EQUAL(4, spans);
+}
+
+void test_read_past_end_is_short() {
+    CaptureBuffer capture;
+    capture.begin(16000 * 10, 0);
+    record(capture, 500, 100);
+
+    int16_t out[100];
+    TEST_ASSERT_EQUAL(50, capture.read(450, out, 100));
+    TEST_ASSERT_EQUAL(0, capture.read(600, out, 100));
+}
+
+// ============================================================================
+// Release Tests
+// ============================================================================
+
+void test_clear_keeps_reserve_frees_rest() {
+    blocksLive = 0;
+    CaptureBuffer capture;
+    capture.begin(16000 * 30, 3);
+    record(capture, BLOCK * 10, 512);
+    TEST_ASSERT_EQUAL(10, blocksLive);
+
+    capture.clear();
+
+    TEST_ASSERT_EQUAL(0, capture.size());
+    TEST_ASSERT_EQUAL(3, capture.getBlockCount());
+    TEST_ASSERT_EQUAL(3, blocksLive);
+}
+
+void test_clear_then_record_reuses_reserve() {
+    CaptureBuffer capture;
+    capture.begin(16000 * 30, 4);
+    record(capture, BLOCK * 6, 512);
+    capture.clear();
+
+    int live = blocksLive;
+    record(capture, BLOCK * 3, 512);
+
+    TEST_ASSERT_EQUAL(live, blocksLive);
+    std::vector<int16_t> out(capture.size());
+    capture.read(0, out.data(), out.size());
+    TEST_ASSERT_TRUE(matchesRecording(out.data(), 0, out.size()));
+}
+
+void test_end_frees_every_block() {
+    blocksLive = 0;
+    {
+        CaptureBuffer capture;
+        capture.begin(16000 * 30, 2);
+        record(capture, BLOCK * 7, 512);
+    }
+    TEST_ASSERT_EQUAL(0, blocksLive);
+}
+
+void test_begin_fails_without_reserve_memory() {
+    blocksLive = 0;
+    CaptureBuffer capture;
+
+    allocsLeft = 2;
+    TEST_ASSERT_FALSE(capture.begin(16000 * 30, 4));
+    allocsLeft = -1;
+
+    TEST_ASSERT_EQUAL(0, blocksLive);
+    TEST_ASSERT_EQUAL(0, capture.append(nullptr, 0));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {
+    allocsLeft = -1;
+}
+
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Append tests
+    RUN_TEST(test_begin_allocates_only_reserve);
+    RUN_TEST(test_append_grows_one_block_at_a_time);
+    RUN_TEST(test_append_across_block_boundary_keeps_samples);
+    RUN_TEST(test_append_stops_at_length_limit);
+    RUN_TEST(test_append_short_when_memory_runs_out);
+    RUN_TEST(test_recording_longer_than_ten_seconds);
+
+    // Span tests
+    RUN_TEST(test_span_ends_at_block_boundary);
+    RUN_TEST(test_span_stops_at_recorded_end);
+    RUN_TEST(test_span_walk_covers_range_once);
+    RUN_TEST(test_read_past_end_is_short);
+
+    // Release tests
+    RUN_TEST(test_clear_keeps_reserve_frees_rest);
+    RUN_TEST(test_clear_then_record_reuses_reserve);
+    RUN_TEST(test_end_frees_every_block);
+    RUN_TEST(test_begin_fails_without_reserve_memory);
+
+    return UNITY_END();
+}
@@ -0,0 +1,329 @@
+/**
+ * Unit tests for the serialized conversation history
+ * Tests escaping, message layout and the byte budget from chat_history.cpp
+ */
+
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// ChatHistory (extracted from chat_history.h / chat_history.cpp)
+// The buffer comes from malloc instead of heap_caps PSRAM
+// ============================================================================
+
+class ChatHistory {
+public:
+    static const size_t MAX_TURNS = 32;
+
+    ChatHistory() : _buffer(nullptr), _budget(0), _used(0), _first(0), _count(0) {}
+    ~ChatHistory() { end(); }
+
+    bool begin(size_t budgetBytes) {
+        if (_buffer) return true;
+        budgetBytes = min(budgetBytes, (size_t)UINT16_MAX);
+        _buffer = (char*)malloc(budgetBytes + 1);
+        if (!_buffer) return false;
+        _budget = budgetBytes;
+        clear();
+        return true;
+    }
+
+    void end() {
+        free(_buffer);
+        _buffer = nullptr;
+        _budget = 0;
+        _used = 0;
+        _first = 0;
+        _count = 0;
+    }
+
+    void clear() {
+        _used = 0;
+        _first = 0;
+        _count = 0;
+        if (_buffer) _buffer[0] = '\0';
+    }
+
+    bool add(const String& userMessage, const String& response) {
+        if (!_buffer) return false;
+
+        size_t userBytes = serializeMessage("user", userMessage.c_str(), nullptr);
+        size_t modelBytes = serializeMessage("model", response.c_str(), nullptr);
+        size_t bytes = userBytes + modelBytes + 2;
+        if (bytes > _budget) return false;
+
+        while (_count == MAX_TURNS || _used + bytes > _budget) {
+            dropOldest();
+        }
+
+        char* out = _buffer + _used;
+        out += serializeMessage("user", userMessage.c_str(), out);
+        *out++ = ',';
+        out += serializeMessage("model", response.c_str(), out);
+        *out++ = ',';
+        *out = '\0';
+
+        _turnBytes[(_first + _count) % MAX_TURNS] = bytes;
+        _count++;
+        _used += bytes;
+        return true;
+    }
+
+    const char* data() const { return _buffer; }
+    size_t size() const { return _used; }
+    size_t count() const { return _count; }
+
+    static size_t estimateTokens(size_t bytes) { return (bytes + 3) / 4; }
+
+    static size_t serializeMessage(const char* role, const char* text, char* out) {
+        static const char PREFIX[] = "{\"role\":\"";
+        static const char MIDDLE[] = "\",\"parts\":[{\"text\":\"";
+        static const char SUFFIX[] = "\"}]}";
+
+        size_t length = 0;
+        auto put = [&](const char* s, size_t n) {
+            if (out) memcpy(out + length, s, n);
+            length += n;
+        };
+
+        put(PREFIX, sizeof(PREFIX) - 1);
+        put(role, strlen(role));
+        put(MIDDLE, sizeof(MIDDLE) - 1);
+        length += escape(text, out ? out + length : nullptr);
+        put(SUFFIX, sizeof(SUFFIX) - 1);
+        return length;
+    }
+
+    static size_t escape(const char* text, char* out) {
+        static const char HEX_DIGITS[] = "0123456789abcdef";
+        size_t length = 0;
+
+        for (const char* p = text; *p; p++) {
+            char c = *p;
+            char escaped = 0;
+            switch (c) {
+                case '"':  escaped = '"'; break;
+                case '\\': escaped = '\\'; break;
+                case '\n': escaped = 'n'; break;
+                case '\r': escaped = 'r'; break;
+                case '\t': escaped = 't'; break;
+                default: break;
+            }
+
+            if (escaped) {
+                if (out) {
+                    out[length] = '\\';
+                    out[length + 1] = escaped;
+                }
+                length += 2;
+            } else if ((uint8_t)c < 0x20) {
+                if (out) {
+                    memcpy(out + length, "\\u00", 4);
+                    out[length + 4] = HEX_DIGITS[(uint8_t)c >> 4];
+                    out[length + 5] = HEX_DIGITS[c & 0x0F];
+                }
+                length += 6;
+            } else {
+                if (out) out[length] = c;
+                length++;
+            }
+        }
+        return length;
+    }
+
+private:
+    void dropOldest() {
+        if (_count == 0) return;
+        size_t bytes = _turnBytes[_first];
+        memmove(_buffer, _buffer + bytes, _used - bytes + 1);
+        _used -= bytes;
+        _first = (_first + 1) % MAX_TURNS;
+        _count--;
+    }
+
+    char* _buffer;
+    size_t _budget;
+    size_t _used;
+
+    uint16_t _turnBytes[MAX_TURNS];
+    size_t _first;
+    size_t _count;
+};
+
+static String escaped(const char* text) {
+    char out[256];
+    size_t length = ChatHistory::escape(text, out);
+    out[length] = '\0';
+    return String(out);
+}
+
+// ============================================================================
+// Escaping Tests
+// ============================================================================
+
+void test_escape_plain_text_unchanged() {
+    TEST_ASSERT_EQUAL_STRING("Hello, world!", escaped("Hello, world!").c_str());
+}
+
+void test_escape_quotes_and_backslashes() {
+    TEST_ASSERT_EQUAL_STRING("say \\\"hi\\\" \\\\ bye", escaped("say \"hi\" \\ bye").c_str());
+}
+
+void test_escape_control_characters() {
+    TEST_ASSERT_EQUAL_STRING("a\\nb\\tc\\u0001", escaped("a\nb\tc\x01").c_str());
+}
+
+void test_escape_keeps_utf8() {
+    TEST_ASSERT_EQUAL_STRING("caf\xC3\xA9", escaped("caf\xC3\xA9").c_str());
+}
+
+void test_escape_measure_matches_output() {
+    const char* text = "line\n\"quoted\"\x02";
+    TEST_ASSERT_EQUAL(escaped(text).length(), ChatHistory::escape(text, nullptr));
+}
+
+// ============================================================================
+// Layout Tests
+// ============================================================================
+
+void test_message_layout() {
+    char out[128];
+    size_t length = ChatHistory::serializeMessage("user", "Hi", out);
+    out[length] = '\0';
+    TEST_ASSERT_EQUAL_STRING("{\"role\":\"user\",\"parts\":[{\"text\":\"Hi\"}]}", out);
+}
+
+void test_turn_stored_with_trailing_commas() {
+    ChatHistory history;
+    history.begin(1024);
+    TEST_ASSERT_TRUE(history.add("Hi", "Hello"));
+
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"role\":\"user\",\"parts\":[{\"text\":\"Hi\"}]},"
+        "{\"role\":\"model\",\"parts\":[{\"text\":\"Hello\"}]},",
+        history.data());
+    TEST_ASSERT_EQUAL(strlen(history.data()), history.size());
+}
+
+void test_history_parses_as_contents() {
+    ChatHistory history;
+    history.begin(1024);
+    history.add("What's \"2+2\"?", "Four.\nAnything else?");
+    history.add("No", "Bye");
+
+    // As in a request: history, then the current message, inside [ ]
+    String json = "[";
+    json += history.data();
+    json += "{\"role\":\"user\",\"parts\":[{\"text\":\"Again\"}]}]";
+
+    JsonDocument doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, json.c_str()));
+    TEST_ASSERT_EQUAL(5, doc.size());
+    String role = doc[1]["role"] | "";
+    String answer = doc[1]["parts"][0]["text"] | "";
+    String question = doc[0]["parts"][0]["text"] | "";
+    TEST_ASSERT_EQUAL_STRING("model", role.c_str());
+    TEST_ASSERT_EQUAL_STRING("Four.\nAnything else?", answer.c_str());
+    TEST_ASSERT_EQUAL_STRING("What's \"2+2\"?", question.c_str());
+}
+
+// ============================================================================
+// Budget Tests
+// ============================================================================
+
+void test_budget_drops_oldest_turns() {
+    ChatHistory history;
+    history.begin(300);
+
+    for (int i = 0; i < 10; i++) {
+        String question = "Question " + String(i);
+        TEST_ASSERT_TRUE(history.add(question, "Answer"));
+        TEST_ASSERT_TRUE(history.size() <= 300);
+    }
+
+    // Each turn is ~100 bytes: only the newest fit, oldest first
+    TEST_ASSERT_TRUE(history.count() >= 2 && history.count() <= 3);
+    TEST_ASSERT_NULL(strstr(history.data(), "Question 0"));
+    TEST_ASSERT_NOT_NULL(strstr(history.data(), "Question 9"));
+    TEST_ASSERT_EQUAL(0, strncmp(history.data(), "{\"role\":\"user\"", 14));
+}
+
+void test_turn_limit_drops_oldest() {
+    ChatHistory history;
+    history.begin(16384);
+
+    for (int i = 0; i < (int)ChatHistory::MAX_TURNS + 5; i++) {
+        history.add("q" + String(i), "a");
+    }
+    TEST_ASSERT_EQUAL(ChatHistory::MAX_TURNS, history.count());
+    TEST_ASSERT_NULL(strstr(history.data(), "\"q4\""));
+    TEST_ASSERT_NOT_NULL(strstr(history.data(), "\"q5\""));
+}
+
+void test_oversized_turn_rejected_and_history_kept() {
+    ChatHistory history;
+    history.begin(200);
+    history.add("Hi", "Hello");
+    size_t before = history.size();
+
+    String longText;
+    for (int i = 0; i < 30; i++) longText += "0123456789";
+    TEST_ASSERT_FALSE(history.add(longText, "ok"));
+    TEST_ASSERT_EQUAL(1, history.count());
+    TEST_ASSERT_EQUAL(before, history.size());
+}
+
+void test_clear_empties_history() {
+    ChatHistory history;
+    history.begin(1024);
+    history.add("Hi", "Hello");
+    history.clear();
+
+    TEST_ASSERT_EQUAL(0, history.count());
+    TEST_ASSERT_EQUAL(0, history.size());
+    TEST_ASSERT_EQUAL_STRING("", history.data());
+}
+
+void test_token_estimate() {
+    TEST_ASSERT_EQUAL(0, ChatHistory::estimateTokens(0));
+    TEST_ASSERT_EQUAL(1, ChatHistory::estimateTokens(3));
+    TEST_ASSERT_EQUAL(1536, ChatHistory::estimateTokens(6144));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Escaping tests
+    RUN_TEST(test_escape_plain_text_unchanged);
+    RUN_TEST(test_escape_quotes_and_backslashes);
+    RUN_TEST(test_escape_control_characters);
+    RUN_TEST(test_escape_keeps_utf8);
+    RUN_TEST(test_escape_measure_matches_output);
+
+    // Layout tests
+    RUN_TEST(test_message_layout);
+    RUN_TEST(test_turn_stored_with_trailing_commas);
+    RUN_TEST(test_history_parses_as_contents);
+
+    // Budget tests
+    RUN_TEST(test_budget_drops_oldest_turns);
+    RUN_TEST(test_turn_limit_drops_oldest);
+    RUN_TEST(test_oversized_turn_rejected_and_history_kept);
+    RUN_TEST(test_clear_empties_history);
+    RUN_TEST(test_token_estimate);
+
+    return UNITY_END();
+}
@@ -0,0 +1,411 @@
+/**
+ * Unit tests for the chat view layout cache
+ * Tests line wrapping and the message ring from chat_layout.cpp
+ */
+
+#include <unity.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// ChatLayout (extracted from chat_layout.h / chat_layout.cpp)
+// ============================================================================
+
+// Chat messages with their line breaks worked out once, when the text
+// arrives. The UI font is monospaced, so a line's start and length fully
+// place every glyph and drawing never has to measure text again.
+// Messages live in a ring of fixed slots with a text byte budget: the
+// oldest go when either runs out. Slots keep their String and line
+// capacity, so a long session settles into reusing the same buffers.
+class ChatLayout {
+public:
+    struct Line {
+        uint16_t start;   // Offset into the message text
+        uint16_t length;
+    };
+
+    static const size_t MAX_MESSAGES = 24;
+
+    ChatLayout(int charsPerLine, size_t maxBytes);
+
+    void clear();
+
+    void add(const String& text, uint16_t color);
+
+    // Streamed replies: only the last line of the newest message is re-wrapped
+    void appendToLast(const String& text);
+    void replaceLast(const String& text);
+
+    // Index 0 is the oldest message still held
+    size_t count() const { return _count; }
+    const String& getText(size_t index) const { return slot(index).text; }
+    uint16_t getColor(size_t index) const { return slot(index).color; }
+    const std::vector<Line>& getLines(size_t index) const { return slot(index).lines; }
+
+    size_t getTotalLines() const { return _totalLines; }
+    size_t getBytes() const { return _bytes; }
+
+    // Break text[from..] into lines of at most charsPerLine: at the last
+    // space that fits, at newlines, or mid-word when there is no space
+    static void wrap(const char* text, size_t length, size_t from,
+                     int charsPerLine, std::vector<Line>& lines);
+
+private:
+    struct Message {
+        String text;
+        uint16_t color;
+        std::vector<Line> lines;
+    };
+
+    Message& slot(size_t index) { return _slots[(_first + index) % MAX_MESSAGES]; }
+    const Message& slot(size_t index) const { return _slots[(_first + index) % MAX_MESSAGES]; }
+
+    void relayout(Message& message, size_t fromLine);
+    void dropOldest();
+    void enforceBudget();
+
+    Message _slots[MAX_MESSAGES];
+    size_t _first;
+    size_t _count;
+    size_t _bytes;
+    size_t _totalLines;
+    int _charsPerLine;
+    size_t _maxBytes;
+};
+
+ChatLayout::ChatLayout(int charsPerLine, size_t maxBytes)
+    : _first(0)
+    , _count(0)
+    , _bytes(0)
+    , _totalLines(0)
+    , _charsPerLine(max(charsPerLine, 1))
+    , _maxBytes(maxBytes)
+{
+}
+
+void ChatLayout::clear() {
+    while (_count > 0) {
+        dropOldest();
+    }
+    _first = 0;
+}
+
+void ChatLayout::add(const String& text, uint16_t color) {
+    if (_count == MAX_MESSAGES) {
+        dropOldest();
+    }
+
+    Message& message = slot(_count++);
+    message.text = text;
+    message.color = color;
+    _bytes += text.length();
+    relayout(message, 0);
+    enforceBudget();
+}
+
+void ChatLayout::appendToLast(const String& text) {
+    if (_count == 0) {
+        add(text, 0);
+        return;
+    }
+
+    // Earlier lines were broken with their whole window of text in view,
+    // so appending can only move the last one
+    Message& message = slot(_count - 1);
+    message.text += text;
+    _bytes += text.length();
+    relayout(message, message.lines.empty() ? 0 : message.lines.size() - 1);
+    enforceBudget();
+}
+
+void ChatLayout::replaceLast(const String& text) {
+    if (_count == 0) {
+        add(text, 0);
+        return;
+    }
+
+    Message& message = slot(_count - 1);
+    _bytes -= message.text.length();
+    message.text = text;
+    _bytes += text.length();
+    relayout(message, 0);
+    enforceBudget();
+}
+
+void ChatLayout::relayout(Message& message, size_t fromLine) {
+    size_t from = 0;
+    if (fromLine < message.lines.size()) {
+        from = message.lines[fromLine].start;
+    }
+    _totalLines -= message.lines.size() - min(fromLine, message.lines.size());
+    message.lines.resize(min(fromLine, message.lines.size()));
+
+    size_t before = message.lines.size();
+    wrap(message.text.c_str(), message.text.length(), from, _charsPerLine, message.lines);
+    if (message.lines.empty()) {
+        message.lines.push_back({0, 0});  // Even an empty message takes a line
+    }
+    _totalLines += message.lines.size() - before;
+}
+
+void ChatLayout::dropOldest() {
+    Message& message = slot(0);
+    _bytes -= message.text.length();
+    _totalLines -= message.lines.size();
+    message.text = "";
+    message.lines.clear();
+    _first = (_first + 1) % MAX_MESSAGES;
+    _count--;
+}
+
+void ChatLayout::enforceBudget() {
+    // The newest message always stays, even if it alone is over budget
+    while (_bytes > _maxBytes && _count > 1) {
+        dropOldest();
+    }
+}
+
+void ChatLayout::wrap(const char* text, size_t length, size_t from,
+                      int charsPerLine, std::vector<Line>& lines) {
+    size_t width = charsPerLine;
+    size_t pos = from;
+
+    while (pos < length) {
+        size_t remaining = length - pos;
+
+        // A newline within reach ends the line early
+        size_t scan = min(remaining, width);
+        size_t newline = scan;
+        for (size_t i = 0; i < scan; i++) {
+            if (text[pos + i] == '\n') {
+                newline = i;
+                break;
+            }
+        }
+        if (newline < scan) {
+            lines.push_back({(uint16_t)pos, (uint16_t)newline});
+            pos += newline + 1;
+            continue;
+        }
+
+        if (remaining <= width) {
+            lines.push_back({(uint16_t)pos, (uint16_t)remaining});
+            break;
+        }
+
+        // Last space that fits (the one right after a full line counts);
+        // the space itself is dropped
+        size_t breakAt = 0;
+        for (size_t i = width; i > 0; i--) {
+            if (text[pos + i] == ' ') {
+                breakAt = i;
+                break;
+            }
+        }
+
+        if (breakAt > 0) {
+            lines.push_back({(uint16_t)pos, (uint16_t)breakAt});
+            pos += breakAt + 1;
+        } else {
+            lines.push_back({(uint16_t)pos, (uint16_t)width});
+            pos += width;
+        }
+    }
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static std::vector<std::string> wrapLines(const char* text, int width) {
+    std::vector<ChatLayout::Line> lines;
+    ChatLayout::wrap(text, strlen(text), 0, width, lines);
+
+    std::vector<std::string> out;
+    for (const ChatLayout::Line& line : lines) {
+        out.push_back(std::string(text + line.start, line.length));
+    }
+    return out;
+}
+
+static std::string lineText(const ChatLayout& chat, size_t index, size_t line) {
+    const ChatLayout::Line& l = chat.getLines(index)[line];
+    return std::string(chat.getText(index).c_str() + l.start, l.length);
+}
+
+// ============================================================================
+// Wrapping Tests
+// ============================================================================
+
+void test_wrap_short_text_is_one_line() {
+    std::vector<std::string> lines = wrapLines("Hello there", 26);
+    TEST_ASSERT_EQUAL(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("Hello there", lines[0].c_str());
+}
+
+void test_wrap_breaks_at_last_space() {
+    std::vector<std::string> lines = wrapLines("the quick brown fox jumps", 10);
+    TEST_ASSERT_EQUAL(3, lines.size());
+    TEST_ASSERT_EQUAL_STRING("the quick", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("brown fox", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("jumps", lines[2].c_str());
+}
+
+void test_wrap_space_right_after_full_line() {
+    std::vector<std::string> lines = wrapLines("abcde fghij", 5);
+    TEST_ASSERT_EQUAL(2, lines.size());
+    TEST_ASSERT_EQUAL_STRING("abcde", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("fghij", lines[1].c_str());
+}
+
+void test_wrap_long_word_keeps_every_character() {
+    std::vector<std::string> lines = wrapLines("abcdefghijkl", 5);
+    TEST_ASSERT_EQUAL(3, lines.size());
+    TEST_ASSERT_EQUAL_STRING("abcde", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("fghij", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("kl", lines[2].c_str());
+}
+
+void test_wrap_newlines_end_lines() {
+    std::vector<std::string> lines = wrapLines("one\ntwo\n\nthree", 26);
+    TEST_ASSERT_EQUAL(4, lines.size());
+    TEST_ASSERT_EQUAL_STRING("one", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("two", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("", lines[2].c_str());
+    TEST_ASSERT_EQUAL_STRING("three", lines[3].c_str());
+}
+
+// ============================================================================
+// Message Ring Tests
+// ============================================================================
+
+void test_add_lays_out_once() {
+    ChatLayout chat(10, 1024);
+    chat.add("You: the quick brown fox", 1);
+
+    TEST_ASSERT_EQUAL(1, chat.count());
+    TEST_ASSERT_EQUAL(3, chat.getLines(0).size());
+    TEST_ASSERT_EQUAL(3, chat.getTotalLines());
+    TEST_ASSERT_EQUAL(1, chat.getColor(0));
+}
+
+void test_append_matches_full_layout() {
+    // Streaming word by word ends with the same breaks as laying out at once
+    const char* words[] = {"AI: ", "Sure, ", "here ", "is ", "a ", "longer ", "answer ",
+                           "that ", "wraps ", "several ", "times ", "on ", "screen."};
+    ChatLayout streamed(12, 4096);
+    ChatLayout whole(12, 4096);
+
+    String full;
+    streamed.add(words[0], 2);
+    full += words[0];
+    for (size_t i = 1; i < sizeof(words) / sizeof(words[0]); i++) {
+        streamed.appendToLast(words[i]);
+        full += words[i];
+    }
+    whole.add(full, 2);
+
+    TEST_ASSERT_EQUAL(whole.getLines(0).size(), streamed.getLines(0).size());
+    TEST_ASSERT_EQUAL(whole.getTotalLines(), streamed.getTotalLines());
+    for (size_t l = 0; l < whole.getLines(0).size(); l++) {
+        TEST_ASSERT_EQUAL_STRING(lineText(whole, 0, l).c_str(), lineText(streamed, 0, l).c_str());
+    }
+}
+
+void test_replace_last_relayouts() {
+    ChatLayout chat(10, 1024);
+    chat.add("AI: partial", 2);
+    chat.replaceLast("AI: the final and much longer text");
+
+    TEST_ASSERT_EQUAL_STRING("AI: the final and much longer text", chat.getText(0).c_str());
+    TEST_ASSERT_EQUAL(chat.getLines(0).size(), chat.getTotalLines());
+    TEST_ASSERT_EQUAL(34, chat.getBytes());
+}
+
+void test_ring_drops_oldest_when_slots_run_out() {
+    ChatLayout chat(26, 65536);
+    for (size_t i = 0; i < ChatLayout::MAX_MESSAGES + 3; i++) {
+        chat.add(String((int)i), 1);
+    }
+
+    TEST_ASSERT_EQUAL(ChatLayout::MAX_MESSAGES, chat.count());
+    TEST_ASSERT_EQUAL_STRING("3", chat.getText(0).c_str());
+    TEST_ASSERT_EQUAL(ChatLayout::MAX_MESSAGES, chat.getTotalLines());
+}
+
+void test_byte_budget_drops_oldest() {
+    ChatLayout chat(26, 20);
+    chat.add("0123456789", 1);
+    chat.add("abcdefghij", 1);
+    TEST_ASSERT_EQUAL(2, chat.count());
+
+    chat.add("ABCDE", 1);
+    TEST_ASSERT_EQUAL(2, chat.count());
+    TEST_ASSERT_EQUAL_STRING("abcdefghij", chat.getText(0).c_str());
+    TEST_ASSERT_EQUAL(15, chat.getBytes());
+}
+
+void test_newest_message_survives_budget() {
+    ChatLayout chat(26, 8);
+    chat.add("short", 1);
+    chat.add("a message longer than the whole budget", 2);
+
+    TEST_ASSERT_EQUAL(1, chat.count());
+    TEST_ASSERT_EQUAL(2, chat.getColor(0));
+}
+
+void test_clear_resets_counters() {
+    ChatLayout chat(10, 1024);
+    chat.add("You: hello there friend", 1);
+    chat.add("AI: hi", 2);
+    chat.clear();
+
+    TEST_ASSERT_EQUAL(0, chat.count());
+    TEST_ASSERT_EQUAL(0, chat.getTotalLines());
+    TEST_ASSERT_EQUAL(0, chat.getBytes());
+}
+
+void test_empty_message_takes_a_line() {
+    ChatLayout chat(10, 1024);
+    chat.add("", 1);
+    TEST_ASSERT_EQUAL(1, chat.getLines(0).size());
+
+    chat.appendToLast("text");
+    TEST_ASSERT_EQUAL(1, chat.getLines(0).size());
+    TEST_ASSERT_EQUAL_STRING("text", lineText(chat, 0, 0).c_str());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Wrapping tests
+    RUN_TEST(test_wrap_short_text_is_one_line);
+    RUN_TEST(test_wrap_breaks_at_last_space);
+    RUN_TEST(test_wrap_space_right_after_full_line);
+    RUN_TEST(test_wrap_long_word_keeps_every_character);
+    RUN_TEST(test_wrap_newlines_end_lines);
+
+    // Message ring tests
+    RUN_TEST(test_add_lays_out_once);
+    RUN_TEST(test_append_matches_full_layout);
+    RUN_TEST(test_replace_last_relayouts);
+    RUN_TEST(test_ring_drops_oldest_when_slots_run_out);
+    RUN_TEST(test_byte_budget_drops_oldest);
+    RUN_TEST(test_newest_message_survives_budget);
+    RUN_TEST(test_clear_resets_counters);
+    RUN_TEST(test_empty_message_takes_a_line);
+
+    return UNITY_END();
+}
@@ -55,6 +55,43 @@ String extractFinishReason(const String& response) {
     return "";
 }
 
+// Text fragment of one streamGenerateContent SSE event (filter omitted)
+String parseStreamEvent(const char* data) {
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, data);
+
+    if (error) return "";
+    if (doc["error"].is<JsonObject>()) return "";
+
+    JsonObject candidate = doc["candidates"][0];
+    return candidate["content"]["parts"][0]["text"] | "";
+}
+
+// SSE line splitter from GeminiClient::chatStream; input arrives in
+// readSize pieces to exercise events split across socket reads
+String collectStreamText(const String& stream, size_t readSize) {
+    String response;
+    String line;
+
+    for (size_t pos = 0; pos < stream.length(); pos += readSize) {
+        String piece = stream.substring(pos, pos + readSize);
+        for (size_t i = 0; i < piece.length(); i++) {
+            char c = piece[i];
+            if (c == '\r') continue;
+            if (c != '\n') {
+                line += c;
+                continue;
+            }
+
+            if (line.startsWith("data:")) {
+                response += parseStreamEvent(line.c_str() + 5);
+            }
+            line = "";
+        }
+    }
+    return response;
+}
+
 // ============================================================================
 // Test Cases
 // ============================================================================
@@ -249,6 +286,55 @@ void test_parse_long_response() {
     TEST_ASSERT_TRUE(result.indexOf("sentence number 99") >= 0);
 }
 
+void test_stream_event_text() {
+    String text = parseStreamEvent(R"( {"candidates": [{"content": {"parts": [{"text": "Hello"}], "role": "model"}}]})");
+    TEST_ASSERT_EQUAL_STRING("Hello", text.c_str());
+}
+
+void test_stream_event_without_text() {
+    // Final events may only carry finishReason and usage
+    String text = parseStreamEvent(R"({"candidates": [{"finishReason": "STOP"}], "usageMetadata": {}})");
+    TEST_ASSERT_EQUAL_STRING("", text.c_str());
+}
+
+void test_stream_concatenates_events() {
+    String stream =
+        "data: {\"candidates\": [{\"content\": {\"parts\": [{\"text\": \"The sky \"}]}}]}\r\n\r\n"
+        "data: {\"candidates\": [{\"content\": {\"parts\": [{\"text\": \"is blue.\"}]}}]}\r\n\r\n";
+
+    String text = collectStreamText(stream, 512);
+    TEST_ASSERT_EQUAL_STRING("The sky is blue.", text.c_str());
+}
+
+void test_stream_events_split_across_reads() {
+    String stream =
+        "data: {\"candidates\": [{\"content\": {\"parts\": [{\"text\": \"Split \"}]}}]}\n\n"
+        "data: {\"candidates\": [{\"content\": {\"parts\": [{\"text\": \"fine\"}]}}]}\n\n";
+
+    String text = collectStreamText(stream, 7);
+    TEST_ASSERT_EQUAL_STRING("Split fine", text.c_str());
+}
+
+void test_stream_ignores_non_data_lines() {
+    String stream =
+        ": keep-alive\n"
+        "event: message\n"
+        "data: {\"candidates\": [{\"content\": {\"parts\": [{\"text\": \"Only this\"}]}}]}\n\n";
+
+    String text = collectStreamText(stream, 16);
+    TEST_ASSERT_EQUAL_STRING("Only this", text.c_str());
+}
+
+void test_stream_incomplete_last_line_dropped() {
+    // A line without its newline is not an event yet
+    String stream =
+        "data: {\"candidates\": [{\"content\": {\"parts\": [{\"text\": \"Done\"}]}}]}\n\n"
+        "data: {\"candidates\": [{\"content\":";
+
+    String text = collectStreamText(stream, 64);
+    TEST_ASSERT_EQUAL_STRING("Done", text.c_str());
+}
+
 // ============================================================================
 // Test Runner
 // ============================================================================
@@ -288,5 +374,13 @@ int main(int argc, char** argv) {
     RUN_TEST(test_extract_finish_reason_max_tokens);
     RUN_TEST(test_extract_finish_reason_safety);
 
+    // Streaming (SSE) tests
+    RUN_TEST(test_stream_event_text);
+    RUN_TEST(test_stream_event_without_text);
+    RUN_TEST(test_stream_concatenates_events);
+    RUN_TEST(test_stream_events_split_across_reads);
+    RUN_TEST(test_stream_ignores_non_data_lines);
+    RUN_TEST(test_stream_incomplete_last_line_dropped);
+
     return UNITY_END();
 }
@@ -0,0 +1,401 @@
+/**
+ * Unit tests for the local intent matcher
+ * Tests volume, stop and status phrases, filler words, levels and that
+ * ordinary questions are left for Gemini, from intent_matcher.cpp
+ */
+
+#include <unity.h>
+#include <cctype>
+#include <cstring>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// Intent matcher (extracted from intent_matcher.h / intent_matcher.cpp)
+// ============================================================================
+
+enum class Intent {
+    NONE,
+    VOLUME_UP,
+    VOLUME_DOWN,
+    VOLUME_SET,     // value: 0-100 (mute is 0)
+    STOP,
+    STATUS          // IP address, signal and volume
+};
+
+struct IntentMatch {
+    Intent intent;
+    int value;
+};
+
+// A command is a short phrase from a fixed grammar: the transcript is
+// lowercased, punctuation dropped and filler words ("please", "the", "can
+// you") skipped, and what is left has to be one of the phrases exactly.
+// Everything else goes to Gemini, so "what is the volume of a sphere"
+// ("volume of sphere") is never taken for a command. More than
+// INTENT_MAX_WORDS words left is never a command.
+#define INTENT_MAX_WORDS   8
+
+#define INTENT_MAX_CHARS  96    // Longer transcripts are never commands
+
+struct IntentRule {
+    const char* phrase;     // Words left after the fillers; "#" is a level 0-100
+    Intent intent;
+    int value;
+};
+
+static const IntentRule RULES[] = {
+    { "volume up",          Intent::VOLUME_UP,   0 },
+    { "turn up",            Intent::VOLUME_UP,   0 },
+    { "turn up volume",     Intent::VOLUME_UP,   0 },
+    { "turn volume up",     Intent::VOLUME_UP,   0 },
+    { "louder",             Intent::VOLUME_UP,   0 },
+    { "increase volume",    Intent::VOLUME_UP,   0 },
+    { "raise volume",       Intent::VOLUME_UP,   0 },
+
+    { "volume down",        Intent::VOLUME_DOWN, 0 },
+    { "turn down",          Intent::VOLUME_DOWN, 0 },
+    { "turn down volume",   Intent::VOLUME_DOWN, 0 },
+    { "turn volume down",   Intent::VOLUME_DOWN, 0 },
+    { "quieter",            Intent::VOLUME_DOWN, 0 },
+    { "softer",             Intent::VOLUME_DOWN, 0 },
+    { "decrease volume",    Intent::VOLUME_DOWN, 0 },
+    { "lower volume",       Intent::VOLUME_DOWN, 0 },
+
+    { "volume #",           Intent::VOLUME_SET,  0 },
+    { "mute",               Intent::VOLUME_SET,  0 },
+    { "volume off",         Intent::VOLUME_SET,  0 },
+    { "max volume",         Intent::VOLUME_SET,  100 },
+    { "volume max",         Intent::VOLUME_SET,  100 },
+    { "full volume",        Intent::VOLUME_SET,  100 },
+    { "maximum volume",     Intent::VOLUME_SET,  100 },
+
+    { "stop",               Intent::STOP,        0 },
+    { "stop talking",       Intent::STOP,        0 },
+    { "cancel",             Intent::STOP,        0 },
+    { "never mind",         Intent::STOP,        0 },
+    { "nevermind",          Intent::STOP,        0 },
+    { "shut up",            Intent::STOP,        0 },
+    { "be quiet",           Intent::STOP,        0 },
+    { "forget",             Intent::STOP,        0 },
+
+    { "status",             Intent::STATUS,      0 },
+    { "device status",      Intent::STATUS,      0 },
+    { "wifi status",        Intent::STATUS,      0 },
+    { "network status",     Intent::STATUS,      0 },
+    { "signal strength",    Intent::STATUS,      0 },
+    { "ip",                 Intent::STATUS,      0 },
+    { "ip address",         Intent::STATUS,      0 },
+    { "volume",             Intent::STATUS,      0 },
+};
+
+// Politeness and glue that never changes what a command means
+static const char* const FILLERS[] = {
+    "a", "at", "bit", "can", "could", "hey", "is", "it", "level", "little",
+    "make", "me", "my", "now", "ok", "okay", "percent", "please", "set",
+    "tell", "thanks", "the", "to", "what", "whats", "would", "you", "your",
+};
+
+struct NumberWord {
+    const char* word;
+    int value;
+};
+
+// Speech-to-Text writes most levels as digits; round ones sometimes as words
+static const NumberWord NUMBER_WORDS[] = {
+    { "zero", 0 }, { "ten", 10 }, { "twenty", 20 }, { "thirty", 30 },
+    { "forty", 40 }, { "fifty", 50 }, { "sixty", 60 }, { "seventy", 70 },
+    { "eighty", 80 }, { "ninety", 90 }, { "hundred", 100 },
+};
+
+static bool isFiller(const char* word) {
+    for (const char* filler : FILLERS) {
+        if (strcmp(word, filler) == 0) return true;
+    }
+    return false;
+}
+
+// Volume level 0-100 as digits or a number word; -1 otherwise
+static int parseLevel(const char* word) {
+    if (isdigit((unsigned char)*word)) {
+        int value = 0;
+        for (const char* p = word; *p; p++) {
+            if (!isdigit((unsigned char)*p) || value > 100) return -1;
+            value = value * 10 + (*p - '0');
+        }
+        return value <= 100 ? value : -1;
+    }
+
+    for (const NumberWord& number : NUMBER_WORDS) {
+        if (strcmp(word, number.word) == 0) return number.value;
+    }
+    return -1;
+}
+
+// Lowercase words separated by single spaces: apostrophes join ("what's"
+// -> "whats"), "%" becomes a word, other punctuation splits. False if it
+// doesn't fit
+static bool normalize(const char* text, char* out, size_t size) {
+    size_t length = 0;
+
+    for (const char* p = text; *p; p++) {
+        unsigned char c = *p;
+        const char* piece;
+        char letter[2] = { 0, 0 };
+
+        if (c == '\'') {
+            continue;
+        } else if (c == 0xE2 && (uint8_t)p[1] == 0x80 && (uint8_t)p[2] == 0x99) {
+            p += 2;     // Typographic apostrophe (U+2019)
+            continue;
+        } else if (c == '%') {
+            piece = " percent ";
+        } else if (isalnum(c) || c >= 0x80) {
+            letter[0] = tolower(c);
+            piece = letter;
+        } else {
+            piece = " ";
+        }
+
+        for (; *piece; piece++) {
+            // Collapse runs of spaces, none at the start
+            if (*piece == ' ' && (length == 0 || out[length - 1] == ' ')) continue;
+            if (length + 1 >= size) return false;
+            out[length++] = *piece;
+        }
+    }
+
+    out[length] = '\0';
+    return true;
+}
+
+static bool matchRule(const IntentRule& rule, char* const* words, size_t count, int& value) {
+    const char* phrase = rule.phrase;
+    value = rule.value;
+
+    for (size_t i = 0; i < count; i++) {
+        const char* end = strchr(phrase, ' ');
+        size_t length = end ? (size_t)(end - phrase) : strlen(phrase);
+        if (length == 0) return false;
+
+        if (length == 1 && *phrase == '#') {
+            value = parseLevel(words[i]);
+            if (value < 0) return false;
+        } else if (strlen(words[i]) != length || strncmp(words[i], phrase, length) != 0) {
+            return false;
+        }
+
+        phrase += length;
+        if (*phrase == ' ') phrase++;
+    }
+
+    // Every phrase word used up
+    return *phrase == '\0';
+}
+
+bool matchIntent(const String& transcript, IntentMatch& match) {
+    match.intent = Intent::NONE;
+    match.value = 0;
+
+    char text[INTENT_MAX_CHARS + 1];
+    if (!normalize(transcript.c_str(), text, sizeof(text))) return false;
+
+    char* words[INTENT_MAX_WORDS];
+    size_t count = 0;
+
+    // Split in place; normalize() left single spaces
+    char* next = text;
+    while (*next) {
+        char* word = next;
+        char* space = strchr(next, ' ');
+        if (space) {
+            *space = '\0';
+            next = space + 1;
+        } else {
+            next += strlen(next);
+        }
+
+        if (isFiller(word)) continue;
+        if (count == INTENT_MAX_WORDS) return false;
+        words[count++] = word;
+    }
+    if (count == 0) return false;
+
+    for (const IntentRule& rule : RULES) {
+        int value;
+        if (matchRule(rule, words, count, value)) {
+            match.intent = rule.intent;
+            match.value = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* intentName(Intent intent) {
+    switch (intent) {
+        case Intent::VOLUME_UP:   return "volume up";
+        case Intent::VOLUME_DOWN: return "volume down";
+        case Intent::VOLUME_SET:  return "volume set";
+        case Intent::STOP:        return "stop";
+        case Intent::STATUS:      return "status";
+        default:                  return "none";
+    }
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static Intent intentOf(const char* text) {
+    IntentMatch match;
+    return matchIntent(String(text), match) ? match.intent : Intent::NONE;
+}
+
+static int levelOf(const char* text) {
+    IntentMatch match;
+    if (!matchIntent(String(text), match) || match.intent != Intent::VOLUME_SET) return -1;
+    return match.value;
+}
+
+#define ASSERT_INTENT(expected, text) \
+    TEST_ASSERT_EQUAL_STRING(intentName(expected), intentName(intentOf(text)))
+
+// ============================================================================
+// Volume Tests
+// ============================================================================
+
+void test_volume_up_phrases() {
+    ASSERT_INTENT(Intent::VOLUME_UP, "Volume up");
+    ASSERT_INTENT(Intent::VOLUME_UP, "Turn up the volume.");
+    ASSERT_INTENT(Intent::VOLUME_UP, "Can you turn the volume up, please?");
+    ASSERT_INTENT(Intent::VOLUME_UP, "Louder!");
+    ASSERT_INTENT(Intent::VOLUME_UP, "make it a little louder");
+}
+
+void test_volume_down_phrases() {
+    ASSERT_INTENT(Intent::VOLUME_DOWN, "Volume down");
+    ASSERT_INTENT(Intent::VOLUME_DOWN, "Turn it down.");
+    ASSERT_INTENT(Intent::VOLUME_DOWN, "A bit quieter please");
+    ASSERT_INTENT(Intent::VOLUME_DOWN, "Lower the volume");
+}
+
+void test_volume_set_digits() {
+    TEST_ASSERT_EQUAL(40, levelOf("Set the volume to 40"));
+    TEST_ASSERT_EQUAL(40, levelOf("Volume 40%"));
+    TEST_ASSERT_EQUAL(75, levelOf("volume at 75 percent"));
+    TEST_ASSERT_EQUAL(100, levelOf("Volume 100."));
+    TEST_ASSERT_EQUAL(0, levelOf("volume 0"));
+}
+
+void test_volume_set_number_words() {
+    TEST_ASSERT_EQUAL(50, levelOf("Set volume to fifty"));
+    TEST_ASSERT_EQUAL(0, levelOf("volume zero"));
+    TEST_ASSERT_EQUAL(100, levelOf("volume to a hundred percent"));
+}
+
+void test_volume_set_out_of_range() {
+    TEST_ASSERT_EQUAL(-1, levelOf("volume 101"));
+    TEST_ASSERT_EQUAL(-1, levelOf("volume 9999999999"));
+    TEST_ASSERT_EQUAL(-1, levelOf("volume 4o"));
+}
+
+void test_mute_and_max() {
+    TEST_ASSERT_EQUAL(0, levelOf("Mute"));
+    TEST_ASSERT_EQUAL(0, levelOf("Volume off"));
+    TEST_ASSERT_EQUAL(100, levelOf("Max volume!"));
+    TEST_ASSERT_EQUAL(100, levelOf("Set it to full volume"));
+}
+
+// ============================================================================
+// Stop And Status Tests
+// ============================================================================
+
+void test_stop_phrases() {
+    ASSERT_INTENT(Intent::STOP, "Stop.");
+    ASSERT_INTENT(Intent::STOP, "Okay, stop talking");
+    ASSERT_INTENT(Intent::STOP, "Never mind");
+    ASSERT_INTENT(Intent::STOP, "cancel, thanks");
+}
+
+void test_status_phrases() {
+    ASSERT_INTENT(Intent::STATUS, "Status");
+    ASSERT_INTENT(Intent::STATUS, "What's my IP address?");
+    ASSERT_INTENT(Intent::STATUS, "What\xE2\x80\x99s the WiFi status?");
+    ASSERT_INTENT(Intent::STATUS, "What is the volume");
+    ASSERT_INTENT(Intent::STATUS, "Tell me the signal strength");
+}
+
+// ============================================================================
+// Non-Command Tests
+// ============================================================================
+
+void test_questions_go_to_gemini() {
+    ASSERT_INTENT(Intent::NONE, "What is the volume of a sphere?");
+    ASSERT_INTENT(Intent::NONE, "How do I turn up the heat?");
+    ASSERT_INTENT(Intent::NONE, "Why did the band stop touring?");
+    ASSERT_INTENT(Intent::NONE, "What's the weather today?");
+    ASSERT_INTENT(Intent::NONE, "Tell me a joke");
+}
+
+void test_empty_and_filler_only() {
+    ASSERT_INTENT(Intent::NONE, "");
+    ASSERT_INTENT(Intent::NONE, "   ");
+    ASSERT_INTENT(Intent::NONE, "Okay, thanks.");
+    ASSERT_INTENT(Intent::NONE, "?!");
+}
+
+void test_long_transcript_is_never_a_command() {
+    ASSERT_INTENT(Intent::NONE,
+        "stop stop stop stop stop stop stop stop stop");
+    ASSERT_INTENT(Intent::NONE,
+        "Could you please tell me whether it would be a good idea to turn the "
+        "volume up on my speakers before the party tonight");
+}
+
+void test_punctuation_splits_words() {
+    ASSERT_INTENT(Intent::VOLUME_UP, "volume-up");
+    ASSERT_INTENT(Intent::VOLUME_DOWN, "  VOLUME   DOWN  ");
+    TEST_ASSERT_EQUAL(30, levelOf("volume: 30%!"));
+}
+
+void test_match_is_reset_on_failure() {
+    IntentMatch match = { Intent::STOP, 55 };
+    TEST_ASSERT_FALSE(matchIntent(String("hello there"), match));
+    TEST_ASSERT_TRUE(match.intent == Intent::NONE);
+    TEST_ASSERT_EQUAL(0, match.value);
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Volume tests
+    RUN_TEST(test_volume_up_phrases);
+    RUN_TEST(test_volume_down_phrases);
+    RUN_TEST(test_volume_set_digits);
+    RUN_TEST(test_volume_set_number_words);
+    RUN_TEST(test_volume_set_out_of_range);
+    RUN_TEST(test_mute_and_max);
+
+    // Stop and status tests
+    RUN_TEST(test_stop_phrases);
+    RUN_TEST(test_status_phrases);
+
+    // Non-command tests
+    RUN_TEST(test_questions_go_to_gemini);
+    RUN_TEST(test_empty_and_filler_only);
+    RUN_TEST(test_long_transcript_is_never_a_command);
+    RUN_TEST(test_punctuation_splits_words);
+    RUN_TEST(test_match_is_reset_on_failure);
+
+    return UNITY_END();
+}
@@ -0,0 +1,386 @@
+/**
+ * Unit tests for the keyword spotting front end
+ * Tests the MFCC feature extraction from keyword_model.cpp
+ */
+
+#include <unity.h>
+#include <cmath>
+#include <cstring>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// MfccFrontEnd (extracted from keyword_model.h / keyword_model.cpp)
+// ============================================================================
+
+// MFCC features computed incrementally, one 512-sample wake word frame at a
+// time (32 ms at 16 kHz, no overlap). The last WINDOW_FRAMES frames are kept
+// so a model always sees the most recent ~1 s of audio.
+class MfccFrontEnd {
+public:
+    static const size_t FRAME_SIZE = 512;
+    static const size_t MEL_BANDS = 26;
+    static const size_t COEFFS = 13;
+    static const size_t WINDOW_FRAMES = 32;
+
+    MfccFrontEnd();
+
+    void begin(int sampleRate);
+    void reset();
+
+    // Append one frame of FRAME_SIZE samples
+    void process(const int16_t* samples);
+
+    // Frames held, up to WINDOW_FRAMES
+    size_t getFrameCount() const { return _frames; }
+
+    // Oldest-first copy of the window (WINDOW_FRAMES x COEFFS); frames not
+    // yet seen are filled with silence
+    void copyWindow(float* out) const;
+
+    // Coefficients of the newest frame
+    const float* getLatest() const;
+
+private:
+    static const size_t FFT_BINS = FRAME_SIZE / 2 + 1;
+
+    void fft();
+
+    float _window[FRAME_SIZE];
+    float _re[FRAME_SIZE];
+    float _im[FRAME_SIZE];
+    float _cos[FRAME_SIZE / 2];
+    float _sin[FRAME_SIZE / 2];
+    uint16_t _melEdges[MEL_BANDS + 2];  // FFT bins: band b spans edges b..b+2
+    float _dct[COEFFS][MEL_BANDS];
+    float _silence[COEFFS];             // Coefficients of an all-zero frame
+
+    float _history[WINDOW_FRAMES][COEFFS];
+    size_t _head;                       // Next slot to write
+    size_t _frames;
+};
+
+#define MFCC_LOW_HZ       20.0f
+#define MFCC_LOG_FLOOR    1e-6f   // Keeps log() finite on silent bands
+
+static float hzToMel(float hz) {
+    return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+static float melToHz(float mel) {
+    return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+MfccFrontEnd::MfccFrontEnd()
+    : _head(0)
+    , _frames(0)
+{
+}
+
+void MfccFrontEnd::begin(int sampleRate) {
+    for (size_t n = 0; n < FRAME_SIZE; n++) {
+        _window[n] = 0.5f - 0.5f * cosf(2.0f * M_PI * n / (FRAME_SIZE - 1));
+    }
+    for (size_t k = 0; k < FRAME_SIZE / 2; k++) {
+        _cos[k] = cosf(2.0f * M_PI * k / FRAME_SIZE);
+        _sin[k] = -sinf(2.0f * M_PI * k / FRAME_SIZE);
+    }
+
+    // Triangular bands evenly spaced on the mel scale up to Nyquist
+    float melLow = hzToMel(MFCC_LOW_HZ);
+    float melHigh = hzToMel(sampleRate / 2.0f);
+    for (size_t i = 0; i < MEL_BANDS + 2; i++) {
+        float hz = melToHz(melLow + (melHigh - melLow) * i / (MEL_BANDS + 1));
+        _melEdges[i] = min((size_t)lroundf(hz * FRAME_SIZE / sampleRate), FFT_BINS - 1);
+    }
+
+    // DCT-II, orthonormal
+    for (size_t c = 0; c < COEFFS; c++) {
+        float norm = sqrtf((c == 0 ? 1.0f : 2.0f) / MEL_BANDS);
+        for (size_t m = 0; m < MEL_BANDS; m++) {
+            _dct[c][m] = norm * cosf(M_PI * c * (m + 0.5f) / MEL_BANDS);
+        }
+    }
+
+    for (size_t c = 0; c < COEFFS; c++) {
+        _silence[c] = 0;
+        for (size_t m = 0; m < MEL_BANDS; m++) {
+            _silence[c] += _dct[c][m] * logf(MFCC_LOG_FLOOR);
+        }
+    }
+
+    reset();
+}
+
+void MfccFrontEnd::reset() {
+    _head = 0;
+    _frames = 0;
+}
+
+void MfccFrontEnd::process(const int16_t* samples) {
+    for (size_t n = 0; n < FRAME_SIZE; n++) {
+        _re[n] = samples[n] / 32768.0f * _window[n];
+        _im[n] = 0;
+    }
+    fft();
+
+    // Power spectrum, reusing _re for bins 0..N/2
+    for (size_t k = 0; k < FFT_BINS; k++) {
+        _re[k] = _re[k] * _re[k] + _im[k] * _im[k];
+    }
+
+    float logMel[MEL_BANDS];
+    for (size_t b = 0; b < MEL_BANDS; b++) {
+        size_t lo = _melEdges[b];
+        size_t center = _melEdges[b + 1];
+        size_t hi = _melEdges[b + 2];
+
+        float energy = 0;
+        for (size_t k = lo; k <= hi; k++) {
+            float weight;
+            if (k <= center) {
+                weight = center == lo ? 1.0f : (float)(k - lo) / (center - lo);
+            } else {
+                weight = (float)(hi - k) / (hi - center);
+            }
+            energy += weight * _re[k];
+        }
+        logMel[b] = logf(energy + MFCC_LOG_FLOOR);
+    }
+
+    float* out = _history[_head];
+    for (size_t c = 0; c < COEFFS; c++) {
+        float sum = 0;
+        for (size_t m = 0; m < MEL_BANDS; m++) {
+            sum += _dct[c][m] * logMel[m];
+        }
+        out[c] = sum;
+    }
+
+    _head = (_head + 1) % WINDOW_FRAMES;
+    if (_frames < WINDOW_FRAMES) _frames++;
+}
+
+void MfccFrontEnd::copyWindow(float* out) const {
+    size_t missing = WINDOW_FRAMES - _frames;
+    for (size_t f = 0; f < missing; f++) {
+        memcpy(out + f * COEFFS, _silence, sizeof(_silence));
+    }
+
+    size_t oldest = (_head + WINDOW_FRAMES - _frames) % WINDOW_FRAMES;
+    for (size_t f = 0; f < _frames; f++) {
+        memcpy(out + (missing + f) * COEFFS, _history[(oldest + f) % WINDOW_FRAMES], COEFFS * sizeof(float));
+    }
+}
+
+const float* MfccFrontEnd::getLatest() const {
+    if (_frames == 0) return _silence;
+    return _history[(_head + WINDOW_FRAMES - 1) % WINDOW_FRAMES];
+}
+
+void MfccFrontEnd::fft() {
+    // Iterative radix-2: bit-reverse, then butterflies of growing span
+    for (size_t i = 1, j = 0; i < FRAME_SIZE; i++) {
+        size_t bit = FRAME_SIZE >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            float t = _re[i]; _re[i] = _re[j]; _re[j] = t;
+            t = _im[i]; _im[i] = _im[j]; _im[j] = t;
+        }
+    }
+
+    for (size_t span = 2; span <= FRAME_SIZE; span <<= 1) {
+        size_t half = span >> 1;
+        size_t step = FRAME_SIZE / span;
+        for (size_t start = 0; start < FRAME_SIZE; start += span) {
+            for (size_t k = 0; k < half; k++) {
+                float wr = _cos[k * step];
+                float wi = _sin[k * step];
+                size_t a = start + k;
+                size_t b = a + half;
+                float tr = _re[b] * wr - _im[b] * wi;
+                float ti = _re[b] * wi + _im[b] * wr;
+                _re[b] = _re[a] - tr;
+                _im[b] = _im[a] - ti;
+                _re[a] += tr;
+                _im[a] += ti;
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static const int SAMPLE_RATE = 16000;
+static const size_t N = MfccFrontEnd::FRAME_SIZE;
+static const size_t C = MfccFrontEnd::COEFFS;
+
+static void makeSine(int16_t* out, float hz, float amplitude, float phase = 0) {
+    for (size_t i = 0; i < N; i++) {
+        out[i] = (int16_t)(amplitude * sinf(2.0f * M_PI * hz * i / SAMPLE_RATE + phase));
+    }
+}
+
+static float distance(const float* a, const float* b) {
+    float sum = 0;
+    for (size_t i = 0; i < C; i++) sum += (a[i] - b[i]) * (a[i] - b[i]);
+    return sqrtf(sum);
+}
+
+static MfccFrontEnd frontEnd;  // ~20 KB, kept off the stack
+
+// ============================================================================
+// Test Cases
+// ============================================================================
+
+void test_silent_frame_matches_padding() {
+    frontEnd.begin(SAMPLE_RATE);
+
+    int16_t silence[N] = {0};
+    frontEnd.process(silence);
+
+    // Window padding and a processed silent frame are the same features
+    static float window[MfccFrontEnd::WINDOW_FRAMES * C];
+    frontEnd.copyWindow(window);
+    for (size_t i = 0; i < C; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, window[i], frontEnd.getLatest()[i]);
+        TEST_ASSERT_TRUE(std::isfinite(window[i]));
+    }
+}
+
+void test_louder_frame_raises_c0() {
+    frontEnd.begin(SAMPLE_RATE);
+    int16_t frame[N];
+
+    makeSine(frame, 500, 1000);
+    frontEnd.process(frame);
+    float quiet = frontEnd.getLatest()[0];
+
+    makeSine(frame, 500, 16000);
+    frontEnd.process(frame);
+    float loud = frontEnd.getLatest()[0];
+
+    TEST_ASSERT_TRUE(loud > quiet);
+}
+
+void test_low_pitch_has_higher_c1() {
+    // c1 weights low bands positively and high bands negatively
+    frontEnd.begin(SAMPLE_RATE);
+    int16_t frame[N];
+
+    makeSine(frame, 300, 8000);
+    frontEnd.process(frame);
+    float low = frontEnd.getLatest()[1];
+
+    makeSine(frame, 5000, 8000);
+    frontEnd.process(frame);
+    float high = frontEnd.getLatest()[1];
+
+    TEST_ASSERT_TRUE(low > high);
+}
+
+void test_phase_shift_barely_changes_features() {
+    frontEnd.begin(SAMPLE_RATE);
+    int16_t frame[N];
+    float a[C], b[C], other[C];
+
+    makeSine(frame, 1000, 8000, 0);
+    frontEnd.process(frame);
+    memcpy(a, frontEnd.getLatest(), sizeof(a));
+
+    makeSine(frame, 1000, 8000, 1.3f);
+    frontEnd.process(frame);
+    memcpy(b, frontEnd.getLatest(), sizeof(b));
+
+    makeSine(frame, 2500, 8000, 0);
+    frontEnd.process(frame);
+    memcpy(other, frontEnd.getLatest(), sizeof(other));
+
+    TEST_ASSERT_TRUE(distance(a, b) < distance(a, other) / 10);
+}
+
+void test_window_is_oldest_first() {
+    frontEnd.begin(SAMPLE_RATE);
+    int16_t frame[N];
+    static float window[MfccFrontEnd::WINDOW_FRAMES * C];
+
+    for (int i = 1; i <= 3; i++) {
+        makeSine(frame, 800, 2000.0f * i);
+        frontEnd.process(frame);
+    }
+    TEST_ASSERT_EQUAL(3, frontEnd.getFrameCount());
+
+    frontEnd.copyWindow(window);
+    size_t first = (MfccFrontEnd::WINDOW_FRAMES - 3) * C;
+    TEST_ASSERT_TRUE(window[first] < window[first + C]);
+    TEST_ASSERT_TRUE(window[first + C] < window[first + 2 * C]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, frontEnd.getLatest()[0], window[first + 2 * C]);
+
+    // Leading frames are silence padding, quieter than anything heard
+    TEST_ASSERT_TRUE(window[0] < window[first]);
+}
+
+void test_window_rolls_over() {
+    frontEnd.begin(SAMPLE_RATE);
+    int16_t frame[N];
+    static float window[MfccFrontEnd::WINDOW_FRAMES * C];
+    const size_t total = MfccFrontEnd::WINDOW_FRAMES + 5;
+    float c0[total];
+
+    for (size_t i = 0; i < total; i++) {
+        makeSine(frame, 300.0f + 100.0f * i, 8000);
+        frontEnd.process(frame);
+        c0[i] = frontEnd.getLatest()[0];
+    }
+    TEST_ASSERT_EQUAL(MfccFrontEnd::WINDOW_FRAMES, frontEnd.getFrameCount());
+
+    // The five oldest frames are gone; the rest are in order
+    frontEnd.copyWindow(window);
+    for (size_t f = 0; f < MfccFrontEnd::WINDOW_FRAMES; f++) {
+        TEST_ASSERT_EQUAL_FLOAT(c0[f + 5], window[f * C]);
+    }
+}
+
+void test_reset_clears_window() {
+    frontEnd.begin(SAMPLE_RATE);
+    int16_t frame[N];
+    makeSine(frame, 800, 8000);
+    frontEnd.process(frame);
+
+    frontEnd.reset();
+    TEST_ASSERT_EQUAL(0, frontEnd.getFrameCount());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {
+    // Setup before each test
+}
+
+void tearDown() {
+    // Cleanup after each test
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Features
+    RUN_TEST(test_silent_frame_matches_padding);
+    RUN_TEST(test_louder_frame_raises_c0);
+    RUN_TEST(test_low_pitch_has_higher_c1);
+    RUN_TEST(test_phase_shift_barely_changes_features);
+
+    // Feature window
+    RUN_TEST(test_window_is_oldest_first);
+    RUN_TEST(test_window_rolls_over);
+    RUN_TEST(test_reset_clears_window);
+
+    return UNITY_END();
+}
@@ -0,0 +1,417 @@
+/**
+ * Unit tests for the turn arena allocator
+ * Tests stacked allocation, out-of-order release and reset from memory_arena.cpp
+ */
+
+#include <unity.h>
+#include <cstring>
+#include <cstdint>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// Single-threaded tests: the spinlock is a no-op
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(lock)
+#define portEXIT_CRITICAL(lock)
+
+// ============================================================================
+// TurnArena (extracted from memory_arena.h / memory_arena.cpp)
+// ============================================================================
+
+class TurnArena {
+public:
+    TurnArena();
+    ~TurnArena();
+
+    bool begin(size_t bytes);
+    void end();
+
+    // nullptr when the arena is full (callers fall back to the heap)
+    void* allocate(size_t size);
+
+    // Grows the newest block in place; otherwise moves it. nullptr when full
+    void* reallocate(void* ptr, size_t size);
+
+    void release(void* ptr);
+    bool owns(const void* ptr) const;
+    size_t getBlockSize(const void* ptr) const;  // Payload bytes of an arena block
+
+    // End of turn: frees every block and reports the turn's usage
+    void reset();
+
+    size_t getCapacity() const { return _capacity; }
+    size_t getUsed() const { return _top; }
+    size_t getHighWater() const { return _highWater; }
+    uint32_t getFallbackCount() const { return _fallbacks; }
+    void countFallback() { _fallbacks++; }
+
+private:
+    struct Block {
+        uint32_t size;      // Payload bytes
+        uint32_t prev;      // Offset of the block below, NO_BLOCK for the first
+        uint32_t released;  // Freed, waiting for the blocks above to go
+        uint32_t reserved;  // Keeps the payload 16-byte aligned
+    };
+
+    static const uint32_t NO_BLOCK = 0xFFFFFFFF;
+    static const size_t ALIGN = 16;
+
+    Block* blockOf(const void* ptr) const;
+    void collapse();
+
+    uint8_t* _raw;
+    uint8_t* _memory;       // _raw aligned to ALIGN
+    size_t _capacity;
+    size_t _top;            // First free byte
+    uint32_t _last;         // Offset of the newest block
+    size_t _highWater;      // Since boot
+    size_t _turnPeak;       // Since the last reset
+    uint32_t _turnAllocations;
+    uint32_t _liveBlocks;
+    uint32_t _fallbacks;
+    portMUX_TYPE _lock;
+};
+
+TurnArena::TurnArena()
+    : _raw(nullptr)
+    , _memory(nullptr)
+    , _capacity(0)
+    , _top(0)
+    , _last(NO_BLOCK)
+    , _highWater(0)
+    , _turnPeak(0)
+    , _turnAllocations(0)
+    , _liveBlocks(0)
+    , _fallbacks(0)
+    , _lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+TurnArena::~TurnArena() {
+    end();
+}
+
+bool TurnArena::begin(size_t bytes) {
+    if (_memory) return true;
+
+    _raw = psramFound() ? (uint8_t*)ps_malloc(bytes + ALIGN) : (uint8_t*)malloc(bytes + ALIGN);
+    if (!_raw) {
+        Serial.printf("[Arena] Failed to allocate %d KB\n", bytes / 1024);
+        return false;
+    }
+
+    _memory = (uint8_t*)(((uintptr_t)_raw + ALIGN - 1) & ~(uintptr_t)(ALIGN - 1));
+    _capacity = bytes;
+    _top = 0;
+    _last = NO_BLOCK;
+
+    Serial.printf("[Arena] %d KB turn arena in %s\n", bytes / 1024, psramFound() ? "PSRAM" : "heap");
+    return true;
+}
+
+void TurnArena::end() {
+    if (_raw) {
+        free(_raw);
+        _raw = nullptr;
+    }
+    _memory = nullptr;
+    _capacity = 0;
+    _top = 0;
+    _last = NO_BLOCK;
+    _liveBlocks = 0;
+}
+
+void* TurnArena::allocate(size_t size) {
+    size_t payload = (size + ALIGN - 1) & ~(ALIGN - 1);
+    size_t need = sizeof(Block) + payload;
+
+    portENTER_CRITICAL(&_lock);
+    if (!_memory || _top + need > _capacity) {
+        portEXIT_CRITICAL(&_lock);
+        return nullptr;
+    }
+
+    Block* block = (Block*)(_memory + _top);
+    block->size = payload;
+    block->prev = _last;
+    block->released = 0;
+
+    _last = _top;
+    _top += need;
+    _liveBlocks++;
+    _turnAllocations++;
+    if (_top > _turnPeak) _turnPeak = _top;
+    if (_top > _highWater) _highWater = _top;
+    portEXIT_CRITICAL(&_lock);
+
+    return block + 1;
+}
+
+void* TurnArena::reallocate(void* ptr, size_t size) {
+    if (!ptr) return allocate(size);
+
+    size_t payload = (size + ALIGN - 1) & ~(ALIGN - 1);
+    size_t oldSize;
+
+    portENTER_CRITICAL(&_lock);
+    Block* block = blockOf(ptr);
+    if (!block) {
+        portEXIT_CRITICAL(&_lock);
+        return nullptr;
+    }
+
+    uint32_t offset = (uint8_t*)block - _memory;
+    oldSize = block->size;
+
+    // Growing strings are usually the newest block: extend it where it is
+    if (offset == _last && offset + sizeof(Block) + payload <= _capacity) {
+        block->size = payload;
+        _top = offset + sizeof(Block) + payload;
+        if (_top > _turnPeak) _turnPeak = _top;
+        if (_top > _highWater) _highWater = _top;
+        portEXIT_CRITICAL(&_lock);
+        return ptr;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (payload <= oldSize) return ptr;
+
+    void* moved = allocate(size);
+    if (!moved) return nullptr;
+
+    memcpy(moved, ptr, oldSize);
+    release(ptr);
+    return moved;
+}
+
+void TurnArena::release(void* ptr) {
+    if (!ptr) return;
+
+    portENTER_CRITICAL(&_lock);
+    Block* block = blockOf(ptr);
+    if (block && !block->released) {
+        block->released = 1;
+        _liveBlocks--;
+        collapse();
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+bool TurnArena::owns(const void* ptr) const {
+    const uint8_t* p = (const uint8_t*)ptr;
+    return _memory && p >= _memory && p < _memory + _capacity;
+}
+
+size_t TurnArena::getBlockSize(const void* ptr) const {
+    Block* block = blockOf(ptr);
+    return block ? block->size : 0;
+}
+
+TurnArena::Block* TurnArena::blockOf(const void* ptr) const {
+    const uint8_t* p = (const uint8_t*)ptr;
+    if (!_memory || p < _memory + sizeof(Block) || p >= _memory + _top) return nullptr;
+    return (Block*)p - 1;
+}
+
+void TurnArena::collapse() {
+    // Rewind past every released block at the top of the stack
+    while (_last != NO_BLOCK) {
+        Block* block = (Block*)(_memory + _last);
+        if (!block->released) break;
+        _top = _last;
+        _last = block->prev;
+    }
+}
+
+void TurnArena::reset() {
+    portENTER_CRITICAL(&_lock);
+    uint32_t allocations = _turnAllocations;
+    uint32_t liveBlocks = _liveBlocks;
+    size_t turnPeak = _turnPeak;
+
+    _top = 0;
+    _last = NO_BLOCK;
+    _liveBlocks = 0;
+    _turnAllocations = 0;
+    _turnPeak = 0;
+    portEXIT_CRITICAL(&_lock);
+
+    if (allocations == 0) return;
+
+    Serial.printf("[Arena] Turn: %d allocations, peak %d KB, high water %d / %d KB, %d heap fallbacks\n",
+                  allocations, turnPeak / 1024, _highWater / 1024, _capacity / 1024, _fallbacks);
+    if (liveBlocks > 0) {
+        Serial.printf("[Arena] %d blocks were still held at end of turn\n", liveBlocks);
+    }
+}
+
+// ============================================================================
+// Test Cases
+// ============================================================================
+
+static const size_t BLOCK_OVERHEAD = 16;
+
+void test_allocate_is_aligned_and_owned() {
+    TurnArena arena;
+    TEST_ASSERT_TRUE(arena.begin(4096));
+
+    void* a = arena.allocate(3);
+    void* b = arena.allocate(100);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)a % 16);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)b % 16);
+    TEST_ASSERT_TRUE(arena.owns(a));
+    TEST_ASSERT_TRUE(arena.owns(b));
+    TEST_ASSERT_EQUAL(16, arena.getBlockSize(a));
+    TEST_ASSERT_EQUAL(112, arena.getBlockSize(b));
+
+    int local;
+    TEST_ASSERT_FALSE(arena.owns(&local));
+}
+
+void test_full_arena_returns_null() {
+    TurnArena arena;
+    arena.begin(1024);
+
+    TEST_ASSERT_NOT_NULL(arena.allocate(1024 - BLOCK_OVERHEAD));
+    TEST_ASSERT_NULL(arena.allocate(1));
+}
+
+void test_release_newest_rewinds() {
+    TurnArena arena;
+    arena.begin(4096);
+
+    arena.allocate(64);
+    size_t used = arena.getUsed();
+    void* b = arena.allocate(256);
+    arena.release(b);
+
+    TEST_ASSERT_EQUAL(used, arena.getUsed());
+}
+
+void test_out_of_order_release_collapses() {
+    TurnArena arena;
+    arena.begin(4096);
+
+    void* a = arena.allocate(64);
+    void* b = arena.allocate(64);
+    void* c = arena.allocate(64);
+
+    arena.release(b);  // Not the newest: stays until c is gone
+    TEST_ASSERT_EQUAL(3 * (64 + BLOCK_OVERHEAD), arena.getUsed());
+
+    arena.release(c);  // Rewinds past c and the already released b
+    TEST_ASSERT_EQUAL(64 + BLOCK_OVERHEAD, arena.getUsed());
+
+    arena.release(a);
+    TEST_ASSERT_EQUAL(0, arena.getUsed());
+}
+
+void test_double_release_ignored() {
+    TurnArena arena;
+    arena.begin(4096);
+
+    void* a = arena.allocate(64);
+    void* b = arena.allocate(64);
+    arena.release(a);
+    arena.release(a);
+    TEST_ASSERT_EQUAL(2 * (64 + BLOCK_OVERHEAD), arena.getUsed());
+
+    arena.release(b);
+    TEST_ASSERT_EQUAL(0, arena.getUsed());
+}
+
+void test_reallocate_newest_grows_in_place() {
+    TurnArena arena;
+    arena.begin(4096);
+
+    char* s = (char*)arena.allocate(16);
+    strcpy(s, "hello");
+    char* grown = (char*)arena.reallocate(s, 500);
+
+    TEST_ASSERT_EQUAL_PTR(s, grown);
+    TEST_ASSERT_EQUAL_STRING("hello", grown);
+    TEST_ASSERT_EQUAL(512 + BLOCK_OVERHEAD, arena.getUsed());
+}
+
+void test_reallocate_older_block_moves() {
+    TurnArena arena;
+    arena.begin(4096);
+
+    char* s = (char*)arena.allocate(16);
+    strcpy(s, "hello");
+    void* other = arena.allocate(16);
+
+    char* moved = (char*)arena.reallocate(s, 200);
+    TEST_ASSERT_TRUE(moved != s);
+    TEST_ASSERT_EQUAL_STRING("hello", moved);
+
+    // The old copy is reclaimed with the block above it
+    arena.release(other);
+    arena.release(moved);
+    TEST_ASSERT_EQUAL(0, arena.getUsed());
+}
+
+void test_reset_and_high_water() {
+    TurnArena arena;
+    arena.begin(8192);
+
+    arena.allocate(1000);
+    arena.allocate(2000);
+    size_t peak = arena.getUsed();
+    arena.reset();
+
+    TEST_ASSERT_EQUAL(0, arena.getUsed());
+    TEST_ASSERT_EQUAL(peak, arena.getHighWater());
+
+    // The next turn starts from the bottom again
+    void* a = arena.allocate(100);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_EQUAL(112 + BLOCK_OVERHEAD, arena.getUsed());
+    TEST_ASSERT_EQUAL(peak, arena.getHighWater());
+}
+
+void test_unstarted_arena_allocates_nothing() {
+    TurnArena arena;
+    TEST_ASSERT_NULL(arena.allocate(16));
+    TEST_ASSERT_FALSE(arena.owns(nullptr));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {
+    // Setup before each test
+}
+
+void tearDown() {
+    // Cleanup after each test
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Allocation
+    RUN_TEST(test_allocate_is_aligned_and_owned);
+    RUN_TEST(test_full_arena_returns_null);
+    RUN_TEST(test_unstarted_arena_allocates_nothing);
+
+    // Release
+    RUN_TEST(test_release_newest_rewinds);
+    RUN_TEST(test_out_of_order_release_collapses);
+    RUN_TEST(test_double_release_ignored);
+
+    // Reallocation (JSON strings)
+    RUN_TEST(test_reallocate_newest_grows_in_place);
+    RUN_TEST(test_reallocate_older_block_moves);
+
+    // Turn boundary
+    RUN_TEST(test_reset_and_high_water);
+
+    return UNITY_END();
+}
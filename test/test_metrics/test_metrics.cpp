@@ -0,0 +1,212 @@
+/**
+ * Unit tests for latency metrics
+ * Tests the span histogram from metrics.cpp
+ */
+
+#include <unity.h>
+#include <algorithm>
+#include <cstring>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// LatencyHistogram (extracted from metrics.h / metrics.cpp)
+// ============================================================================
+
+class LatencyHistogram {
+public:
+    static const size_t RING_SIZE = 32;
+    static const size_t BUCKETS = 8;
+
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        memset(_ring, 0, sizeof(_ring));
+        memset(_buckets, 0, sizeof(_buckets));
+        _pos = 0;
+        _count = 0;
+    }
+
+    void add(uint32_t us) {
+        _ring[_pos] = us;
+        _pos = (_pos + 1) % RING_SIZE;
+        _count++;
+
+        uint32_t ms = us / 1000;
+        size_t index = 0;
+        while (index < BUCKETS - 1 && ms >= BUCKET_LIMITS_MS[index]) {
+            index++;
+        }
+        _buckets[index]++;
+    }
+
+    uint32_t count() const { return _count; }
+
+    uint32_t last() const {
+        return _count > 0 ? _ring[(_pos + RING_SIZE - 1) % RING_SIZE] : 0;
+    }
+
+    uint32_t percentile(int percent) const {
+        size_t n = min((size_t)_count, RING_SIZE);
+        if (n == 0) return 0;
+
+        uint32_t sorted[RING_SIZE];
+        memcpy(sorted, _ring, n * sizeof(uint32_t));
+        std::sort(sorted, sorted + n);
+
+        size_t rank = (n * constrain(percent, 0, 100) + 99) / 100;
+        return sorted[rank > 0 ? rank - 1 : 0];
+    }
+
+    uint32_t peak() const {
+        size_t n = min((size_t)_count, RING_SIZE);
+        uint32_t highest = 0;
+        for (size_t i = 0; i < n; i++) {
+            highest = std::max(highest, _ring[i]);
+        }
+        return highest;
+    }
+
+    uint32_t bucket(size_t index) const { return _buckets[index]; }
+
+    static uint32_t bucketLimitMs(size_t index) {
+        return index < BUCKETS - 1 ? BUCKET_LIMITS_MS[index] : 0;
+    }
+
+private:
+    static constexpr uint32_t BUCKET_LIMITS_MS[BUCKETS - 1] = {
+        50, 100, 200, 500, 1000, 2000, 5000
+    };
+
+    uint32_t _ring[RING_SIZE];
+    size_t _pos;
+    uint32_t _count;
+    uint32_t _buckets[BUCKETS];
+};
+
+constexpr uint32_t LatencyHistogram::BUCKET_LIMITS_MS[];
+
+static const uint32_t MS = 1000;  // Samples are in microseconds
+
+// ============================================================================
+// Ring Tests
+// ============================================================================
+
+void test_empty_histogram() {
+    LatencyHistogram h;
+    TEST_ASSERT_EQUAL(0, h.count());
+    TEST_ASSERT_EQUAL(0, h.last());
+    TEST_ASSERT_EQUAL(0, h.percentile(50));
+    TEST_ASSERT_EQUAL(0, h.peak());
+}
+
+void test_last_and_count() {
+    LatencyHistogram h;
+    h.add(120 * MS);
+    h.add(80 * MS);
+    TEST_ASSERT_EQUAL(2, h.count());
+    TEST_ASSERT_EQUAL(80 * MS, h.last());
+}
+
+void test_percentiles_of_partial_ring() {
+    LatencyHistogram h;
+    // Unfilled slots must not pull the percentiles down to zero
+    for (uint32_t v : {500u, 100u, 300u, 200u, 400u}) {
+        h.add(v * MS);
+    }
+    TEST_ASSERT_EQUAL(300 * MS, h.percentile(50));
+    TEST_ASSERT_EQUAL(500 * MS, h.percentile(90));
+    TEST_ASSERT_EQUAL(100 * MS, h.percentile(0));
+    TEST_ASSERT_EQUAL(500 * MS, h.peak());
+}
+
+void test_ring_keeps_only_recent_samples() {
+    LatencyHistogram h;
+    h.add(9000 * MS);  // Slow start, later pushed out of the ring
+    for (size_t i = 0; i < LatencyHistogram::RING_SIZE; i++) {
+        h.add(100 * MS);
+    }
+    TEST_ASSERT_EQUAL(LatencyHistogram::RING_SIZE + 1, h.count());
+    TEST_ASSERT_EQUAL(100 * MS, h.peak());
+    TEST_ASSERT_EQUAL(100 * MS, h.percentile(90));
+}
+
+void test_p90_of_full_ring() {
+    LatencyHistogram h;
+    for (uint32_t i = 1; i <= LatencyHistogram::RING_SIZE; i++) {
+        h.add(i * MS);
+    }
+    // Nearest rank: ceil(32 * 0.9) = 29th smallest
+    TEST_ASSERT_EQUAL(29 * MS, h.percentile(90));
+    TEST_ASSERT_EQUAL(16 * MS, h.percentile(50));
+}
+
+// ============================================================================
+// Bucket Tests
+// ============================================================================
+
+void test_bucket_boundaries() {
+    LatencyHistogram h;
+    h.add(49 * MS);    // < 50
+    h.add(50 * MS);    // 50..100
+    h.add(999 * MS);   // 500..1000
+    h.add(1000 * MS);  // 1000..2000
+    h.add(60000 * MS); // 5000+
+
+    TEST_ASSERT_EQUAL(1, h.bucket(0));
+    TEST_ASSERT_EQUAL(1, h.bucket(1));
+    TEST_ASSERT_EQUAL(1, h.bucket(4));
+    TEST_ASSERT_EQUAL(1, h.bucket(5));
+    TEST_ASSERT_EQUAL(1, h.bucket(7));
+}
+
+void test_buckets_count_all_time() {
+    LatencyHistogram h;
+    for (int i = 0; i < 100; i++) {
+        h.add(150 * MS);
+    }
+    TEST_ASSERT_EQUAL(100, h.bucket(2));
+}
+
+void test_bucket_limits() {
+    TEST_ASSERT_EQUAL(50, LatencyHistogram::bucketLimitMs(0));
+    TEST_ASSERT_EQUAL(5000, LatencyHistogram::bucketLimitMs(6));
+    TEST_ASSERT_EQUAL(0, LatencyHistogram::bucketLimitMs(7));
+}
+
+void test_reset_clears_everything() {
+    LatencyHistogram h;
+    h.add(300 * MS);
+    h.reset();
+    TEST_ASSERT_EQUAL(0, h.count());
+    TEST_ASSERT_EQUAL(0, h.bucket(3));
+    TEST_ASSERT_EQUAL(0, h.peak());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Ring tests
+    RUN_TEST(test_empty_histogram);
+    RUN_TEST(test_last_and_count);
+    RUN_TEST(test_percentiles_of_partial_ring);
+    RUN_TEST(test_ring_keeps_only_recent_samples);
+    RUN_TEST(test_p90_of_full_ring);
+
+    // Bucket tests
+    RUN_TEST(test_bucket_boundaries);
+    RUN_TEST(test_buckets_count_all_time);
+    RUN_TEST(test_bucket_limits);
+    RUN_TEST(test_reset_clears_everything);
+
+    return UNITY_END();
+}
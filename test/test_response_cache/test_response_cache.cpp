@@ -0,0 +1,442 @@
+/**
+ * Unit tests for the response cache
+ * Tests key normalization, the stale-reply filter and the PSRAM region
+ * allocator (LRU eviction, pinned prompts, compaction) from response_cache.cpp
+ */
+
+#include <unity.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+#define RESPONSE_CACHE_SKIP_DIGITS  true
+
+// ============================================================================
+// ResponseCache (extracted from response_cache.h / response_cache.cpp)
+// Mutex, TTL, reply capture and persistence are left out; the region is a
+// plain malloc block instead of PSRAM
+// ============================================================================
+
+#define CACHE_ALIGN        16
+#define PROMPT_KEY_PREFIX  "#prompt:"
+
+static size_t alignedBytes(size_t samples) {
+    return (samples * sizeof(int16_t) + CACHE_ALIGN - 1) & ~(size_t)(CACHE_ALIGN - 1);
+}
+
+class ResponseCache {
+public:
+    struct Hit {
+        String text;
+        const int16_t* samples;
+        size_t count;
+    };
+
+    static const size_t MAX_ENTRIES = 32;
+
+    ResponseCache() : _memory(nullptr), _capacity(0), _used(0), _useClock(0) {
+        for (size_t i = 0; i < MAX_ENTRIES; i++) _entries[i].used = false;
+    }
+    ~ResponseCache() { free(_memory); }
+
+    bool begin(size_t bytes) {
+        _memory = (uint8_t*)malloc(bytes);
+        _capacity = bytes;
+        return _memory != nullptr;
+    }
+
+    static String normalize(const String& transcript) {
+        String key;
+        bool space = false;
+        for (size_t i = 0; i < transcript.length(); i++) {
+            char c = transcript[i];
+            if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+
+            if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (uint8_t)c >= 0x80) {
+                if (space && key.length() > 0) key += ' ';
+                key += c;
+                space = false;
+            } else if (c == ' ' || c == '\t' || c == '\n' || c == '-') {
+                space = true;
+            }
+        }
+        return key;
+    }
+
+    static bool isCacheable(const String& reply) {
+        if (reply.length() == 0) return false;
+        if (RESPONSE_CACHE_SKIP_DIGITS) {
+            for (size_t i = 0; i < reply.length(); i++) {
+                if (reply[i] >= '0' && reply[i] <= '9') return false;
+            }
+        }
+        return true;
+    }
+
+    bool lookup(const String& transcript, Hit& hit) {
+        Entry* entry = find(normalize(transcript));
+        if (!entry) return false;
+        entry->lastUsed = ++_useClock;
+        hit.text = entry->text;
+        hit.samples = (const int16_t*)(_memory + entry->offset);
+        hit.count = entry->samples;
+        return true;
+    }
+
+    bool store(const String& transcript, const String& reply,
+               const int16_t* samples, size_t count) {
+        if (!isCacheable(reply)) return false;
+        String key = normalize(transcript);
+        if (key.length() == 0) return false;
+        return insert(key, reply, samples, count, false);
+    }
+
+    bool storePrompt(const String& text, const int16_t* samples, size_t count) {
+        return insert(PROMPT_KEY_PREFIX + text, text, samples, count, true);
+    }
+
+    bool hasPrompt(const String& text) { return find(PROMPT_KEY_PREFIX + text) != nullptr; }
+
+    size_t getCount() const { return _used; }
+
+    size_t getBytesUsed() const {
+        size_t bytes = 0;
+        for (size_t i = 0; i < MAX_ENTRIES; i++) {
+            if (_entries[i].used) bytes += alignedBytes(_entries[i].samples);
+        }
+        return bytes;
+    }
+
+private:
+    struct Entry {
+        bool used;
+        bool pinned;
+        String key;
+        String text;
+        size_t offset;
+        size_t samples;
+        uint32_t lastUsed;
+    };
+
+    Entry* find(const String& key) {
+        for (size_t i = 0; i < MAX_ENTRIES; i++) {
+            if (_entries[i].used && _entries[i].key == key) return &_entries[i];
+        }
+        return nullptr;
+    }
+
+    bool insert(const String& key, const String& text,
+                const int16_t* samples, size_t count, bool pinned) {
+        size_t bytes = alignedBytes(count);
+        if (count == 0 || bytes > _capacity) return false;
+
+        Entry* existing = find(key);
+        if (existing) evict(*existing);
+
+        Entry* slot = nullptr;
+        size_t offset = 0;
+        while (true) {
+            slot = nullptr;
+            for (size_t i = 0; i < MAX_ENTRIES && !slot; i++) {
+                if (!_entries[i].used) slot = &_entries[i];
+            }
+
+            if (slot && findGap(bytes, offset)) break;
+
+            if (slot && _capacity - getBytesUsed() >= bytes) {
+                compact();
+                if (findGap(bytes, offset)) break;
+            }
+
+            if (!evictOldest()) return false;
+        }
+
+        memcpy(_memory + offset, samples, count * sizeof(int16_t));
+        slot->used = true;
+        slot->pinned = pinned;
+        slot->key = key;
+        slot->text = text;
+        slot->offset = offset;
+        slot->samples = count;
+        slot->lastUsed = ++_useClock;
+        _used++;
+        return true;
+    }
+
+    void evict(Entry& entry) {
+        entry.used = false;
+        entry.key = "";
+        entry.text = "";
+        _used--;
+    }
+
+    bool evictOldest() {
+        Entry* oldest = nullptr;
+        for (size_t i = 0; i < MAX_ENTRIES; i++) {
+            Entry& entry = _entries[i];
+            if (!entry.used || entry.pinned) continue;
+            if (!oldest || entry.lastUsed < oldest->lastUsed) oldest = &entry;
+        }
+        if (!oldest) return false;
+        evict(*oldest);
+        return true;
+    }
+
+    bool findGap(size_t bytes, size_t& offset) const {
+        for (size_t c = 0; c <= MAX_ENTRIES; c++) {
+            size_t start = 0;
+            if (c < MAX_ENTRIES) {
+                if (!_entries[c].used) continue;
+                start = _entries[c].offset + alignedBytes(_entries[c].samples);
+            }
+            if (start + bytes > _capacity) continue;
+
+            bool overlaps = false;
+            for (size_t i = 0; i < MAX_ENTRIES && !overlaps; i++) {
+                const Entry& entry = _entries[i];
+                if (!entry.used) continue;
+                size_t end = entry.offset + alignedBytes(entry.samples);
+                overlaps = start < end && entry.offset < start + bytes;
+            }
+
+            if (!overlaps) {
+                offset = start;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void compact() {
+        size_t cursor = 0;
+        bool moved[MAX_ENTRIES] = {false};
+        while (true) {
+            Entry* lowest = nullptr;
+            for (size_t i = 0; i < MAX_ENTRIES; i++) {
+                if (!_entries[i].used || moved[i]) continue;
+                if (!lowest || _entries[i].offset < lowest->offset) lowest = &_entries[i];
+            }
+            if (!lowest) break;
+
+            moved[lowest - _entries] = true;
+            size_t bytes = alignedBytes(lowest->samples);
+            if (lowest->offset != cursor) {
+                memmove(_memory + cursor, _memory + lowest->offset, bytes);
+                lowest->offset = cursor;
+            }
+            cursor += bytes;
+        }
+    }
+
+    uint8_t* _memory;
+    size_t _capacity;
+    Entry _entries[MAX_ENTRIES];
+    size_t _used;
+    uint32_t _useClock;
+};
+
+// ============================================================================
+// Test Helpers
+// ============================================================================
+
+// Clip of count samples all set to value, so a hit can be traced to its store
+static std::vector<int16_t> clip(size_t count, int16_t value) {
+    return std::vector<int16_t>(count, value);
+}
+
+static bool holds(ResponseCache& cache, const char* question, int16_t value, size_t count) {
+    ResponseCache::Hit hit;
+    if (!cache.lookup(question, hit) || hit.count != count) return false;
+    for (size_t i = 0; i < count; i++) {
+        if (hit.samples[i] != value) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Normalization Tests
+// ============================================================================
+
+void test_normalize_drops_case_and_punctuation() {
+    TEST_ASSERT_EQUAL_STRING("whats the weather like",
+        ResponseCache::normalize("What's the weather like?").c_str());
+}
+
+void test_normalize_collapses_whitespace() {
+    TEST_ASSERT_EQUAL_STRING("tell me a joke",
+        ResponseCache::normalize("  Tell   me\ta - joke. ").c_str());
+}
+
+void test_normalize_punctuation_only_is_empty() {
+    TEST_ASSERT_EQUAL_STRING("", ResponseCache::normalize("?!.").c_str());
+}
+
+void test_cacheable_rejects_digits_and_empty() {
+    TEST_ASSERT_TRUE(ResponseCache::isCacheable("Why did the chicken cross the road?"));
+    TEST_ASSERT_FALSE(ResponseCache::isCacheable("It's 10:42 right now."));
+    TEST_ASSERT_FALSE(ResponseCache::isCacheable(""));
+}
+
+// ============================================================================
+// Store / Lookup Tests
+// ============================================================================
+
+void test_lookup_matches_rephrased_punctuation() {
+    ResponseCache cache;
+    cache.begin(4096);
+    std::vector<int16_t> audio = clip(100, 7);
+
+    TEST_ASSERT_TRUE(cache.store("Tell me a joke!", "Knock knock.", audio.data(), audio.size()));
+
+    ResponseCache::Hit hit;
+    TEST_ASSERT_TRUE(cache.lookup("tell me a joke", hit));
+    TEST_ASSERT_EQUAL_STRING("Knock knock.", hit.text.c_str());
+    TEST_ASSERT_TRUE(holds(cache, "TELL ME A JOKE?", 7, 100));
+    TEST_ASSERT_FALSE(cache.lookup("tell me a story", hit));
+}
+
+void test_store_skips_stale_reply() {
+    ResponseCache cache;
+    cache.begin(4096);
+    std::vector<int16_t> audio = clip(100, 1);
+
+    TEST_ASSERT_FALSE(cache.store("what time is it", "It's 3 pm.", audio.data(), audio.size()));
+    TEST_ASSERT_EQUAL(0, cache.getCount());
+}
+
+void test_store_replaces_same_question() {
+    ResponseCache cache;
+    cache.begin(4096);
+    std::vector<int16_t> first = clip(100, 1);
+    std::vector<int16_t> second = clip(50, 2);
+
+    cache.store("hello", "Hi.", first.data(), first.size());
+    cache.store("Hello!", "Hey there.", second.data(), second.size());
+
+    TEST_ASSERT_EQUAL(1, cache.getCount());
+    TEST_ASSERT_TRUE(holds(cache, "hello", 2, 50));
+}
+
+void test_clip_larger_than_cache_is_rejected() {
+    ResponseCache cache;
+    cache.begin(1024);
+    std::vector<int16_t> audio = clip(1000, 1);
+
+    TEST_ASSERT_FALSE(cache.store("long one", "A long answer.", audio.data(), audio.size()));
+}
+
+// ============================================================================
+// Eviction Tests
+// ============================================================================
+
+void test_full_cache_evicts_least_recently_used() {
+    ResponseCache cache;
+    cache.begin(3 * 256);  // Three 128-sample clips
+    std::vector<int16_t> a = clip(128, 1), b = clip(128, 2), c = clip(128, 3), d = clip(128, 4);
+
+    cache.store("a", "Reply a.", a.data(), a.size());
+    cache.store("b", "Reply b.", b.data(), b.size());
+    cache.store("c", "Reply c.", c.data(), c.size());
+
+    ResponseCache::Hit hit;
+    cache.lookup("a", hit);  // b is now the oldest
+
+    TEST_ASSERT_TRUE(cache.store("d", "Reply d.", d.data(), d.size()));
+    TEST_ASSERT_TRUE(holds(cache, "a", 1, 128));
+    TEST_ASSERT_FALSE(cache.lookup("b", hit));
+    TEST_ASSERT_TRUE(holds(cache, "c", 3, 128));
+    TEST_ASSERT_TRUE(holds(cache, "d", 4, 128));
+}
+
+void test_pinned_prompts_are_never_evicted() {
+    ResponseCache cache;
+    cache.begin(2 * 256);
+    std::vector<int16_t> prompt = clip(128, 9), a = clip(128, 1), b = clip(128, 2);
+
+    TEST_ASSERT_TRUE(cache.storePrompt("Hi, I'm ready.", prompt.data(), prompt.size()));
+    cache.store("a", "Reply a.", a.data(), a.size());
+    cache.store("b", "Reply b.", b.data(), b.size());
+
+    TEST_ASSERT_TRUE(cache.hasPrompt("Hi, I'm ready."));
+    TEST_ASSERT_TRUE(holds(cache, "b", 2, 128));
+
+    // Nothing evictable is left once only prompts remain
+    cache.storePrompt("Sorry.", b.data(), b.size());
+    TEST_ASSERT_FALSE(cache.store("c", "Reply c.", a.data(), a.size()));
+}
+
+void test_prompt_key_does_not_collide_with_question() {
+    ResponseCache cache;
+    cache.begin(4096);
+    std::vector<int16_t> prompt = clip(64, 9);
+
+    cache.storePrompt("hello", prompt.data(), prompt.size());
+
+    ResponseCache::Hit hit;
+    TEST_ASSERT_FALSE(cache.lookup("hello", hit));
+}
+
+void test_scattered_space_is_compacted() {
+    ResponseCache cache;
+    cache.begin(5 * 128);  // Room for five 64-sample clips
+    std::vector<int16_t> a = clip(64, 1), b = clip(64, 2), c = clip(64, 3), d = clip(64, 4);
+    std::vector<int16_t> big = clip(128, 5);
+
+    cache.store("a", "Reply a.", a.data(), a.size());
+    cache.store("b", "Reply b.", b.data(), b.size());
+    cache.store("c", "Reply c.", c.data(), c.size());
+    cache.store("d", "Reply d.", d.data(), d.size());
+
+    // Short replacements for a and c leave free space split around b and d
+    std::vector<int16_t> small = clip(8, 6);
+    cache.store("a", "Reply a.", small.data(), small.size());
+    cache.store("c", "Reply c.", small.data(), small.size());
+
+    ResponseCache::Hit hit;
+    cache.lookup("b", hit);
+    cache.lookup("d", hit);
+
+    // Total free space fits, so nothing has to be evicted
+    TEST_ASSERT_TRUE(cache.store("big", "Big reply.", big.data(), big.size()));
+    TEST_ASSERT_EQUAL(5, cache.getCount());
+    TEST_ASSERT_TRUE(holds(cache, "a", 6, 8));
+    TEST_ASSERT_TRUE(holds(cache, "b", 2, 64));
+    TEST_ASSERT_TRUE(holds(cache, "c", 6, 8));
+    TEST_ASSERT_TRUE(holds(cache, "d", 4, 64));
+    TEST_ASSERT_TRUE(holds(cache, "big", 5, 128));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Normalization tests
+    RUN_TEST(test_normalize_drops_case_and_punctuation);
+    RUN_TEST(test_normalize_collapses_whitespace);
+    RUN_TEST(test_normalize_punctuation_only_is_empty);
+    RUN_TEST(test_cacheable_rejects_digits_and_empty);
+
+    // Store / lookup tests
+    RUN_TEST(test_lookup_matches_rephrased_punctuation);
+    RUN_TEST(test_store_skips_stale_reply);
+    RUN_TEST(test_store_replaces_same_question);
+    RUN_TEST(test_clip_larger_than_cache_is_rejected);
+
+    // Eviction tests
+    RUN_TEST(test_full_cache_evicts_least_recently_used);
+    RUN_TEST(test_pinned_prompts_are_never_evicted);
+    RUN_TEST(test_prompt_key_does_not_collide_with_question);
+    RUN_TEST(test_scattered_space_is_compacted);
+
+    return UNITY_END();
+}
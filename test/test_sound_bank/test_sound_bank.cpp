@@ -0,0 +1,245 @@
+/**
+ * Unit tests for the feedback sound bank
+ * Tests tone rendering and the cue layout from sound_bank.cpp
+ */
+
+#include <unity.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// SoundBank (extracted from sound_bank.h / sound_bank.cpp)
+// The block comes from malloc instead of heap_caps internal RAM
+// ============================================================================
+
+enum class Cue {
+    BEEP,
+    START,
+    STOP,
+    ERROR,
+    COUNT
+};
+
+#define TONE_AMPLITUDE  16000
+#define MAX_CUE_TONES   3
+
+struct Tone {
+    int frequency;
+    int durationMs;
+};
+
+static const Tone CUE_TONES[(int)Cue::COUNT][MAX_CUE_TONES] = {
+    { { 1000, 50 } },
+    { { 800, 100 }, { 0, 50 }, { 1200, 100 } },
+    { { 1200, 100 }, { 0, 50 }, { 800, 100 } },
+    { { 400, 200 }, { 0, 100 }, { 300, 300 } },
+};
+
+static size_t toneSamples(const Tone& tone, int sampleRate) {
+    return (size_t)sampleRate * tone.durationMs / 1000;
+}
+
+class SoundBank {
+public:
+    SoundBank() : _samples(nullptr) {}
+    ~SoundBank() { free(_samples); }
+
+    bool begin(int sampleRate) {
+        size_t total = 0;
+        for (int c = 0; c < (int)Cue::COUNT; c++) {
+            _offsets[c] = total;
+            _counts[c] = 0;
+            for (int t = 0; t < MAX_CUE_TONES; t++) {
+                _counts[c] += toneSamples(CUE_TONES[c][t], sampleRate);
+            }
+            total += _counts[c];
+        }
+
+        _samples = (int16_t*)malloc(total * sizeof(int16_t));
+        if (!_samples) return false;
+
+        for (int c = 0; c < (int)Cue::COUNT; c++) {
+            int16_t* out = _samples + _offsets[c];
+            for (int t = 0; t < MAX_CUE_TONES; t++) {
+                out += renderTone(out, CUE_TONES[c][t].frequency, CUE_TONES[c][t].durationMs, sampleRate);
+            }
+        }
+        return true;
+    }
+
+    const int16_t* get(Cue cue, size_t& count) const {
+        int index = (int)cue;
+        if (!_samples || index < 0 || index >= (int)Cue::COUNT) {
+            count = 0;
+            return nullptr;
+        }
+        count = _counts[index];
+        return _samples + _offsets[index];
+    }
+
+    static size_t renderTone(int16_t* out, int frequency, int durationMs, int sampleRate) {
+        size_t sampleCount = (size_t)sampleRate * durationMs / 1000;
+        if (frequency <= 0) {
+            memset(out, 0, sampleCount * sizeof(int16_t));
+            return sampleCount;
+        }
+
+        size_t fadeLen = sampleCount / 10;
+        float phaseIncrement = (2.0f * M_PI * frequency) / sampleRate;
+
+        for (size_t i = 0; i < sampleCount; i++) {
+            float envelope = 1.0f;
+            if (i < fadeLen) {
+                envelope = (float)i / fadeLen;
+            } else if (i > sampleCount - fadeLen) {
+                envelope = (float)(sampleCount - i) / fadeLen;
+            }
+            out[i] = (int16_t)(sinf(phaseIncrement * i) * TONE_AMPLITUDE * envelope);
+        }
+        return sampleCount;
+    }
+
+private:
+    int16_t* _samples;
+    size_t _offsets[(int)Cue::COUNT];
+    size_t _counts[(int)Cue::COUNT];
+};
+
+// ============================================================================
+// Test Helpers
+// ============================================================================
+
+static int16_t peakOf(const int16_t* samples, size_t count) {
+    int16_t peak = 0;
+    for (size_t i = 0; i < count; i++) {
+        int16_t magnitude = abs(samples[i]);
+        if (magnitude > peak) peak = magnitude;
+    }
+    return peak;
+}
+
+static size_t zeroCrossings(const int16_t* samples, size_t count) {
+    size_t crossings = 0;
+    for (size_t i = 1; i < count; i++) {
+        if ((samples[i - 1] >= 0) != (samples[i] >= 0)) crossings++;
+    }
+    return crossings;
+}
+
+// ============================================================================
+// Tone Tests
+// ============================================================================
+
+void test_tone_length_matches_duration() {
+    std::vector<int16_t> out(2000);
+    TEST_ASSERT_EQUAL(800, SoundBank::renderTone(out.data(), 1000, 50, 16000));
+}
+
+void test_tone_fades_in_and_out() {
+    std::vector<int16_t> out(1600);
+    size_t count = SoundBank::renderTone(out.data(), 1000, 100, 16000);
+
+    TEST_ASSERT_EQUAL(0, out[0]);
+    TEST_ASSERT_TRUE(abs(out[count - 1]) < 200);
+    TEST_ASSERT_TRUE(peakOf(out.data(), count) <= TONE_AMPLITUDE);
+    TEST_ASSERT_TRUE(peakOf(out.data() + count / 2 - 20, 40) > TONE_AMPLITUDE * 9 / 10);
+}
+
+void test_tone_frequency() {
+    std::vector<int16_t> out(16000);
+    size_t count = SoundBank::renderTone(out.data(), 800, 1000, 16000);
+
+    // Two crossings per cycle
+    size_t crossings = zeroCrossings(out.data(), count);
+    TEST_ASSERT_INT_WITHIN(4, 1600, (int)crossings);
+}
+
+void test_gap_is_silent() {
+    std::vector<int16_t> out(800, 123);
+    TEST_ASSERT_EQUAL(800, SoundBank::renderTone(out.data(), 0, 50, 16000));
+    TEST_ASSERT_EQUAL(0, peakOf(out.data(), 800));
+}
+
+// ============================================================================
+// Cue Layout Tests
+// ============================================================================
+
+void test_cue_lengths() {
+    SoundBank bank;
+    TEST_ASSERT_TRUE(bank.begin(16000));
+
+    size_t count;
+    bank.get(Cue::BEEP, count);
+    TEST_ASSERT_EQUAL(800, count);
+    bank.get(Cue::START, count);
+    TEST_ASSERT_EQUAL(4000, count);
+    bank.get(Cue::ERROR, count);
+    TEST_ASSERT_EQUAL(9600, count);
+}
+
+void test_start_cue_has_gap_between_tones() {
+    SoundBank bank;
+    bank.begin(16000);
+
+    size_t count;
+    const int16_t* start = bank.get(Cue::START, count);
+
+    TEST_ASSERT_TRUE(peakOf(start, 1600) > 0);
+    TEST_ASSERT_EQUAL(0, peakOf(start + 1600, 800));
+    TEST_ASSERT_TRUE(peakOf(start + 2400, 1600) > 0);
+}
+
+void test_cues_do_not_overlap() {
+    SoundBank bank;
+    bank.begin(16000);
+
+    size_t beepCount, startCount;
+    const int16_t* beep = bank.get(Cue::BEEP, beepCount);
+    const int16_t* start = bank.get(Cue::START, startCount);
+    TEST_ASSERT_TRUE(beep + beepCount <= start);
+
+    std::vector<int16_t> reference(4000);
+    SoundBank::renderTone(reference.data(), 800, 100, 16000);
+    TEST_ASSERT_EQUAL_INT16_ARRAY(reference.data(), start, 1600);
+}
+
+void test_invalid_cue_returns_null() {
+    SoundBank bank;
+    size_t count = 99;
+    TEST_ASSERT_NULL(bank.get(Cue::BEEP, count));
+    TEST_ASSERT_EQUAL(0, count);
+
+    bank.begin(16000);
+    TEST_ASSERT_NULL(bank.get(Cue::COUNT, count));
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Tone tests
+    RUN_TEST(test_tone_length_matches_duration);
+    RUN_TEST(test_tone_fades_in_and_out);
+    RUN_TEST(test_tone_frequency);
+    RUN_TEST(test_gap_is_silent);
+
+    // Cue layout tests
+    RUN_TEST(test_cue_lengths);
+    RUN_TEST(test_start_cue_has_gap_between_tones);
+    RUN_TEST(test_cues_do_not_overlap);
+    RUN_TEST(test_invalid_cue_returns_null);
+
+    return UNITY_END();
+}
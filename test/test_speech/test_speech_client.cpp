@@ -111,6 +111,30 @@ std::vector<uint8_t> base64Decode(const String& encoded) {
     return result;
 }
 
+// Block encoder used by the streaming STT upload (extracted from speech_client.cpp)
+size_t base64EncodeBlock(const uint8_t* data, size_t length, char* out) {
+    char* p = out;
+
+    while (length >= 3) {
+        *p++ = base64_chars[data[0] >> 2];
+        *p++ = base64_chars[((data[0] & 0x03) << 4) | (data[1] >> 4)];
+        *p++ = base64_chars[((data[1] & 0x0f) << 2) | (data[2] >> 6)];
+        *p++ = base64_chars[data[2] & 0x3f];
+        data += 3;
+        length -= 3;
+    }
+
+    if (length > 0) {
+        uint8_t b1 = length > 1 ? data[1] : 0;
+        *p++ = base64_chars[data[0] >> 2];
+        *p++ = base64_chars[((data[0] & 0x03) << 4) | (b1 >> 4)];
+        *p++ = length > 1 ? base64_chars[(b1 & 0x0f) << 2] : '=';
+        *p++ = '=';
+    }
+
+    return p - out;
+}
+
 // ============================================================================
 // STT Response parsing (extracted from speech_client.cpp)
 // ============================================================================
@@ -243,6 +267,40 @@ void test_base64_roundtrip_binary() {
     TEST_ASSERT_EQUAL_MEMORY(original, decoded.data(), decoded.size());
 }
 
+void test_base64_block_encode_matches_single_pass() {
+    // Streaming upload encodes 1536-byte blocks; the concatenation must equal
+    // a one-shot encode for any length
+    const size_t BLOCK = 1536;
+    std::vector<uint8_t> data(BLOCK * 3 + 7);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (uint8_t)(i * 37 + 11);
+    }
+
+    String expected = base64Encode(data.data(), data.size());
+
+    std::string streamed;
+    char block[BLOCK / 3 * 4 + 4];
+    for (size_t pos = 0; pos < data.size(); pos += BLOCK) {
+        size_t len = min(BLOCK, data.size() - pos);
+        size_t n = base64EncodeBlock(data.data() + pos, len, block);
+        streamed.append(block, n);
+    }
+
+    TEST_ASSERT_EQUAL(expected.length(), streamed.size());
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), streamed.c_str());
+}
+
+void test_base64_block_encode_padding() {
+    char out[8];
+    size_t n = base64EncodeBlock((const uint8_t*)"M", 1, out);
+    TEST_ASSERT_EQUAL(4, n);
+    TEST_ASSERT_EQUAL_MEMORY("TQ==", out, 4);
+
+    n = base64EncodeBlock((const uint8_t*)"Ma", 2, out);
+    TEST_ASSERT_EQUAL(4, n);
+    TEST_ASSERT_EQUAL_MEMORY("TWE=", out, 4);
+}
+
 // ============================================================================
 // STT Response Test Cases
 // ============================================================================
@@ -369,6 +427,8 @@ int main(int argc, char** argv) {
     RUN_TEST(test_base64_decode_hello);
     RUN_TEST(test_base64_roundtrip);
     RUN_TEST(test_base64_roundtrip_binary);
+    RUN_TEST(test_base64_block_encode_matches_single_pass);
+    RUN_TEST(test_base64_block_encode_padding);
 
     // STT response parsing tests
     RUN_TEST(test_stt_parse_valid_response);
@@ -0,0 +1,235 @@
+/**
+ * Unit tests for the TTS sentence pipeline
+ * Tests the sentence splitting logic extracted from tts_pipeline.cpp
+ */
+
+#include <unity.h>
+#include <vector>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// SentenceSplitter (from tts_pipeline.cpp)
+// ============================================================================
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+class SentenceSplitter {
+public:
+    SentenceSplitter(size_t minChars, size_t maxChars)
+        : _minChars(minChars), _maxChars(maxChars) {}
+
+    void reset() { _pending = ""; }
+    void push(const String& text) { _pending += text; }
+
+    bool next(String& sentence) {
+        while (true) {
+            int end = findBoundary();
+            if (end < 0) return false;
+
+            take(end, sentence);
+            if (sentence.length() > 0) return true;
+        }
+    }
+
+    bool flush(String& sentence) {
+        take(_pending.length(), sentence);
+        return sentence.length() > 0;
+    }
+
+private:
+    int findBoundary() const {
+        int length = _pending.length();
+
+        for (int i = 0; i + 1 < length; i++) {
+            char c = _pending[i];
+            bool terminator = c == '.' || c == '!' || c == '?' || c == ':' || c == ';';
+            if ((c == '\n' || (terminator && isSpace(_pending[i + 1]))) && (size_t)(i + 1) >= _minChars) {
+                return i + 1;
+            }
+        }
+
+        if ((size_t)length <= _maxChars) return -1;
+
+        for (int i = _maxChars; i > (int)_maxChars / 2; i--) {
+            if (_pending[i - 1] == ',' && isSpace(_pending[i])) return i;
+        }
+        for (int i = _maxChars; i > 0; i--) {
+            if (isSpace(_pending[i])) return i;
+        }
+        return _maxChars;
+    }
+
+    void take(int end, String& sentence) {
+        sentence = _pending.substring(0, end);
+        sentence.trim();
+
+        while (end < (int)_pending.length() && isSpace(_pending[end])) end++;
+        _pending = _pending.substring(end);
+    }
+
+    String _pending;
+    size_t _minChars;
+    size_t _maxChars;
+};
+
+// Feeds text in fragments of fragmentSize and collects every sentence
+std::vector<String> splitAll(const String& text, size_t fragmentSize,
+                             size_t minChars = 20, size_t maxChars = 200) {
+    SentenceSplitter splitter(minChars, maxChars);
+    std::vector<String> sentences;
+    String sentence;
+
+    for (size_t pos = 0; pos < text.length(); pos += fragmentSize) {
+        splitter.push(text.substring(pos, pos + fragmentSize));
+        while (splitter.next(sentence)) {
+            sentences.push_back(sentence);
+        }
+    }
+
+    if (splitter.flush(sentence)) {
+        sentences.push_back(sentence);
+    }
+    return sentences;
+}
+
+// ============================================================================
+// Test Cases
+// ============================================================================
+
+void test_split_two_sentences() {
+    auto s = splitAll("The weather is sunny today. Expect a high of 25 degrees.", 1000);
+    TEST_ASSERT_EQUAL(2, s.size());
+    TEST_ASSERT_EQUAL_STRING("The weather is sunny today.", s[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("Expect a high of 25 degrees.", s[1].c_str());
+}
+
+void test_split_across_fragments() {
+    // Gemini deltas end anywhere, including right after the period
+    auto s = splitAll("The weather is sunny today. Expect a high of 25 degrees.", 3);
+    TEST_ASSERT_EQUAL(2, s.size());
+    TEST_ASSERT_EQUAL_STRING("The weather is sunny today.", s[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("Expect a high of 25 degrees.", s[1].c_str());
+}
+
+void test_sentence_ready_before_reply_ends() {
+    SentenceSplitter splitter(20, 200);
+    String sentence;
+
+    splitter.push("Sure, here is the answer you need.");
+    TEST_ASSERT_FALSE(splitter.next(sentence));  // Period not confirmed yet
+
+    splitter.push(" And more");
+    TEST_ASSERT_TRUE(splitter.next(sentence));
+    TEST_ASSERT_EQUAL_STRING("Sure, here is the answer you need.", sentence.c_str());
+    TEST_ASSERT_FALSE(splitter.next(sentence));
+}
+
+void test_decimal_number_not_split() {
+    auto s = splitAll("The temperature today will be 21.5 degrees in the city.", 4);
+    TEST_ASSERT_EQUAL(1, s.size());
+    TEST_ASSERT_EQUAL_STRING("The temperature today will be 21.5 degrees in the city.", s[0].c_str());
+}
+
+void test_short_sentences_merged() {
+    // "Yes." alone would cost a full TTS request for half a second of audio
+    auto s = splitAll("Yes. Sure thing! The meeting starts at noon. Bring your notes.", 1000);
+    TEST_ASSERT_EQUAL(2, s.size());
+    TEST_ASSERT_EQUAL_STRING("Yes. Sure thing! The meeting starts at noon.", s[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("Bring your notes.", s[1].c_str());
+}
+
+void test_question_and_exclamation() {
+    auto s = splitAll("Did you know that octopuses have three hearts? It's true, they really do!", 5);
+    TEST_ASSERT_EQUAL(2, s.size());
+    TEST_ASSERT_EQUAL_STRING("Did you know that octopuses have three hearts?", s[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("It's true, they really do!", s[1].c_str());
+}
+
+void test_newline_is_boundary() {
+    auto s = splitAll("Here is the first line of text\nand here is the second line", 1000);
+    TEST_ASSERT_EQUAL(2, s.size());
+    TEST_ASSERT_EQUAL_STRING("Here is the first line of text", s[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("and here is the second line", s[1].c_str());
+}
+
+void test_long_run_cut_at_comma() {
+    String text = "This sentence keeps going without a stop, and it just continues on and on";
+    auto s = splitAll(text, 1000, 10, 50);
+    TEST_ASSERT_EQUAL(2, s.size());
+    TEST_ASSERT_EQUAL_STRING("This sentence keeps going without a stop,", s[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("and it just continues on and on", s[1].c_str());
+}
+
+void test_long_run_cut_at_space() {
+    String text = "aaaa bbbb cccc dddd eeee ffff gggg hhhh iiii jjjj";
+    auto s = splitAll(text, 1000, 5, 22);
+    TEST_ASSERT_TRUE(s.size() >= 2);
+    for (const auto& sentence : s) {
+        TEST_ASSERT_TRUE(sentence.length() <= 22);
+        TEST_ASSERT_FALSE(sentence.startsWith(" "));
+    }
+}
+
+void test_flush_returns_remainder() {
+    auto s = splitAll("No terminator at the end of this reply", 7);
+    TEST_ASSERT_EQUAL(1, s.size());
+    TEST_ASSERT_EQUAL_STRING("No terminator at the end of this reply", s[0].c_str());
+}
+
+void test_empty_reply() {
+    auto s = splitAll("   ", 1);
+    TEST_ASSERT_EQUAL(0, s.size());
+}
+
+void test_long_reply_not_truncated() {
+    // Replies used to be cut at 500 characters before TTS
+    String text;
+    for (int i = 0; i < 20; i++) {
+        text += "This is sentence number " + String(i) + " of the reply. ";
+    }
+
+    auto s = splitAll(text, 6);
+    TEST_ASSERT_EQUAL(20, s.size());
+    TEST_ASSERT_EQUAL_STRING("This is sentence number 19 of the reply.", s[19].c_str());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {
+    // Setup before each test
+}
+
+void tearDown() {
+    // Cleanup after each test
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Sentence boundaries
+    RUN_TEST(test_split_two_sentences);
+    RUN_TEST(test_split_across_fragments);
+    RUN_TEST(test_sentence_ready_before_reply_ends);
+    RUN_TEST(test_decimal_number_not_split);
+    RUN_TEST(test_question_and_exclamation);
+    RUN_TEST(test_newline_is_boundary);
+
+    // Length limits
+    RUN_TEST(test_short_sentences_merged);
+    RUN_TEST(test_long_run_cut_at_comma);
+    RUN_TEST(test_long_run_cut_at_space);
+    RUN_TEST(test_long_reply_not_truncated);
+
+    // End of reply
+    RUN_TEST(test_flush_returns_remainder);
+    RUN_TEST(test_empty_reply);
+
+    return UNITY_END();
+}
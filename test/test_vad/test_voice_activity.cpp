@@ -0,0 +1,577 @@
+/**
+ * Unit tests for voice activity detection
+ * Tests the noise floor, onset, hangover and end of utterance of the
+ * VoiceActivityDetector from audio_input.h / audio_input.cpp
+ */
+
+#include <unity.h>
+#include <cstdlib>
+#include <vector>
+
+#ifdef NATIVE_BUILD
+#include "../mocks/Arduino.h"
+#endif
+
+// ============================================================================
+// DSP kernels used by the detector (extracted from audio_dsp.cpp)
+// ============================================================================
+
+int32_t dspMeanAbs(const int16_t* samples, size_t count) {
+    if (count == 0) return 0;
+
+    int32_t sum = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        sum += abs(samples[i]) + abs(samples[i + 1]) + abs(samples[i + 2]) + abs(samples[i + 3]);
+    }
+    for (; i < count; i++) {
+        sum += abs(samples[i]);
+    }
+    return sum / (int32_t)count;
+}
+
+uint32_t dspZeroCrossings(const int16_t* samples, size_t count) {
+    // Neighbours differ in sign exactly when their XOR is negative
+    uint32_t crossings = 0;
+    size_t i = 1;
+    for (; i + 4 <= count; i += 4) {
+        crossings += ((samples[i - 1] ^ samples[i])     < 0)
+                   + ((samples[i]     ^ samples[i + 1]) < 0)
+                   + ((samples[i + 1] ^ samples[i + 2]) < 0)
+                   + ((samples[i + 2] ^ samples[i + 3]) < 0);
+    }
+    for (; i < count; i++) {
+        crossings += (samples[i - 1] ^ samples[i]) < 0;
+    }
+    return crossings;
+}
+
+// ============================================================================
+// VoiceActivityDetector (extracted from audio_input.h / audio_input.cpp)
+// ============================================================================
+
+class VoiceActivityDetector {
+public:
+    static const size_t FRAME_SAMPLES = 512;   // 32 ms at 16 kHz
+
+    VoiceActivityDetector(uint32_t sampleRate, int minLevel, float onsetRatio, float releaseRatio,
+                          uint32_t onsetMs, uint32_t endSilenceMs, uint32_t noSpeechMs);
+
+    // New utterance; the first prerollSamples were captured before it began.
+    // noiseLevel is the room's mean absolute sample level if it was measured
+    // beforehand (0: use the floor learned in the last utterance)
+    void reset(size_t prerollSamples = 0, int noiseLevel = 0);
+
+    // Samples in any block size (frames are assembled internally)
+    void process(const int16_t* samples, size_t count);
+
+    bool inSpeech() const { return _inSpeech; }
+    bool hasSpeech() const { return _hasSpeech; }
+
+    // End of utterance, or nobody spoke after the pre-roll within noSpeechMs
+    bool isEnded() const { return _ended; }
+
+    // Sample positions (from reset) of the first and past the last speech frame
+    size_t getSpeechStart() const { return _speechStart; }
+    size_t getSpeechEnd() const { return _speechEnd; }
+
+    int getNoiseFloor() const { return (int)_floor; }
+    int getLevel() const { return _level; }
+
+private:
+    static const size_t NOISE_BLOCKS = 4;        // Minimum tracked over 4 blocks
+    static const uint32_t BLOCK_FRAMES = 16;     // of ~0.5 s each
+
+    void processFrame();
+    void trackNoise(int level);
+
+    uint32_t _sampleRate;
+    int _minLevel;
+    float _onsetRatio;
+    float _releaseRatio;
+    uint32_t _onsetFrames;
+    uint32_t _endFrames;
+    size_t _noSpeechSamples;
+
+    // Frame being assembled
+    int32_t _absSum;
+    uint32_t _crossings;
+    int16_t _lastSample;
+    size_t _frameFill;
+    size_t _position;   // Samples in completed frames
+
+    // Noise floor
+    int _blockMin[NOISE_BLOCKS];
+    size_t _block;
+    uint32_t _blockFrames;
+    float _floor;
+    int _learnedFloor;  // Kept across reset(); 0 until a block has been heard
+
+    // Endpointing
+    int _level;
+    uint32_t _activeRun;
+    uint32_t _quietRun;
+    size_t _runStart;
+    size_t _armAfter;
+    bool _inSpeech;
+    bool _hasSpeech;
+    bool _armed;
+    bool _ended;
+    size_t _speechStart;
+    size_t _speechEnd;
+};
+
+// Onsets with more sign changes than this are noise bursts (clicks, hiss)
+// rather than the start of voiced speech
+#define VAD_MAX_ONSET_ZCR     0.45f
+
+static uint32_t msToFrames(uint32_t ms, uint32_t sampleRate) {
+    const uint32_t frame = VoiceActivityDetector::FRAME_SAMPLES;
+    return max((ms * sampleRate / 1000 + frame - 1) / frame, (uint32_t)1);
+}
+
+VoiceActivityDetector::VoiceActivityDetector(uint32_t sampleRate, int minLevel, float onsetRatio,
+                                             float releaseRatio, uint32_t onsetMs,
+                                             uint32_t endSilenceMs, uint32_t noSpeechMs)
+    : _sampleRate(sampleRate)
+    , _minLevel(minLevel)
+    , _onsetRatio(onsetRatio)
+    , _releaseRatio(releaseRatio)
+    , _onsetFrames(msToFrames(onsetMs, sampleRate))
+    , _endFrames(msToFrames(endSilenceMs, sampleRate))
+    , _noSpeechSamples((size_t)noSpeechMs * sampleRate / 1000)
+    , _learnedFloor(0)
+{
+    reset();
+}
+
+void VoiceActivityDetector::reset(size_t prerollSamples, int noiseLevel) {
+    _absSum = 0;
+    _crossings = 0;
+    _lastSample = 0;
+    _frameFill = 0;
+    _position = 0;
+
+    // The window starts out as if it had heard the room already: at the
+    // level measured before the recording, else the floor learned in the
+    // last one. Only with neither is it a guess that leaves the threshold
+    // at the minimum level until real blocks replace it
+    int prior = noiseLevel > 0 ? noiseLevel
+              : _learnedFloor > 0 ? _learnedFloor
+              : (int)(_minLevel / _onsetRatio);
+    for (size_t i = 0; i < NOISE_BLOCKS; i++) {
+        _blockMin[i] = prior;
+    }
+    _block = 0;
+    _blockFrames = 0;
+    _floor = prior;
+
+    _level = 0;
+    _activeRun = 0;
+    _quietRun = 0;
+    _runStart = 0;
+    _armAfter = prerollSamples;
+    _inSpeech = false;
+    _hasSpeech = false;
+    _armed = false;
+    _ended = false;
+    _speechStart = 0;
+    _speechEnd = 0;
+}
+
+void VoiceActivityDetector::process(const int16_t* samples, size_t count) {
+    while (count > 0 && !_ended) {
+        size_t n = min(count, FRAME_SAMPLES - _frameFill);
+
+        _absSum += dspMeanAbs(samples, n) * (int32_t)n;
+        _crossings += ((_lastSample ^ samples[0]) < 0) + dspZeroCrossings(samples, n);
+        _lastSample = samples[n - 1];
+
+        _frameFill += n;
+        samples += n;
+        count -= n;
+
+        if (_frameFill == FRAME_SAMPLES) {
+            processFrame();
+            _absSum = 0;
+            _crossings = 0;
+            _frameFill = 0;
+        }
+    }
+}
+
+void VoiceActivityDetector::processFrame() {
+    int level = _absSum / (int32_t)FRAME_SAMPLES;
+    float zcr = (float)_crossings / FRAME_SAMPLES;
+    size_t frameStart = _position;
+    _position += FRAME_SAMPLES;
+    _level = level;
+
+    // Hysteresis: starting speech takes more than continuing it, and only
+    // a voiced frame can start it (fricatives can continue it)
+    float threshold = max((float)_minLevel, _floor * (_inSpeech ? _releaseRatio : _onsetRatio));
+    bool active = level > threshold && (_inSpeech || zcr < VAD_MAX_ONSET_ZCR);
+    trackNoise(level);
+
+    if (active) {
+        _quietRun = 0;
+        if (_activeRun++ == 0) _runStart = frameStart;
+
+        if (!_inSpeech && _activeRun >= _onsetFrames) {
+            _inSpeech = true;
+            if (!_hasSpeech) {
+                _hasSpeech = true;
+                _speechStart = _runStart;
+            }
+        }
+        if (_inSpeech) {
+            _speechEnd = _position;
+            if (frameStart >= _armAfter) _armed = true;
+        }
+    } else {
+        _activeRun = 0;
+
+        // Hangover: speech carries on through pauses shorter than the end
+        if (_inSpeech && ++_quietRun >= _endFrames) {
+            _inSpeech = false;
+            _quietRun = 0;
+            if (_armed) _ended = true;
+        }
+    }
+
+    if (!_armed && !_inSpeech && _position >= _armAfter + _noSpeechSamples) {
+        _ended = true;
+    }
+}
+
+void VoiceActivityDetector::trackNoise(int level) {
+    _blockMin[_block] = min(_blockMin[_block], level);
+
+    int lowest = _blockMin[0];
+    for (size_t i = 1; i < NOISE_BLOCKS; i++) {
+        lowest = min(lowest, _blockMin[i]);
+    }
+    // Smoothed, so one quiet frame does not drop the threshold at once
+    _floor += (lowest - _floor) * 0.3f;
+
+    if (++_blockFrames >= BLOCK_FRAMES) {
+        _blockFrames = 0;
+        _learnedFloor = (int)_floor;
+        _block = (_block + 1) % NOISE_BLOCKS;
+        _blockMin[_block] = INT32_MAX;
+    }
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+#define RATE           16000
+#define MIN_LEVEL      500
+#define END_SILENCE_MS 500
+#define NO_SPEECH_MS   4000
+
+static size_t ms(uint32_t milliseconds) {
+    return (size_t)RATE * milliseconds / 1000;
+}
+
+static VoiceActivityDetector makeVad() {
+    return VoiceActivityDetector(RATE, MIN_LEVEL, 3.0f, 2.0f, 64, END_SILENCE_MS, NO_SPEECH_MS);
+}
+
+// Signal built piece by piece: voiced tone bursts over optional room noise
+class Signal {
+public:
+    explicit Signal(int noiseLevel = 0) : _noiseLevel(noiseLevel), _seed(1), _smooth(0) {}
+
+    Signal& silence(uint32_t milliseconds) { return tone(milliseconds, 0, 0); }
+
+    // 200 Hz is well inside the voiced range (low zero-crossing rate)
+    Signal& speech(uint32_t milliseconds, int amplitude) { return tone(milliseconds, amplitude, 200); }
+
+    Signal& tone(uint32_t milliseconds, int amplitude, int frequency) {
+        for (size_t i = 0; i < ms(milliseconds); i++) {
+            float t = (float)_samples.size() / RATE;
+            float value = amplitude * sinf(2.0f * (float)M_PI * frequency * t) + noise();
+            _samples.push_back((int16_t)constrain(value, -32768.0f, 32767.0f));
+        }
+        return *this;
+    }
+
+    // Alternating samples: all high-frequency energy, like a click or hiss
+    Signal& buzz(uint32_t milliseconds, int amplitude) {
+        for (size_t i = 0; i < ms(milliseconds); i++) {
+            _samples.push_back((int16_t)((i & 1) ? amplitude : -amplitude));
+        }
+        return *this;
+    }
+
+    const std::vector<int16_t>& samples() const { return _samples; }
+
+private:
+    // Low-passed noise (fan, traffic) with a mean level near _noiseLevel
+    float noise() {
+        if (_noiseLevel == 0) return 0;
+        _seed = _seed * 1103515245 + 12345;
+        float white = (float)((int32_t)(_seed >> 8) % 2000 - 1000) / 1000.0f;
+        _smooth = 0.9f * _smooth + 0.1f * white;
+        return _smooth * _noiseLevel * 6.0f;
+    }
+
+    int _noiseLevel;
+    std::vector<int16_t> _samples;
+    uint32_t _seed;
+    float _smooth;
+};
+
+// Feeds the signal in mic-sized blocks; returns the sample position where
+// the detector reported the end (or the signal length if it never did)
+static size_t feed(VoiceActivityDetector& vad, const std::vector<int16_t>& samples,
+                   size_t block = 512) {
+    size_t pos = 0;
+    while (pos < samples.size() && !vad.isEnded()) {
+        size_t n = min(block, samples.size() - pos);
+        vad.process(samples.data() + pos, n);
+        pos += n;
+    }
+    return pos;
+}
+
+// ============================================================================
+// Endpointing Tests
+// ============================================================================
+
+void test_silence_never_starts_speech() {
+    VoiceActivityDetector vad = makeVad();
+    Signal signal;
+    signal.silence(3000);
+    feed(vad, signal.samples());
+
+    TEST_ASSERT_FALSE(vad.hasSpeech());
+    TEST_ASSERT_FALSE(vad.isEnded());
+}
+
+void test_no_speech_times_out() {
+    VoiceActivityDetector vad = makeVad();
+    Signal signal;
+    signal.silence(6000);
+    size_t endedAt = feed(vad, signal.samples());
+
+    TEST_ASSERT_TRUE(vad.isEnded());
+    TEST_ASSERT_FALSE(vad.hasSpeech());
+    TEST_ASSERT_UINT32_WITHIN(ms(40), ms(NO_SPEECH_MS), endedAt);
+}
+
+void test_utterance_ends_after_end_silence() {
+    VoiceActivityDetector vad = makeVad();
+    Signal signal;
+    signal.silence(300).speech(1500, 4000).silence(2000);
+    size_t endedAt = feed(vad, signal.samples());
+
+    TEST_ASSERT_TRUE(vad.isEnded());
+    TEST_ASSERT_TRUE(vad.hasSpeech());
+    // Ends END_SILENCE_MS after the speech, not the old fixed 1.5 s
+    TEST_ASSERT_UINT32_WITHIN(ms(70), ms(1800 + END_SILENCE_MS), endedAt);
+}
+
+void test_speech_bounds_found() {
+    VoiceActivityDetector vad = makeVad();
+    Signal signal;
+    signal.silence(800).speech(1000, 4000).silence(1000);
+    feed(vad, signal.samples());
+
+    TEST_ASSERT_UINT32_WITHIN(ms(40), ms(800), vad.getSpeechStart());
+    TEST_ASSERT_UINT32_WITHIN(ms(40), ms(1800), vad.getSpeechEnd());
+}
+
+void test_short_pause_carries_on() {
+    VoiceActivityDetector vad = makeVad();
+    Signal signal;
+    signal.speech(800, 4000).silence(300).speech(800, 4000).silence(1000);
+    size_t endedAt = feed(vad, signal.samples());
+
+    TEST_ASSERT_UINT32_WITHIN(ms(40), 0, vad.getSpeechStart());
+    TEST_ASSERT_UINT32_WITHIN(ms(40), ms(1900), vad.getSpeechEnd());
+    TEST_ASSERT_TRUE(endedAt > ms(1900 + END_SILENCE_MS - 40));
+}
+
+void test_click_does_not_start_speech() {
+    // One loud frame is shorter than the onset run
+    VoiceActivityDetector vad = makeVad();
+    Signal signal;
+    signal.silence(512).speech(32, 8000).silence(1000);  // Exactly one frame
+    feed(vad, signal.samples());
+
+    TEST_ASSERT_FALSE(vad.hasSpeech());
+}
+
+void test_unvoiced_burst_does_not_start_speech() {
+    VoiceActivityDetector vad = makeVad();
+    Signal signal;
+    signal.silence(500).buzz(500, 6000).silence(1000);
+    feed(vad, signal.samples());
+
+    TEST_ASSERT_FALSE(vad.hasSpeech());
+}
+
+void test_quiet_speech_below_minimum_ignored() {
+    VoiceActivityDetector vad = makeVad();
+    Signal signal;
+    signal.speech(1500, MIN_LEVEL / 2);
+    feed(vad, signal.samples());
+
+    TEST_ASSERT_FALSE(vad.hasSpeech());
+}
+
+// ============================================================================
+// Noise Floor Tests
+// ============================================================================
+
+void test_noise_floor_follows_room() {
+    VoiceActivityDetector vad = makeVad();
+    Signal signal(1500);
+    signal.silence(3000);
+    feed(vad, signal.samples());
+
+    TEST_ASSERT_INT_WITHIN(600, 1200, vad.getNoiseFloor());
+}
+
+void test_noisy_room_still_ends() {
+    // Room noise well above VAD_THRESHOLD used to keep a fixed detector
+    // recording until the buffer filled
+    VoiceActivityDetector vad = makeVad();
+    Signal signal(1500);
+    signal.silence(2500).speech(1500, 8000).silence(6000);
+    size_t endedAt = feed(vad, signal.samples());
+
+    TEST_ASSERT_TRUE(vad.isEnded());
+    TEST_ASSERT_TRUE(endedAt < ms(4000 + END_SILENCE_MS + 200));
+    TEST_ASSERT_UINT32_WITHIN(ms(100), ms(4000), vad.getSpeechEnd());
+}
+
+void test_noisy_room_floor_carried_to_next_utterance() {
+    // No quiet lead-in this time: the floor heard in the last recording
+    // keeps the room noise from counting as speech
+    VoiceActivityDetector vad = makeVad();
+    Signal room(1500);
+    room.silence(3000);
+    feed(vad, room.samples());
+
+    vad.reset(ms(300));
+    Signal signal(1500);
+    signal.silence(300).speech(800, 8000).silence(6000);
+    size_t endedAt = feed(vad, signal.samples());
+
+    TEST_ASSERT_TRUE(vad.isEnded());
+    TEST_ASSERT_UINT32_WITHIN(ms(100), ms(300), vad.getSpeechStart());
+    TEST_ASSERT_UINT32_WITHIN(ms(100), ms(1100), vad.getSpeechEnd());
+    TEST_ASSERT_TRUE(endedAt < ms(1100 + END_SILENCE_MS + 200));
+}
+
+void test_noisy_room_speech_right_after_preroll() {
+    // First utterance, room level measured beforehand (by the wake word
+    // detector): speech straight after the pre-roll is trimmed tight
+    VoiceActivityDetector vad = makeVad();
+    vad.reset(ms(300), 1200);
+    Signal signal(1500);
+    signal.silence(300).speech(800, 8000).silence(6000);
+    size_t endedAt = feed(vad, signal.samples());
+
+    TEST_ASSERT_TRUE(vad.isEnded());
+    TEST_ASSERT_UINT32_WITHIN(ms(100), ms(300), vad.getSpeechStart());
+    TEST_ASSERT_UINT32_WITHIN(ms(100), ms(1100), vad.getSpeechEnd());
+    TEST_ASSERT_TRUE(endedAt < ms(1100 + END_SILENCE_MS + 200));
+}
+
+void test_measured_level_too_high_falls_to_room() {
+    // A level measured in a louder moment must not hide normal speech
+    VoiceActivityDetector vad = makeVad();
+    vad.reset(0, 3000);
+    Signal signal(300);
+    signal.silence(300).speech(1000, 4000).silence(1500);
+    feed(vad, signal.samples());
+
+    TEST_ASSERT_TRUE(vad.hasSpeech());
+    TEST_ASSERT_UINT32_WITHIN(ms(100), ms(300), vad.getSpeechStart());
+}
+
+// ============================================================================
+// Pre-roll and Framing Tests
+// ============================================================================
+
+void test_pause_after_preroll_speech_waits() {
+    // The wake word is in the pre-roll; the question comes after a pause
+    VoiceActivityDetector vad = makeVad();
+    vad.reset(ms(500));
+    Signal signal;
+    signal.speech(500, 4000).silence(1500).speech(1000, 4000).silence(1000);
+    size_t endedAt = feed(vad, signal.samples());
+
+    TEST_ASSERT_TRUE(vad.isEnded());
+    TEST_ASSERT_UINT32_WITHIN(ms(40), 0, vad.getSpeechStart());
+    TEST_ASSERT_UINT32_WITHIN(ms(40), ms(3000), vad.getSpeechEnd());
+    TEST_ASSERT_TRUE(endedAt > ms(3000));
+}
+
+void test_block_size_does_not_matter() {
+    Signal signal(300);
+    signal.silence(700).speech(1200, 5000).silence(1200);
+
+    VoiceActivityDetector whole = makeVad();
+    VoiceActivityDetector pieces = makeVad();
+    size_t endWhole = feed(whole, signal.samples(), 512);
+    size_t endPieces = feed(pieces, signal.samples(), 100);
+
+    TEST_ASSERT_EQUAL(whole.getSpeechStart(), pieces.getSpeechStart());
+    TEST_ASSERT_EQUAL(whole.getSpeechEnd(), pieces.getSpeechEnd());
+    TEST_ASSERT_UINT32_WITHIN(512, endWhole, endPieces);
+}
+
+void test_reset_starts_over() {
+    VoiceActivityDetector vad = makeVad();
+    Signal signal;
+    signal.speech(1000, 4000).silence(1000);
+    feed(vad, signal.samples());
+    TEST_ASSERT_TRUE(vad.isEnded());
+
+    vad.reset();
+    TEST_ASSERT_FALSE(vad.isEnded());
+    TEST_ASSERT_FALSE(vad.hasSpeech());
+    TEST_ASSERT_FALSE(vad.inSpeech());
+    TEST_ASSERT_EQUAL(0, vad.getSpeechEnd());
+}
+
+// ============================================================================
+// Test Runner
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+
+    // Endpointing
+    RUN_TEST(test_silence_never_starts_speech);
+    RUN_TEST(test_no_speech_times_out);
+    RUN_TEST(test_utterance_ends_after_end_silence);
+    RUN_TEST(test_speech_bounds_found);
+    RUN_TEST(test_short_pause_carries_on);
+    RUN_TEST(test_click_does_not_start_speech);
+    RUN_TEST(test_unvoiced_burst_does_not_start_speech);
+    RUN_TEST(test_quiet_speech_below_minimum_ignored);
+
+    // Noise floor
+    RUN_TEST(test_noise_floor_follows_room);
+    RUN_TEST(test_noisy_room_still_ends);
+    RUN_TEST(test_noisy_room_floor_carried_to_next_utterance);
+    RUN_TEST(test_noisy_room_speech_right_after_preroll);
+    RUN_TEST(test_measured_level_too_high_falls_to_room);
+
+    // Pre-roll and framing
+    RUN_TEST(test_pause_after_preroll_speech_waits);
+    RUN_TEST(test_block_size_does_not_matter);
+    RUN_TEST(test_reset_starts_over);
+
+    return UNITY_END();
+}
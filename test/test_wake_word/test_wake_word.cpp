@@ -109,6 +109,71 @@ bool processFrame(WakeWordState& state, float energy, float zcr, float avgEnergy
     return false;
 }
 
+// ============================================================================
+// Running statistics (extracted from wake_word.h)
+// ============================================================================
+
+template <size_t N>
+class RunningMean {
+public:
+    RunningMean() { reset(); }
+
+    void reset() {
+        memset(_values, 0, sizeof(_values));
+        _sum = 0;
+        _index = 0;
+    }
+
+    void push(float value) {
+        _sum += value - _values[_index];
+        _values[_index] = value;
+        if (++_index == N) {
+            _index = 0;
+            _sum = 0;
+            for (size_t i = 0; i < N; i++) _sum += _values[i];
+        }
+    }
+
+    float mean() const { return _sum / N; }
+    float latest() const { return _values[(_index + N - 1) % N]; }
+
+private:
+    float _values[N];
+    float _sum;
+    size_t _index;
+};
+
+// Background energy level: follows quieter frames down quickly and creeps
+// up slowly, so a word barely moves it but a fan switched on is learned
+class NoiseFloor {
+public:
+    NoiseFloor(float fallRate, float riseRate)
+        : _fallRate(fallRate), _riseRate(riseRate), _level(0) {}
+
+    void reset() { _level = 0; }
+
+    void update(float energy) {
+        if (_level <= 0) {
+            _level = energy;
+            return;
+        }
+        float rate = energy < _level ? _fallRate : _riseRate;
+        _level += (energy - _level) * rate;
+    }
+
+    float get() const { return _level; }
+
+private:
+    float _fallRate;
+    float _riseRate;
+    float _level;
+};
+
+// Energy threshold as WakeWordDetector::updateThreshold() derives it
+float adaptiveThreshold(float base, const NoiseFloor& floor, float margin) {
+    return fmaxf(base, floor.get() * margin);
+}
+
 // ============================================================================
 // Test Helper Functions
 // ============================================================================
@@ -378,6 +443,87 @@ void test_pattern_no_false_trigger_on_noise() {
     }
 }
 
+// ============================================================================
+// Running Statistics Tests
+// ============================================================================
+
+void test_running_mean_counts_unfilled_slots_as_zero() {
+    RunningMean<32> mean;
+    mean.push(320.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 10.0f, mean.mean());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 320.0f, mean.latest());
+}
+
+void test_running_mean_matches_full_sum() {
+    RunningMean<32> mean;
+    float values[1000];
+    uint32_t seed = 12345;
+    for (int i = 0; i < 1000; i++) {
+        seed = seed * 1103515245 + 12345;
+        values[i] = (seed >> 16) % 5000;
+        mean.push(values[i]);
+
+        // Same result as summing the last 32 values every frame
+        float sum = 0;
+        for (int j = i; j > i - 32 && j >= 0; j--) sum += values[j];
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, sum / 32, mean.mean());
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, values[i], mean.latest());
+    }
+}
+
+void test_running_mean_reset() {
+    RunningMean<32> mean;
+    for (int i = 0; i < 40; i++) mean.push(1000.0f);
+    mean.reset();
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, mean.mean());
+}
+
+void test_noise_floor_starts_at_first_frame() {
+    NoiseFloor floor(0.1f, 0.004f);
+    floor.update(250.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 250.0f, floor.get());
+}
+
+void test_noise_floor_falls_quickly() {
+    NoiseFloor floor(0.1f, 0.004f);
+    floor.update(1000.0f);
+    for (int i = 0; i < 31; i++) floor.update(100.0f);  // ~1 s of quiet
+    TEST_ASSERT_LESS_THAN(150.0f, floor.get());
+}
+
+void test_noise_floor_ignores_short_bursts() {
+    NoiseFloor floor(0.1f, 0.004f);
+    floor.update(100.0f);
+    for (int i = 0; i < 25; i++) floor.update(3000.0f);  // ~0.8 s word
+    TEST_ASSERT_LESS_THAN(500.0f, floor.get());
+}
+
+void test_noise_floor_learns_louder_background() {
+    NoiseFloor floor(0.1f, 0.004f);
+    floor.update(100.0f);
+    for (int i = 0; i < 31 * 30; i++) floor.update(600.0f);  // Fan on for 30 s
+    TEST_ASSERT_FLOAT_WITHIN(20.0f, 600.0f, floor.get());
+}
+
+void test_adaptive_threshold_rises_with_noise() {
+    NoiseFloor floor(0.1f, 0.004f);
+
+    // Quiet room: the fixed threshold still applies
+    floor.update(50.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 533.0f, adaptiveThreshold(533.0f, floor, 3.0f));
+
+    // Noisy room: energies that used to trigger are now below threshold
+    for (int i = 0; i < 31 * 30; i++) floor.update(400.0f);
+    float threshold = adaptiveThreshold(533.0f, floor, 3.0f);
+    TEST_ASSERT_GREATER_THAN(1100.0f, threshold);
+
+    WakeWordState state;
+    state.energyThreshold = threshold;
+    for (int i = 0; i < 50; i++) {
+        TEST_ASSERT_FALSE(processFrame(state, 900.0f, 0.08f, 400.0f));
+    }
+}
+
 // ============================================================================
 // Integration Tests
 // ============================================================================
@@ -459,6 +605,16 @@ int main(int argc, char** argv) {
     RUN_TEST(test_pattern_resets_on_high_zcr);
     RUN_TEST(test_pattern_no_false_trigger_on_noise);
 
+    // Running statistics tests
+    RUN_TEST(test_running_mean_counts_unfilled_slots_as_zero);
+    RUN_TEST(test_running_mean_matches_full_sum);
+    RUN_TEST(test_running_mean_reset);
+    RUN_TEST(test_noise_floor_starts_at_first_frame);
+    RUN_TEST(test_noise_floor_falls_quickly);
+    RUN_TEST(test_noise_floor_ignores_short_bursts);
+    RUN_TEST(test_noise_floor_learns_louder_background);
+    RUN_TEST(test_adaptive_threshold_rises_with_noise);
+
     // Integration tests
     RUN_TEST(test_realistic_wake_word_audio);
 